@@ -70,6 +70,8 @@ set(SUNSHINE_TARGET_FILES
         "${CMAKE_SOURCE_DIR}/src/config.cpp"
         "${CMAKE_SOURCE_DIR}/src/display_device.h"
         "${CMAKE_SOURCE_DIR}/src/display_device.cpp"
+        "${CMAKE_SOURCE_DIR}/src/encode_scheduler.cpp"
+        "${CMAKE_SOURCE_DIR}/src/encode_scheduler.h"
         "${CMAKE_SOURCE_DIR}/src/entry_handler.cpp"
         "${CMAKE_SOURCE_DIR}/src/entry_handler.h"
         "${CMAKE_SOURCE_DIR}/src/file_handler.cpp"
@@ -82,14 +84,30 @@ set(SUNSHINE_TARGET_FILES
         "${CMAKE_SOURCE_DIR}/src/main.h"
         "${CMAKE_SOURCE_DIR}/src/crypto.cpp"
         "${CMAKE_SOURCE_DIR}/src/crypto.h"
+        "${CMAKE_SOURCE_DIR}/src/congestion_controller.cpp"
+        "${CMAKE_SOURCE_DIR}/src/congestion_controller.h"
+        "${CMAKE_SOURCE_DIR}/src/arena.cpp"
+        "${CMAKE_SOURCE_DIR}/src/arena.h"
+        "${CMAKE_SOURCE_DIR}/src/fec.cpp"
+        "${CMAKE_SOURCE_DIR}/src/fec.h"
+        "${CMAKE_SOURCE_DIR}/src/fec_controller.cpp"
+        "${CMAKE_SOURCE_DIR}/src/fec_controller.h"
+        "${CMAKE_SOURCE_DIR}/src/frame_deadline.cpp"
+        "${CMAKE_SOURCE_DIR}/src/frame_deadline.h"
         "${CMAKE_SOURCE_DIR}/src/nvhttp.cpp"
         "${CMAKE_SOURCE_DIR}/src/nvhttp.h"
         "${CMAKE_SOURCE_DIR}/src/httpcommon.cpp"
         "${CMAKE_SOURCE_DIR}/src/httpcommon.h"
+        "${CMAKE_SOURCE_DIR}/src/xml_writer.cpp"
+        "${CMAKE_SOURCE_DIR}/src/xml_writer.h"
         "${CMAKE_SOURCE_DIR}/src/confighttp.cpp"
         "${CMAKE_SOURCE_DIR}/src/confighttp.h"
+        "${CMAKE_SOURCE_DIR}/src/static_assets.cpp"
+        "${CMAKE_SOURCE_DIR}/src/static_assets.h"
         "${CMAKE_SOURCE_DIR}/src/rtsp.cpp"
         "${CMAKE_SOURCE_DIR}/src/rtsp.h"
+        "${CMAKE_SOURCE_DIR}/src/nal.cpp"
+        "${CMAKE_SOURCE_DIR}/src/nal.h"
         "${CMAKE_SOURCE_DIR}/src/stream.cpp"
         "${CMAKE_SOURCE_DIR}/src/stream.h"
         "${CMAKE_SOURCE_DIR}/src/video.cpp"
@@ -153,4 +171,5 @@ list(APPEND SUNSHINE_EXTERNAL_LIBRARIES
         ${FFMPEG_LIBRARIES}
         ${Boost_LIBRARIES}
         ${OPENSSL_LIBRARIES}
+        ZLIB::ZLIB
         ${PLATFORM_LIBRARIES})
@@ -119,6 +119,7 @@ function add_debain_based_deps() {
     "udev"
     "wget"  # necessary for cuda install with `run` file
     "xvfb"  # necessary for headless unit testing
+    "zlib1g-dev"
   )
 
   if [ "$skip_libva" == 0 ]; then
@@ -181,6 +182,7 @@ function add_fedora_deps() {
     "wget"  # necessary for cuda install with `run` file
     "which"  # necessary for cuda install with `run` file
     "xorg-x11-server-Xvfb"  # necessary for headless unit testing
+    "zlib-devel"
   )
 
   if [ "$skip_libva" == 0 ]; then
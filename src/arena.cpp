@@ -0,0 +1,90 @@
+/**
+ * @file src/arena.cpp
+ * @brief Definitions for a monotonic allocator of short-lived buffers.
+ */
+// standard includes
+#include <algorithm>
+#include <new>
+
+// local includes
+#include "arena.h"
+
+namespace arena {
+  namespace {
+    std::size_t
+    align_up(std::size_t size) {
+      return (size + (arena_t::alignment - 1)) & ~(arena_t::alignment - 1);
+    }
+  }  // namespace
+
+  arena_t::arena_t(std::size_t capacity) {
+    if (capacity) {
+      _capacity = align_up(capacity);
+      _block = allocate_block(_capacity);
+    }
+  }
+
+  arena_t::~arena_t() {
+    for (auto block : _overflow) {
+      free_block(block);
+    }
+
+    free_block(_block);
+  }
+
+  void *
+  arena_t::allocate_bytes(std::size_t size) {
+    size = align_up(std::max<std::size_t>(size, 1));
+
+    _allocated += size;
+    _high_water = std::max(_high_water, _allocated);
+
+    if (_capacity - _used >= size) {
+      auto data = _block + _used;
+      _used += size;
+
+      return data;
+    }
+
+    // Overflow gets a block of its own until the next reset. Make room for it first,
+    // so the block isn't leaked if that throws.
+    if (_overflow.size() == _overflow.capacity()) {
+      _overflow.reserve(std::max<std::size_t>(8, _overflow.capacity() * 2));
+    }
+    return _overflow.emplace_back(allocate_block(size));
+  }
+
+  void
+  arena_t::reset() {
+    _used = 0;
+    _allocated = 0;
+
+    if (_overflow.empty()) {
+      return;
+    }
+
+    for (auto block : _overflow) {
+      free_block(block);
+    }
+    _overflow.clear();
+
+    // Leave some headroom, so a slowly growing workload doesn't grow the block every cycle
+    free_block(_block);
+    _capacity = align_up(_high_water + _high_water / 4);
+    _block = allocate_block(_capacity);
+  }
+
+  std::byte *
+  arena_t::allocate_block(std::size_t size) {
+    ++_heap_allocations;
+
+    return (std::byte *) ::operator new(size, std::align_val_t { alignment });
+  }
+
+  void
+  arena_t::free_block(std::byte *block) {
+    if (block) {
+      ::operator delete(block, std::align_val_t { alignment });
+    }
+  }
+}  // namespace arena
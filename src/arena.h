@@ -0,0 +1,120 @@
+/**
+ * @file src/arena.h
+ * @brief Declarations for a monotonic allocator of short-lived buffers.
+ */
+#pragma once
+
+// standard includes
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Allocates the buffers of a work cycle, such as a video frame, without going to the heap.
+ */
+namespace arena {
+  /**
+   * @brief A monotonic allocator of buffers that live until the next reset.
+   * @details Allocations are bumped from a single block. If a cycle needs more than that, the
+   * overflow comes from extra blocks, and the next `reset()` replaces all of them with a single
+   * block sized from the high-water mark. A steady workload stops allocating after its largest cycle.
+   */
+  class arena_t {
+  public:
+    /**
+     * @brief The alignment of every allocation, a cache line.
+     */
+    static constexpr std::size_t alignment = 64;
+
+    /**
+     * @brief Create an arena.
+     * @param capacity The size of the initial block, or 0 to allocate it on first use.
+     */
+    explicit arena_t(std::size_t capacity = 0);
+
+    ~arena_t();
+
+    arena_t(const arena_t &) = delete;
+    arena_t &
+    operator=(const arena_t &) = delete;
+
+    /**
+     * @brief Allocate uninitialized storage that lives until the next `reset()`.
+     * @param size The number of bytes.
+     * @return The storage, aligned to `alignment`.
+     */
+    void *
+    allocate_bytes(std::size_t size);
+
+    /**
+     * @brief Allocate an uninitialized array that lives until the next `reset()`.
+     * @param count The number of elements.
+     * @return The array.
+     */
+    template <class T>
+    std::span<T>
+    allocate(std::size_t count) {
+      static_assert(std::is_trivially_destructible_v<T>, "Nothing in an arena is destroyed");
+      static_assert(alignof(T) <= alignment);
+
+      if (!count) {
+        return {};
+      }
+
+      return { (T *) allocate_bytes(count * sizeof(T)), count };
+    }
+
+    /**
+     * @brief Release everything allocated since the last reset.
+     * @details If the last cycle overflowed, the block grows to fit it in one piece.
+     */
+    void
+    reset();
+
+    /**
+     * @brief Get the size of the block allocations are bumped from.
+     * @return The capacity in bytes.
+     */
+    std::size_t
+    capacity() const {
+      return _capacity;
+    }
+
+    /**
+     * @brief Get the most bytes that were allocated within a single cycle.
+     * @return The high-water mark in bytes.
+     */
+    std::size_t
+    high_water() const {
+      return _high_water;
+    }
+
+    /**
+     * @brief Get the number of times the arena went to the heap for more memory.
+     * @return The count since the arena was created.
+     */
+    std::size_t
+    heap_allocations() const {
+      return _heap_allocations;
+    }
+
+  private:
+    std::byte *
+    allocate_block(std::size_t size);
+
+    static void
+    free_block(std::byte *block);
+
+    std::byte *_block = nullptr;
+    std::size_t _capacity = 0;
+    std::size_t _used = 0;
+
+    // The blocks of the allocations that didn't fit this cycle
+    std::vector<std::byte *> _overflow;
+    std::size_t _allocated = 0;
+
+    std::size_t _high_water = 0;
+    std::size_t _heap_allocations = 0;
+  };
+}  // namespace arena
@@ -423,6 +423,8 @@ namespace config {
     0,  // av1_mode
 
     2,  // min_threads
+    "idr"s,  // recovery_mode
+    30,  // intra_refresh_frames
     {
       "superfast"s,  // preset
       "zerolatency"s,  // tune
@@ -503,6 +505,17 @@ namespace config {
 
     20,  // fecPercentage
 
+    false,  // adaptive_fec
+    5,  // fec_percentage_min
+    50,  // fec_percentage_max
+    "auto"s,  // fec_kernel
+
+    1000,  // pacing_link_rate
+    false,  // kernel_pacing
+
+    false,  // adaptive_bitrate
+    25,  // adaptive_bitrate_min
+
     ENCRYPTION_MODE_NEVER,  // lan_encryption_mode
     ENCRYPTION_MODE_OPPORTUNISTIC,  // wan_encryption_mode
   };
@@ -1093,6 +1106,8 @@ namespace config {
     int_between_f(vars, "hevc_mode", video.hevc_mode, { 0, 3 });
     int_between_f(vars, "av1_mode", video.av1_mode, { 0, 3 });
     int_f(vars, "min_threads", video.min_threads);
+    string_restricted_f(vars, "recovery_mode", video.recovery_mode, { "idr"sv, "intra_refresh"sv });
+    int_between_f(vars, "intra_refresh_frames", video.intra_refresh_frames, { 2, 600 });
     string_f(vars, "sw_preset", video.sw.sw_preset);
     if (!video.sw.sw_preset.empty()) {
       video.sw.svtav1_preset = sw::svtav1_preset_from_view(video.sw.sw_preset);
@@ -1108,6 +1123,7 @@ namespace config {
     bool_f(vars, "nvenc_realtime_hags", video.nv_realtime_hags);
     bool_f(vars, "nvenc_opengl_vulkan_on_dxgi", video.nv_opengl_vulkan_on_dxgi);
     bool_f(vars, "nvenc_latency_over_power", video.nv_sunshine_high_power_mode);
+    video.nv.recovery_intra_refresh_frames = video.recovery_mode == "intra_refresh"sv ? video.intra_refresh_frames : 0;
 
 #ifndef __APPLE__
     video.nv_legacy.preset = video.nv.quality_preset + 11;
@@ -1216,6 +1232,18 @@ namespace config {
 
     path_f(vars, "file_apps", stream.file_apps);
     int_between_f(vars, "fec_percentage", stream.fec_percentage, { 1, 255 });
+    bool_f(vars, "adaptive_fec", stream.adaptive_fec);
+    int_between_f(vars, "fec_percentage_min", stream.fec_percentage_min, { 1, 255 });
+    int_between_f(vars, "fec_percentage_max", stream.fec_percentage_max, { 1, 255 });
+    if (stream.fec_percentage_max < stream.fec_percentage_min) {
+      BOOST_LOG(warning) << "fec_percentage_max is lower than fec_percentage_min, using "sv << stream.fec_percentage_min << " for both"sv;
+      stream.fec_percentage_max = stream.fec_percentage_min;
+    }
+    string_restricted_f(vars, "fec_kernel", stream.fec_kernel, { "auto"sv, "gfni_avx512"sv, "gfni_avx2"sv, "avx512"sv, "avx2"sv, "ssse3"sv, "default"sv });
+    int_between_f(vars, "pacing_link_rate", stream.pacing_link_rate, { 1, 100000 });
+    bool_f(vars, "kernel_pacing", stream.kernel_pacing);
+    bool_f(vars, "adaptive_bitrate", stream.adaptive_bitrate);
+    int_between_f(vars, "adaptive_bitrate_min", stream.adaptive_bitrate_min, { 1, 100 });
 
     map_int_int_f(vars, "keybindings"s, input.keybindings);
 
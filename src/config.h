@@ -23,6 +23,8 @@ namespace config {
     int av1_mode;
 
     int min_threads;  // Minimum number of threads/slices for CPU encoding
+    std::string recovery_mode;  // How to recover from lost frames, "idr" or "intra_refresh"
+    int intra_refresh_frames;  // The number of frames an intra refresh wave is spread over
     struct {
       std::string sw_preset;
       std::string sw_tune;
@@ -157,6 +159,25 @@ namespace config {
 
     int fec_percentage;
 
+    // Adapt the FEC percentage of each session to its packet loss, within these bounds
+    bool adaptive_fec;
+    int fec_percentage_min;
+    int fec_percentage_max;
+
+    // The RS variant that computes parity shards, or "auto" to use the fastest one on this CPU
+    std::string fec_kernel;
+
+    // The rate video is paced to, in Mbps
+    int pacing_link_rate;
+
+    // Let the kernel pace video packets by their departure time instead of sleeping between batches
+    bool kernel_pacing;
+
+    // Lower the video bitrate of a session when its network path is congested,
+    // down to this percentage of the bitrate the client asked for
+    bool adaptive_bitrate;
+    int adaptive_bitrate_min;
+
     // Video encryption settings for LAN and WAN streams
     int lan_encryption_mode;
     int wan_encryption_mode;
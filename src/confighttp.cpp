@@ -8,7 +8,10 @@
 
 #include "process.h"
 
+#include <algorithm>
+#include <charconv>
 #include <filesystem>
+#include <mutex>
 #include <set>
 
 #include <boost/property_tree/json_parser.hpp>
@@ -37,6 +40,7 @@
 #include "nvhttp.h"
 #include "platform/common.h"
 #include "rtsp.h"
+#include "static_assets.h"
 #include "utility.h"
 #include "uuid.h"
 #include "version.h"
@@ -57,6 +61,9 @@ namespace confighttp {
   std::string sessionCookie;
   static std::chrono::time_point<std::chrono::steady_clock> cookie_creation_time;
 
+  // Loaded once at startup, the Web UI files don't change while running
+  static static_assets::asset_table_t web_assets;
+
   enum class op_e {
     ADD,  ///< Add client
     REMOVE  ///< Remove client
@@ -248,6 +255,55 @@ namespace confighttp {
     response->write(code, data.str(), headers);
   }
 
+  /**
+   * @brief Send a file from the in-memory web asset table.
+   * @param response The HTTP response object.
+   * @param request The HTTP request object.
+   * @param path The path of the file relative to the web directory.
+   * @param headers Additional headers, a `Content-Type` given here overrides the asset's.
+   * @return `false` if the file isn't in the asset table and nothing was sent.
+   */
+  bool
+  send_asset(resp_https_t response, req_https_t request, std::string_view path, SimpleWeb::CaseInsensitiveMultimap headers = {}) {
+    auto asset = web_assets.find(path);
+    if (!asset) {
+      return false;
+    }
+
+    std::string_view accept_encoding;
+    if (auto it = request->header.find("Accept-Encoding"); it != request->header.end()) {
+      accept_encoding = it->second;
+    }
+
+    auto encoding = static_assets::negotiate(*asset, accept_encoding);
+    auto etag = asset->etag_for(encoding);
+
+    headers.emplace("ETag", etag);
+    headers.emplace("Vary", "Accept-Encoding");
+    // Hashed assets never change under the same name, everything else is revalidated against its ETag
+    headers.emplace("Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+
+    auto if_none_match = request->header.find("If-None-Match");
+    if (if_none_match != request->header.end() && static_assets::etag_matches(if_none_match->second, etag)) {
+      response->write(SimpleWeb::StatusCode::redirection_not_modified, headers);
+      return true;
+    }
+
+    if (encoding == static_assets::encoding_e::gzip) {
+      headers.emplace("Content-Encoding", "gzip");
+    }
+    else if (encoding == static_assets::encoding_e::brotli) {
+      headers.emplace("Content-Encoding", "br");
+    }
+
+    if (headers.find("Content-Type") == headers.end()) {
+      headers.emplace("Content-Type", asset->content_type);
+    }
+
+    response->write(SimpleWeb::StatusCode::success_ok, asset->body(encoding), headers);
+    return true;
+  }
+
   /**
    * @brief Get the index page.
    * @param response The HTTP response object.
@@ -262,11 +318,15 @@ namespace confighttp {
 
     print_req(request);
 
-    std::string content = file_handler::read_file((WEB_DIR + page).c_str());
     const SimpleWeb::CaseInsensitiveMultimap headers {
       { "Content-Type", "text/html; charset=utf-8" },
       { "Access-Control-Allow-Origin", "https://images.igdb.com/"}
     };
+    if (send_asset(response, request, page, headers)) {
+      return;
+    }
+
+    std::string content = file_handler::read_file((WEB_DIR + page).c_str());
     response->write(content, headers);
   };
 
@@ -378,6 +438,10 @@ namespace confighttp {
 
     print_req(request);
 
+    if (send_asset(response, request, "images/apollo.ico")) {
+      return;
+    }
+
     std::ifstream in(WEB_DIR "images/apollo.ico", std::ios::binary);
     const SimpleWeb::CaseInsensitiveMultimap headers {
       { "Content-Type", "image/x-icon" }
@@ -400,6 +464,10 @@ namespace confighttp {
 
     print_req(request);
 
+    if (send_asset(response, request, "images/logo-apollo-45.png")) {
+      return;
+    }
+
     std::ifstream in(WEB_DIR "images/logo-apollo-45.png", std::ios::binary);
     const SimpleWeb::CaseInsensitiveMultimap headers {
       { "Content-Type", "image/png" }
@@ -449,6 +517,10 @@ namespace confighttp {
     }
 
     auto relPath = fs::relative(filePath, webDirPath);
+    if (send_asset(response, request, relPath.generic_string())) {
+      return;
+    }
+
     // get the mime type from the file extension mime_types map
     // remove the leading period from the extension
     auto mimeType = mime_types.find(relPath.extension().string().substr(1));
@@ -485,12 +557,37 @@ namespace confighttp {
     response->write(content, headers);
   }
 
+  /**
+   * @brief Get the minimum log level requested by the `level` query parameter.
+   * @param args The parsed query string.
+   * @return The requested log level, or `0` (verbose) if absent or invalid.
+   */
+  int
+  get_log_level_arg(const args_t &args) {
+    auto it = args.find("level");
+    if (it == std::end(args)) {
+      return 0;
+    }
+
+    int min_log_level = 0;
+    auto &value = it->second;
+    std::from_chars(value.data(), value.data() + value.size(), min_log_level);
+    return std::clamp(min_log_level, 0, 5);
+  }
+
   /**
    * @brief Get the logs from the log file.
    * @param response The HTTP response object.
    * @param request The HTTP request object.
    *
-   * @api_examples{/api/logs| GET| null}
+   * Only a bounded range of the log file is read and sent per request.
+   * Without an `offset` the last `LOG_CHUNK_MAX` bytes are returned, starting at a line boundary.
+   * With `offset` the log is returned from that byte offset, as given by the previous response.
+   * The response ends on a complete line, the `X-Log-Offset` header holds the offset to request next.
+   * If the log was rotated since the offset was obtained, the tail is returned and `X-Log-Reset` is set.
+   * The optional `level` parameter (0 = verbose ... 5 = fatal) filters records by severity.
+   *
+   * @api_examples{/api/logs?offset=1024&level=3| GET| null}
    */
   void
   getLogs(resp_https_t response, req_https_t request) {
@@ -498,13 +595,229 @@ namespace confighttp {
 
     print_req(request);
 
-    std::string content = file_handler::read_file(config::sunshine.log_file.c_str());
-    const SimpleWeb::CaseInsensitiveMultimap headers {
-      { "Content-Type", "text/plain" }
+    auto &log_file = config::sunshine.log_file;
+    auto args = request->parse_query_string();
+
+    std::error_code ec;
+    std::uintmax_t log_size = fs::file_size(log_file, ec);
+    if (ec) {
+      log_size = 0;
+    }
+
+    auto tail_offset = log_size > LOG_CHUNK_MAX ? log_size - LOG_CHUNK_MAX : 0;
+
+    std::uintmax_t offset = tail_offset;
+    bool reset = false;
+    if (auto it = args.find("offset"); it != std::end(args)) {
+      auto &value = it->second;
+      auto [ptr, errc] = std::from_chars(value.data(), value.data() + value.size(), offset);
+      if (errc != std::errc {} || ptr != value.data() + value.size()) {
+        bad_request(response, request, "Invalid log offset");
+        return;
+      }
+
+      if (offset > log_size) {
+        offset = tail_offset;
+        reset = true;
+      }
+    }
+    else {
+      reset = true;
+    }
+
+    std::string content = file_handler::read_file_range(log_file.c_str(), offset, LOG_CHUNK_MAX);
+
+    // The tail starts at an arbitrary byte, skip to the first complete line.
+    // That line may be longer than a chunk, so keep reading until it ends.
+    if (reset && offset > 0) {
+      while (true) {
+        auto pos = content.find('\n');
+        if (pos != std::string::npos) {
+          content.erase(0, pos + 1);
+          offset += pos + 1;
+          break;
+        }
+
+        offset += content.size();
+        if (content.size() < LOG_CHUNK_MAX) {
+          // The log ends in the middle of the line
+          content.clear();
+          break;
+        }
+
+        content = file_handler::read_file_range(log_file.c_str(), offset, LOG_CHUNK_MAX);
+      }
+    }
+
+    // Don't send a line that is still being written, unless a single line fills the whole chunk
+    if (auto pos = content.rfind('\n'); pos != std::string::npos) {
+      content.resize(pos + 1);
+    }
+    else if (content.size() < LOG_CHUNK_MAX) {
+      content.clear();
+    }
+
+    auto next_offset = offset + content.size();
+
+    auto min_log_level = get_log_level_arg(args);
+    if (min_log_level > 0) {
+      content = logging::filter_log_level(content, min_log_level);
+    }
+
+    SimpleWeb::CaseInsensitiveMultimap headers {
+      { "Content-Type", "text/plain" },
+      { "Cache-Control", "no-store" },
+      { "X-Log-Offset", std::to_string(next_offset) },
+      { "X-Log-Size", std::to_string(log_size) },
     };
+    if (reset) {
+      headers.emplace("X-Log-Reset", "true");
+    }
     response->write(SimpleWeb::StatusCode::success_ok, content, headers);
   }
 
+  /**
+   * @brief A server-sent events stream of new log records for a single Web UI client.
+   */
+  class log_stream_t: public std::enable_shared_from_this<log_stream_t> {
+  public:
+    log_stream_t(resp_https_t response, int min_log_level):
+        response { std::move(response) }, min_log_level { min_log_level } {}
+
+    /**
+     * @brief Send the response header and start forwarding log records.
+     */
+    void
+    start() {
+      {
+        std::lock_guard lg { mutex };
+        const SimpleWeb::CaseInsensitiveMultimap headers {
+          { "Content-Type", "text/event-stream" },
+          { "Cache-Control", "no-store" }
+        };
+        response->write(SimpleWeb::StatusCode::success_ok, headers);
+        response->send();
+      }
+
+      std::weak_ptr<log_stream_t> weak_self = shared_from_this();
+      auto listener = logging::add_log_listener([weak_self](int log_level, const std::string &line) {
+        if (auto self = weak_self.lock()) {
+          self->push(log_level, line);
+        }
+      });
+
+      std::lock_guard lg { mutex };
+      this->listener = std::move(listener);
+    }
+
+    /**
+     * @brief Stop forwarding log records and release the connection.
+     */
+    void
+    stop() {
+      std::unique_ptr<logging::log_listener_t> listener;
+      {
+        std::lock_guard lg { mutex };
+        listener = std::move(this->listener);
+        response.reset();
+      }
+
+      // Unregister outside of our lock, the thread feeding the log listeners may be waiting on it inside push()
+      listener.reset();
+
+      std::lock_guard lg { log_streams_mutex };
+      log_streams.erase(shared_from_this());
+    }
+
+    static inline std::mutex log_streams_mutex;
+    static inline std::set<std::shared_ptr<log_stream_t>> log_streams;
+
+  private:
+    /**
+     * @brief Queue a log record to the client.
+     * @note Called on the thread that feeds the log listeners, so it must neither block the other listeners
+     * nor unregister the listener.
+     */
+    void
+    push(int log_level, const std::string &line) {
+      std::lock_guard lg { mutex };
+      if (!response || overflowed || log_level < min_log_level) {
+        return;
+      }
+
+      // A client that can't keep up is disconnected, it reconnects and backfills from /api/logs
+      if (pending_bytes > LOG_STREAM_MAX_PENDING) {
+        overflowed = true;
+        return;
+      }
+
+      std::string event;
+      event.reserve(line.size() + 16);
+      std::string_view rest = line;
+      while (!rest.empty()) {
+        auto end = rest.find('\n');
+        event += "data: "sv;
+        event += rest.substr(0, end);
+        event += '\n';
+        rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+      }
+      event += '\n';
+
+      pending_bytes += event.size();
+      *response << event;
+
+      std::weak_ptr<log_stream_t> weak_self = shared_from_this();
+      response->send([weak_self, size = event.size()](const SimpleWeb::error_code &ec) {
+        auto self = weak_self.lock();
+        if (!self) {
+          return;
+        }
+
+        bool done;
+        {
+          std::lock_guard lg { self->mutex };
+          self->pending_bytes -= size;
+          done = ec || self->overflowed;
+        }
+
+        if (done) {
+          self->stop();
+        }
+      });
+    }
+
+    std::mutex mutex;
+    resp_https_t response;
+    int min_log_level;
+    std::size_t pending_bytes = 0;
+    bool overflowed = false;
+    std::unique_ptr<logging::log_listener_t> listener;
+  };
+
+  /**
+   * @brief Stream new log records as server-sent events.
+   * @param response The HTTP response object.
+   * @param request The HTTP request object.
+   *
+   * Records are pushed from the logging sink as they are emitted, without reading the log file.
+   * The optional `level` parameter (0 = verbose ... 5 = fatal) filters records by severity.
+   *
+   * @api_examples{/api/logs/stream?level=2| GET| null}
+   */
+  void
+  getLogsStream(resp_https_t response, req_https_t request) {
+    if (!authenticate(response, request)) return;
+
+    print_req(request);
+
+    auto stream = std::make_shared<log_stream_t>(response, get_log_level_arg(request->parse_query_string()));
+    {
+      std::lock_guard lg { log_stream_t::log_streams_mutex };
+      log_stream_t::log_streams.emplace(stream);
+    }
+    stream->start();
+  }
+
   /**
    * @brief Save an application. To save a new application the index must be `-1`. To update an existing application, you must provide the current index of the application.
    * @param response The HTTP response object.
@@ -1224,6 +1537,34 @@ namespace confighttp {
     send_response(response, outputTree);
   }
 
+  /**
+   * @brief Get the TLS connection counters of the GameStream HTTPS server.
+   * @param response The HTTP response object.
+   * @param request The HTTP request object.
+   * @details The resumption rate is the share of handshakes that resumed an earlier TLS session,
+   * the keep-alive rate the share of requests that reused the connection of an earlier request.
+   *
+   * @api_examples{/api/clients/tls-stats| GET| null}
+   */
+  void
+  getTlsStats(resp_https_t response, req_https_t request) {
+    if (!authenticate(response, request)) return;
+
+    print_req(request);
+
+    auto stats = nvhttp::get_tls_stats();
+
+    pt::ptree outputTree;
+    outputTree.put("handshakes", stats.handshakes);
+    outputTree.put("resumed_handshakes", stats.resumed_handshakes);
+    outputTree.put("resumption_rate", stats.handshakes ? (double) stats.resumed_handshakes / stats.handshakes : 0.0);
+    outputTree.put("handshakes_per_second", stats.handshakes_per_second);
+    outputTree.put("requests", stats.requests);
+    outputTree.put("keep_alive_rate", stats.requests ? (double) stats.kept_alive_requests / stats.requests : 0.0);
+    outputTree.put("status", true);
+    send_response(response, outputTree);
+  }
+
   /**
    * @brief Close the currently running application.
    * @param response The HTTP response object.
@@ -1251,6 +1592,8 @@ namespace confighttp {
     auto port_https = net::map_port(PORT_HTTPS);
     auto address_family = net::af_from_enum_string(config::sunshine.address_family);
 
+    web_assets.load(WEB_DIR);
+
     https_server_t server { config::nvhttp.cert, config::nvhttp.pkey };
     server.default_resource["DELETE"] = [](resp_https_t response, req_https_t request) {
       bad_request(response, request);
@@ -1282,6 +1625,7 @@ namespace confighttp {
     server.resource["^/api/apps/launch$"]["POST"] = launchApp;
     server.resource["^/api/apps/close$"]["POST"] = closeApp;
     server.resource["^/api/logs$"]["GET"] = getLogs;
+    server.resource["^/api/logs/stream$"]["GET"] = getLogsStream;
     server.resource["^/api/config$"]["GET"] = getConfig;
     server.resource["^/api/config$"]["POST"] = saveConfig;
     server.resource["^/api/configLocale$"]["GET"] = getLocale;
@@ -1291,6 +1635,7 @@ namespace confighttp {
     server.resource["^/api/password$"]["POST"] = savePassword;
     server.resource["^/api/clients/unpair-all$"]["POST"] = unpairAll;
     server.resource["^/api/clients/list$"]["GET"] = listClients;
+    server.resource["^/api/clients/tls-stats$"]["GET"] = getTlsStats;
     server.resource["^/api/clients/update$"]["POST"] = updateClient;
     server.resource["^/api/clients/unpair$"]["POST"] = unpair;
     server.resource["^/api/clients/disconnect$"]["POST"] = disconnect;
@@ -1326,6 +1671,16 @@ namespace confighttp {
 
     server.stop();
 
+    // Log streams keep their responses alive until they are explicitly stopped
+    std::set<std::shared_ptr<log_stream_t>> log_streams;
+    {
+      std::lock_guard lg { log_stream_t::log_streams_mutex };
+      log_streams = log_stream_t::log_streams;
+    }
+    for (auto &stream : log_streams) {
+      stream->stop();
+    }
+
     tcp.join();
   }
 }  // namespace confighttp
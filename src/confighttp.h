@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <chrono>
+#include <cstddef>
 #include <string>
 
 #include "thread_safe.h"
@@ -17,6 +18,8 @@ using namespace std::chrono_literals;
 namespace confighttp {
   constexpr auto PORT_HTTPS = 1;
   constexpr auto SESSION_EXPIRE_DURATION = 24h * 15;
+  constexpr std::size_t LOG_CHUNK_MAX = 1024 * 1024;  ///< Maximum number of log bytes sent per /api/logs request
+  constexpr std::size_t LOG_STREAM_MAX_PENDING = 256 * 1024;  ///< Unsent bytes after which a log stream client is dropped
   void
   start();
 }  // namespace confighttp
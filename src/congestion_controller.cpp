@@ -0,0 +1,145 @@
+/**
+ * @file src/congestion_controller.cpp
+ * @brief Definitions for the per-session congestion controller that picks the video bitrate.
+ */
+// standard includes
+#include <algorithm>
+#include <cmath>
+
+// local includes
+#include "congestion_controller.h"
+
+using namespace std::literals;
+
+namespace stream::congestion {
+  // The path's baseline round trip time is the lowest one seen over this window
+  constexpr auto base_rtt_window_length = 10s;
+
+  controller_t::controller_t(int max_bitrate, int min_bitrate, clock::time_point now):
+      max_bitrate { max_bitrate },
+      min_bitrate { std::clamp(min_bitrate, 1, max_bitrate) },
+      target { (double) max_bitrate },
+      reported { max_bitrate },
+      base_rtt { std::chrono::milliseconds::max(), std::chrono::milliseconds::max() },
+      base_rtt_window { now },
+      last_update { now },
+      hold_until { now } {}
+
+  void
+  controller_t::sent(std::size_t packets, int batches, int short_batches) {
+    std::lock_guard lg { lock };
+
+    packets_sent += packets;
+    batches_sent += batches;
+    short_batches_sent += short_batches;
+  }
+
+  void
+  controller_t::loss_stats(int lost_packets) {
+    if (lost_packets <= 0) {
+      return;
+    }
+
+    std::lock_guard lg { lock };
+
+    packets_lost += lost_packets;
+  }
+
+  void
+  controller_t::frames_lost() {
+    std::lock_guard lg { lock };
+
+    ++frames_lost_count;
+  }
+
+  std::optional<int>
+  controller_t::update(std::chrono::milliseconds rtt, clock::time_point now) {
+    std::lock_guard lg { lock };
+
+    auto window = now - last_update;
+    if (window < interval) {
+      return std::nullopt;
+    }
+    last_update = now;
+
+    auto loss = packets_sent ? std::min(1.0, (double) packets_lost / packets_sent) : 0.0;
+
+    if (congested(rtt, window, now)) {
+      // Don't pile up decreases before the previous one had a chance to drain the queues
+      if (now - last_decrease >= decrease_interval) {
+        last_decrease = now;
+        ceiling = target;
+        ceiling_expiry = now + ceiling_time;
+
+        // Back off harder for heavy loss, the path has far less capacity than we're using
+        target = std::max<double>(min_bitrate, target * std::clamp(1.0 - loss, 0.5, 0.85));
+        hold_until = now + hold_time;
+      }
+    }
+    else if (now >= hold_until && target < max_bitrate) {
+      if (ceiling && now >= ceiling_expiry) {
+        ceiling.reset();
+      }
+
+      // Recover quickly while far below the bitrate that caused congestion, then approach it carefully
+      // and stay just below it until it's forgotten, so a constrained link doesn't cause a sawtooth
+      if (!ceiling) {
+        target *= 1.08;
+      }
+      else if (target < *ceiling * 0.85) {
+        target = std::min(target * 1.08, *ceiling * 0.85);
+      }
+      else {
+        target = std::max(target, std::min(target + max_bitrate * 0.005, *ceiling * 0.95));
+      }
+
+      target = std::min<double>(target, max_bitrate);
+    }
+
+    packets_sent = 0;
+    packets_lost = 0;
+    frames_lost_count = 0;
+    batches_sent = 0;
+    short_batches_sent = 0;
+
+    // Small changes aren't worth reconfiguring the encoder for, unless they reach the bounds
+    auto bitrate = (int) std::lround(target);
+    auto change = std::abs(bitrate - reported);
+    if (change == 0 || (change < reported * min_change && bitrate != max_bitrate && bitrate != min_bitrate)) {
+      return std::nullopt;
+    }
+
+    reported = bitrate;
+    return bitrate;
+  }
+
+  int
+  controller_t::current() const {
+    std::lock_guard lg { lock };
+
+    return reported;
+  }
+
+  bool
+  controller_t::congested(std::chrono::milliseconds rtt, clock::duration window, clock::time_point now) {
+    if (now - base_rtt_window >= base_rtt_window_length) {
+      base_rtt_window = now;
+      base_rtt[1] = base_rtt[0];
+      base_rtt[0] = std::chrono::milliseconds::max();
+    }
+
+    if (rtt > 0ms) {
+      base_rtt[0] = std::min(base_rtt[0], rtt);
+    }
+    auto baseline = std::min(base_rtt[0], base_rtt[1]);
+
+    auto loss = packets_sent ? (double) packets_lost / packets_sent : 0.0;
+    auto frames_lost_rate = frames_lost_count / std::chrono::duration<double>(window).count();
+    auto short_batch_share = batches_sent ? (double) short_batches_sent / batches_sent : 0.0;
+
+    return loss > loss_threshold ||
+           frames_lost_rate > frames_lost_threshold ||
+           short_batch_share > short_batch_threshold ||
+           (rtt > 0ms && rtt - baseline > delay_threshold);
+  }
+}  // namespace stream::congestion
@@ -0,0 +1,156 @@
+/**
+ * @file src/congestion_controller.h
+ * @brief Declarations for the per-session congestion controller that picks the video bitrate.
+ */
+#pragma once
+
+// standard includes
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace stream::congestion {
+  /**
+   * @brief Picks the video bitrate of a session from the congestion signals of its network path.
+   * @details Loss reports, lost frames and the control stream's round trip time arrive on the control stream thread,
+   * while the video broadcast thread reports the packets it sent, so all members are thread-safe.
+   *
+   * Every signal is a rate over the evaluation window, so a single lost packet or frame doesn't lower the bitrate.
+   * A full socket buffer only counts as the share of this session's own send batches that it held up,
+   * since the video socket is shared by all sessions.
+   *
+   * The bitrate drops multiplicatively as soon as the path shows congestion, then is held for a while.
+   * Once the path is clean, it rises quickly while it's well below the bitrate that last caused congestion
+   * and probes carefully near it. Changes smaller than `min_change` aren't reported, so encoders
+   * aren't reconfigured for every small step.
+   */
+  class controller_t {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Create a controller.
+     * @param max_bitrate The bitrate negotiated with the client in Kbps, which is never exceeded.
+     * @param min_bitrate The lowest bitrate the controller may pick in Kbps.
+     * @param now The time the stream starts.
+     */
+    controller_t(int max_bitrate, int min_bitrate, clock::time_point now);
+
+    /**
+     * @brief Account for video packets that were sent to the client.
+     * @param packets The number of data and parity packets sent.
+     * @param batches The number of batches the packets were sent in.
+     * @param short_batches The number of those batches that didn't fit into the socket's send buffer at once.
+     */
+    void
+    sent(std::size_t packets, int batches, int short_batches);
+
+    /**
+     * @brief Handle a loss report from the client.
+     * @param lost_packets The number of packets lost since the last report.
+     */
+    void
+    loss_stats(int lost_packets);
+
+    /**
+     * @brief Handle frames the client couldn't recover, i.e. a reference frame invalidation or IDR request.
+     */
+    void
+    frames_lost();
+
+    /**
+     * @brief Evaluate the signals collected since the last evaluation.
+     * @param rtt The current round trip time of the control stream.
+     * @param now The current time.
+     * @return The new bitrate in Kbps if it changed enough to be applied.
+     */
+    std::optional<int>
+    update(std::chrono::milliseconds rtt, clock::time_point now);
+
+    /**
+     * @brief Get the last bitrate reported by `update()`.
+     * @return The bitrate in Kbps.
+     */
+    int
+    current() const;
+
+    /**
+     * @brief How often the collected signals are evaluated.
+     */
+    static constexpr auto interval = std::chrono::milliseconds { 500 };
+
+    /**
+     * @brief The shortest interval between two decreases, so queues can drain before the next one is considered.
+     */
+    static constexpr auto decrease_interval = std::chrono::seconds { 1 };
+
+    /**
+     * @brief How long the bitrate is held after it was lowered before it may rise again.
+     */
+    static constexpr auto hold_time = std::chrono::seconds { 3 };
+
+    /**
+     * @brief How long the bitrate that caused congestion is remembered.
+     */
+    static constexpr auto ceiling_time = std::chrono::seconds { 30 };
+
+    /**
+     * @brief The share of lost packets that indicates congestion.
+     */
+    static constexpr double loss_threshold = 0.02;
+
+    /**
+     * @brief The number of unrecoverable frames per second that indicates congestion.
+     * @details Clients occasionally lose a frame on a clean path, e.g. to Wi-Fi interference.
+     */
+    static constexpr double frames_lost_threshold = 2.0;
+
+    /**
+     * @brief The share of a session's send batches that didn't fit into the socket buffer at once that indicates congestion.
+     * @details Another session's burst holds up a few batches of this one as well, only a sustained share counts.
+     */
+    static constexpr double short_batch_threshold = 0.25;
+
+    /**
+     * @brief The round trip time above the path's baseline that indicates a standing queue.
+     */
+    static constexpr auto delay_threshold = std::chrono::milliseconds { 40 };
+
+    /**
+     * @brief The smallest relative change of the bitrate that is reported.
+     */
+    static constexpr double min_change = 0.05;
+
+  private:
+    bool
+    congested(std::chrono::milliseconds rtt, clock::duration window, clock::time_point now);
+
+    mutable std::mutex lock;
+
+    int max_bitrate;
+    int min_bitrate;
+
+    // The bitrate picked by the controller, and the one last reported to the encoder
+    double target;
+    int reported;
+
+    // Signals collected since the last evaluation
+    std::size_t packets_sent = 0;
+    int packets_lost = 0;
+    int frames_lost_count = 0;
+    int batches_sent = 0;
+    int short_batches_sent = 0;
+
+    // The lowest round trip time of the current and the previous window
+    std::chrono::milliseconds base_rtt[2];
+    clock::time_point base_rtt_window;
+
+    // The bitrate that last caused congestion
+    std::optional<double> ceiling;
+    clock::time_point ceiling_expiry;
+
+    clock::time_point last_update;
+    clock::time_point last_decrease {};
+    clock::time_point hold_until;
+  };
+}  // namespace stream::congestion
@@ -87,23 +87,20 @@ namespace crypto {
 
   namespace cipher {
 
+    /**
+     * @brief Create a context holding the expanded key schedule, but no IV yet.
+     * @details The IV is set per packet with `set_iv()`, which keeps the key schedule.
+     * OpenSSL picks its AES-NI/VAES implementation here when the CPU supports it.
+     */
     static int
-    init_decrypt_gcm(cipher_ctx_t &ctx, aes_t *key, aes_t *iv, bool padding) {
+    init_ctx(cipher_ctx_t &ctx, const EVP_CIPHER *cipher, const aes_t &key, bool padding, int enc) {
       ctx.reset(EVP_CIPHER_CTX_new());
-
       if (!ctx) {
         return -1;
       }
 
-      if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_128_gcm(), nullptr, nullptr, nullptr) != 1) {
-        return -1;
-      }
-
-      if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, iv->size(), nullptr) != 1) {
-        return -1;
-      }
-
-      if (EVP_DecryptInit_ex(ctx.get(), nullptr, nullptr, key->data(), iv->data()) != 1) {
+      if (EVP_CipherInit_ex(ctx.get(), cipher, nullptr, key.data(), nullptr, enc) != 1) {
+        ctx.reset();
         return -1;
       }
       EVP_CIPHER_CTX_set_padding(ctx.get(), padding);
@@ -112,50 +109,36 @@ namespace crypto {
     }
 
     static int
-    init_encrypt_gcm(cipher_ctx_t &ctx, aes_t *key, aes_t *iv, bool padding) {
-      ctx.reset(EVP_CIPHER_CTX_new());
-
-      // Gen 7 servers use 128-bit AES ECB
-      if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_128_gcm(), nullptr, nullptr, nullptr) != 1) {
-        return -1;
-      }
-
-      if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, iv->size(), nullptr) != 1) {
+    set_iv(cipher_ctx_t &ctx, aes_t *iv, int enc) {
+      // Calling with cipher == nullptr and key == nullptr results in a parameter change
+      // without requiring a reallocation of the internal cipher ctx or a new key schedule.
+      if (EVP_CipherInit_ex(ctx.get(), nullptr, nullptr, nullptr, iv->data(), enc) != 1) {
         return -1;
       }
 
-      if (EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr, key->data(), iv->data()) != 1) {
-        return -1;
-      }
-      EVP_CIPHER_CTX_set_padding(ctx.get(), padding);
-
       return 0;
     }
 
     static int
-    init_encrypt_cbc(cipher_ctx_t &ctx, aes_t *key, aes_t *iv, bool padding) {
-      ctx.reset(EVP_CIPHER_CTX_new());
-
-      // Gen 7 servers use 128-bit AES ECB
-      if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_128_cbc(), nullptr, key->data(), iv->data()) != 1) {
-        return -1;
+    set_gcm_iv(cipher_ctx_t &ctx, std::size_t &iv_size, aes_t *iv, int enc) {
+      if (iv->size() != iv_size) {
+        if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, iv->size(), nullptr) != 1) {
+          return -1;
+        }
+        iv_size = iv->size();
       }
 
-      EVP_CIPHER_CTX_set_padding(ctx.get(), padding);
-
-      return 0;
+      return set_iv(ctx, iv, enc);
     }
 
     int
     gcm_t::decrypt(const std::string_view &tagged_cipher, std::vector<std::uint8_t> &plaintext, aes_t *iv) {
-      if (!decrypt_ctx && init_decrypt_gcm(decrypt_ctx, &key, iv, padding)) {
+      if (!decrypt_ctx && init_ctx(decrypt_ctx, EVP_aes_128_gcm(), key, padding, 0)) {
         return -1;
       }
 
-      // Calling with cipher == nullptr results in a parameter change
-      // without requiring a reallocation of the internal cipher ctx.
-      if (EVP_DecryptInit_ex(decrypt_ctx.get(), nullptr, nullptr, nullptr, iv->data()) != 1) {
-        return false;
+      if (set_gcm_iv(decrypt_ctx, decrypt_iv_size, iv, 0)) {
+        return -1;
       }
 
       auto cipher = tagged_cipher.substr(tag_size);
@@ -188,13 +171,11 @@ namespace crypto {
      */
     int
     gcm_t::encrypt(const std::string_view &plaintext, std::uint8_t *tag, std::uint8_t *ciphertext, aes_t *iv) {
-      if (!encrypt_ctx && init_encrypt_gcm(encrypt_ctx, &key, iv, padding)) {
+      if (!encrypt_ctx && init_ctx(encrypt_ctx, EVP_aes_128_gcm(), key, padding, 1)) {
         return -1;
       }
 
-      // Calling with cipher == nullptr results in a parameter change
-      // without requiring a reallocation of the internal cipher ctx.
-      if (EVP_EncryptInit_ex(encrypt_ctx.get(), nullptr, nullptr, nullptr, iv->data()) != 1) {
+      if (set_gcm_iv(encrypt_ctx, encrypt_iv_size, iv, 1)) {
         return -1;
       }
 
@@ -287,14 +268,12 @@ namespace crypto {
      */
     int
     cbc_t::encrypt(const std::string_view &plaintext, std::uint8_t *cipher, aes_t *iv) {
-      if (!encrypt_ctx && init_encrypt_cbc(encrypt_ctx, &key, iv, padding)) {
+      if (!encrypt_ctx && init_ctx(encrypt_ctx, EVP_aes_128_cbc(), key, padding, 1)) {
         return -1;
       }
 
-      // Calling with cipher == nullptr results in a parameter change
-      // without requiring a reallocation of the internal cipher ctx.
-      if (EVP_EncryptInit_ex(encrypt_ctx.get(), nullptr, nullptr, nullptr, iv->data()) != 1) {
-        return false;
+      if (set_iv(encrypt_ctx, iv, 1)) {
+        return -1;
       }
 
       int update_outlen, final_outlen;
@@ -315,10 +294,17 @@ namespace crypto {
         cipher_t { EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_new(), key, padding } {}
 
     cbc_t::cbc_t(const aes_t &key, bool padding):
-        cipher_t { nullptr, nullptr, key, padding } {}
+        cipher_t { nullptr, nullptr, key, padding } {
+      // Expand the key schedule now instead of on the first packet.
+      // If this fails, encrypt() retries and reports the error.
+      init_ctx(encrypt_ctx, EVP_aes_128_cbc(), this->key, padding, 1);
+    }
 
     gcm_t::gcm_t(const crypto::aes_t &key, bool padding):
-        cipher_t { nullptr, nullptr, key, padding } {}
+        cipher_t { nullptr, nullptr, key, padding } {
+      init_ctx(encrypt_ctx, EVP_aes_128_gcm(), this->key, padding, 1);
+      init_ctx(decrypt_ctx, EVP_aes_128_gcm(), this->key, padding, 0);
+    }
 
   }  // namespace cipher
 
@@ -174,6 +174,10 @@ namespace crypto {
       decrypt(const std::string_view &cipher, std::vector<std::uint8_t> &plaintext);
     };
 
+    /**
+     * @brief AES-128 GCM with key schedules that are expanded once and reused for every packet.
+     * @details Only the IV changes between packets. The IV length may differ between calls.
+     */
     class gcm_t: public cipher_t {
     public:
       gcm_t() = default;
@@ -207,8 +211,16 @@ namespace crypto {
 
       int
       decrypt(const std::string_view &cipher, std::vector<std::uint8_t> &plaintext, aes_t *iv);
+
+    private:
+      // The IV length the contexts are configured for, 12 bytes is the GCM default
+      std::size_t encrypt_iv_size = 12;
+      std::size_t decrypt_iv_size = 12;
     };
 
+    /**
+     * @brief AES-128 CBC encryption with a key schedule that is expanded once and reused for every packet.
+     */
     class cbc_t: public cipher_t {
     public:
       cbc_t() = default;
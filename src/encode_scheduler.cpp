@@ -0,0 +1,220 @@
+/**
+ * @file src/encode_scheduler.cpp
+ * @brief Definitions for sharing the host's CPUs between software encoded sessions.
+ */
+// standard includes
+#include <algorithm>
+#include <tuple>
+
+// local includes
+#include "encode_scheduler.h"
+#include "logging.h"
+
+using namespace std::literals;
+
+namespace video::scheduler {
+  // How often the encoding statistics of a session are logged
+  constexpr auto report_interval = 10s;
+
+  // The size of the partition the calling thread was pinned to
+  thread_local int pinned_cpus = 0;
+
+  std::vector<std::vector<int>>
+  partition(std::vector<platf::cpu_t> cpus, std::size_t count) {
+    std::vector<std::vector<int>> partitions(count);
+    if (!count || cpus.empty()) {
+      return partitions;
+    }
+
+    std::sort(std::begin(cpus), std::end(cpus), [](const platf::cpu_t &l, const platf::cpu_t &r) {
+      return std::tie(l.numa_node, l.l3_domain, l.id) < std::tie(r.numa_node, r.l3_domain, r.id);
+    });
+
+    std::vector<std::vector<int>> domains;
+    for (auto it = std::begin(cpus); it != std::end(cpus); ++it) {
+      if (it == std::begin(cpus) || it->numa_node != std::prev(it)->numa_node || it->l3_domain != std::prev(it)->l3_domain) {
+        domains.emplace_back();
+      }
+      domains.back().emplace_back(it->id);
+    }
+
+    if (domains.size() >= count) {
+      // Every partition gets whole neighboring domains, so no cache is shared between sessions
+      // and partitions only span NUMA nodes when they have to
+      auto domain = std::begin(domains);
+      std::size_t assigned = 0;
+      for (std::size_t x = 0; x < count; ++x) {
+        auto fair_share = cpus.size() * (x + 1) / count;
+        auto partitions_left = count - x - 1;
+
+        // Take the next domain while most of it fits in the fair share, but leave a domain for each remaining partition
+        do {
+          partitions[x].insert(std::end(partitions[x]), std::begin(*domain), std::end(*domain));
+          assigned += domain->size();
+          ++domain;
+        } while (domain != std::end(domains) &&
+                 (std::size_t) (std::end(domains) - domain) > partitions_left &&
+                 (!partitions_left || assigned + domain->size() / 2 <= fair_share));
+      }
+
+      return partitions;
+    }
+
+    // More partitions than domains, each domain gets at least one partition,
+    // the rest go to the domains with the most CPUs per partition
+    std::vector<std::size_t> shares(domains.size(), 1);
+    for (auto x = domains.size(); x < count; ++x) {
+      std::size_t best = 0;
+      for (std::size_t y = 1; y < domains.size(); ++y) {
+        if (domains[y].size() * shares[best] > domains[best].size() * shares[y]) {
+          best = y;
+        }
+      }
+      ++shares[best];
+    }
+
+    auto next = std::begin(partitions);
+    for (std::size_t x = 0; x < domains.size(); ++x) {
+      auto &domain = domains[x];
+      auto share = shares[x];
+
+      for (std::size_t y = 0; y < share; ++y, ++next) {
+        auto begin = domain.size() * y / share;
+        auto end = domain.size() * (y + 1) / share;
+
+        // More sessions than CPUs, they have to share
+        if (begin == end) {
+          next->emplace_back(domain[begin % domain.size()]);
+          continue;
+        }
+
+        next->assign(std::begin(domain) + begin, std::begin(domain) + end);
+      }
+    }
+
+    return partitions;
+  }
+
+  int
+  thread_budget() {
+    return pinned_cpus;
+  }
+
+  std::vector<int>
+  slot_t::cpus() const {
+    std::lock_guard lg { scheduler->lock };
+
+    return partition;
+  }
+
+  void
+  slot_t::apply() {
+    std::vector<int> cpu_ids;
+    {
+      std::lock_guard lg { scheduler->lock };
+
+      cpu_ids = partition;
+      applied_generation = generation;
+    }
+
+    if (platf::set_thread_affinity(cpu_ids)) {
+      pinned_cpus = (int) cpu_ids.size();
+      BOOST_LOG(info) << "Encoding session "sv << id << " runs on "sv << cpu_ids.size() << " CPUs"sv;
+    }
+    else {
+      pinned_cpus = 0;
+    }
+  }
+
+  bool
+  slot_t::moved() const {
+    return generation != applied_generation;
+  }
+
+  void
+  slot_t::frame_encoded(std::chrono::nanoseconds encode_time, std::chrono::nanoseconds deadline) {
+    ++frames;
+    encode_time_total += encode_time;
+    encode_time_max = std::max(encode_time_max, encode_time);
+    if (encode_time > deadline) {
+      ++deadline_misses;
+    }
+
+    if (std::chrono::steady_clock::now() - last_report >= report_interval) {
+      report();
+    }
+  }
+
+  void
+  slot_t::report() {
+    last_report = std::chrono::steady_clock::now();
+    if (!frames) {
+      return;
+    }
+
+    auto to_ms = [](std::chrono::nanoseconds duration) {
+      return std::chrono::duration<double, std::milli>(duration).count();
+    };
+
+    BOOST_LOG(debug) << "Encoding session "sv << id << ": "sv << frames << " frames, "sv
+                     << to_ms(encode_time_total / frames) << "ms average and "sv << to_ms(encode_time_max) << "ms maximum encode time, "sv
+                     << deadline_misses << " missed deadlines"sv;
+
+    frames = 0;
+    deadline_misses = 0;
+    encode_time_total = {};
+    encode_time_max = {};
+  }
+
+  scheduler_t::scheduler_t(std::vector<platf::cpu_t> topology):
+      topology { std::move(topology) } {}
+
+  std::shared_ptr<slot_t>
+  scheduler_t::join() {
+    auto slot = new slot_t;
+    slot->scheduler = this;
+
+    {
+      std::lock_guard lg { lock };
+
+      slot->id = next_id++;
+      slots.emplace_back(slot);
+      rebalance();
+    }
+
+    return std::shared_ptr<slot_t> { slot, [this](slot_t *slot) {
+                                      slot->report();
+                                      leave(slot);
+                                      delete slot;
+                                    } };
+  }
+
+  void
+  scheduler_t::leave(slot_t *slot) {
+    std::lock_guard lg { lock };
+
+    slots.erase(std::find(std::begin(slots), std::end(slots), slot));
+    rebalance();
+  }
+
+  void
+  scheduler_t::rebalance() {
+    auto partitions = partition(topology, slots.size());
+
+    for (std::size_t x = 0; x < slots.size(); ++x) {
+      auto slot = slots[x];
+
+      if (slot->partition != partitions[x]) {
+        slot->partition = std::move(partitions[x]);
+        ++slot->generation;
+      }
+    }
+  }
+
+  scheduler_t &
+  instance() {
+    static scheduler_t scheduler { platf::cpu_topology() };
+
+    return scheduler;
+  }
+}  // namespace video::scheduler
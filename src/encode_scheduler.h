@@ -0,0 +1,142 @@
+/**
+ * @file src/encode_scheduler.h
+ * @brief Declarations for sharing the host's CPUs between software encoded sessions.
+ */
+#pragma once
+
+// standard includes
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// platform includes
+#include "platform/common.h"
+
+namespace video::scheduler {
+  /**
+   * @brief Split CPUs into partitions that share as few caches as possible.
+   * @details The CPUs are grouped into L3 domains, ordered by NUMA node. With at least as many domains as partitions,
+   * each partition gets neighboring whole domains with about the same number of CPUs in total.
+   * Otherwise, each domain is split between a number of partitions proportional to its size.
+   * @param cpus The CPUs to split.
+   * @param count The number of partitions.
+   * @return The ids of the CPUs of each partition, ordered by domain.
+   */
+  std::vector<std::vector<int>>
+  partition(std::vector<platf::cpu_t> cpus, std::size_t count);
+
+  /**
+   * @brief Get the number of threads an encoder created on the calling thread should use.
+   * @return The size of the partition the thread was pinned to by `slot_t::apply()`, 0 if it wasn't pinned.
+   */
+  int
+  thread_budget();
+
+  class scheduler_t;
+
+  /**
+   * @brief The share of the host's CPUs of an encoding session.
+   * @details The scheduler changes the partition from any thread when sessions join or leave,
+   * the encoding thread applies it to itself before creating the encoder, whose threads inherit it.
+   */
+  class slot_t {
+  public:
+    /**
+     * @brief Get the current partition of the session.
+     * @return The ids of the CPUs.
+     */
+    std::vector<int>
+    cpus() const;
+
+    /**
+     * @brief Pin the calling thread to the current partition.
+     */
+    void
+    apply();
+
+    /**
+     * @brief Check if the partition changed since the last call to `apply()`.
+     * @return `true` if the encoder should be recreated to move its threads.
+     */
+    bool
+    moved() const;
+
+    /**
+     * @brief Account for an encoded frame.
+     * @param encode_time The time it took to convert and encode the frame.
+     * @param deadline The time the frame had to be encoded in, which is the frame interval.
+     */
+    void
+    frame_encoded(std::chrono::nanoseconds encode_time, std::chrono::nanoseconds deadline);
+
+    /**
+     * @brief Log the encoding times and deadline misses since the last report.
+     * @details Called periodically by `frame_encoded()` and when the session leaves.
+     */
+    void
+    report();
+
+    int id = 0;
+
+  private:
+    friend class scheduler_t;
+
+    scheduler_t *scheduler;
+
+    // Protected by the scheduler's lock
+    std::vector<int> partition;
+    std::atomic_int generation { 0 };
+
+    // Only used by the encoding thread
+    int applied_generation = -1;
+    std::chrono::steady_clock::time_point last_report { std::chrono::steady_clock::now() };
+    std::chrono::nanoseconds encode_time_total {};
+    std::chrono::nanoseconds encode_time_max {};
+    int frames = 0;
+    int deadline_misses = 0;
+  };
+
+  /**
+   * @brief Partitions the host's CPUs between the sessions that use software encoders.
+   * @details Without a scheduler, the encoders of concurrent sessions each size their thread pools
+   * for the whole host and fight over the same cores and caches.
+   */
+  class scheduler_t {
+  public:
+    /**
+     * @brief Create a scheduler.
+     * @param topology The CPUs to share, usually `platf::cpu_topology()`.
+     */
+    explicit scheduler_t(std::vector<platf::cpu_t> topology);
+
+    /**
+     * @brief Add a session and rebalance the partitions.
+     * @return The slot of the session, which leaves when it's destroyed.
+     */
+    std::shared_ptr<slot_t>
+    join();
+
+  private:
+    friend class slot_t;
+
+    void
+    leave(slot_t *slot);
+
+    void
+    rebalance();
+
+    mutable std::mutex lock;
+    std::vector<platf::cpu_t> topology;
+    std::vector<slot_t *> slots;
+    int next_id = 0;
+  };
+
+  /**
+   * @brief Get the scheduler for the CPUs of this host.
+   * @return The scheduler.
+   */
+  scheduler_t &
+  instance();
+}  // namespace video::scheduler
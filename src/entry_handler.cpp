@@ -4,6 +4,7 @@
  */
 // standard includes
 #include <csignal>
+#include <iomanip>
 #include <iostream>
 #include <thread>
 
@@ -11,6 +12,7 @@
 #include "config.h"
 #include "confighttp.h"
 #include "entry_handler.h"
+#include "fec.h"
 #include "globals.h"
 #include "httpcommon.h"
 #include "logging.h"
@@ -50,6 +52,32 @@ namespace args {
     return 0;
   }
 
+  int
+  fec_benchmark() {
+    int count;
+    auto variants = reed_solomon_variants(&count);
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto x = 0; x < count; ++x) {
+      auto &variant = variants[x];
+      if (!variant.supported()) {
+        continue;
+      }
+
+      for (auto &shape : stream::fec::benchmark_shapes()) {
+        auto rate = stream::fec::benchmark(variant, shape, 200ms);
+
+        std::cout << std::setw(12) << std::left << variant.name
+                  << std::setw(4) << std::right << shape.data_shards << " + "sv
+                  << std::setw(2) << shape.parity_shards << " shards of "sv
+                  << std::setw(4) << shape.blocksize << " bytes: "sv
+                  << std::setw(7) << rate << " GB/s"sv << std::endl;
+      }
+    }
+
+    return 0;
+  }
+
   int
   help(const char *name) {
     logging::print_help(name);
@@ -46,6 +46,15 @@ namespace args {
   int
   creds(const char *name, int argc, char *argv[]);
 
+  /**
+   * @brief Print the throughput of each FEC kernel the CPU supports to stdout, then exit.
+   * @examples
+   * fec_benchmark();
+   * @examples_end
+   */
+  int
+  fec_benchmark();
+
   /**
    * @brief Print help to stdout, then exit.
    * @param name The name of the program.
@@ -0,0 +1,303 @@
+/**
+ * @file src/fec.cpp
+ * @brief Definitions for the FEC blocks of video frames.
+ */
+// standard includes
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+// local includes
+#include "fec.h"
+#include "logging.h"
+
+using namespace std::literals;
+
+namespace stream::fec {
+  namespace {
+    // A stream sees at most a few hundred shapes, one per block size in shards
+    std::mutex rs_cache_lock;
+    std::map<std::pair<int, int>, rs_t> rs_cache;
+
+    void
+    clear_rs_cache() {
+      std::lock_guard lg { rs_cache_lock };
+      rs_cache.clear();
+    }
+  }  // namespace
+
+  reed_solomon *
+  rs_for_shape(int data_shards, int parity_shards) {
+    std::lock_guard lg { rs_cache_lock };
+
+    auto &rs = rs_cache[{ data_shards, parity_shards }];
+    if (!rs) {
+      rs.reset(reed_solomon_new(data_shards, parity_shards));
+    }
+
+    return rs.get();
+  }
+
+  void
+  fec_t::encode_parity() {
+    parity_start = std::chrono::steady_clock::now();
+
+    if (nr_shards > data_shards) {
+      // packets = parity_shards + data_shards
+      auto rs = rs_for_shape(data_shards, nr_shards - data_shards);
+
+      reed_solomon_encode(rs, shards_p.data(), nr_shards, blocksize);
+    }
+
+    parity_end = std::chrono::steady_clock::now();
+  }
+
+  fec_t
+  prepare(const std::string_view &payload, size_t blocksize, size_t fecpercentage, size_t minparityshards, size_t prefixsize, arena::arena_t &arena) {
+    auto payload_size = payload.size();
+
+    auto pad = payload_size % blocksize != 0;
+
+    auto aligned_data_shards = payload_size / blocksize;
+    auto data_shards = aligned_data_shards + (pad ? 1 : 0);
+    auto parity_shards = (data_shards * fecpercentage + 99) / 100;
+
+    // increase the FEC percentage for this frame if the parity shard minimum is not met
+    if (parity_shards < minparityshards && fecpercentage != 0) {
+      parity_shards = minparityshards;
+      fecpercentage = (100 * parity_shards) / data_shards;
+
+      BOOST_LOG(verbose) << "Increasing FEC percentage to "sv << fecpercentage << " to meet parity shard minimum"sv << std::endl;
+    }
+
+    auto nr_shards = data_shards + parity_shards;
+
+    // If we need to store a zero-padded data shard, allocate that first to
+    // to keep the shards in order and reduce buffer fragmentation
+    auto parity_shard_offset = pad ? 1 : 0;
+    auto shards = arena.allocate<char>((parity_shard_offset + parity_shards) * blocksize);
+    auto shards_p = arena.allocate<uint8_t *>(nr_shards);
+    auto encrypted = arena.allocate<char>(prefixsize ? data_shards * blocksize : 0);
+
+    // The encryption headers are filled in field by field
+    auto headers = arena.allocate<char>(nr_shards * prefixsize);
+    std::fill(std::begin(headers), std::end(headers), 0);
+
+    std::array<platf::buffer_descriptor_t, 2> payload_buffers;
+
+    // Point into the payload buffer for all except the final padded data shard
+    auto next = std::begin(payload);
+    for (auto x = 0; x < aligned_data_shards; ++x) {
+      shards_p[x] = (uint8_t *) next;
+      next += blocksize;
+    }
+
+    // If the last data shard needs to be zero-padded, we must use the shards buffer
+    if (pad) {
+      shards_p[aligned_data_shards] = (uint8_t *) &shards[0];
+
+      // GCC doesn't figure out that std::copy_n() can be replaced with memcpy() here
+      // and ends up compiling a horribly slow element-by-element copy loop, so we
+      // help it by using memcpy()/memset() directly.
+      auto copy_len = std::min<size_t>(blocksize, std::end(payload) - next);
+      std::memcpy(shards_p[aligned_data_shards], next, copy_len);
+      if (copy_len < blocksize) {
+        // Zero any additional space after the end of the payload
+        std::memset(shards_p[aligned_data_shards] + copy_len, 0, blocksize - copy_len);
+      }
+    }
+
+    if (prefixsize) {
+      // The data shards are sent from their encrypted copies, the parity shards are encrypted in place
+      payload_buffers[0] = { encrypted.data(), encrypted.size() };
+      payload_buffers[1] = { shards.data() + parity_shard_offset * blocksize, parity_shards * blocksize };
+    }
+    else {
+      payload_buffers[0] = { payload.data(), aligned_data_shards * blocksize };
+
+      // Add a payload buffer describing the shard buffer
+      payload_buffers[1] = { shards.data(), shards.size() };
+    }
+
+    // Point into our allocated buffer for the parity shards
+    for (auto x = 0; x < parity_shards; ++x) {
+      shards_p[data_shards + x] = (uint8_t *) &shards[(parity_shard_offset + x) * blocksize];
+    }
+
+    return {
+      data_shards,
+      nr_shards,
+      fecpercentage,
+      blocksize,
+      prefixsize,
+      shards,
+      headers,
+      shards_p,
+      encrypted,
+      payload_buffers,
+    };
+  }
+
+  std::vector<shape_t>
+  benchmark_shapes() {
+    // DATA_SHARDS_MAX data and parity shards at 20% FEC, and the default packet sizes of
+    // Moonlight on LAN (1392 bytes) and WAN (1024 bytes) plus MAX_RTP_HEADER_SIZE
+    return {
+      { 212, 43, 1408 },
+      { 40, 8, 1408 },
+      { 4, 2, 1040 },
+    };
+  }
+
+  double
+  benchmark(const reed_solomon_variant &variant, const shape_t &shape, std::chrono::nanoseconds duration) {
+    auto nr_shards = shape.data_shards + shape.parity_shards;
+
+    std::vector<uint8_t> shards((size_t) nr_shards * shape.blocksize);
+    std::vector<uint8_t *> shards_p(nr_shards);
+    for (auto x = 0; x < nr_shards; ++x) {
+      shards_p[x] = &shards[(size_t) x * shape.blocksize];
+    }
+
+    // Nothing is sparse about the payload of a video frame
+    for (size_t x = 0; x < shards.size(); ++x) {
+      shards[x] = (uint8_t) (x * 167 + (x >> 8));
+    }
+
+    variant.init();
+    auto rs = variant.new_fn(shape.data_shards, shape.parity_shards);
+    auto fg = util::fail_guard([&]() {
+      variant.release_fn(rs);
+    });
+
+    // Warm up the caches before the clock starts
+    variant.encode_fn(rs, shards_p.data(), nr_shards, shape.blocksize);
+
+    std::uint64_t blocks = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = 0ns;
+    do {
+      variant.encode_fn(rs, shards_p.data(), nr_shards, shape.blocksize);
+      ++blocks;
+
+      elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < duration);
+
+    // Bytes per nanosecond are GB/s
+    return (double) (blocks * shape.data_shards * shape.blocksize) / (double) elapsed.count();
+  }
+
+  const reed_solomon_variant &
+  init(std::string_view kernel) {
+    // The handles of the previous variant may not fit the next one
+    clear_rs_cache();
+
+    int count;
+    auto variants = reed_solomon_variants(&count);
+
+    std::vector<const reed_solomon_variant *> supported;
+    for (auto x = 0; x < count; ++x) {
+      if (variants[x].supported()) {
+        supported.emplace_back(&variants[x]);
+      }
+    }
+
+    if (kernel != "auto"sv) {
+      auto it = std::find_if(std::begin(supported), std::end(supported), [&](auto variant) {
+        return variant->name == kernel;
+      });
+
+      if (it != std::end(supported)) {
+        reed_solomon_use(*it);
+
+        BOOST_LOG(info) << "Using the "sv << kernel << " FEC kernel"sv;
+        return **it;
+      }
+
+      BOOST_LOG(warning) << "The "sv << kernel << " FEC kernel isn't supported on this CPU, using the fastest one instead"sv;
+    }
+
+    // The default variant is always supported
+    const reed_solomon_variant *fastest = supported.back();
+    double fastest_rate = 0;
+    for (auto variant : supported) {
+      auto shapes = benchmark_shapes();
+
+      double rate = 0;
+      for (auto &shape : shapes) {
+        rate += benchmark(*variant, shape, 5ms) / shapes.size();
+      }
+
+      BOOST_LOG(debug) << "FEC kernel "sv << variant->name << ": "sv << rate << " GB/s"sv;
+
+      // Prefer the more specialized variant if both are as fast
+      if (rate > fastest_rate) {
+        fastest = variant;
+        fastest_rate = rate;
+      }
+    }
+
+    reed_solomon_use(fastest);
+
+    BOOST_LOG(info) << "Using the "sv << fastest->name << " FEC kernel ("sv << fastest_rate << " GB/s)"sv;
+    return *fastest;
+  }
+
+  parity_pool_t::parity_pool_t(int thread_count):
+      threads(std::max(1, thread_count)) {
+    for (auto &thread : threads) {
+      thread = std::thread(&parity_pool_t::run, this);
+    }
+  }
+
+  parity_pool_t::~parity_pool_t() {
+    jobs.stop();
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  void
+  parity_ready_t::wait() {
+    std::unique_lock ul { lock };
+
+    cv.wait(ul, [this]() {
+      return !pending;
+    });
+  }
+
+  void
+  parity_pool_t::submit(fec_t &shards, parity_ready_t &ready) {
+    {
+      std::lock_guard lg { ready.lock };
+      ready.pending = true;
+    }
+
+    jobs.raise(job_t { &shards, &ready });
+  }
+
+  int
+  parity_pool_t::default_threads() {
+    // hardware_concurrency() may return 0 if it's unknown
+    auto cores = (int) std::thread::hardware_concurrency();
+
+    return std::clamp(cores - 1, 1, MAX_FEC_BLOCKS);
+  }
+
+  void
+  parity_pool_t::run() {
+    // The broadcast thread waits for the parity shards
+    platf::adjust_thread_priority(platf::thread_priority_e::high);
+
+    while (auto job = jobs.pop()) {
+      job->shards->encode_parity();
+
+      {
+        std::lock_guard lg { job->ready->lock };
+        job->ready->pending = false;
+      }
+      job->ready->cv.notify_all();
+    }
+  }
+}  // namespace stream::fec
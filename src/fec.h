@@ -0,0 +1,226 @@
+/**
+ * @file src/fec.h
+ * @brief Declarations for the FEC blocks of video frames.
+ */
+#pragma once
+
+// standard includes
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// local includes
+#include "arena.h"
+#include "thread_safe.h"
+#include "utility.h"
+
+// platform includes
+#include "platform/common.h"
+
+extern "C" {
+#include "rswrapper.h"
+}
+
+namespace stream::fec {
+  using rs_t = util::safe_ptr<reed_solomon, [](reed_solomon *rs) { reed_solomon_release(rs); }>;
+
+  /**
+   * @brief There are 2 bits for FEC block count for a maximum of 4 FEC blocks per frame.
+   */
+  constexpr auto MAX_FEC_BLOCKS = 4;
+
+  /**
+   * @brief The data and parity shards of an FEC block.
+   * @details The buffers belong to the arena the block was prepared in.
+   */
+  struct fec_t {
+    size_t data_shards;
+    size_t nr_shards;
+    size_t percentage;
+
+    size_t blocksize;
+    size_t prefixsize;
+    std::span<char> shards;
+    std::span<char> headers;
+    std::span<uint8_t *> shards_p;
+
+    // If the shards are encrypted, the data shards are encrypted into this buffer instead of in place,
+    // so the parity shards can still be computed from the plaintext after the data shards were sent
+    std::span<char> encrypted;
+
+    std::array<platf::buffer_descriptor_t, 2> payload_buffers;
+
+    // When encode_parity() ran, for logging
+    std::chrono::steady_clock::time_point parity_start {};
+    std::chrono::steady_clock::time_point parity_end {};
+
+    char *
+    data(size_t el) {
+      return (char *) shards_p[el];
+    }
+
+    /**
+     * @brief Get the buffer that is sent for a shard.
+     * @param el The index of the shard.
+     * @return The encrypted copy for data shards of encrypted blocks, the shard itself otherwise.
+     */
+    char *
+    payload(size_t el) {
+      return (prefixsize && el < data_shards) ? &encrypted[el * blocksize] : data(el);
+    }
+
+    char *
+    prefix(size_t el) {
+      return prefixsize ? &headers[el * prefixsize] : nullptr;
+    }
+
+    size_t
+    size() const {
+      return nr_shards;
+    }
+
+    /**
+     * @brief Compute the parity shards from the data shards.
+     * @note The data shards must not be modified while this is running.
+     */
+    void
+    encode_parity();
+  };
+
+  /**
+   * @brief Get the RS handle that computes the parity of blocks of a shape.
+   * @details Setting up the encoding matrix of a shape costs more than encoding a block with it,
+   * so the handles are created once per shape and shared by all threads. `init()` releases them,
+   * so it must not run while parity is being computed.
+   * @param data_shards The number of data shards.
+   * @param parity_shards The number of parity shards.
+   * @return The handle, valid until the next `init()`.
+   */
+  reed_solomon *
+  rs_for_shape(int data_shards, int parity_shards);
+
+  /**
+   * @brief Split an FEC block into data shards and allocate its parity shards.
+   * @details The parity shards are left uninitialized, so the data shards can be sent
+   * before `fec_t::encode_parity()` is called.
+   * @param payload The payload of the FEC block.
+   * @param blocksize The size of each shard.
+   * @param fecpercentage The percentage of parity shards.
+   * @param minparityshards The minimum number of parity shards, unless the percentage is 0.
+   * @param prefixsize The size of the encryption header before each shard, or 0 if the shards aren't encrypted.
+   * @param arena The arena the buffers of the block are allocated from.
+   * @return The shards of the block, valid until the arena is reset.
+   */
+  fec_t
+  prepare(const std::string_view &payload, size_t blocksize, size_t fecpercentage, size_t minparityshards, size_t prefixsize, arena::arena_t &arena);
+
+  /**
+   * @brief The shape of an FEC block.
+   */
+  struct shape_t {
+    int data_shards;
+    int parity_shards;
+    int blocksize;
+  };
+
+  /**
+   * @brief Get the shapes of the FEC blocks `videoBroadcastThread()` produces at the default FEC percentage.
+   * @return A full block of a large frame, the block of an average frame and the block of a tiny frame.
+   */
+  std::vector<shape_t>
+  benchmark_shapes();
+
+  /**
+   * @brief Measure how fast an RS variant computes the parity shards of FEC blocks.
+   * @param variant The variant, which must be supported by the CPU.
+   * @param shape The shape of the blocks.
+   * @param duration How long to keep encoding for.
+   * @return The throughput in GB/s of data shards.
+   */
+  double
+  benchmark(const reed_solomon_variant &variant, const shape_t &shape, std::chrono::nanoseconds duration);
+
+  /**
+   * @brief Select the RS variant that computes the parity shards of all FEC blocks.
+   * @details Unless a supported variant is named, each supported variant is benchmarked
+   * briefly with `benchmark_shapes()` and the fastest one is used.
+   * @param kernel The name of the variant, or "auto".
+   * @return The selected variant.
+   */
+  const reed_solomon_variant &
+  init(std::string_view kernel);
+
+  /**
+   * @brief Signals that the parity of a block submitted to a `parity_pool_t` is computed.
+   * @details It's reused from frame to frame, so submitting a block doesn't allocate.
+   */
+  class parity_ready_t {
+  public:
+    /**
+     * @brief Wait for the parity of the last block submitted with this.
+     * @details Returns immediately if that parity is computed already, or if nothing was submitted.
+     */
+    void
+    wait();
+
+  private:
+    friend class parity_pool_t;
+
+    std::mutex lock;
+    std::condition_variable cv;
+    bool pending = false;
+  };
+
+  /**
+   * @brief Computes parity shards on a set of persistent threads.
+   * @details The FEC blocks of a frame share nothing but their sequence numbers, which are assigned
+   * before they are submitted, so the parity of all blocks of a large frame is computed concurrently.
+   * The broadcast thread sends the data shards meanwhile and waits for the parity of each block in order.
+   */
+  class parity_pool_t {
+  public:
+    /**
+     * @brief Start the threads of the pool.
+     * @param thread_count The number of threads, at least one is started.
+     */
+    explicit parity_pool_t(int thread_count = default_threads());
+
+    ~parity_pool_t();
+
+    parity_pool_t(const parity_pool_t &) = delete;
+    parity_pool_t &
+    operator=(const parity_pool_t &) = delete;
+
+    /**
+     * @brief Queue the parity computation of an FEC block.
+     * @param shards The block, which must stay alive and unmodified until `ready.wait()` returns.
+     * @param ready Signaled once the parity shards are computed, it must not be waited on by anyone else meanwhile.
+     */
+    void
+    submit(fec_t &shards, parity_ready_t &ready);
+
+    /**
+     * @brief Get the number of threads that fits the protocol and the host.
+     * @return One thread per FEC block of a frame, but leave a core to the broadcast thread.
+     */
+    static int
+    default_threads();
+
+  private:
+    struct job_t {
+      fec_t *shards;
+      parity_ready_t *ready;
+    };
+
+    void
+    run();
+
+    safe::queue_t<job_t> jobs;
+    std::vector<std::thread> threads;
+  };
+}  // namespace stream::fec
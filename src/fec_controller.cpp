@@ -0,0 +1,144 @@
+/**
+ * @file src/fec_controller.cpp
+ * @brief Definitions for the per-session adaptive FEC controller.
+ */
+// standard includes
+#include <algorithm>
+#include <cmath>
+
+// local includes
+#include "fec_controller.h"
+
+namespace stream::fec {
+  controller_t::controller_t(int initial_percentage, int min_percentage, int max_percentage):
+      min_percentage { min_percentage },
+      max_percentage { std::max(min_percentage, max_percentage) },
+      level { std::clamp(initial_percentage, min_percentage, std::max(min_percentage, max_percentage)) },
+      reported_level { level },
+      floor_level { min_percentage } {
+    // Give the client a chance to report loss before lowering the initial level
+    auto now = clock::now();
+    hold_until = now + hold_time;
+    last_step_down = now;
+    last_frame_lost = now;
+  }
+
+  void
+  controller_t::sent(std::size_t packets) {
+    std::lock_guard lg { lock };
+
+    packets_sent += packets;
+  }
+
+  void
+  controller_t::loss_stats(int lost_packets, clock::time_point now) {
+    if (min_percentage == max_percentage || lost_packets < 0) {
+      return;
+    }
+
+    std::lock_guard lg { lock };
+
+    auto sent = packets_sent;
+    packets_sent = 0;
+
+    if (lost_packets == 0) {
+      average_loss *= 0.75;
+      return;
+    }
+
+    auto rate = sent ? std::min(1.0, (double) lost_packets / sent) : 1.0;
+    average_loss = average_loss * 0.75 + rate * 0.25;
+
+    raise_to(target(), now);
+  }
+
+  void
+  controller_t::frames_lost(clock::time_point now) {
+    if (min_percentage == max_percentage) {
+      return;
+    }
+
+    std::lock_guard lg { lock };
+
+    // FEC couldn't recover a frame, so whatever we had wasn't enough. If the average loss is low,
+    // the packets were lost in a burst, which only more parity packets per block can cover.
+    extra_parity_packets = std::min(extra_parity_packets + 1, max_extra_parity_packets);
+    last_frame_lost = now;
+
+    // Don't fall back to the level that just failed until the link stayed clean for a while
+    floor_level = std::min(level + 5, max_percentage);
+    raise_to(std::max(target(), level + 5), now);
+  }
+
+  int
+  controller_t::percentage(clock::time_point now) {
+    if (min_percentage == max_percentage) {
+      return level;
+    }
+
+    std::lock_guard lg { lock };
+
+    // Bursts are rare, so what was added for lost frames is given up much more slowly
+    if ((extra_parity_packets > 0 || floor_level > min_percentage) && now - last_frame_lost >= parity_step_down_interval) {
+      extra_parity_packets = std::max(0, extra_parity_packets - 1);
+      floor_level = std::max(min_percentage, floor_level - 5);
+      last_frame_lost = now;
+    }
+
+    if (now >= hold_until && now - last_step_down >= step_down_interval) {
+      last_step_down = now;
+
+      // Forget old loss, clients that don't send loss reports only signal lost frames
+      average_loss = average_loss < 0.001 ? 0.0 : average_loss / 2;
+
+      // Step down in a quarter of the remaining distance, so large levels fall quickly
+      // while the last few steps near the target are taken carefully
+      auto goal = target();
+      if (level > goal) {
+        level = std::max(goal, level - std::max(1, (level - goal) / 4));
+        reported_level = level;
+      }
+    }
+
+    return level;
+  }
+
+  int
+  controller_t::min_parity_packets(int client_minimum) const {
+    std::lock_guard lg { lock };
+
+    return client_minimum + extra_parity_packets;
+  }
+
+  int
+  controller_t::current() const {
+    return reported_level;
+  }
+
+  int
+  controller_t::target() const {
+    if (average_loss <= 0.0) {
+      return floor_level;
+    }
+
+    // Reed-Solomon recovers as many lost packets per block as it has parity packets.
+    // Twice the recent loss rate leaves room for loss that isn't spread evenly,
+    // bursts are covered by the floor and the extra parity packets instead.
+    auto goal = (int) std::ceil(average_loss * 200) + 5;
+    return std::clamp(goal, floor_level, max_percentage);
+  }
+
+  void
+  controller_t::raise_to(int new_level, clock::time_point now) {
+    // Loss below the current level doesn't hold it, so it keeps falling towards the target
+    if (new_level <= level || level == max_percentage) {
+      return;
+    }
+
+    level = std::min(new_level, max_percentage);
+    reported_level = level;
+
+    hold_until = now + hold_time;
+    last_step_down = now;
+  }
+}  // namespace stream::fec
@@ -0,0 +1,128 @@
+/**
+ * @file src/fec_controller.h
+ * @brief Declarations for the per-session adaptive FEC controller.
+ */
+#pragma once
+
+// standard includes
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace stream::fec {
+  /**
+   * @brief Picks the FEC percentage for each video frame of a session from the loss the client reports.
+   * @details Loss reports and frame invalidation requests arrive on the control stream thread,
+   * while the video broadcast thread asks for the level of each frame, so all members are thread-safe.
+   *
+   * The level rises immediately when loss is reported and falls back towards the bounds' minimum
+   * slowly once the link is clean again. Frames that couldn't be recovered additionally raise the
+   * minimum number of parity packets: with bursty loss, whole runs of packets are dropped while the
+   * average loss stays low, and small frames would only get a single parity packet from the percentage.
+   */
+  class controller_t {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Create a controller.
+     * @param initial_percentage The level used until the first loss report arrives.
+     * @param min_percentage The lowest level the controller may pick.
+     * @param max_percentage The highest level the controller may pick.
+     * If equal to `min_percentage`, the level is fixed.
+     */
+    controller_t(int initial_percentage, int min_percentage, int max_percentage);
+
+    /**
+     * @brief Account for video packets that were sent to the client.
+     * @param packets The number of data and parity packets sent.
+     */
+    void
+    sent(std::size_t packets);
+
+    /**
+     * @brief Handle a loss report from the client.
+     * @param lost_packets The number of packets lost since the last report.
+     * @param now The time the report arrived.
+     */
+    void
+    loss_stats(int lost_packets, clock::time_point now);
+
+    /**
+     * @brief Handle frames the client couldn't recover, i.e. a reference frame invalidation or IDR request.
+     * @param now The time the request arrived.
+     */
+    void
+    frames_lost(clock::time_point now);
+
+    /**
+     * @brief Get the FEC percentage to use for the next frame.
+     * @param now The current time, used to lower the level after a period without loss.
+     * @return The FEC percentage.
+     */
+    int
+    percentage(clock::time_point now);
+
+    /**
+     * @brief Get the minimum number of parity packets per FEC block.
+     * @param client_minimum The minimum requested by the client.
+     * @return The minimum number of parity packets.
+     */
+    int
+    min_parity_packets(int client_minimum) const;
+
+    /**
+     * @brief Get the last level picked, for reporting.
+     * @return The FEC percentage.
+     */
+    int
+    current() const;
+
+    /**
+     * @brief How long the level is held after it was raised.
+     */
+    static constexpr auto hold_time = std::chrono::seconds { 3 };
+
+    /**
+     * @brief The interval between steps down while the link is clean.
+     */
+    static constexpr auto step_down_interval = std::chrono::seconds { 1 };
+
+    /**
+     * @brief The interval between giving up some of what lost frames added while no frames are lost.
+     */
+    static constexpr auto parity_step_down_interval = std::chrono::seconds { 10 };
+
+    /**
+     * @brief The most parity packets added on top of the client's minimum for bursty loss.
+     */
+    static constexpr int max_extra_parity_packets = 4;
+
+  private:
+    int
+    target() const;
+
+    void
+    raise_to(int level, clock::time_point now);
+
+    mutable std::mutex lock;
+
+    int min_percentage;
+    int max_percentage;
+    int level;
+    std::atomic_int reported_level;
+
+    std::size_t packets_sent = 0;
+
+    // Exponential moving average of the loss rate of each report
+    double average_loss = 0.0;
+
+    // Raised by lost frames, the level doesn't fall below it
+    int floor_level;
+    int extra_parity_packets = 0;
+
+    clock::time_point hold_until {};
+    clock::time_point last_step_down {};
+    clock::time_point last_frame_lost {};
+  };
+}  // namespace stream::fec
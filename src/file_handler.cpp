@@ -4,6 +4,7 @@
  */
 
 // standard includes
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 
@@ -45,6 +46,33 @@ namespace file_handler {
     return std::string { (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() };
   }
 
+  std::string
+  read_file_range(const char *path, std::uintmax_t offset, std::size_t max_size) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+      BOOST_LOG(debug) << "Missing file: " << path;
+      return {};
+    }
+
+    if (offset >= size || max_size == 0) {
+      return {};
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+      return {};
+    }
+
+    std::string contents(std::min<std::uintmax_t>(size - offset, max_size), '\0');
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+    // The file may have been truncated between querying the size and reading it
+    contents.resize(static_cast<std::size_t>(in.gcount()));
+    return contents;
+  }
+
   int
   write_file(const char *path, const std::string_view &contents) {
     std::ofstream out(path);
@@ -4,6 +4,7 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 /**
@@ -43,6 +44,21 @@ namespace file_handler {
   std::string
   read_file(const char *path);
 
+  /**
+   * @brief Read a byte range of a file to string.
+   * @details Only the requested range is read from disk, which keeps memory bounded for large files such as logs.
+   * If `offset` is past the end of the file, an empty string is returned.
+   * @param path The path of the file.
+   * @param offset The byte offset to start reading from.
+   * @param max_size The maximum number of bytes to read.
+   * @return The contents of the requested range.
+   * @examples
+   * std::string tail = read_file_range("path/to/file", 1024, 4096);
+   * @examples_end
+   */
+  std::string
+  read_file_range(const char *path, std::uintmax_t offset, std::size_t max_size);
+
   /**
    * @brief Writes a file.
    * @param path The path of the file.
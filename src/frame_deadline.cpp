@@ -0,0 +1,67 @@
+/**
+ * @file src/frame_deadline.cpp
+ * @brief Definitions for the deadline policy of the frames of an encoding session.
+ */
+// local includes
+#include "frame_deadline.h"
+
+namespace video::deadline {
+  policy_t::policy_t(std::chrono::nanoseconds frame_interval):
+      frame_interval { frame_interval } {}
+
+  decision_e
+  policy_t::admit(const std::optional<clock::time_point> &captured, clock::time_point now) {
+    if (!captured) {
+      return decision_e::encode;
+    }
+
+    auto deadline = *captured + frame_interval;
+
+    // Only give up on a capture if it can't make its deadline anyway and the next capture is due
+    // about now. If it was due long ago, the content is static and there won't be a next capture soon.
+    if (now + encode_time > deadline && deadline <= now + grace() && deadline > now - grace()) {
+      return decision_e::wait_for_newer;
+    }
+
+    return decision_e::encode;
+  }
+
+  std::chrono::nanoseconds
+  policy_t::grace() const {
+    return frame_interval / 4;
+  }
+
+  void
+  policy_t::encoded(std::uint64_t capture_nr, const std::optional<clock::time_point> &captured, clock::time_point started, clock::time_point now) {
+    // Capture numbers restart with the capture thread
+    if (last_capture_nr && capture_nr > last_capture_nr) {
+      current.skipped += (int) (capture_nr - last_capture_nr - 1);
+    }
+    last_capture_nr = capture_nr;
+
+    // Weigh the latest encode by 1/8th, like TCP's smoothed round trip time
+    auto duration = now - started;
+    encode_time = encode_time.count() ? encode_time + (duration - encode_time) / 8 : duration;
+
+    if (!captured) {
+      return;
+    }
+
+    if (now <= *captured + frame_interval) {
+      ++current.on_time;
+    }
+    else {
+      ++current.late;
+    }
+  }
+
+  const stats_t &
+  policy_t::stats() const {
+    return current;
+  }
+
+  void
+  policy_t::reset_stats() {
+    current = {};
+  }
+}  // namespace video::deadline
@@ -0,0 +1,98 @@
+/**
+ * @file src/frame_deadline.h
+ * @brief Declarations for the deadline policy of the frames of an encoding session.
+ */
+#pragma once
+
+// standard includes
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace video::deadline {
+  using clock = std::chrono::steady_clock;
+
+  /**
+   * @brief What to do with a capture taken from the image mailbox.
+   */
+  enum class decision_e {
+    encode,  ///< Encode the capture
+    wait_for_newer,  ///< The capture can't make its slot, wait up to `policy_t::grace()` for a newer one to replace it
+  };
+
+  /**
+   * @brief How the captures of a session met their deadlines.
+   */
+  struct stats_t {
+    int on_time = 0;  ///< Captures encoded before the next capture was due
+    int late = 0;  ///< Captures encoded after the next capture was due
+    int skipped = 0;  ///< Captures replaced by newer ones before the encoder took them
+  };
+
+  /**
+   * @brief Decides which captures are worth encoding and accounts for their deadlines.
+   * @details The capture thread hands images to the encoder through a single slot, so a newer capture
+   * replaces one the encoder didn't take yet and the encoder always takes the newest. When the encoder is
+   * so far behind that the capture it takes would only be done after the next one is due anyway, it's better
+   * to wait briefly for that next capture than to spend an encode on a stale one.
+   *
+   * The deadline of a capture is the time the next capture is due, i.e. its capture time plus the frame interval.
+   */
+  class policy_t {
+  public:
+    /**
+     * @brief Create a policy.
+     * @param frame_interval The interval between captures at the session's framerate.
+     */
+    explicit policy_t(std::chrono::nanoseconds frame_interval);
+
+    /**
+     * @brief Decide what to do with a capture taken from the mailbox.
+     * @param captured The time of the capture, if the display reported it.
+     * @param now The current time.
+     * @return Whether to encode the capture or wait for a newer one.
+     */
+    decision_e
+    admit(const std::optional<clock::time_point> &captured, clock::time_point now);
+
+    /**
+     * @brief Get how long to wait for a newer capture after `decision_e::wait_for_newer`.
+     * @return A fraction of the frame interval.
+     */
+    std::chrono::nanoseconds
+    grace() const;
+
+    /**
+     * @brief Account for a capture that was encoded.
+     * @details Captures the capture thread numbered in between were skipped.
+     * @param capture_nr The number the capture thread gave the capture.
+     * @param captured The time of the capture, if the display reported it.
+     * @param started The time the encoder took the capture.
+     * @param now The time the encoder finished.
+     */
+    void
+    encoded(std::uint64_t capture_nr, const std::optional<clock::time_point> &captured, clock::time_point started, clock::time_point now);
+
+    /**
+     * @brief Get the statistics since the last call to `reset_stats()`.
+     * @return The statistics.
+     */
+    const stats_t &
+    stats() const;
+
+    /**
+     * @brief Reset the statistics.
+     */
+    void
+    reset_stats();
+
+  private:
+    std::chrono::nanoseconds frame_interval;
+
+    // A moving average of the time from taking a capture to finishing its encode
+    std::chrono::nanoseconds encode_time {};
+    std::uint64_t last_capture_nr = 0;
+
+    stats_t current;
+  };
+}  // namespace video::deadline
@@ -54,6 +54,8 @@ namespace mail {
   MAIL(invalidate_ref_frames);
   MAIL(gamepad_feedback);
   MAIL(hdr);
+  MAIL(video_start);
+  MAIL(bitrate);
 #undef MAIL
 
 }  // namespace mail
@@ -13,6 +13,7 @@ extern "C" {
 #include <chrono>
 #include <cmath>
 #include <list>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 
@@ -109,15 +110,22 @@ namespace input {
     return std::clamp(from_netfloat(f), min, max);
   }
 
-  static task_pool_util::TaskPool::task_id_t key_press_repeat_id {};
   static std::unordered_map<key_press_id_t, bool> key_press {};
   static std::array<std::uint8_t, 5> mouse_press {};
 
   static platf::input_t platf_input;
   static std::bitset<platf::MAX_GAMEPADS> gamepadMask {};
 
+  // The input of each client runs on a strand of its own, but all clients share the keyboard and mouse
+  static std::mutex desktop_input_lock;
+
+  // Guards gamepadMask while gamepads of different clients come and go
+  static std::mutex gamepad_lock;
+
   void
   free_gamepad(platf::input_t &platf_input, int id) {
+    std::lock_guard lg(gamepad_lock);
+
     platf::gamepad_update(platf_input, id, platf::gamepad_state_t {});
     platf::free_gamepad(platf_input, id);
 
@@ -126,13 +134,6 @@ namespace input {
   struct gamepad_t {
     gamepad_t():
         gamepad_state {}, back_timeout_id {}, id { -1 }, back_button_state { button_state_e::NONE } {}
-    ~gamepad_t() {
-      if (id >= 0) {
-        task_pool.push([id = this->id]() {
-          free_gamepad(platf_input, id);
-        });
-      }
-    }
 
     platf::gamepad_state_t gamepad_state;
 
@@ -161,18 +162,41 @@ namespace input {
       platf::feedback_queue_t feedback_queue):
         shortcutFlags {},
         gamepads(MAX_GAMEPADS),
-        client_context { platf::allocate_client_input_context(platf_input) },
+        strand { task_pool.strand() },
+        client_context { platf::allocate_client_input_context(platf_input, strand) },
         touch_port_event { std::move(touch_port_event) },
         feedback_queue { std::move(feedback_queue) },
         mouse_left_button_timeout {},
+        key_press_repeat_id {},
         touch_port { { 0, 0, 0, 0 }, 0, 0, 1.0f },
         accumulated_vscroll_delta {},
         accumulated_hscroll_delta {} {}
 
+    ~input_t() {
+      // The timeouts and repeats of the gamepads, touch and pen input run on the strand,
+      // so they are freed there, after the input that is still queued
+      for (auto &gamepad : gamepads) {
+        if (gamepad.id >= 0) {
+          strand->post([id = std::exchange(gamepad.id, -1)]() {
+            free_gamepad(platf_input, id);
+          });
+        }
+      }
+
+      strand->post([client_context = std::move(client_context)]() mutable {
+        client_context.reset();
+      });
+    }
+
     // Keep track of alt+ctrl+shift key combo
     int shortcutFlags;
 
     std::vector<gamepad_t> gamepads;
+
+    // Keeps the input of this client in order, and runs its timeouts and repeats.
+    // The ids of the delayed tasks are only touched on the strand.
+    std::shared_ptr<thread_pool_util::Strand> strand;
+
     std::unique_ptr<platf::client_input_t> client_context;
 
     safe::mail_raw_t::event_t<input::touch_port_t> touch_port_event;
@@ -182,6 +206,7 @@ namespace input {
     std::mutex input_queue_lock;
 
     thread_pool_util::ThreadPool::task_id_t mouse_left_button_timeout;
+    thread_pool_util::ThreadPool::task_id_t key_press_repeat_id;
 
     input::touch_port_t touch_port;
 
@@ -600,6 +625,8 @@ namespace input {
      */
     if (button == BUTTON_LEFT && release && !input->mouse_left_button_timeout) {
       auto f = [=]() {
+        std::lock_guard lg(desktop_input_lock);
+
         auto left_released = mouse_press[BUTTON_LEFT];
         if (left_released) {
           // Already released left button
@@ -611,7 +638,7 @@ namespace input {
         input->mouse_left_button_timeout = nullptr;
       };
 
-      input->mouse_left_button_timeout = task_pool.pushDelayed(std::move(f), 10ms).task_id;
+      input->mouse_left_button_timeout = input->strand->postDelayed(std::move(f), 10ms);
 
       return;
     }
@@ -728,16 +755,18 @@ namespace input {
   }
 
   void
-  repeat_key(uint16_t key_code, uint8_t flags, uint8_t synthetic_modifiers) {
+  repeat_key(std::shared_ptr<input_t> input, uint16_t key_code, uint8_t flags, uint8_t synthetic_modifiers) {
+    std::lock_guard lg(desktop_input_lock);
+
     // If key no longer pressed, stop repeating
     if (!key_press[make_kpid(key_code, flags)]) {
-      key_press_repeat_id = nullptr;
+      input->key_press_repeat_id = nullptr;
       return;
     }
 
     send_key_and_modifiers(key_code, false, flags, synthetic_modifiers);
 
-    key_press_repeat_id = task_pool.pushDelayed(repeat_key, config::input.key_repeat_period, key_code, flags, synthetic_modifiers).task_id;
+    input->key_press_repeat_id = input->strand->postDelayed(repeat_key, config::input.key_repeat_period, input, key_code, flags, synthetic_modifiers);
   }
 
   void
@@ -773,12 +802,12 @@ namespace input {
           return;
         }
 
-        if (key_press_repeat_id) {
-          task_pool.cancel(key_press_repeat_id);
+        if (input->key_press_repeat_id) {
+          input->strand->cancel(input->key_press_repeat_id);
         }
 
         if (config::input.key_repeat_delay.count() > 0) {
-          key_press_repeat_id = task_pool.pushDelayed(repeat_key, config::input.key_repeat_delay, keyCode, packet->flags, synthetic_modifiers).task_id;
+          input->key_press_repeat_id = input->strand->postDelayed(repeat_key, config::input.key_repeat_delay, input, keyCode, packet->flags, synthetic_modifiers);
         }
       }
       else {
@@ -885,13 +914,15 @@ namespace input {
       util::endian::little(packet->supportedButtonFlags),
     };
 
+    std::lock_guard lg(gamepad_lock);
+
     auto id = alloc_id(gamepadMask);
     if (id < 0) {
       return;
     }
 
     // Allocate a new gamepad
-    if (platf::alloc_gamepad(platf_input, { id, packet->controllerNumber }, arrival, input->feedback_queue)) {
+    if (platf::alloc_gamepad(platf_input, { id, packet->controllerNumber }, arrival, input->feedback_queue, input->strand)) {
       free_id(gamepadMask, id);
       return;
     }
@@ -1130,12 +1161,14 @@ namespace input {
     // If this is an event for a new gamepad, create the gamepad now. Ideally, the client would
     // send a controller arrival instead of this but it's still supported for legacy clients.
     if ((packet->activeGamepadMask & (1 << packet->controllerNumber)) && gamepad.id < 0) {
+      std::lock_guard lg(gamepad_lock);
+
       auto id = alloc_id(gamepadMask);
       if (id < 0) {
         return;
       }
 
-      if (platf::alloc_gamepad(platf_input, { id, (uint8_t) packet->controllerNumber }, {}, input->feedback_queue)) {
+      if (platf::alloc_gamepad(platf_input, { id, (uint8_t) packet->controllerNumber }, {}, input->feedback_queue, input->strand)) {
         free_id(gamepadMask, id);
         return;
       }
@@ -1217,11 +1250,11 @@ namespace input {
             gamepad.back_timeout_id = nullptr;
           };
 
-          gamepad.back_timeout_id = task_pool.pushDelayed(std::move(f), config::input.back_button_timeout).task_id;
+          gamepad.back_timeout_id = input->strand->postDelayed(std::move(f), config::input.back_button_timeout);
         }
       }
       else if (gamepad.back_timeout_id) {
-        task_pool.cancel(gamepad.back_timeout_id);
+        input->strand->cancel(gamepad.back_timeout_id);
         gamepad.back_timeout_id = nullptr;
       }
     }
@@ -1523,7 +1556,30 @@ namespace input {
   }
 
   /**
-   * @brief Called on a thread pool thread to process an input message.
+   * @brief Check if an input message goes to the keyboard or mouse all clients share.
+   * @param magic The magic number of the message.
+   * @return `true` if the message needs `desktop_input_lock`.
+   */
+  bool
+  uses_desktop_input(uint32_t magic) {
+    switch (magic) {
+      case MOUSE_MOVE_REL_MAGIC_GEN5:
+      case MOUSE_MOVE_ABS_MAGIC:
+      case MOUSE_BUTTON_DOWN_EVENT_MAGIC_GEN5:
+      case MOUSE_BUTTON_UP_EVENT_MAGIC_GEN5:
+      case SCROLL_MAGIC_GEN5:
+      case SS_HSCROLL_MAGIC:
+      case KEY_DOWN_EVENT_MAGIC:
+      case KEY_UP_EVENT_MAGIC:
+      case UTF8_TEXT_EVENT_MAGIC:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  /**
+   * @brief Called on the strand of the client to process an input message.
    * @param input The input context pointer.
    */
   void
@@ -1573,6 +1629,12 @@ namespace input {
     // Print the final input packet
     input::print((void *) payload);
 
+    // Other clients type and move the same mouse
+    std::unique_lock<std::mutex> desktop_lock;
+    if (uses_desktop_input(util::endian::little(payload->magic))) {
+      desktop_lock = std::unique_lock { desktop_input_lock };
+    }
+
     // Send the batched input to the OS
     switch (util::endian::little(payload->magic)) {
       case MOUSE_MOVE_REL_MAGIC_GEN5:
@@ -1692,16 +1754,29 @@ namespace input {
       std::lock_guard<std::mutex> lg(input->input_queue_lock);
       input->input_queue.push_back(std::move(input_data));
     }
-    task_pool.push(passthrough_next_message, input);
+    input->strand->post(passthrough_next_message, input);
   }
 
   void
   reset(std::shared_ptr<input_t> &input) {
-    task_pool.cancel(key_press_repeat_id);
-    task_pool.cancel(input->mouse_left_button_timeout);
+    auto stats = input->strand->stats();
+    if (stats.tasks) {
+      BOOST_LOG(debug)
+        << "Input: "sv << stats.tasks << " messages, up to "sv << stats.max_queued << " queued, waited "sv
+        << std::chrono::duration_cast<std::chrono::microseconds>(stats.total_wait / stats.tasks).count() << "us on average and "sv
+        << std::chrono::duration_cast<std::chrono::microseconds>(stats.max_wait).count() << "us at most, took "sv
+        << std::chrono::duration_cast<std::chrono::microseconds>(stats.total_run / stats.tasks).count() << "us on average and "sv
+        << std::chrono::duration_cast<std::chrono::microseconds>(stats.max_run).count() << "us at most"sv;
+    }
+
+    // Stop the timeouts on the strand that posts them, then release what's still pressed,
+    // in between the input of the other clients
+    input->strand->post([input]() {
+      input->strand->cancel(input->key_press_repeat_id);
+      input->strand->cancel(input->mouse_left_button_timeout);
+
+      std::lock_guard lg(desktop_input_lock);
 
-    // Ensure input is synchronous, by using the task_pool
-    task_pool.push([]() {
       for (int x = 0; x < mouse_press.size(); ++x) {
         if (mouse_press[x]) {
           platf::button_mouse(platf_input, x, true);
@@ -1753,7 +1828,9 @@ namespace input {
       mail->queue<platf::gamepad_feedback_msg_t>(mail::gamepad_feedback));
 
     // Workaround to ensure new frames will be captured when a client connects
-    task_pool.pushDelayed([]() {
+    task_pool.postDelayed([]() {
+      std::lock_guard lg(desktop_input_lock);
+
       platf::move_mouse(platf_input, 1, 1);
       platf::move_mouse(platf_input, -1, -1);
     },
@@ -3,10 +3,13 @@
  * @brief Definitions for logging related functions.
  */
 // standard includes
+#include <atomic>
 #include <fstream>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
 
 // lib includes
 #include <boost/core/null_deleter.hpp>
@@ -31,6 +34,37 @@ namespace bl = boost::log;
 
 boost::shared_ptr<boost::log::sinks::asynchronous_sink<boost::log::sinks::text_ostream_backend>> sink;
 
+namespace {
+  std::mutex listeners_mutex;
+  std::map<std::uint64_t, logging::log_listener_cb_t> listeners;
+  std::uint64_t next_listener_id = 0;
+
+  // Checked by the listener sink filter, so records are never formatted for listeners unless someone is listening
+  std::atomic_bool has_listeners = false;
+
+  /**
+   * @brief Sink backend that forwards formatted records to the registered log listeners.
+   */
+  class listener_backend_t: public bl::sinks::basic_formatted_sink_backend<char, bl::sinks::synchronized_feeding> {
+  public:
+    void
+    consume(const bl::record_view &view, const string_type &line) {
+      auto log_level = view.attribute_values()["Severity"].extract<int>();
+      if (!log_level) {
+        return;
+      }
+
+      std::lock_guard lg { listeners_mutex };
+      for (auto &[id, callback] : listeners) {
+        callback(*log_level, line);
+      }
+    }
+  };
+
+  // Fed from a thread of its own like the file sink, so the capture and encode threads never wait on a listener
+  boost::shared_ptr<bl::sinks::asynchronous_sink<listener_backend_t>> listener_sink;
+}  // namespace
+
 bl::sources::severity_logger<int> verbose(0);  // Dominating output
 bl::sources::severity_logger<int> debug(1);  // Follow what is happening
 bl::sources::severity_logger<int> info(2);  // Should be informed about
@@ -53,6 +87,8 @@ namespace logging {
     log_flush();
     bl::core::get()->remove_sink(sink);
     sink.reset();
+    bl::core::get()->remove_sink(listener_sink);
+    listener_sink.reset();
   }
 
   void
@@ -136,6 +172,19 @@ namespace logging {
     sink->locked_backend()->auto_flush(true);
 
     bl::core::get()->add_sink(sink);
+
+    listener_sink = boost::make_shared<bl::sinks::asynchronous_sink<listener_backend_t>>();
+    listener_sink->set_filter([min_log_level](const bl::attribute_value_set &attrs) {
+      if (!has_listeners.load(std::memory_order_relaxed)) {
+        return false;
+      }
+
+      auto log_level = attrs["Severity"].extract<int>();
+      return log_level && *log_level >= min_log_level;
+    });
+    listener_sink->set_formatter(&formatter);
+    bl::core::get()->add_sink(listener_sink);
+
     return std::make_unique<deinit_t>();
   }
 
@@ -210,6 +259,79 @@ namespace logging {
     if (sink) {
       sink->flush();
     }
+    if (listener_sink) {
+      listener_sink->flush();
+    }
+  }
+
+  int
+  parse_log_level(std::string_view line) {
+    // Records start with "[YYYY-MM-DD HH:MM:SS.mmm]: <Severity>: "
+    if (line.empty() || line.front() != '[') {
+      return -1;
+    }
+
+    auto pos = line.find("]: "sv);
+    if (pos == std::string_view::npos) {
+      return -1;
+    }
+    line.remove_prefix(pos + 3);
+
+    constexpr std::pair<std::string_view, int> prefixes[] {
+      { "Verbose: "sv, 0 },
+      { "Debug: "sv, 1 },
+      { "Info: "sv, 2 },
+      { "Warning: "sv, 3 },
+      { "Error: "sv, 4 },
+      { "Fatal: "sv, 5 },
+    };
+    for (auto &[prefix, log_level] : prefixes) {
+      if (line.substr(0, prefix.size()) == prefix) {
+        return log_level;
+      }
+    }
+
+    return -1;
+  }
+
+  std::string
+  filter_log_level(std::string_view log, int min_log_level) {
+    std::string filtered;
+
+    // Lines before the first record header are kept, they may be the tail of a record cut by a range read
+    bool keep = true;
+    while (!log.empty()) {
+      auto end = log.find('\n');
+      auto line = log.substr(0, end == std::string_view::npos ? log.size() : end + 1);
+      log.remove_prefix(line.size());
+
+      auto log_level = parse_log_level(line);
+      if (log_level >= 0) {
+        keep = log_level >= min_log_level;
+      }
+
+      if (keep) {
+        filtered += line;
+      }
+    }
+
+    return filtered;
+  }
+
+  log_listener_t::~log_listener_t() {
+    std::lock_guard lg { listeners_mutex };
+    listeners.erase(id);
+    has_listeners = !listeners.empty();
+  }
+
+  std::unique_ptr<log_listener_t>
+  add_log_listener(log_listener_cb_t callback) {
+    std::lock_guard lg { listeners_mutex };
+    auto id = next_listener_id++;
+    listeners.emplace(id, std::move(callback));
+    has_listeners = true;
+
+    return std::make_unique<log_listener_t>(id);
   }
 
   void
@@ -222,6 +344,7 @@ namespace logging {
       << std::endl
       << "    --help                    | print help"sv << std::endl
       << "    --creds username password | set user credentials for the Web manager"sv << std::endl
+      << "    --fec-benchmark           | print the throughput of each FEC kernel"sv << std::endl
       << "    --version                 | print the version of sunshine"sv << std::endl
       << std::endl
       << "    flags"sv << std::endl
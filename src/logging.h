@@ -4,6 +4,13 @@
  */
 #pragma once
 
+// standard includes
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
 // lib includes
 #include <boost/log/common.hpp>
 #include <boost/log/sinks.hpp>
@@ -82,6 +89,67 @@ namespace logging {
   void
   log_flush();
 
+  /**
+   * @brief Get the severity of a formatted log line.
+   * @param line A single line as written by `formatter()`.
+   * @return The severity of the record, or `-1` if the line is the continuation of a multi-line record.
+   * @examples
+   * int level = parse_log_level("[2024-01-01 12:00:00.000]: Warning: Something happened");
+   * @examples_end
+   */
+  int
+  parse_log_level(std::string_view line);
+
+  /**
+   * @brief Keep only the records of a formatted log that are at or above a severity.
+   * @details Continuation lines of multi-line records share the fate of the record they belong to.
+   * @param log The formatted log contents.
+   * @param min_log_level The minimum severity to keep.
+   * @return The filtered log contents.
+   * @examples
+   * std::string warnings = filter_log_level(read_file("sunshine.log"), 3);
+   * @examples_end
+   */
+  std::string
+  filter_log_level(std::string_view log, int min_log_level);
+
+  /**
+   * @brief Callback invoked with the severity and formatted line of every new log record.
+   */
+  using log_listener_cb_t = std::function<void(int, const std::string &)>;
+
+  /**
+   * @brief A registered log listener, it is removed when this object is destroyed.
+   */
+  class log_listener_t {
+  public:
+    explicit log_listener_t(std::uint64_t id):
+        id { id } {}
+    ~log_listener_t();
+
+    log_listener_t(const log_listener_t &) = delete;
+    log_listener_t &
+    operator=(const log_listener_t &) = delete;
+
+  private:
+    std::uint64_t id;
+  };
+
+  /**
+   * @brief Register a callback that receives log records as they are emitted.
+   * @details The callback runs on the thread that feeds the listeners, so a slow listener never holds up
+   * the thread that emitted the record. It must still return quickly, since it delays the other listeners,
+   * and it must not log. Records that are still queued are delivered by `log_flush()`.
+   * Records are only formatted for listeners while at least one listener is registered.
+   * @param callback The callback to invoke for each record.
+   * @return An object that unregisters the callback when it goes out of scope.
+   * @examples
+   * auto listener = add_log_listener([](int level, const std::string &line) { ... });
+   * @examples_end
+   */
+  [[nodiscard]] std::unique_ptr<log_listener_t>
+  add_log_listener(log_listener_cb_t callback);
+
   /**
    * @brief Print help to stdout.
    * @param name The name of the program.
@@ -3,15 +3,18 @@
  * @brief Definitions for the main entry point for Sunshine.
  */
 // standard includes
+#include <algorithm>
 #include <codecvt>
 #include <csignal>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 // local includes
 #include "confighttp.h"
 #include "display_device.h"
 #include "entry_handler.h"
+#include "fec.h"
 #include "globals.h"
 #include "httpcommon.h"
 #include "logging.h"
@@ -23,10 +26,6 @@
 #include "version.h"
 #include "video.h"
 
-extern "C" {
-#include "rswrapper.h"
-}
-
 using namespace std::literals;
 
 std::map<int, std::function<void()>> signal_handlers;
@@ -45,6 +44,7 @@ on_signal(int sig, FN &&fn) {
 
 std::map<std::string_view, std::function<int(const char *name, int argc, char **argv)>> cmd_to_func {
   { "creds"sv, [](const char *name, int argc, char **argv) { return args::creds(name, argc, argv); } },
+  { "fec-benchmark"sv, [](const char *name, int argc, char **argv) { return args::fec_benchmark(); } },
   { "help"sv, [](const char *name, int argc, char **argv) { return args::help(name); } },
   { "version"sv, [](const char *name, int argc, char **argv) { return args::version(); } },
 #ifdef _WIN32
@@ -232,7 +232,9 @@ main(int argc, char *argv[]) {
 
 #endif
 
-  task_pool.start(1);
+  // The input of each client runs on a strand of its own, so clients don't wait for each other.
+  // Tasks that cancel and repost their own delayed tasks do so on a strand as well.
+  task_pool.start(std::clamp((int) std::thread::hardware_concurrency(), 2, 4));
 
 #if defined SUNSHINE_TRAY && SUNSHINE_TRAY >= 1
   // create tray thread and detach it
@@ -249,7 +251,7 @@ main(int argc, char *argv[]) {
       logging::log_flush();
       lifetime::debug_trap();
     };
-    force_shutdown = task_pool.pushDelayed(task, 10s).task_id;
+    force_shutdown = task_pool.postDelayed(task, 10s);
 
     shutdown_event->raise(true);
     display_device_deinit_guard = nullptr;
@@ -263,7 +265,7 @@ main(int argc, char *argv[]) {
       logging::log_flush();
       lifetime::debug_trap();
     };
-    force_shutdown = task_pool.pushDelayed(task, 10s).task_id;
+    force_shutdown = task_pool.postDelayed(task, 10s);
 
     shutdown_event->raise(true);
     display_device_deinit_guard = nullptr;
@@ -289,7 +291,7 @@ main(int argc, char *argv[]) {
     BOOST_LOG(error) << "Proc failed to initialize"sv;
   }
 
-  reed_solomon_init();
+  stream::fec::init(config::stream.fec_kernel);
   auto input_deinit_guard = input::init();
 
   if (input::probe_gamepads()) {
@@ -0,0 +1,48 @@
+/**
+ * @file src/nal.cpp
+ * @brief Definitions for finding NAL units in H.264 and HEVC access units.
+ */
+// standard includes
+#include <cstring>
+
+// local includes
+#include "nal.h"
+
+namespace nal {
+  const std::uint8_t *
+  find_start_code(const std::uint8_t *begin, const std::uint8_t *end) {
+    if (end - begin < 3) {
+      return end;
+    }
+
+    // memchr() is vectorized, so look for the 01 and check for the zeros in front of it
+    auto next = begin + 2;
+    while (next < end) {
+      next = (const std::uint8_t *) std::memchr(next, 0x01, end - next);
+      if (!next) {
+        return end;
+      }
+
+      if (next[-1] == 0 && next[-2] == 0) {
+        return next - 2;
+      }
+
+      // The next start code can't have this 01 in its zeros
+      next += 3;
+    }
+
+    return end;
+  }
+
+  bool
+  is_vcl(std::uint8_t header, bool hevc) {
+    if (hevc) {
+      // nal_unit_type 0 through 31
+      return ((header >> 1) & 0x3F) < 32;
+    }
+
+    // nal_unit_type 1 through 5
+    auto type = header & 0x1F;
+    return type >= 1 && type <= 5;
+  }
+}  // namespace nal
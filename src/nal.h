@@ -0,0 +1,97 @@
+/**
+ * @file src/nal.h
+ * @brief Declarations for finding NAL units in H.264 and HEVC access units.
+ */
+#pragma once
+
+// standard includes
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Finds NAL units in Annex B access units without parsing them.
+ */
+namespace nal {
+  /**
+   * @brief Find the next Annex B start code.
+   * @param begin The start of the data to search.
+   * @param end The end of the data to search.
+   * @return A pointer to the `00 00 01` of the start code, or `end` if there is none.
+   */
+  const std::uint8_t *
+  find_start_code(const std::uint8_t *begin, const std::uint8_t *end);
+
+  /**
+   * @brief Check if a NAL unit holds a slice of the picture.
+   * @details Parameter sets never follow the first slice of an access unit.
+   * @param header The first byte of the NAL unit header.
+   * @param hevc `true` for HEVC, `false` for H.264.
+   * @return `true` for the NAL unit types of coded slices.
+   */
+  bool
+  is_vcl(std::uint8_t header, bool hevc);
+
+  /**
+   * @brief Split an access unit around the parameter sets that are to be replaced.
+   * @details Only the NAL units in front of the first slice are looked at, so the bulk of the
+   * access unit is neither searched nor copied. Each replaced NAL unit is matched together
+   * with its start code, like `cbs::make_sps_h264()` and `cbs::make_sps_hevc()` write them.
+   * @param access_unit The Annex B access unit.
+   * @param replacements The NAL units to replace, with an `old` and a `_new` view each.
+   * @param hevc `true` for HEVC, `false` for H.264.
+   * @param segments The pieces of the access unit and the new NAL units are appended to it, in order.
+   * @return The number of NAL units that were replaced.
+   */
+  template <class Replacements>
+  int
+  splice_parameter_sets(std::string_view access_unit, const Replacements &replacements, bool hevc, std::vector<std::string_view> &segments) {
+    auto begin = (const std::uint8_t *) access_unit.data();
+    auto end = begin + access_unit.size();
+
+    // The access unit up to here is already in segments
+    std::size_t spliced = 0;
+    int replaced = 0;
+
+    auto replace_at = [&](std::size_t offset) {
+      for (auto &replacement : replacements) {
+        if (replacement.old.empty() || access_unit.substr(offset).substr(0, replacement.old.size()) != replacement.old) {
+          continue;
+        }
+
+        segments.emplace_back(access_unit.substr(spliced, offset - spliced));
+        segments.emplace_back(replacement._new);
+        spliced = offset + replacement.old.size();
+        ++replaced;
+
+        return true;
+      }
+
+      return false;
+    };
+
+    for (auto start_code = find_start_code(begin, end); start_code + 3 < end; start_code = find_start_code(start_code + 3, end)) {
+      if (is_vcl(start_code[3], hevc)) {
+        break;
+      }
+
+      auto offset = (std::size_t) (start_code - begin);
+      if (offset < spliced) {
+        continue;
+      }
+
+      // The zero_byte in front of a 4 byte start code may or may not be part of the old NAL unit
+      if (!(offset > spliced && start_code[-1] == 0 && replace_at(offset - 1))) {
+        replace_at(offset);
+      }
+
+      if (replaced == (int) std::size(replacements)) {
+        break;
+      }
+    }
+
+    segments.emplace_back(access_unit.substr(spliced));
+    return replaced;
+  }
+}  // namespace nal
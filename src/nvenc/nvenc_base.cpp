@@ -293,6 +293,33 @@ namespace nvenc {
       vui_config.chromaSampleLocationBot = 0;
     };
 
+    auto set_intra_refresh = [&](auto &format_config, uint32_t period) {
+      if (!get_encoder_cap(NV_ENC_CAPS_SUPPORT_INTRA_REFRESH)) {
+        return false;
+      }
+      format_config.enableIntraRefresh = 1;
+      format_config.intraRefreshPeriod = period;
+      format_config.intraRefreshCnt = period - 1;
+      if (get_encoder_cap(NV_ENC_CAPS_SINGLE_SLICE_INTRA_REFRESH)) {
+        format_config.singleSliceIntraRefresh = 1;
+      }
+      else {
+        BOOST_LOG(warning) << "NvEnc: Single Slice Intra Refresh not supported";
+      }
+      return true;
+    };
+
+    // Lost frames that can't be invalidated are healed by a wave of intra refresh instead of an IDR frame,
+    // which spreads the cost of the intra blocks over the frames of the wave
+    auto set_recovery_intra_refresh = [&](auto &format_config) {
+      if (set_intra_refresh(format_config, config.recovery_intra_refresh_frames)) {
+        encoder_params.intra_refresh_frames = config.recovery_intra_refresh_frames;
+      }
+      else {
+        BOOST_LOG(warning) << "NvEnc: gpu doesn't support intra refresh, recovering with IDR frames";
+      }
+    };
+
     switch (client_config.videoFormat) {
       case 0: {
         // H.264
@@ -308,6 +335,9 @@ namespace nvenc {
         set_ref_frames(format_config.maxNumRefFrames, format_config.numRefL0, 5);
         set_minqp_if_enabled(config.min_qp_h264);
         fill_h264_hevc_vui(format_config.h264VUIParameters);
+        if (config.recovery_intra_refresh_frames) {
+          set_recovery_intra_refresh(format_config);
+        }
         break;
       }
 
@@ -321,19 +351,11 @@ namespace nvenc {
         set_ref_frames(format_config.maxNumRefFramesInDPB, format_config.numRefL0, 5);
         set_minqp_if_enabled(config.min_qp_hevc);
         fill_h264_hevc_vui(format_config.hevcVUIParameters);
-        if (client_config.enableIntraRefresh == 1 || config.intra_refresh) {
-          if (get_encoder_cap(NV_ENC_CAPS_SUPPORT_INTRA_REFRESH)) {
-            format_config.enableIntraRefresh = 1;
-            format_config.intraRefreshPeriod = 300;
-            format_config.intraRefreshCnt = 299;
-            if (get_encoder_cap(NV_ENC_CAPS_SINGLE_SLICE_INTRA_REFRESH)) {
-              format_config.singleSliceIntraRefresh = 1;
-            }
-            else {
-              BOOST_LOG(warning) << "NvEnc: Single Slice Intra Refresh not supported";
-            }
-          }
-          else {
+        if (config.recovery_intra_refresh_frames) {
+          set_recovery_intra_refresh(format_config);
+        }
+        else if (client_config.enableIntraRefresh == 1 || config.intra_refresh) {
+          if (!set_intra_refresh(format_config, 300)) {
             BOOST_LOG(error) << "NvEnc: Client asked for intra-refresh but the encoder does not support intra-refresh";
           }
         }
@@ -415,6 +437,7 @@ namespace nvenc {
       if (enc_config.rcParams.multiPass != NV_ENC_MULTI_PASS_DISABLED) extra += " two-pass";
       if (config.vbv_percentage_increase > 0 && get_encoder_cap(NV_ENC_CAPS_SUPPORT_CUSTOM_VBV_BUF_SIZE)) extra += " vbv+" + std::to_string(config.vbv_percentage_increase);
       if (encoder_params.rfi) extra += " rfi";
+      if (encoder_params.intra_refresh_frames) extra += " intra-refresh=" + std::to_string(encoder_params.intra_refresh_frames);
       if (init_params.enableWeightedPrediction) extra += " weighted-prediction";
       if (enc_config.rcParams.enableAQ) extra += " spatial-aq";
       if (enc_config.rcParams.enableMinQP) extra += " qpmin=" + std::to_string(enc_config.rcParams.minQP.qpInterP);
@@ -423,6 +446,12 @@ namespace nvenc {
       BOOST_LOG(info) << "NvEnc: created encoder " << video_format_string << quality_preset_string_from_guid(init_params.presetGUID) << extra;
     }
 
+    reconfigure_params.init_params = init_params;
+    reconfigure_params.enc_config = enc_config;
+    reconfigure_params.init_params.encodeConfig = &reconfigure_params.enc_config;
+    reconfigure_params.custom_vbv = get_encoder_cap(NV_ENC_CAPS_SUPPORT_CUSTOM_VBV_BUF_SIZE);
+    reconfigure_params.vbv_percentage_increase = config.vbv_percentage_increase;
+
     encoder_state = {};
     fail_guard.disable();
     return true;
@@ -458,10 +487,11 @@ namespace nvenc {
 
     encoder_state = {};
     encoder_params = {};
+    reconfigure_params = {};
   }
 
   nvenc_encoded_frame
-  nvenc_base::encode_frame(uint64_t frame_index, bool force_idr) {
+  nvenc_base::encode_frame(uint64_t frame_index, bool force_idr, std::vector<uint8_t> &&buffer) {
     if (!encoder) {
       return {};
     }
@@ -498,6 +528,17 @@ namespace nvenc {
     pic_params.outputBitstream = output_bitstream;
     pic_params.completionEvent = async_event_handle;
 
+    if (encoder_state.intra_refresh_needed && !force_idr) {
+      if (equal_guids(reconfigure_params.init_params.encodeGUID, NV_ENC_CODEC_HEVC_GUID)) {
+        pic_params.codecPicParams.hevcPicParams.forceIntraRefreshWithFrameCnt = encoder_params.intra_refresh_frames;
+      }
+      else {
+        pic_params.codecPicParams.h264PicParams.forceIntraRefreshWithFrameCnt = encoder_params.intra_refresh_frames;
+      }
+      BOOST_LOG(debug) << "NvEnc: intra refresh from frame " << frame_index;
+    }
+    encoder_state.intra_refresh_needed = false;
+
     if (nvenc_failed(nvenc->nvEncEncodePicture(encoder, &pic_params))) {
       BOOST_LOG(error) << "NvEnc: NvEncEncodePicture() failed: " << last_nvenc_error_string;
       return {};
@@ -518,8 +559,10 @@ namespace nvenc {
     }
 
     auto data_pointer = (uint8_t *) lock_bitstream.bitstreamBufferPtr;
+    buffer.assign(data_pointer, data_pointer + lock_bitstream.bitstreamSizeInBytes);
+
     nvenc_encoded_frame encoded_frame {
-      { data_pointer, data_pointer + lock_bitstream.bitstreamSizeInBytes },
+      std::move(buffer),
       lock_bitstream.outputTimeStamp,
       lock_bitstream.pictureType == NV_ENC_PIC_TYPE_IDR,
       encoder_state.rfi_needs_confirmation,
@@ -547,7 +590,9 @@ namespace nvenc {
 
   bool
   nvenc_base::invalidate_ref_frames(uint64_t first_frame, uint64_t last_frame) {
-    if (!encoder || !encoder_params.rfi) return false;
+    if (!encoder) return false;
+
+    if (!encoder_params.rfi) return start_intra_refresh();
 
     if (first_frame >= encoder_state.last_rfi_range.first &&
         last_frame <= encoder_state.last_rfi_range.second) {
@@ -568,6 +613,11 @@ namespace nvenc {
     encoder_state.last_rfi_range = { first_frame, last_frame };
 
     if (last_frame - first_frame + 1 >= encoder_params.ref_frames_in_dpb) {
+      if (start_intra_refresh()) {
+        BOOST_LOG(debug) << "NvEnc: rfi request too large, starting intra refresh";
+        return true;
+      }
+
       BOOST_LOG(debug) << "NvEnc: rfi request too large, generating IDR";
       return false;
     }
@@ -582,6 +632,49 @@ namespace nvenc {
     return true;
   }
 
+  bool
+  nvenc_base::start_intra_refresh() {
+    if (!encoder_params.intra_refresh_frames) return false;
+
+    // The frames of the wave may still reference the lost ones, so they can't confirm the invalidation
+    encoder_state.rfi_needs_confirmation = false;
+    encoder_state.intra_refresh_needed = true;
+    return true;
+  }
+
+  bool
+  nvenc_base::set_bitrate(uint32_t bitrate_kbps) {
+    if (!encoder) return false;
+
+    auto enc_config = reconfigure_params.enc_config;
+    enc_config.rcParams.averageBitRate = bitrate_kbps * 1000;
+
+    if (reconfigure_params.custom_vbv) {
+      enc_config.rcParams.vbvBufferSize = bitrate_kbps * 1000 / reconfigure_params.init_params.frameRateNum;
+      if (reconfigure_params.vbv_percentage_increase > 0) {
+        enc_config.rcParams.vbvBufferSize += enc_config.rcParams.vbvBufferSize * reconfigure_params.vbv_percentage_increase / 100;
+      }
+    }
+
+    NV_ENC_RECONFIGURE_PARAMS params = { min_struct_version(NV_ENC_RECONFIGURE_PARAMS_VER) };
+    params.reInitEncodeParams = reconfigure_params.init_params;
+    params.reInitEncodeParams.encodeConfig = &enc_config;
+
+    // Keep the references, the client only sees the frame sizes change
+    params.resetEncoder = 0;
+    params.forceIDR = 0;
+
+    if (nvenc_failed(nvenc->nvEncReconfigureEncoder(encoder, &params))) {
+      BOOST_LOG(error) << "NvEnc: NvEncReconfigureEncoder() failed: " << last_nvenc_error_string;
+      return false;
+    }
+
+    reconfigure_params.enc_config = enc_config;
+
+    BOOST_LOG(debug) << "NvEnc: bitrate changed to " << bitrate_kbps << " Kbps";
+    return true;
+  }
+
   bool
   nvenc_base::nvenc_failed(NVENCSTATUS status) {
     auto status_string = [](NVENCSTATUS status) -> std::string {
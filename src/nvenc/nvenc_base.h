@@ -58,10 +58,11 @@ namespace nvenc {
      *        Afterwards serves as parameter for `invalidate_ref_frames()`.
      *        No restrictions on the first frame index, but later frame indexes must be subsequent.
      * @param force_idr Whether to encode frame as forced IDR.
+     * @param buffer Storage to reuse for the encoded data, its contents are replaced.
      * @return Encoded frame.
      */
     nvenc_encoded_frame
-    encode_frame(uint64_t frame_index, bool force_idr);
+    encode_frame(uint64_t frame_index, bool force_idr, std::vector<uint8_t> &&buffer = {});
 
     /**
      * @brief Perform reference frame invalidation (RFI) procedure.
@@ -69,10 +70,20 @@ namespace nvenc {
      * @param last_frame Last frame index of the invalidation range.
      * @return `true` on success, `false` on error.
      *         After error next frame must be encoded with `force_idr = true`.
+     *         With `recovery_intra_refresh_frames` set, requests that can't be fulfilled start a wave of intra refresh instead.
      */
     bool
     invalidate_ref_frames(uint64_t first_frame, uint64_t last_frame);
 
+    /**
+     * @brief Change the bitrate of the encoder without recreating it.
+     * @param bitrate_kbps The new bitrate in Kbps.
+     * @return `true` on success, `false` on error.
+     *         After error the encoder keeps its previous bitrate.
+     */
+    bool
+    set_bitrate(uint32_t bitrate_kbps);
+
   protected:
     /**
      * @brief Required. Used for loading NvEnc library and setting `nvenc` variable with `NvEncodeAPICreateInstance()`.
@@ -132,6 +143,7 @@ namespace nvenc {
       NV_ENC_BUFFER_FORMAT buffer_format = NV_ENC_BUFFER_FORMAT_UNDEFINED;
       uint32_t ref_frames_in_dpb = 0;
       bool rfi = false;
+      uint32_t intra_refresh_frames = 0;
     } encoder_params;
 
     std::string last_nvenc_error_string;
@@ -147,15 +159,31 @@ namespace nvenc {
                                          ///< Can be set in constructor or `init_library()`, must override `wait_for_async_event()`.
 
   private:
+    /**
+     * @brief Encode the next frame with a forced wave of intra refresh, if recovery by intra refresh is enabled.
+     * @return `true` if the wave was started, `false` if an IDR frame is needed instead.
+     */
+    bool
+    start_intra_refresh();
+
     NV_ENC_OUTPUT_PTR output_bitstream = nullptr;
     uint32_t minimum_api_version = 0;
 
     struct {
       uint64_t last_encoded_frame_index = 0;
       bool rfi_needs_confirmation = false;
+      bool intra_refresh_needed = false;
       std::pair<uint64_t, uint64_t> last_rfi_range;
       logging::min_max_avg_periodic_logger<double> frame_size_logger = { debug, "NvEnc: encoded frame sizes in kB", "" };
     } encoder_state;
+
+    // The parameters the encoder was initialized with, reconfiguring it requires all of them
+    struct {
+      NV_ENC_INITIALIZE_PARAMS init_params;
+      NV_ENC_CONFIG enc_config;
+      bool custom_vbv;
+      uint32_t vbv_percentage_increase;
+    } reconfigure_params = {};
   };
 
 }  // namespace nvenc
@@ -51,6 +51,9 @@ namespace nvenc {
 
     // Intra refresh for clients that doesn't request keyframe correctly
     bool intra_refresh = false;
+
+    // Recover from lost frames with intra refresh waves of this many frames instead of IDR frames, 0 to disable
+    unsigned recovery_intra_refresh_frames = 0;
   };
 
 }  // namespace nvenc
@@ -6,7 +6,11 @@
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
 
 // standard includes
+#include <algorithm>
+#include <array>
+#include <deque>
 #include <filesystem>
+#include <mutex>
 #include <utility>
 #include <string>
 
@@ -37,6 +41,7 @@
 #include "utility.h"
 #include "uuid.h"
 #include "video.h"
+#include "xml_writer.h"
 
 #ifdef _WIN32
   #include "platform/windows/virtual_display.h"
@@ -63,6 +68,49 @@ namespace nvhttp {
   static std::string otp_device_name;
   static std::chrono::time_point<std::chrono::steady_clock> otp_creation_time;
 
+  static struct {
+    std::atomic<std::uint64_t> handshakes;
+    std::atomic<std::uint64_t> resumed_handshakes;
+    std::atomic<std::uint64_t> requests;
+    std::atomic<std::uint64_t> kept_alive_requests;
+
+    // The times of the handshakes of the last minute, the rate is computed from them when it's read
+    std::mutex rate_lock;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::deque<std::chrono::steady_clock::time_point> recent_handshakes;
+  } tls_counters;
+
+  constexpr auto handshake_rate_window = 1min;
+
+  void
+  count_handshake(bool resumed) {
+    ++tls_counters.handshakes;
+    if (resumed) {
+      ++tls_counters.resumed_handshakes;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard lg(tls_counters.rate_lock);
+
+    auto &recent = tls_counters.recent_handshakes;
+    while (!recent.empty() && now - recent.front() > handshake_rate_window) {
+      recent.pop_front();
+    }
+    recent.push_back(now);
+  }
+
+  void
+  enable_session_resumption(SSL_CTX *ctx) {
+    // Both by session id and by session ticket. The client certificate is kept in the session,
+    // so it can be verified again when the session is resumed.
+    static constexpr unsigned char session_id_context[] = "nvhttp";
+    SSL_CTX_set_session_id_context(ctx, session_id_context, sizeof(session_id_context) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, 1024);
+    SSL_CTX_set_timeout(ctx, 24 * 60 * 60);
+  }
+
   class SunshineHTTPS: public SimpleWeb::HTTPS {
   public:
     SunshineHTTPS(boost::asio::io_context &io_context, boost::asio::ssl::context &ctx):
@@ -85,14 +133,32 @@ namespace nvhttp {
       context.set_options(boost::asio::ssl::context::no_tlsv1_1);
       context.use_certificate_chain_file(certification_file);
       context.use_private_key_file(private_key_file, boost::asio::ssl::context::pem);
+
+      enable_session_resumption(context.native_handle());
     }
 
     std::function<bool(std::shared_ptr<Request>, SSL*)> verify;
     std::function<void(std::shared_ptr<Response>, std::shared_ptr<Request>)> on_verify_failed;
 
+    /**
+     * @brief Verify the client of a request that followed another one on a kept-alive connection.
+     * @details The certificate of the connection's TLS session is checked against the paired clients again,
+     * so a client that was unpaired in the meantime is refused.
+     * @param request The request, which doesn't carry the client from the handshake.
+     * @return `true` if the client is paired.
+     */
+    bool
+    verify_kept_alive(const std::shared_ptr<Request> &request) {
+      auto connection = connections.find(request->remote_endpoint());
+      return connection && verify(request, connection->socket->native_handle());
+    }
+
   protected:
     boost::asio::ssl::context context;
 
+    // The verified connections, which outlive the requests that arrive on them
+    connection_table_t<Connection> connections;
+
     void
     after_bind() override {
       if (verify) {
@@ -131,10 +197,18 @@ namespace nvhttp {
             if (!lock)
               return;
             if (!ec) {
-              if (verify && !verify(session->request, session->connection->socket->native_handle()))
+              auto ssl = session->connection->socket->native_handle();
+              count_handshake(SSL_session_reused(ssl));
+
+              if (verify && !verify(session->request, ssl))
                 this->write(session, on_verify_failed);
-              else
+              else {
+                if (verify) {
+                  connections.add(session->request->remote_endpoint(), session->connection);
+                }
+
                 this->read(session);
+              }
             }
             else if (this->on_error)
               this->on_error(session->request, ec);
@@ -561,6 +635,71 @@ namespace nvhttp {
     return (crypto::named_cert_t*)request->userp.get();
   }
 
+  void
+  verify_failed(resp_https_t response, req_https_t request) {
+    pt::ptree tree;
+    auto g = util::fail_guard([&]() {
+      std::ostringstream data;
+
+      pt::write_xml(data, tree);
+      response->write(data.str());
+      response->close_connection_after_response = true;
+    });
+
+    tree.put("root.<xmlattr>.status_code"s, 401);
+    tree.put("root.<xmlattr>.query"s, request->path);
+    tree.put("root.<xmlattr>.status_message"s, "The client is not authorized. Certificate verification failed."s);
+  }
+
+  /**
+   * @brief Only let verified clients through to a handler of the HTTPS server.
+   * @details The first request of a connection was verified during the handshake. The requests
+   * that follow it on a kept-alive connection are verified against their connection's TLS session.
+   */
+  template <class F>
+  auto
+  verified(https_server_t &server, F &&handler) {
+    return [&server, handler = std::forward<F>(handler)](resp_https_t response, req_https_t request) {
+      if (!request->userp) {
+        if (!server.verify_kept_alive(request)) {
+          verify_failed(response, request);
+          return;
+        }
+
+        ++tls_counters.kept_alive_requests;
+      }
+
+      ++tls_counters.requests;
+      handler(response, request);
+    };
+  }
+
+  tls_stats_t
+  get_tls_stats() {
+    tls_stats_t stats {
+      tls_counters.handshakes,
+      tls_counters.resumed_handshakes,
+      tls_counters.requests,
+      tls_counters.kept_alive_requests,
+    };
+
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard lg(tls_counters.rate_lock);
+
+    auto &recent = tls_counters.recent_handshakes;
+    while (!recent.empty() && now - recent.front() > handshake_rate_window) {
+      recent.pop_front();
+    }
+
+    // Right after the server started, the window is as long as it has been running
+    auto window = std::min<std::chrono::steady_clock::duration>(now - tls_counters.started, handshake_rate_window);
+    auto seconds = std::chrono::duration<double>(window).count();
+    stats.handshakes_per_second = seconds > 0 ? recent.size() / seconds : 0.0;
+
+    return stats;
+  }
+
   template <class T>
   void
   print_req(std::shared_ptr<typename SimpleWeb::ServerBase<T>::Request> request) {
@@ -771,6 +910,166 @@ namespace nvhttp {
     return true;
   }
 
+  /**
+   * @brief The parts of the serverinfo and applist responses that are the same for every request.
+   * @details Clients poll serverinfo every few seconds, so the responses are rendered once and only
+   * rendered again when what they were rendered from changes. The fields that depend on the client,
+   * its permissions or the running app are filled in for every request.
+   */
+  struct cached_responses_t {
+    /**
+     * @brief What the cached responses were rendered from.
+     */
+    struct source_t {
+      std::string hostname;
+      int hevc_mode;
+      int av1_mode;
+      std::array<bool, 3> yuv444;
+      std::uint64_t apps_generation;
+
+      bool
+      operator==(const source_t &) const = default;
+    };
+
+    source_t source;
+
+    // From the XML declaration up to and including MaxLumaPixelsHEVC
+    std::string serverinfo_head;
+
+    // The ServerCodecModeSupport element
+    std::string serverinfo_codecs;
+
+    // The complete applist response for clients allowed to list the apps
+    std::string applist;
+  };
+
+  static std::mutex cached_responses_lock;
+  static std::shared_ptr<const cached_responses_t> cached_responses;
+
+  uint32_t
+  server_codec_mode_support() {
+    uint32_t codec_mode_flags = SCM_H264;
+    if (video::last_encoder_probe_supported_yuv444_for_codec[0]) {
+      codec_mode_flags |= SCM_H264_HIGH8_444;
+    }
+    if (video::active_hevc_mode >= 2) {
+      codec_mode_flags |= SCM_HEVC;
+      if (video::last_encoder_probe_supported_yuv444_for_codec[1]) {
+        codec_mode_flags |= SCM_HEVC_REXT8_444;
+      }
+    }
+    if (video::active_hevc_mode >= 3) {
+      codec_mode_flags |= SCM_HEVC_MAIN10;
+      if (video::last_encoder_probe_supported_yuv444_for_codec[1]) {
+        codec_mode_flags |= SCM_HEVC_REXT10_444;
+      }
+    }
+    if (video::active_av1_mode >= 2) {
+      codec_mode_flags |= SCM_AV1_MAIN8;
+      if (video::last_encoder_probe_supported_yuv444_for_codec[2]) {
+        codec_mode_flags |= SCM_AV1_HIGH8_444;
+      }
+    }
+    if (video::active_av1_mode >= 3) {
+      codec_mode_flags |= SCM_AV1_MAIN10;
+      if (video::last_encoder_probe_supported_yuv444_for_codec[2]) {
+        codec_mode_flags |= SCM_AV1_HIGH10_444;
+      }
+    }
+
+    return codec_mode_flags;
+  }
+
+  std::shared_ptr<const cached_responses_t>
+  render_responses(cached_responses_t::source_t &&source) {
+    auto responses = std::make_shared<cached_responses_t>();
+
+    auto &head = responses->serverinfo_head;
+    xml::begin_document(head, 200);
+    xml::element(head, "hostname"sv, config::nvhttp.sunshine_name);
+    xml::element(head, "appversion"sv, VERSION);
+    xml::element(head, "GfeVersion"sv, GFE_VERSION);
+    xml::element(head, "uniqueid"sv, http::unique_id);
+    xml::element(head, "HttpsPort"sv, net::map_port(PORT_HTTPS));
+    xml::element(head, "ExternalPort"sv, net::map_port(PORT_HTTP));
+    xml::element(head, "MaxLumaPixelsHEVC"sv, video::active_hevc_mode > 1 ? "1869449984"sv : "0"sv);
+
+    xml::element(responses->serverinfo_codecs, "ServerCodecModeSupport"sv, server_codec_mode_support());
+
+    auto &applist = responses->applist;
+    xml::begin_document(applist, 200);
+    for (auto &app : proc::proc.get_apps()) {
+      xml::open(applist, "App"sv);
+      xml::element(applist, "IsHdrSupported"sv, video::active_hevc_mode == 3 ? 1 : 0);
+      xml::element(applist, "AppTitle"sv, app.name);
+      xml::element(applist, "UUID"sv, app.uuid);
+      xml::element(applist, "ID"sv, app.id);
+      xml::close(applist, "App"sv);
+    }
+    xml::end_document(applist);
+
+    responses->source = std::move(source);
+    return responses;
+  }
+
+  /**
+   * @return The cached responses, rendered again if what they were rendered from changed.
+   */
+  std::shared_ptr<const cached_responses_t>
+  get_cached_responses() {
+    cached_responses_t::source_t source {
+      config::nvhttp.sunshine_name,
+      video::active_hevc_mode,
+      video::active_av1_mode,
+      video::last_encoder_probe_supported_yuv444_for_codec,
+      proc::apps_generation,
+    };
+
+    std::lock_guard lg(cached_responses_lock);
+    if (!cached_responses || cached_responses->source != source) {
+      cached_responses = render_responses(std::move(source));
+    }
+
+    return cached_responses;
+  }
+
+  std::string
+  serverinfo_response(const serverinfo_client_t &client) {
+    auto cached = get_cached_responses();
+
+    std::string data;
+    data.reserve(cached->serverinfo_head.size() + cached->serverinfo_codecs.size() + 512);
+    data += cached->serverinfo_head;
+
+    xml::element(data, "mac"sv, client.mac);
+
+    if (client.server_commands) {
+      // Broadcast server_cmds
+      for (const auto& cmd : config::sunshine.server_cmds) {
+        xml::element(data, "ServerCommand"sv, cmd.cmd_name);
+      }
+    }
+
+    xml::element(data, "Permission"sv, client.permission);
+
+    if (client.virtual_display_driver_ready) {
+      xml::element(data, "VirtualDisplayCapable"sv, true);
+      xml::element(data, "VirtualDisplayDriverReady"sv, *client.virtual_display_driver_ready);
+    }
+
+    xml::element(data, "LocalIP"sv, client.local_ip);
+
+    data += cached->serverinfo_codecs;
+
+    xml::element(data, "PairStatus"sv, client.pair_status);
+    xml::element(data, "currentgame"sv, client.current_game);
+    xml::element(data, "state"sv, client.current_game > 0 ? "SUNSHINE_SERVER_BUSY"sv : "SUNSHINE_SERVER_FREE"sv);
+
+    xml::end_document(data);
+
+    return data;
+  }
+
   template <class T>
   void
   serverinfo(std::shared_ptr<typename SimpleWeb::ServerBase<T>::Response> response, std::shared_ptr<typename SimpleWeb::ServerBase<T>::Request> request) {
@@ -788,53 +1087,35 @@ namespace nvhttp {
 
     auto local_endpoint = request->local_endpoint();
 
-    pt::ptree tree;
-
-    tree.put("root.<xmlattr>.status_code", 200);
-    tree.put("root.hostname", config::nvhttp.sunshine_name);
-
-    tree.put("root.appversion", VERSION);
-    tree.put("root.GfeVersion", GFE_VERSION);
-    tree.put("root.uniqueid", http::unique_id);
-    tree.put("root.HttpsPort", net::map_port(PORT_HTTPS));
-    tree.put("root.ExternalPort", net::map_port(PORT_HTTP));
-    tree.put("root.MaxLumaPixelsHEVC", video::active_hevc_mode > 1 ? "1869449984" : "0");
+    serverinfo_client_t client;
+    client.pair_status = pair_status;
 
     // Only include the MAC address for requests sent from paired clients over HTTPS.
     // For HTTP requests, use a placeholder MAC address that Moonlight knows to ignore.
     if constexpr (std::is_same_v<SunshineHTTPS, T>) {
-      tree.put("root.mac", platf::get_mac_address(net::addr_to_normalized_string(local_endpoint.address())));
+      client.mac = platf::get_mac_address(net::addr_to_normalized_string(local_endpoint.address()));
 
       auto named_cert_p = get_verified_cert(request);
       if (!!(named_cert_p->perm & PERM::server_cmd)) {
-        pt::ptree& root_node = tree.get_child("root");
-
-        if (config::sunshine.server_cmds.size() > 0) {
-          // Broadcast server_cmds
-          for (const auto& cmd : config::sunshine.server_cmds) {
-            pt::ptree cmd_node;
-            cmd_node.put_value(cmd.cmd_name);
-            root_node.push_back(std::make_pair("ServerCommand", cmd_node));
-          }
-        }
+        client.server_commands = true;
       } else {
         BOOST_LOG(debug) << "Permission Get ServerCommand denied for [" << named_cert_p->name << "] (" << (uint32_t)named_cert_p->perm << ")";
       }
 
-      tree.put("root.Permission", std::to_string((uint32_t)named_cert_p->perm));
+      client.permission = (uint32_t) named_cert_p->perm;
 
     #ifdef _WIN32
-      tree.put("root.VirtualDisplayCapable", true);
       if (!!(named_cert_p->perm & PERM::_all_actions)) {
-        tree.put("root.VirtualDisplayDriverReady", proc::vDisplayDriverStatus == VDISPLAY::DRIVER_STATUS::OK);
+        client.virtual_display_driver_ready = proc::vDisplayDriverStatus == VDISPLAY::DRIVER_STATUS::OK;
       } else {
-        tree.put("root.VirtualDisplayDriverReady", true);
+        client.virtual_display_driver_ready = true;
       }
     #endif
+
+      client.current_game = proc::proc.running();
     }
     else {
-      tree.put("root.mac", "00:00:00:00:00:00");
-      tree.put("root.Permission", "0");
+      client.mac = "00:00:00:00:00:00"s;
     }
 
     // Moonlight clients track LAN IPv6 addresses separately from LocalIP which is expected to
@@ -847,58 +1128,20 @@ namespace nvhttp {
     // which returns 127.0.0.1 as LocalIP for IPv6 connections. Moonlight clients with IPv6
     // support know to ignore this bogus address.
     if (local_endpoint.address().is_v6() && !local_endpoint.address().to_v6().is_v4_mapped()) {
-      tree.put("root.LocalIP", "127.0.0.1");
+      client.local_ip = "127.0.0.1"s;
     }
     else {
-      tree.put("root.LocalIP", net::addr_to_normalized_string(local_endpoint.address()));
+      client.local_ip = net::addr_to_normalized_string(local_endpoint.address());
     }
 
-    uint32_t codec_mode_flags = SCM_H264;
-    if (video::last_encoder_probe_supported_yuv444_for_codec[0]) {
-      codec_mode_flags |= SCM_H264_HIGH8_444;
-    }
-    if (video::active_hevc_mode >= 2) {
-      codec_mode_flags |= SCM_HEVC;
-      if (video::last_encoder_probe_supported_yuv444_for_codec[1]) {
-        codec_mode_flags |= SCM_HEVC_REXT8_444;
-      }
-    }
-    if (video::active_hevc_mode >= 3) {
-      codec_mode_flags |= SCM_HEVC_MAIN10;
-      if (video::last_encoder_probe_supported_yuv444_for_codec[1]) {
-        codec_mode_flags |= SCM_HEVC_REXT10_444;
-      }
-    }
-    if (video::active_av1_mode >= 2) {
-      codec_mode_flags |= SCM_AV1_MAIN8;
-      if (video::last_encoder_probe_supported_yuv444_for_codec[2]) {
-        codec_mode_flags |= SCM_AV1_HIGH8_444;
-      }
-    }
-    if (video::active_av1_mode >= 3) {
-      codec_mode_flags |= SCM_AV1_MAIN10;
-      if (video::last_encoder_probe_supported_yuv444_for_codec[2]) {
-        codec_mode_flags |= SCM_AV1_HIGH10_444;
-      }
-    }
-    tree.put("root.ServerCodecModeSupport", codec_mode_flags);
+    auto data = serverinfo_response(client);
 
-    tree.put("root.PairStatus", pair_status);
+    response->write(data);
 
-    if constexpr (std::is_same_v<SunshineHTTPS, T>) {
-      auto current_appid = proc::proc.running();
-      tree.put("root.currentgame", current_appid);
-      tree.put("root.state", current_appid > 0 ? "SUNSHINE_SERVER_BUSY" : "SUNSHINE_SERVER_FREE");
-    } else {
-      tree.put("root.currentgame", 0);
-      tree.put("root.state", "SUNSHINE_SERVER_FREE");
+    // Verified clients may keep the connection open for their next request
+    if constexpr (!std::is_same_v<SunshineHTTPS, T>) {
+      response->close_connection_after_response = true;
     }
-
-    std::ostringstream data;
-
-    pt::write_xml(data, tree);
-    response->write(data.str());
-    response->close_connection_after_response = true;
   }
 
   pt::ptree
@@ -926,6 +1169,12 @@ namespace nvhttp {
             }
         }
         named_cert_node.put("connected"s, connected);
+
+        if (connected) {
+          if (auto session = rtsp_stream::find_session(named_cert_p->uuid)) {
+            named_cert_node.put("fec_percentage"s, stream::session::fec_percentage(*session));
+          }
+        }
       }
 
       named_cert_nodes.push_back(std::make_pair(""s, named_cert_node));
@@ -938,47 +1187,29 @@ namespace nvhttp {
   applist(resp_https_t response, req_https_t request) {
     print_req<SunshineHTTPS>(request);
 
-    pt::ptree tree;
-
-    auto g = util::fail_guard([&]() {
-      std::ostringstream data;
-
-      pt::write_xml(data, tree);
-      response->write(data.str());
-      response->close_connection_after_response = true;
-    });
-
-    auto &apps = tree.add_child("root", pt::ptree {});
-
-    apps.put("<xmlattr>.status_code", 200);
-
     auto named_cert_p = get_verified_cert(request);
     if (!!(named_cert_p->perm & PERM::_all_actions)) {
-      for (auto &app : proc::proc.get_apps()) {
-        pt::ptree app_node;
-
-        app_node.put("IsHdrSupported"s, video::active_hevc_mode == 3 ? 1 : 0);
-        app_node.put("AppTitle"s, app.name);
-        app_node.put("UUID", app.uuid);
-        app_node.put("ID", app.id);
-
-        apps.push_back(std::make_pair("App", std::move(app_node)));
-      }
-    } else {
-      BOOST_LOG(debug) << "Permission ListApp denied for [" << named_cert_p->name << "] (" << (uint32_t)named_cert_p->perm << ")";
-
-      pt::ptree app_node;
-
-      app_node.put("IsHdrSupported"s, 0);
-      app_node.put("AppTitle"s, "Permission Denied");
-      app_node.put("UUID", "");
-      app_node.put("ID", "114514");
+      // Keep the cached responses alive while they're written
+      auto cached = get_cached_responses();
 
-      apps.push_back(std::make_pair("App", std::move(app_node)));
+      response->write(cached->applist);
 
       return;
     }
 
+    BOOST_LOG(debug) << "Permission ListApp denied for [" << named_cert_p->name << "] (" << (uint32_t)named_cert_p->perm << ")";
+
+    std::string data;
+    xml::begin_document(data, 200);
+    xml::open(data, "App"sv);
+    xml::element(data, "IsHdrSupported"sv, 0);
+    xml::element(data, "AppTitle"sv, "Permission Denied"sv);
+    xml::element(data, "UUID"sv, ""sv);
+    xml::element(data, "ID"sv, "114514"sv);
+    xml::close(data, "App"sv);
+    xml::end_document(data);
+
+    response->write(data);
   }
 
   void
@@ -991,7 +1222,6 @@ namespace nvhttp {
 
       pt::write_xml(data, tree);
       response->write(data.str());
-      response->close_connection_after_response = true;
     });
 
     auto named_cert_p = get_verified_cert(request);
@@ -1091,7 +1321,6 @@ namespace nvhttp {
 
       pt::write_xml(data, tree);
       response->write(data.str());
-      response->close_connection_after_response = true;
     });
 
     auto named_cert_p = get_verified_cert(request);
@@ -1187,7 +1416,6 @@ namespace nvhttp {
 
       pt::write_xml(data, tree);
       response->write(data.str());
-      response->close_connection_after_response = true;
     });
 
     auto named_cert_p = get_verified_cert(request);
@@ -1243,7 +1471,6 @@ namespace nvhttp {
     SimpleWeb::CaseInsensitiveMultimap headers;
     headers.emplace("Content-Type", "image/png");
     response->write(SimpleWeb::StatusCode::success_ok, in, headers);
-    response->close_connection_after_response = true;
   }
 
   void
@@ -1418,31 +1645,18 @@ namespace nvhttp {
       return true;
     };
 
-    https_server.on_verify_failed = [](resp_https_t resp, req_https_t req) {
-      pt::ptree tree;
-      auto g = util::fail_guard([&]() {
-        std::ostringstream data;
-
-        pt::write_xml(data, tree);
-        resp->write(data.str());
-        resp->close_connection_after_response = true;
-      });
-
-      tree.put("root.<xmlattr>.status_code"s, 401);
-      tree.put("root.<xmlattr>.query"s, req->path);
-      tree.put("root.<xmlattr>.status_message"s, "The client is not authorized. Certificate verification failed."s);
-    };
-
-    https_server.default_resource["GET"] = not_found<SunshineHTTPS>;
-    https_server.resource["^/serverinfo$"]["GET"] = serverinfo<SunshineHTTPS>;
-    https_server.resource["^/pair$"]["GET"] = pair<SunshineHTTPS>;
-    https_server.resource["^/applist$"]["GET"] = applist;
-    https_server.resource["^/appasset$"]["GET"] = appasset;
-    https_server.resource["^/launch$"]["GET"] = [&host_audio](auto resp, auto req) { launch(host_audio, resp, req); };
-    https_server.resource["^/resume$"]["GET"] = [&host_audio](auto resp, auto req) { resume(host_audio, resp, req); };
-    https_server.resource["^/cancel$"]["GET"] = cancel;
-    https_server.resource["^/actions/clipboard$"]["GET"] = getClipboard;
-    https_server.resource["^/actions/clipboard$"]["POST"] = setClipboard;
+    https_server.on_verify_failed = verify_failed;
+
+    https_server.default_resource["GET"] = verified(https_server, not_found<SunshineHTTPS>);
+    https_server.resource["^/serverinfo$"]["GET"] = verified(https_server, serverinfo<SunshineHTTPS>);
+    https_server.resource["^/pair$"]["GET"] = verified(https_server, pair<SunshineHTTPS>);
+    https_server.resource["^/applist$"]["GET"] = verified(https_server, applist);
+    https_server.resource["^/appasset$"]["GET"] = verified(https_server, appasset);
+    https_server.resource["^/launch$"]["GET"] = verified(https_server, [&host_audio](auto resp, auto req) { launch(host_audio, resp, req); });
+    https_server.resource["^/resume$"]["GET"] = verified(https_server, [&host_audio](auto resp, auto req) { resume(host_audio, resp, req); });
+    https_server.resource["^/cancel$"]["GET"] = verified(https_server, cancel);
+    https_server.resource["^/actions/clipboard$"]["GET"] = verified(https_server, getClipboard);
+    https_server.resource["^/actions/clipboard$"]["POST"] = verified(https_server, setClipboard);
 
     https_server.config.reuse_address = true;
     https_server.config.address = net::af_to_any_address_string(address_family);
@@ -6,8 +6,13 @@
 #pragma once
 
 // standard includes
-#include <string>
 #include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 
 // lib includes
 #include <Simple-Web-Server/server_https.hpp>
@@ -99,6 +104,117 @@ namespace nvhttp {
   boost::property_tree::ptree
   get_all_clients();
 
+  /**
+   * @brief The open connections of the HTTPS server, by the endpoint of their client.
+   * @details Only the first request of a connection carries the client verified during the handshake.
+   * The requests that follow it on a kept-alive connection find their connection here, so its TLS session
+   * can be verified again. Connections aren't owned by the table, a closed one is no longer found.
+   * @tparam T The connection type.
+   */
+  template <class T>
+  class connection_table_t {
+  public:
+    /**
+     * @brief Add a verified connection.
+     * @param endpoint The endpoint of the client.
+     * @param connection The connection.
+     */
+    void
+    add(const boost::asio::ip::tcp::endpoint &endpoint, const std::shared_ptr<T> &connection) {
+      std::lock_guard lg(lock);
+
+      // Closed connections are dropped here, their endpoints may be reused by new connections
+      std::erase_if(connections, [](const auto &entry) {
+        return entry.second.expired();
+      });
+      connections.insert_or_assign(endpoint, connection);
+    }
+
+    /**
+     * @brief Find the open connection of a client.
+     * @param endpoint The endpoint of the client.
+     * @return The connection, or `nullptr` if it was closed or never verified.
+     */
+    std::shared_ptr<T>
+    find(const boost::asio::ip::tcp::endpoint &endpoint) {
+      std::lock_guard lg(lock);
+
+      auto it = connections.find(endpoint);
+      if (it == std::end(connections)) {
+        return nullptr;
+      }
+
+      return it->second.lock();
+    }
+
+    /**
+     * @brief Get the number of connections in the table, including closed ones that weren't dropped yet.
+     * @return The number of connections.
+     */
+    std::size_t
+    size() {
+      std::lock_guard lg(lock);
+
+      return connections.size();
+    }
+
+  private:
+    std::mutex lock;
+    std::map<boost::asio::ip::tcp::endpoint, std::weak_ptr<T>> connections;
+  };
+
+  /**
+   * @brief The fields of a serverinfo response that depend on the client and its request.
+   */
+  struct serverinfo_client_t {
+    std::string mac;  ///< The MAC address, or a placeholder for unpaired clients
+    bool server_commands = false;  ///< Whether the client may see the server commands
+    std::uint32_t permission = 0;  ///< The permissions of the client
+    std::optional<bool> virtual_display_driver_ready;  ///< Only reported to paired clients on Windows
+    std::string local_ip;  ///< The address the request came in on
+    int pair_status = 0;
+    int current_game = 0;  ///< The running app, 0 if none
+  };
+
+  /**
+   * @brief Build the serverinfo response for a client.
+   * @details The parts that are the same for every client are rendered once and cached, until the
+   * host name, the codec support or the apps change. The fields of the client are filled in around them.
+   * @param client The fields of the client.
+   * @return The XML document.
+   */
+  std::string
+  serverinfo_response(const serverinfo_client_t &client);
+
+  /**
+   * @brief Let clients resume their TLS session instead of going through a full handshake for every connection.
+   * @param ctx The SSL context of the HTTPS server.
+   */
+  void
+  enable_session_resumption(SSL_CTX *ctx);
+
+  /**
+   * @brief Counters of the TLS connections to the HTTPS server.
+   */
+  struct tls_stats_t {
+    std::uint64_t handshakes;  ///< Completed TLS handshakes
+    std::uint64_t resumed_handshakes;  ///< Handshakes that resumed an earlier TLS session
+    std::uint64_t requests;  ///< Requests of verified clients
+    std::uint64_t kept_alive_requests;  ///< Requests that reused the connection of an earlier request
+    double handshakes_per_second;  ///< Measured over the last minute
+  };
+
+  /**
+   * @brief Get the counters of the TLS connections to the HTTPS server.
+   * @return The counters since the server started.
+   * @examples
+   * auto stats = nvhttp::get_tls_stats();
+   * double resumption_rate = stats.handshakes ? (double) stats.resumed_handshakes / stats.handshakes : 0;
+   * @examples_end
+   */
+  tls_stats_t
+  get_tls_stats();
+
   /**
    * @brief Remove all paired clients.
    * @examples
@@ -5,9 +5,12 @@
 #pragma once
 
 #include <bitset>
+#include <chrono>
 #include <filesystem>
 #include <functional>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 
 #include <boost/core/noncopyable.hpp>
@@ -59,6 +62,9 @@ namespace boost {
 namespace video {
   struct config_t;
 }  // namespace video
+namespace thread_pool_util {
+  class Strand;
+}  // namespace thread_pool_util
 namespace nvenc {
   class nvenc_base;
 }
@@ -357,6 +363,9 @@ namespace platf {
 
     std::optional<std::chrono::steady_clock::time_point> frame_timestamp;
 
+    // Numbers the captures handed to the encoders, so they can tell how many they skipped
+    std::uint64_t capture_nr {};
+
     virtual ~img_t() = default;
   };
 
@@ -620,6 +629,31 @@ namespace platf {
   void
   adjust_thread_priority(thread_priority_e priority);
 
+  /**
+   * @brief A logical CPU and the resources it shares with other CPUs.
+   */
+  struct cpu_t {
+    int id;  ///< The index of the logical CPU, as used by `set_thread_affinity()`
+    int numa_node;  ///< The NUMA node the CPU belongs to
+    int l3_domain;  ///< An identifier shared by all CPUs behind the same L3 cache
+  };
+
+  /**
+   * @brief Get the logical CPUs this process may run on.
+   * @return The CPUs, or an empty list if the topology is unknown.
+   */
+  std::vector<cpu_t>
+  cpu_topology();
+
+  /**
+   * @brief Restrict the calling thread to a set of CPUs.
+   * @details Threads created by the calling thread afterwards inherit the restriction.
+   * @param cpus The ids of the CPUs from `cpu_topology()`.
+   * @return `true` if the affinity was changed.
+   */
+  bool
+  set_thread_affinity(const std::vector<int> &cpus);
+
   // Allow OS-specific actions to be taken to prepare for streaming
   void
   streaming_will_start();
@@ -665,7 +699,7 @@ namespace platf {
     // One or more data buffers to use for the payloads
     //
     // NB: Data buffers must be aligned to payload size!
-    std::vector<buffer_descriptor_t> &payload_buffers;
+    std::span<const buffer_descriptor_t> payload_buffers;
     size_t payload_size;
 
     // The offset (in header+payload message blocks) in the header and payload
@@ -680,6 +714,14 @@ namespace platf {
     uint16_t target_port;
     boost::asio::ip::address &source_address;
 
+    // If set, the kernel holds the messages until this time instead of sending them immediately.
+    // This is only honored on sockets where enable_socket_txtime() succeeded.
+    std::optional<std::chrono::steady_clock::time_point> departure_time {};
+
+    // Incremented for each call whose batch didn't fit into the socket's send buffer at once.
+    // Platforms that can't tell leave it untouched.
+    int short_batches = 0;
+
     /**
      * @brief Returns a payload buffer descriptor for the given payload offset.
      * @param offset The offset in the total payload data (bytes).
@@ -704,6 +746,25 @@ namespace platf {
   bool
   send_batch(batched_send_info_t &send_info);
 
+  /**
+   * @brief Let the kernel pace outgoing traffic by the departure time of each batch.
+   * @details Departure times are only enforced if the qdisc of the outgoing interface supports them, e.g. fq.
+   * @param native_socket The native socket handle.
+   * @return `true` if `batched_send_info_t::departure_time` is honored for this socket.
+   */
+  bool
+  enable_socket_txtime(std::uintptr_t native_socket);
+
+  /**
+   * @brief Check whether the qdisc of the interface that traffic to an address leaves through enforces departure times.
+   * @details A socket accepts departure times regardless of the qdisc, but only fq holds packets until they are due.
+   * With any other qdisc the packets leave immediately, so the caller must keep pacing them itself.
+   * @param address The address the traffic is sent to.
+   * @return `true` if `batched_send_info_t::departure_time` is enforced for traffic to this address.
+   */
+  bool
+  departure_time_enforced(const boost::asio::ip::address &address);
+
   struct send_info_t {
     const char *header;
     size_t header_size;
@@ -791,10 +852,11 @@ namespace platf {
   /**
    * @brief Allocate a context to store per-client input data.
    * @param input The global input context.
+   * @param strand The strand the input of the client runs on, which also runs its repeated events.
    * @return A unique pointer to a per-client input data context.
    */
   std::unique_ptr<client_input_t>
-  allocate_client_input_context(input_t &input);
+  allocate_client_input_context(input_t &input, std::shared_ptr<thread_pool_util::Strand> strand);
 
   /**
    * @brief Send a touch event to the OS.
@@ -844,10 +906,11 @@ namespace platf {
    * @param id The gamepad ID.
    * @param metadata Controller metadata from client (empty if none provided).
    * @param feedback_queue The queue for posting messages back to the client.
+   * @param strand The strand the input of the client runs on, which also runs the repeated reports of the gamepad.
    * @return 0 on success.
    */
   int
-  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue);
+  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue, std::shared_ptr<thread_pool_util::Strand> strand);
   void
   free_gamepad(input_t &input, int nr);
 
@@ -0,0 +1,95 @@
+/**
+ * @file src/platform/linux/cursor_blend.h
+ * @brief Declarations for blending cursors into captured BGRA images.
+ */
+#pragma once
+
+// standard includes
+#include <cstdint>
+#include <vector>
+
+// local includes
+#include "src/platform/common.h"
+
+namespace platf::cursor {
+  /**
+   * @brief Blend a row of premultiplied BGRA pixels over a row of BGRA pixels.
+   * @details Uses AVX2 or SSE4.1 when the CPU supports it.
+   * @param dst The destination pixels.
+   * @param src The premultiplied source pixels.
+   * @param count The number of pixels.
+   */
+  void
+  blend_row(std::uint32_t *dst, const std::uint32_t *src, int count);
+
+  /**
+   * @brief The portable implementation of `blend_row()`.
+   */
+  void
+  blend_row_scalar(std::uint32_t *dst, const std::uint32_t *src, int count);
+
+  /**
+   * @brief Scale a premultiplied BGRA image with bilinear filtering.
+   * @param src The source pixels.
+   * @param src_width The source width.
+   * @param src_height The source height.
+   * @param src_pitch The distance between source rows in pixels.
+   * @param dst The destination, must hold `dst_width * dst_height` pixels.
+   * @param dst_width The destination width.
+   * @param dst_height The destination height.
+   */
+  void
+  scale(const std::uint32_t *src, int src_width, int src_height, int src_pitch, std::uint32_t *dst, int dst_width, int dst_height);
+
+  /**
+   * @brief A cursor image prepared for blending.
+   * @details The image is scaled to its on-screen size and cropped to its non-transparent pixels
+   * only when the cursor image changes, so blending a frame only touches the pixels the cursor covers.
+   */
+  class overlay_t {
+  public:
+    /**
+     * @brief Update the cursor image.
+     * @details Nothing is done if the serial and the on-screen size didn't change.
+     * @param serial Identifies the cursor image, changes whenever the image does.
+     * @param pixels The premultiplied BGRA pixels.
+     * @param width The width of the image.
+     * @param height The height of the image.
+     * @param pitch The distance between rows in pixels.
+     * @param dst_width The on-screen width of the cursor.
+     * @param dst_height The on-screen height of the cursor.
+     */
+    void
+    update(unsigned long serial, const std::uint32_t *pixels, int width, int height, int pitch, int dst_width, int dst_height);
+
+    /**
+     * @brief Check whether the cursor image needs to be updated.
+     * @param serial The serial of the current cursor image.
+     * @return `true` if `update()` was never called with this serial.
+     */
+    bool
+    stale(unsigned long serial) const;
+
+    /**
+     * @brief Blend the cursor into an image.
+     * @param img The 32-bit BGRA image.
+     * @param x The position of the cursor's top left corner, relative to the image. May be negative.
+     * @param y The position of the cursor's top left corner, relative to the image. May be negative.
+     */
+    void
+    blend(img_t &img, int x, int y) const;
+
+  private:
+    bool valid = false;
+    unsigned long serial = 0;
+    int dst_width = 0;
+    int dst_height = 0;
+
+    // The non-transparent part of the scaled cursor
+    std::vector<std::uint32_t> pixels;
+    int crop_x = 0;
+    int crop_y = 0;
+    int width = 0;
+    int height = 0;
+  };
+}  // namespace platf::cursor
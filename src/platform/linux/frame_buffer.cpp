@@ -0,0 +1,219 @@
+/**
+ * @file src/platform/linux/frame_buffer.cpp
+ * @brief Definitions for the buffers of captured frames in system memory.
+ */
+// standard includes
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <utility>
+
+// platform includes
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// local includes
+#include "frame_buffer.h"
+#include "src/logging.h"
+
+using namespace std::literals;
+
+namespace platf::frame_buffer {
+  namespace {
+    // MPOL_PREFERRED from <numaif.h>, which is part of libnuma rather than the C library
+    constexpr int MPOL_PREFERRED_MODE = 1;
+
+    // MAP_HUGE_2MB from <linux/mman.h>, the size of the reserved huge pages to map
+    constexpr int MAP_HUGE_2MB_FLAG = 21 << MAP_HUGE_SHIFT;
+    static_assert(huge_page_size == 1 << 21);
+
+    std::atomic<std::size_t> buffers;
+    std::atomic<std::size_t> bytes;
+    std::atomic<std::size_t> transparent_huge_page_bytes;
+    std::atomic<std::size_t> pinned_bytes;
+
+    std::size_t
+    align_up(std::size_t size, std::size_t alignment) {
+      return (size + (alignment - 1)) & ~(alignment - 1);
+    }
+
+    std::atomic<std::size_t> *
+    bytes_of(backing_e backing) {
+      switch (backing) {
+        case backing_e::transparent_huge_pages:
+          return &transparent_huge_page_bytes;
+        case backing_e::huge_pages:
+          return &pinned_bytes;
+        default:
+          return nullptr;
+      }
+    }
+
+    void
+    account(backing_e backing, std::size_t size) {
+      ++buffers;
+      bytes += size;
+      if (auto backing_bytes = bytes_of(backing)) {
+        *backing_bytes += size;
+      }
+    }
+
+    void
+    unaccount(backing_e backing, std::size_t size) {
+      --buffers;
+      bytes -= size;
+      if (auto backing_bytes = bytes_of(backing)) {
+        *backing_bytes -= size;
+      }
+    }
+
+    bool
+    is_numa() {
+      static const bool numa = std::filesystem::exists("/sys/devices/system/node/node1"sv);
+      return numa;
+    }
+
+    /**
+     * @brief Prefer the NUMA node of the calling thread for the pages of a mapping.
+     * @details The pages are placed when they are first touched, so this must be called before.
+     */
+    void
+    prefer_local_node(void *data, std::size_t size) {
+      if (!is_numa()) {
+        return;
+      }
+
+      unsigned cpu, node;
+      if (syscall(SYS_getcpu, &cpu, &node, nullptr) || node >= 64) {
+        return;
+      }
+
+      unsigned long nodemask = 1UL << node;
+      if (syscall(SYS_mbind, data, size, MPOL_PREFERRED_MODE, &nodemask, sizeof(nodemask) * 8, 0)) {
+        BOOST_LOG(debug) << "Couldn't place frame buffer on NUMA node "sv << node << ": "sv << std::strerror(errno);
+      }
+    }
+
+    /**
+     * @brief Map reserved huge pages.
+     * @details Whether this fails depends on how many of the reserved huge pages are free at the time,
+     * so every buffer tries again.
+     * @return The mapping, or `nullptr` if there aren't enough free reserved huge pages.
+     */
+    void *
+    map_huge_pages(std::size_t size) {
+      auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB_FLAG, -1, 0);
+      if (data == MAP_FAILED) {
+        BOOST_LOG(debug) << "Couldn't map "sv << size << " bytes of reserved huge pages for a frame buffer, falling back to transparent huge pages: "sv << std::strerror(errno);
+
+        return nullptr;
+      }
+
+      return data;
+    }
+
+    void *
+    map_aligned(std::size_t size) {
+      // Map a huge page more than needed, then unmap the parts in front of and behind the aligned range
+      auto raw = (std::uint8_t *) mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (raw == (std::uint8_t *) MAP_FAILED) {
+        return nullptr;
+      }
+
+      auto data = (std::uint8_t *) align_up((std::uintptr_t) raw, huge_page_size);
+      if (auto head = data - raw) {
+        munmap(raw, head);
+      }
+      if (auto tail = huge_page_size - (data - raw)) {
+        munmap(data + size, tail);
+      }
+
+      // Without transparent huge pages enabled for madvise(), this is merely a hint that fails
+      madvise(data, size, MADV_HUGEPAGE);
+
+      return data;
+    }
+  }  // namespace
+
+  buffer_t::buffer_t(std::size_t size):
+      _size { size } {
+    if (size < huge_page_size) {
+      _mapped_size = align_up(std::max<std::size_t>(size, 1), alignment);
+      _data = (std::uint8_t *) ::operator new(_mapped_size, std::align_val_t { alignment });
+      _backing = backing_e::heap;
+
+      account(_backing, _mapped_size);
+      return;
+    }
+
+    _mapped_size = align_up(size, huge_page_size);
+
+    void *data = map_huge_pages(_mapped_size);
+    _backing = backing_e::huge_pages;
+    if (!data) {
+      data = map_aligned(_mapped_size);
+      _backing = backing_e::transparent_huge_pages;
+    }
+
+    if (!data) {
+      throw std::bad_alloc {};
+    }
+
+    prefer_local_node(data, _mapped_size);
+
+    _data = (std::uint8_t *) data;
+    account(_backing, _mapped_size);
+  }
+
+  buffer_t::~buffer_t() {
+    release();
+  }
+
+  buffer_t::buffer_t(buffer_t &&other) noexcept:
+      _data { std::exchange(other._data, nullptr) },
+      _size { std::exchange(other._size, 0) },
+      _mapped_size { std::exchange(other._mapped_size, 0) },
+      _backing { other._backing } {}
+
+  buffer_t &
+  buffer_t::operator=(buffer_t &&other) noexcept {
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    std::swap(_mapped_size, other._mapped_size);
+    std::swap(_backing, other._backing);
+
+    return *this;
+  }
+
+  void
+  buffer_t::release() {
+    if (!_data) {
+      return;
+    }
+
+    unaccount(_backing, _mapped_size);
+
+    if (_backing == backing_e::heap) {
+      ::operator delete(_data, std::align_val_t { alignment });
+    }
+    else {
+      munmap(_data, _mapped_size);
+    }
+
+    _data = nullptr;
+  }
+
+  stats_t
+  stats() {
+    return {
+      buffers,
+      bytes,
+      transparent_huge_page_bytes,
+      pinned_bytes,
+    };
+  }
+}  // namespace platf::frame_buffer
@@ -0,0 +1,101 @@
+/**
+ * @file src/platform/linux/frame_buffer.h
+ * @brief Declarations for the buffers of captured frames in system memory.
+ */
+#pragma once
+
+// standard includes
+#include <cstddef>
+#include <cstdint>
+
+namespace platf::frame_buffer {
+  /**
+   * @brief Every buffer is aligned to a cache line, which is enough for any SIMD load.
+   */
+  constexpr std::size_t alignment = 64;
+
+  /**
+   * @brief Buffers of at least this size are mapped in huge pages of this size, when possible.
+   */
+  constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+  enum class backing_e : int {
+    heap,  ///< Regular pages from the heap, for small buffers
+    transparent_huge_pages,  ///< Aligned to a huge page and advised to be backed by transparent huge pages
+    huge_pages,  ///< Reserved huge pages, which are never swapped out
+  };
+
+  /**
+   * @brief A buffer for a captured frame.
+   * @details A 4K frame spans about 8000 regular pages, which thrashes the TLB while it's
+   * converted and encoded. Large buffers are mapped with `MAP_HUGETLB` if huge pages are
+   * reserved, and are otherwise aligned to a huge page with `MADV_HUGEPAGE`. On NUMA systems,
+   * their pages are preferably placed on the node of the allocating thread.
+   */
+  class buffer_t {
+  public:
+    buffer_t() = default;
+
+    /**
+     * @brief Allocate an uninitialized buffer.
+     * @param size The size in bytes.
+     * @throws std::bad_alloc If no memory could be mapped.
+     */
+    explicit buffer_t(std::size_t size);
+
+    ~buffer_t();
+
+    buffer_t(buffer_t &&other) noexcept;
+    buffer_t &
+    operator=(buffer_t &&other) noexcept;
+
+    buffer_t(const buffer_t &) = delete;
+    buffer_t &
+    operator=(const buffer_t &) = delete;
+
+    std::uint8_t *
+    data() const {
+      return _data;
+    }
+
+    std::size_t
+    size() const {
+      return _size;
+    }
+
+    backing_e
+    backing() const {
+      return _backing;
+    }
+
+  private:
+    void
+    release();
+
+    std::uint8_t *_data = nullptr;
+    std::size_t _size = 0;
+    std::size_t _mapped_size = 0;
+    backing_e _backing = backing_e::heap;
+  };
+
+  /**
+   * @brief The memory held by frame buffers.
+   */
+  struct stats_t {
+    std::size_t buffers;
+    std::size_t bytes;
+
+    // Backed by transparent huge pages, if the kernel found them
+    std::size_t transparent_huge_page_bytes;
+
+    // Backed by reserved huge pages, which are pinned in memory
+    std::size_t pinned_bytes;
+  };
+
+  /**
+   * @brief Get the memory held by all frame buffers that are alive.
+   * @return The totals.
+   */
+  stats_t
+  stats();
+}  // namespace platf::frame_buffer
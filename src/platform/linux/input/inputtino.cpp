@@ -26,7 +26,7 @@ namespace platf {
   }
 
   std::unique_ptr<client_input_t>
-  allocate_client_input_context(input_t &input) {
+  allocate_client_input_context(input_t &input, std::shared_ptr<thread_pool_util::Strand> strand) {
     return std::make_unique<client_input_raw_t>(input);
   }
 
@@ -91,7 +91,7 @@ namespace platf {
   }
 
   int
-  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue) {
+  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue, std::shared_ptr<thread_pool_util::Strand> strand) {
     auto raw = (input_raw_t *) input.get();
     return platf::gamepad::alloc(raw, id, metadata, feedback_queue);
   }
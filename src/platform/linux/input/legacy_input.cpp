@@ -1571,7 +1571,7 @@ namespace platf {
   }
 
   int
-  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue) {
+  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue, std::shared_ptr<thread_pool_util::Strand> strand) {
     return ((input_raw_t *) input.get())->alloc_gamepad(id, metadata, std::move(feedback_queue));
   }
 
@@ -1674,10 +1674,11 @@ namespace platf {
   /**
    * @brief Allocates a context to store per-client input data.
    * @param input The global input context.
+   * @param strand The strand the input of the client runs on.
    * @return A unique pointer to a per-client input data context.
    */
   std::unique_ptr<client_input_t>
-  allocate_client_input_context(input_t &input) {
+  allocate_client_input_context(input_t &input, std::shared_ptr<thread_pool_util::Strand> strand) {
     return std::make_unique<client_input_raw_t>(input);
   }
 
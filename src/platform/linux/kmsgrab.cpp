@@ -23,6 +23,8 @@
 #include "src/video.h"
 
 #include "cuda.h"
+#include "cursor_blend.h"
+#include "frame_buffer.h"
 #include "graphics.h"
 #include "vaapi.h"
 #include "wayland.h"
@@ -559,10 +561,17 @@ namespace platf {
     }
 
     struct kms_img_t: public img_t {
+      explicit kms_img_t(std::size_t size):
+          buffer { size } {
+        data = buffer.data();
+      }
+
       ~kms_img_t() override {
-        delete[] data;
+        // Owned by buffer
         data = nullptr;
       }
+
+      frame_buffer::buffer_t buffer;
     };
 
     void
@@ -1254,52 +1263,12 @@ namespace platf {
 
       void
       blend_cursor(img_t &img) {
-        // TODO: Cursor scaling is not supported in this codepath.
-        // We always draw the cursor at the source size.
-        auto pixels = (int *) img.data;
-
-        int32_t screen_height = img.height;
-        int32_t screen_width = img.width;
-
-        // This is the position in the target that we will start drawing the cursor
-        auto cursor_x = std::max<int32_t>(0, captured_cursor.x - img_offset_x);
-        auto cursor_y = std::max<int32_t>(0, captured_cursor.y - img_offset_y);
-
-        // If the cursor is partially off screen, the coordinates may be negative
-        // which means we will draw the top-right visible portion of the cursor only.
-        auto cursor_delta_x = cursor_x - std::max<int32_t>(-captured_cursor.src_w, captured_cursor.x - img_offset_x);
-        auto cursor_delta_y = cursor_y - std::max<int32_t>(-captured_cursor.src_h, captured_cursor.y - img_offset_y);
-
-        auto delta_height = std::min<uint32_t>(captured_cursor.src_h, std::max<int32_t>(0, screen_height - cursor_y)) - cursor_delta_y;
-        auto delta_width = std::min<uint32_t>(captured_cursor.src_w, std::max<int32_t>(0, screen_width - cursor_x)) - cursor_delta_x;
-        for (auto y = 0; y < delta_height; ++y) {
-          // Offset into the cursor image to skip drawing the parts of the cursor image that are off screen
-          //
-          // NB: We must access the elements via the data() function because cursor_end may point to the
-          // the first element beyond the valid range of the vector. Using vector's [] operator in that
-          // manner is undefined behavior (and triggers errors when using debug libc++), while doing the
-          // same with an array is fine.
-          auto cursor_begin = (uint32_t *) &captured_cursor.pixels.data()[((y + cursor_delta_y) * captured_cursor.src_w + cursor_delta_x) * 4];
-          auto cursor_end = (uint32_t *) &captured_cursor.pixels.data()[((y + cursor_delta_y) * captured_cursor.src_w + delta_width + cursor_delta_x) * 4];
-
-          auto pixels_begin = &pixels[(y + cursor_y) * (img.row_pitch / img.pixel_pitch) + cursor_x];
-
-          std::for_each(cursor_begin, cursor_end, [&](uint32_t cursor_pixel) {
-            auto colors_in = (uint8_t *) pixels_begin;
-
-            auto alpha = (*(uint *) &cursor_pixel) >> 24u;
-            if (alpha == 255) {
-              *pixels_begin = cursor_pixel;
-            }
-            else {
-              auto colors_out = (uint8_t *) &cursor_pixel;
-              colors_in[0] = colors_out[0] + (colors_in[0] * (255 - alpha) + 255 / 2) / 255;
-              colors_in[1] = colors_out[1] + (colors_in[1] * (255 - alpha) + 255 / 2) / 255;
-              colors_in[2] = colors_out[2] + (colors_in[2] * (255 - alpha) + 255 / 2) / 255;
-            }
-            ++pixels_begin;
-          });
-        }
+        // The overlay is only rebuilt when the cursor image or its on-screen size changes
+        cursor_overlay.update(captured_cursor.serial, (std::uint32_t *) captured_cursor.pixels.data(),
+          captured_cursor.src_w, captured_cursor.src_h, captured_cursor.src_w,
+          captured_cursor.dst_w, captured_cursor.dst_h);
+
+        cursor_overlay.blend(img, captured_cursor.x - img_offset_x, captured_cursor.y - img_offset_y);
       }
 
       capture_e
@@ -1347,12 +1316,13 @@ namespace platf {
 
       std::shared_ptr<img_t>
       alloc_img() override {
-        auto img = std::make_shared<kms_img_t>();
+        auto row_pitch = 4 * width;
+
+        auto img = std::make_shared<kms_img_t>((std::size_t) height * row_pitch);
         img->width = width;
         img->height = height;
         img->pixel_pitch = 4;
-        img->row_pitch = img->pixel_pitch * width;
-        img->data = new std::uint8_t[height * img->row_pitch];
+        img->row_pitch = row_pitch;
 
         return img;
       }
@@ -1365,6 +1335,8 @@ namespace platf {
       gbm::gbm_t gbm;
       egl::display_t display;
       egl::ctx_t ctx;
+
+      cursor::overlay_t cursor_overlay;
     };
 
     class display_vram_t: public display_t {
@@ -9,6 +9,7 @@
 #endif
 
 // standard includes
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -20,8 +21,13 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <ifaddrs.h>
+#include <linux/net_tstamp.h>
+#include <linux/pkt_sched.h>
+#include <net/if.h>
 #include <netinet/udp.h>
+#include <pthread.h>
 #include <pwd.h>
+#include <sched.h>
 #include <unistd.h>
 
 // local includes
@@ -372,6 +378,73 @@ get_local_ip_for_gateway() {
     // Unimplemented
   }
 
+  std::vector<cpu_t>
+  cpu_topology() {
+    // Only the CPUs we're allowed to run on, containers and taskset may restrict them
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+      BOOST_LOG(warning) << "Couldn't get the CPU affinity: "sv << strerror(errno);
+      return {};
+    }
+
+    std::vector<cpu_t> cpus;
+    for (int id = 0; id < CPU_SETSIZE; ++id) {
+      if (!CPU_ISSET(id, &allowed)) {
+        continue;
+      }
+
+      cpu_t cpu { id, 0, 0 };
+
+      std::error_code ec;
+      auto cpu_dir = fs::path { "/sys/devices/system/cpu" } / ("cpu"s + std::to_string(id));
+      for (auto &entry : fs::directory_iterator { cpu_dir, ec }) {
+        auto name = entry.path().filename().string();
+        if (name.size() > 4 && name.starts_with("node"sv)) {
+          cpu.numa_node = std::atoi(name.c_str() + 4);
+        }
+      }
+
+      // Name the L3 domain after the lowest CPU sharing the cache
+      for (auto &entry : fs::directory_iterator { cpu_dir / "cache", ec }) {
+        std::ifstream level { entry.path() / "level" };
+        int cache_level = 0;
+        if (!(level >> cache_level) || cache_level != 3) {
+          continue;
+        }
+
+        std::ifstream shared_cpu_list { entry.path() / "shared_cpu_list" };
+        shared_cpu_list >> cpu.l3_domain;
+      }
+
+      cpus.emplace_back(cpu);
+    }
+
+    return cpus;
+  }
+
+  bool
+  set_thread_affinity(const std::vector<int> &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set);
+      }
+    }
+
+    if (!CPU_COUNT(&set)) {
+      return false;
+    }
+
+    if (auto status = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+      BOOST_LOG(warning) << "Couldn't set the thread's CPU affinity: "sv << strerror(status);
+      return false;
+    }
+
+    return true;
+  }
+
   void
   streaming_will_start() {
     // Nothing to do
@@ -471,6 +544,14 @@ get_local_ip_for_gateway() {
     auto sockfd = (int) send_info.native_socket;
     struct msghdr msg = {};
 
+    // Set once the send buffer was full, a batch is counted as short only once however often it waited
+    bool short_batch = false;
+    auto count_short_batch = util::fail_guard([&]() {
+      if (short_batch) {
+        ++send_info.short_batches;
+      }
+    });
+
     // Convert the target address into a sockaddr
     struct sockaddr_in taddr_v4 = {};
     struct sockaddr_in6 taddr_v6 = {};
@@ -488,7 +569,7 @@ get_local_ip_for_gateway() {
     }
 
     union {
-      char buf[CMSG_SPACE(sizeof(uint16_t)) +
+      char buf[CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(uint64_t)) +
                std::max(CMSG_SPACE(sizeof(struct in_pktinfo)), CMSG_SPACE(sizeof(struct in6_pktinfo)))];
       struct cmsghdr alignment;
     } cmbuf = {};  // Must be zeroed for CMSG_NXTHDR()
@@ -497,8 +578,9 @@ get_local_ip_for_gateway() {
     msg.msg_control = cmbuf.buf;
     msg.msg_controllen = sizeof(cmbuf.buf);
 
-    // The PKTINFO option will always be first, then we will conditionally
-    // append the UDP_SEGMENT option next if applicable.
+    // The PKTINFO option will always be first, followed by the TXTIME option
+    // if a departure time was given, then we will conditionally append the
+    // UDP_SEGMENT option next if applicable.
     auto pktinfo_cm = CMSG_FIRSTHDR(&msg);
     if (send_info.source_address.is_v6()) {
       struct in6_pktinfo pktInfo;
@@ -529,6 +611,25 @@ get_local_ip_for_gateway() {
       memcpy(CMSG_DATA(pktinfo_cm), &pktInfo, sizeof(pktInfo));
     }
 
+    auto last_cm = pktinfo_cm;
+
+#ifdef SO_TXTIME
+    if (send_info.departure_time) {
+      // steady_clock is CLOCK_MONOTONIC, which is the clock enable_socket_txtime() selected
+      uint64_t txtime = std::chrono::duration_cast<std::chrono::nanoseconds>(send_info.departure_time->time_since_epoch()).count();
+
+      auto txtime_cm = CMSG_NXTHDR(&msg, pktinfo_cm);
+      cmbuflen += CMSG_SPACE(sizeof(txtime));
+
+      txtime_cm->cmsg_level = SOL_SOCKET;
+      txtime_cm->cmsg_type = SCM_TXTIME;
+      txtime_cm->cmsg_len = CMSG_LEN(sizeof(txtime));
+      memcpy(CMSG_DATA(txtime_cm), &txtime, sizeof(txtime));
+
+      last_cm = txtime_cm;
+    }
+#endif
+
     auto const max_iovs_per_msg = send_info.payload_buffers.size() + (send_info.headers ? 1 : 0);
 
 #ifdef UDP_SEGMENT
@@ -574,7 +675,7 @@ get_local_ip_for_gateway() {
           msg.msg_controllen = cmbuflen + CMSG_SPACE(sizeof(uint16_t));
 
           // Enable GSO to perform segmentation of our buffer for us
-          auto cm = CMSG_NXTHDR(&msg, pktinfo_cm);
+          auto cm = CMSG_NXTHDR(&msg, last_cm);
           cm->cmsg_level = SOL_UDP;
           cm->cmsg_type = UDP_SEGMENT;
           cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
@@ -591,6 +692,8 @@ get_local_ip_for_gateway() {
         if (bytes_sent < 0) {
           // If there's no send buffer space, wait for some to be available
           if (errno == EAGAIN) {
+            short_batch = true;
+
             struct pollfd pfd;
 
             pfd.fd = sockfd;
@@ -651,6 +754,8 @@ get_local_ip_for_gateway() {
         if (msgs_sent < 0) {
           // If there's no send buffer space, wait for some to be available
           if (errno == EAGAIN) {
+            short_batch = true;
+
             struct pollfd pfd;
 
             pfd.fd = sockfd;
@@ -669,6 +774,11 @@ get_local_ip_for_gateway() {
           return false;
         }
 
+        // The send buffer filled up in the middle of the batch
+        if (blocks_sent + msgs_sent < send_info.block_count) {
+          short_batch = true;
+        }
+
         blocks_sent += msgs_sent;
       }
 
@@ -806,6 +916,170 @@ get_local_ip_for_gateway() {
     std::vector<std::tuple<int, int, int>> options;
   };
 
+  bool
+  enable_socket_txtime(std::uintptr_t native_socket) {
+#ifdef SO_TXTIME
+    struct sock_txtime txtime = {};
+
+    // The fq qdisc only accepts departure times on the monotonic clock
+    txtime.clockid = CLOCK_MONOTONIC;
+    txtime.flags = 0;
+
+    if (setsockopt((int) native_socket, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime))) {
+      BOOST_LOG(warning) << "Failed to set SO_TXTIME, falling back to userspace pacing: "sv << errno;
+      return false;
+    }
+
+    return true;
+#else
+    BOOST_LOG(warning) << "SO_TXTIME isn't supported by this build, falling back to userspace pacing"sv;
+    return false;
+#endif
+  }
+
+  /**
+   * @brief Find the index of the interface the kernel routes traffic to an address through.
+   * @param address The destination address.
+   * @return The interface index, or 0 if it can't be determined.
+   */
+  static unsigned int
+  egress_interface(const boost::asio::ip::address &address) {
+    auto family = address.is_v6() ? AF_INET6 : AF_INET;
+    auto fd = socket(family, SOCK_DGRAM, 0);
+    if (fd < 0) {
+      return 0;
+    }
+    auto close_fd = util::fail_guard([fd]() {
+      close(fd);
+    });
+
+    // Connecting a UDP socket sends nothing, it only picks the route and with it the source address
+    boost::asio::ip::udp::endpoint peer { address, 9 };
+    if (connect(fd, (sockaddr *) peer.data(), peer.size())) {
+      return 0;
+    }
+
+    sockaddr_storage local {};
+    socklen_t local_size = sizeof(local);
+    if (getsockname(fd, (sockaddr *) &local, &local_size)) {
+      return 0;
+    }
+
+    ifaddrs *ifaddr;
+    if (getifaddrs(&ifaddr)) {
+      return 0;
+    }
+    auto free_ifaddr = util::fail_guard([ifaddr]() {
+      freeifaddrs(ifaddr);
+    });
+
+    for (auto ifa = ifaddr; ifa; ifa = ifa->ifa_next) {
+      if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != family) {
+        continue;
+      }
+
+      bool match = family == AF_INET ?
+                     ((sockaddr_in *) ifa->ifa_addr)->sin_addr.s_addr == ((sockaddr_in *) &local)->sin_addr.s_addr :
+                     !memcmp(&((sockaddr_in6 *) ifa->ifa_addr)->sin6_addr, &((sockaddr_in6 *) &local)->sin6_addr, sizeof(in6_addr));
+      if (match) {
+        return if_nametoindex(ifa->ifa_name);
+      }
+    }
+
+    return 0;
+  }
+
+  bool
+  departure_time_enforced(const boost::asio::ip::address &address) {
+    auto ifindex = egress_interface(address);
+    if (!ifindex) {
+      BOOST_LOG(warning) << "Unable to find the interface traffic to "sv << address.to_string() << " leaves through"sv;
+      return false;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    if (fd < 0) {
+      BOOST_LOG(warning) << "Socket creation failed: "sv << strerror(errno);
+      return false;
+    }
+    auto close_fd = util::fail_guard([fd]() {
+      close(fd);
+    });
+
+    struct {
+      nlmsghdr header;
+      tcmsg tc;
+    } request {};
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(tcmsg));
+    request.header.nlmsg_type = RTM_GETQDISC;
+    request.header.nlmsg_flags = NLM_F_DUMP | NLM_F_REQUEST;
+    request.header.nlmsg_seq = 1;
+    request.tc.tcm_family = AF_UNSPEC;
+
+    if (send(fd, &request, request.header.nlmsg_len, 0) < 0) {
+      BOOST_LOG(warning) << "Send message failed: "sv << strerror(errno);
+      return false;
+    }
+
+    // The qdiscs of the interface: handle, parent and kind
+    std::vector<std::tuple<std::uint32_t, std::uint32_t, std::string>> qdiscs;
+
+    alignas(nlmsghdr) char buffer[16384];
+    bool done = false;
+    while (!done) {
+      int len = recv(fd, buffer, sizeof(buffer), 0);
+      if (len <= 0) {
+        break;
+      }
+
+      for (auto msg = (nlmsghdr *) buffer; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len)) {
+        if (msg->nlmsg_type == NLMSG_DONE || msg->nlmsg_type == NLMSG_ERROR) {
+          done = true;
+          break;
+        }
+
+        auto tc = (tcmsg *) NLMSG_DATA(msg);
+        if (msg->nlmsg_type != RTM_NEWQDISC || tc->tcm_ifindex != (int) ifindex) {
+          continue;
+        }
+
+        auto attr = (rtattr *) ((char *) tc + NLMSG_ALIGN(sizeof(tcmsg)));
+        int attr_len = msg->nlmsg_len - NLMSG_LENGTH(sizeof(tcmsg));
+        for (; RTA_OK(attr, attr_len); attr = RTA_NEXT(attr, attr_len)) {
+          if (attr->rta_type == TCA_KIND) {
+            qdiscs.emplace_back(tc->tcm_handle, tc->tcm_parent, std::string { (char *) RTA_DATA(attr) });
+          }
+        }
+      }
+    }
+
+    // Multiqueue devices have an mq root with one child qdisc per transmit queue, all of them must be fq
+    for (auto &[handle, parent, kind] : qdiscs) {
+      if (parent != TC_H_ROOT) {
+        continue;
+      }
+
+      bool enforced = kind == "fq"sv;
+      if (kind == "mq"sv) {
+        auto children = std::count_if(std::begin(qdiscs), std::end(qdiscs), [&](auto &qdisc) {
+          return std::get<1>(qdisc) != TC_H_ROOT && TC_H_MAJ(std::get<1>(qdisc)) == TC_H_MAJ(handle);
+        });
+        auto fq_children = std::count_if(std::begin(qdiscs), std::end(qdiscs), [&](auto &qdisc) {
+          return std::get<1>(qdisc) != TC_H_ROOT && TC_H_MAJ(std::get<1>(qdisc)) == TC_H_MAJ(handle) && std::get<2>(qdisc) == "fq"sv;
+        });
+        enforced = children > 0 && children == fq_children;
+      }
+
+      if (!enforced) {
+        BOOST_LOG(info) << "The "sv << kind << " qdisc doesn't enforce departure times, pacing video packets in userspace instead"sv;
+      }
+      return enforced;
+    }
+
+    BOOST_LOG(warning) << "Unable to find the qdisc of interface "sv << ifindex << ", pacing video packets in userspace"sv;
+    return false;
+  }
+
   /**
    * @brief Enables QoS on the given socket for traffic to the specified destination.
    * @param native_socket The native socket handle.
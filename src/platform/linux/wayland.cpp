@@ -16,6 +16,7 @@
 #include "wayland.h"
 
 extern const wl_interface wl_output_interface;
+extern const wl_interface wl_shm_interface;
 
 using namespace std::literals;
 
@@ -46,11 +47,12 @@ namespace wl {
       return -1;
     }
 
-    display_internal.reset(wl_display_connect(display_name));
-    if (!display_internal) {
+    auto display = wl_display_connect(display_name);
+    if (!display) {
       BOOST_LOG(error) << "Couldn't connect to Wayland display: "sv << display_name;
       return -1;
     }
+    display_internal.reset(display, wl_display_disconnect);
 
     BOOST_LOG(info) << "Found display ["sv << display_name << ']';
 
@@ -94,6 +96,11 @@ namespace wl {
     return true;
   }
 
+  void
+  display_t::flush() {
+    wl_display_flush(display_internal.get());
+  }
+
   wl_registry *
   display_t::registry() {
     return wl_display_get_registry(display_internal.get());
@@ -160,7 +167,11 @@ namespace wl {
 
   interface_t::interface_t() noexcept
       :
+      dmabuf_manager { nullptr },
+      screencopy_manager { nullptr },
+      screencopy_version { 0 },
       output_manager { nullptr },
+      shm { nullptr },
       listener {
         &CLASS_CALL(interface_t, add_interface),
         &CLASS_CALL(interface_t, del_interface)
@@ -193,6 +204,20 @@ namespace wl {
 
       this->interface[WLR_EXPORT_DMABUF] = true;
     }
+    else if (!std::strcmp(interface, zwlr_screencopy_manager_v1_interface.name)) {
+      BOOST_LOG(info) << "Found interface: "sv << interface << '(' << id << ") version "sv << version;
+      // Version 2 adds copy_with_damage, version 3 adds buffer_done
+      screencopy_version = std::min<std::uint32_t>(version, 3);
+      screencopy_manager = (zwlr_screencopy_manager_v1 *) wl_registry_bind(registry, id, &zwlr_screencopy_manager_v1_interface, screencopy_version);
+
+      this->interface[WLR_SCREENCOPY] = true;
+    }
+    else if (!std::strcmp(interface, wl_shm_interface.name)) {
+      BOOST_LOG(info) << "Found interface: "sv << interface << '(' << id << ") version "sv << version;
+      shm = (wl_shm *) wl_registry_bind(registry, id, &wl_shm_interface, 1);
+
+      this->interface[SHM] = true;
+    }
   }
 
   void
@@ -200,6 +225,29 @@ namespace wl {
     BOOST_LOG(info) << "Delete: "sv << id;
   }
 
+  /**
+   * @brief Get the time the compositor finished a frame, from the timestamp of its ready event.
+   * @details The next frame is requested while the current one is consumed, so its events are
+   * only read once the capture loop is due for it. wlroots stamps frames with CLOCK_MONOTONIC,
+   * the clock of `std::chrono::steady_clock`.
+   * @return The time of the frame, or the current time if the timestamp is from another clock.
+   */
+  static std::chrono::steady_clock::time_point
+  frame_time(std::uint32_t tv_sec_hi, std::uint32_t tv_sec_lo, std::uint32_t tv_nsec) {
+    auto now = std::chrono::steady_clock::now();
+
+    auto time = std::chrono::steady_clock::time_point {
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::seconds { ((std::uint64_t) tv_sec_hi << 32) | tv_sec_lo } + std::chrono::nanoseconds { tv_nsec })
+    };
+
+    if (time > now || now - time > 1s) {
+      return now;
+    }
+
+    return time;
+  }
+
   dmabuf_t::dmabuf_t():
       status { READY }, frames {}, current_frame { &frames[0] }, listener {
         &CLASS_CALL(dmabuf_t, frame),
@@ -265,6 +313,7 @@ namespace wl {
     current_frame->destroy();
     current_frame = get_next_frame();
 
+    ready_time = frame_time(tv_sec_hi, tv_sec_lo, tv_nsec);
     status = READY;
   }
 
@@ -280,6 +329,118 @@ namespace wl {
     status = REINIT;
   }
 
+  screencopy_t::screencopy_t():
+      status { READY }, format {}, width {}, height {}, stride {}, y_invert { false }, version { 0 }, listener {
+        &CLASS_CALL(screencopy_t, buffer),
+        &CLASS_CALL(screencopy_t, flags),
+        &CLASS_CALL(screencopy_t, ready),
+        &CLASS_CALL(screencopy_t, failed),
+        &CLASS_CALL(screencopy_t, damage),
+        &CLASS_CALL(screencopy_t, linux_dmabuf),
+        &CLASS_CALL(screencopy_t, buffer_done)
+      },
+      current { nullptr },
+      target { nullptr } {
+  }
+
+  screencopy_t::~screencopy_t() {
+    destroy();
+  }
+
+  void
+  screencopy_t::listen(zwlr_screencopy_manager_v1 *screencopy_manager, wl_output *output, bool blend_cursor, wl_buffer *target) {
+    destroy();
+
+    this->target = target;
+    current = zwlr_screencopy_manager_v1_capture_output(screencopy_manager, blend_cursor, output);
+    zwlr_screencopy_frame_v1_add_listener(current, &listener, this);
+
+    status = WAITING;
+  }
+
+  void
+  screencopy_t::buffer(
+    zwlr_screencopy_frame_v1 *frame,
+    std::uint32_t format,
+    std::uint32_t width, std::uint32_t height,
+    std::uint32_t stride) {
+    if (target && (format != this->format || width != this->width || height != this->height || stride != this->stride)) {
+      BOOST_LOG(info) << "Screencopy buffer changed to "sv << width << 'x' << height << ", reinitializing"sv;
+
+      destroy();
+      status = REINIT;
+      return;
+    }
+
+    this->format = format;
+    this->width = width;
+    this->height = height;
+    this->stride = stride;
+
+    // Before buffer_done, the shm buffer is the last buffer event
+    if (version < 3) {
+      copy(frame);
+    }
+  }
+
+  void
+  screencopy_t::buffer_done(zwlr_screencopy_frame_v1 *frame) {
+    copy(frame);
+  }
+
+  void
+  screencopy_t::copy(zwlr_screencopy_frame_v1 *frame) {
+    if (status != WAITING) {
+      return;
+    }
+
+    if (!target) {
+      destroy();
+      status = READY;
+      return;
+    }
+
+    // Let the compositor hold on to the request until the output is damaged,
+    // so an unchanged output costs neither a copy nor a wakeup
+    if (version >= 2) {
+      zwlr_screencopy_frame_v1_copy_with_damage(frame, target);
+    }
+    else {
+      zwlr_screencopy_frame_v1_copy(frame, target);
+    }
+  }
+
+  void
+  screencopy_t::flags(zwlr_screencopy_frame_v1 *frame, std::uint32_t flags) {
+    y_invert = flags & ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT;
+  }
+
+  void
+  screencopy_t::ready(
+    zwlr_screencopy_frame_v1 *frame,
+    std::uint32_t tv_sec_hi, std::uint32_t tv_sec_lo, std::uint32_t tv_nsec) {
+    destroy();
+
+    // A copy_with_damage request may have waited across several snapshots for the damage
+    ready_time = frame_time(tv_sec_hi, tv_sec_lo, tv_nsec);
+    status = READY;
+  }
+
+  void
+  screencopy_t::failed(zwlr_screencopy_frame_v1 *frame) {
+    destroy();
+
+    status = REINIT;
+  }
+
+  void
+  screencopy_t::destroy() {
+    if (current) {
+      zwlr_screencopy_frame_v1_destroy(current);
+      current = nullptr;
+    }
+  }
+
   void
   frame_t::destroy() {
     for (auto x = 0; x < 4; ++x) {
@@ -8,6 +8,7 @@
 
 #ifdef SUNSHINE_BUILD_WAYLAND
   #include <wlr-export-dmabuf-unstable-v1.h>
+  #include <wlr-screencopy-unstable-v1.h>
   #include <xdg-output-unstable-v1.h>
 #endif
 
@@ -20,7 +21,8 @@
 #ifdef SUNSHINE_BUILD_WAYLAND
 
 namespace wl {
-  using display_internal_t = util::safe_ptr<wl_display, wl_display_disconnect>;
+  // Shared with the images that own Wayland buffers, which must be destroyed before the connection
+  using display_internal_t = std::shared_ptr<wl_display>;
 
   class frame_t {
   public:
@@ -93,10 +95,105 @@ namespace wl {
 
     std::array<frame_t, 2> frames;
     frame_t *current_frame;
+    std::chrono::steady_clock::time_point ready_time;
 
     zwlr_export_dmabuf_frame_v1_listener listener;
   };
 
+  /**
+   * @brief A frame request of wlr-screencopy that copies the output into a buffer of ours once it's damaged.
+   */
+  class screencopy_t {
+  public:
+    enum status_e {
+      WAITING,  ///< Waiting for the compositor to copy a frame
+      READY,  ///< The frame was copied into the target buffer, or the buffer parameters are known
+      REINIT,  ///< The copy failed or the buffer parameters changed
+    };
+
+    screencopy_t(screencopy_t &&) = delete;
+    screencopy_t(const screencopy_t &) = delete;
+
+    screencopy_t &
+    operator=(const screencopy_t &) = delete;
+    screencopy_t &
+    operator=(screencopy_t &&) = delete;
+
+    screencopy_t();
+
+    /**
+     * @brief Request a frame.
+     * @param screencopy_manager The screencopy manager.
+     * @param output The output to capture.
+     * @param blend_cursor Whether the cursor is part of the frame.
+     * @param target The buffer to copy the frame into once the output is damaged,
+     * or `nullptr` to only learn the buffer parameters the compositor expects.
+     */
+    void
+    listen(zwlr_screencopy_manager_v1 *screencopy_manager, wl_output *output, bool blend_cursor, wl_buffer *target);
+
+    ~screencopy_t();
+
+    void
+    buffer(
+      zwlr_screencopy_frame_v1 *frame,
+      std::uint32_t format,
+      std::uint32_t width, std::uint32_t height,
+      std::uint32_t stride);
+
+    void
+    flags(zwlr_screencopy_frame_v1 *frame, std::uint32_t flags);
+
+    void
+    ready(
+      zwlr_screencopy_frame_v1 *frame,
+      std::uint32_t tv_sec_hi, std::uint32_t tv_sec_lo, std::uint32_t tv_nsec);
+
+    void
+    failed(zwlr_screencopy_frame_v1 *frame);
+
+    void
+    damage(
+      zwlr_screencopy_frame_v1 *frame,
+      std::uint32_t x, std::uint32_t y,
+      std::uint32_t width, std::uint32_t height) {}
+
+    void
+    linux_dmabuf(
+      zwlr_screencopy_frame_v1 *frame,
+      std::uint32_t format,
+      std::uint32_t width, std::uint32_t height) {}
+
+    void
+    buffer_done(zwlr_screencopy_frame_v1 *frame);
+
+    status_e status;
+
+    // The shm buffer parameters of the compositor, the target buffer must match them
+    std::uint32_t format;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t stride;
+
+    bool y_invert;
+    std::chrono::steady_clock::time_point ready_time;
+
+    // Before version 3, the compositor doesn't send buffer_done
+    std::uint32_t version;
+
+    zwlr_screencopy_frame_v1_listener listener;
+
+  private:
+    void
+    copy(zwlr_screencopy_frame_v1 *frame);
+
+    void
+    destroy();
+
+    zwlr_screencopy_frame_v1 *current;
+    wl_buffer *target;
+  };
+
   class monitor_t {
   public:
     monitor_t(monitor_t &&) = delete;
@@ -156,6 +253,8 @@ namespace wl {
     enum interface_e {
       XDG_OUTPUT,  ///< xdg-output
       WLR_EXPORT_DMABUF,  ///< Export dmabuf
+      WLR_SCREENCOPY,  ///< Screencopy
+      SHM,  ///< Shared memory buffers
       MAX_INTERFACES,  ///< Maximum number of interfaces
     };
 
@@ -175,7 +274,10 @@ namespace wl {
     std::vector<std::unique_ptr<monitor_t>> monitors;
 
     zwlr_export_dmabuf_manager_v1 *dmabuf_manager;
+    zwlr_screencopy_manager_v1 *screencopy_manager;
+    std::uint32_t screencopy_version;
     zxdg_output_manager_v1 *output_manager;
+    wl_shm *shm;
 
     bool
     operator[](interface_e bit) const {
@@ -212,16 +314,25 @@ namespace wl {
     bool
     dispatch(std::chrono::milliseconds timeout);
 
+    // Send requests to the compositor without waiting for events
+    void
+    flush();
+
     // Get the registry associated with the display
     // No need to manually free the registry
     wl_registry *
     registry();
 
-    inline display_internal_t::pointer
+    inline wl_display *
     get() {
       return display_internal.get();
     }
 
+    inline display_internal_t
+    shared() const {
+      return display_internal;
+    }
+
   private:
     display_internal_t display_internal;
   };
@@ -2,14 +2,19 @@
  * @file src/platform/linux/wlgrab.cpp
  * @brief Definitions for wlgrab capture.
  */
+#include <cstring>
 #include <thread>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "src/platform/common.h"
 
 #include "src/logging.h"
 #include "src/video.h"
 
 #include "cuda.h"
+#include "frame_buffer.h"
 #include "vaapi.h"
 #include "wayland.h"
 
@@ -19,10 +24,38 @@ namespace wl {
   static int env_height;
 
   struct img_t: public platf::img_t {
+    explicit img_t(std::size_t size):
+        buffer { size } {
+      data = buffer.data();
+    }
+
     ~img_t() override {
-      delete[] data;
+      // Owned by buffer
       data = nullptr;
     }
+
+    platf::frame_buffer::buffer_t buffer;
+  };
+
+  /**
+   * @brief An image in shared memory the compositor copies screencopy frames into.
+   */
+  struct shm_img_t: public platf::img_t {
+    ~shm_img_t() override {
+      if (buffer) {
+        wl_buffer_destroy(buffer);
+      }
+
+      if (data) {
+        munmap(data, size);
+        data = nullptr;
+      }
+    }
+
+    // The buffer must be destroyed before the connection is closed
+    display_internal_t display;
+    wl_buffer *buffer {};
+    std::size_t size {};
   };
 
   class wlr_t: public platf::display_t {
@@ -45,11 +78,6 @@ namespace wl {
         return -1;
       }
 
-      if (!interface[wl::interface_t::WLR_EXPORT_DMABUF]) {
-        BOOST_LOG(error) << "Missing Wayland wire for wlr-export-dmabuf"sv;
-        return -1;
-      }
-
       auto monitor = interface.monitors[0].get();
 
       if (!display_name.empty()) {
@@ -91,14 +119,18 @@ namespace wl {
     snapshot(const pull_free_image_cb_t &pull_free_image_cb, std::shared_ptr<platf::img_t> &img_out, std::chrono::milliseconds timeout, bool cursor) {
       auto to = std::chrono::steady_clock::now() + timeout;
 
+      // Normally the request for this frame was sent when the previous frame arrived
+      if (dmabuf.status != dmabuf_t::WAITING) {
+        dmabuf.listen(interface.dmabuf_manager, output, cursor);
+      }
+
       // Dispatch events until we get a new frame or the timeout expires
-      dmabuf.listen(interface.dmabuf_manager, output, cursor);
-      do {
+      while (dmabuf.status == dmabuf_t::WAITING) {
         auto remaining_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(to - std::chrono::steady_clock::now());
         if (remaining_time_ms.count() < 0 || !display.dispatch(remaining_time_ms)) {
           return platf::capture_e::timeout;
         }
-      } while (dmabuf.status == dmabuf_t::WAITING);
+      }
 
       auto current_frame = dmabuf.current_frame;
 
@@ -109,6 +141,13 @@ namespace wl {
         return platf::capture_e::reinit;
       }
 
+      // Keep the request for the next frame in flight while this one is converted and the capture loop
+      // waits for the next frame slot, so the compositor's roundtrip doesn't add to the capture latency.
+      // Its events are only dispatched by the next call, after this frame was consumed,
+      // which is why frames are stamped with the time of their ready event.
+      dmabuf.listen(interface.dmabuf_manager, output, cursor);
+      display.flush();
+
       return platf::capture_e::ok;
     }
 
@@ -173,6 +212,10 @@ namespace wl {
 
     platf::capture_e
     snapshot(const pull_free_image_cb_t &pull_free_image_cb, std::shared_ptr<platf::img_t> &img_out, std::chrono::milliseconds timeout, bool cursor) {
+      if (use_screencopy) {
+        return screencopy_snapshot(pull_free_image_cb, img_out, timeout, cursor);
+      }
+
       auto status = wlr_t::snapshot(pull_free_image_cb, img_out, timeout, cursor);
       if (status != platf::capture_e::ok) {
         return status;
@@ -201,15 +244,133 @@ namespace wl {
       gl::ctx.GetTextureSubImage((*rgb_opt)->tex[0], 0, 0, 0, 0, width, height, 1, GL_BGRA, GL_UNSIGNED_BYTE, img_out->height * img_out->row_pitch, img_out->data);
       gl::ctx.BindTexture(GL_TEXTURE_2D, 0);
 
+      img_out->frame_timestamp = dmabuf.ready_time;
+
+      return platf::capture_e::ok;
+    }
+
+    platf::capture_e
+    screencopy_snapshot(const pull_free_image_cb_t &pull_free_image_cb, std::shared_ptr<platf::img_t> &img_out, std::chrono::milliseconds timeout, bool cursor) {
+      auto to = std::chrono::steady_clock::now() + timeout;
+
+      // Normally the request for this frame was sent when the previous frame arrived.
+      // A request that timed out without damage stays in flight as well.
+      if (screencopy.status != screencopy_t::WAITING && !request_screencopy(pull_free_image_cb, cursor)) {
+        return platf::capture_e::interrupted;
+      }
+
+      // The compositor only copies the frame once the output is damaged, so an unchanged output times out
+      while (screencopy.status == screencopy_t::WAITING) {
+        auto remaining_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(to - std::chrono::steady_clock::now());
+        if (remaining_time_ms.count() < 0 || !display.dispatch(remaining_time_ms)) {
+          return platf::capture_e::timeout;
+        }
+      }
+
+      if (screencopy.status == screencopy_t::REINIT) {
+        return platf::capture_e::reinit;
+      }
+
+      img_out = std::move(screencopy_img);
+      img_out->frame_timestamp = screencopy.ready_time;
+
+      if (screencopy.y_invert) {
+        flip_rows(*img_out);
+      }
+
+      // Like with dmabufs, keep the request for the next frame in flight
+      if (!request_screencopy(pull_free_image_cb, cursor)) {
+        return platf::capture_e::interrupted;
+      }
+
       return platf::capture_e::ok;
     }
 
+    /**
+     * @brief Ask the compositor to copy the next damaged frame into a free image.
+     * @param pull_free_image_cb The callback to get a free image.
+     * @param cursor Whether the cursor is part of the frame.
+     * @return `false` if no image could be pulled.
+     */
+    bool
+    request_screencopy(const pull_free_image_cb_t &pull_free_image_cb, bool cursor) {
+      if (!pull_free_image_cb(screencopy_img)) {
+        return false;
+      }
+
+      screencopy.listen(interface.screencopy_manager, output, cursor, ((shm_img_t *) screencopy_img.get())->buffer);
+      display.flush();
+
+      return true;
+    }
+
+    static void
+    flip_rows(platf::img_t &img) {
+      std::vector<std::uint8_t> row(img.row_pitch);
+
+      for (int y = 0; y < img.height / 2; ++y) {
+        auto top = img.data + y * img.row_pitch;
+        auto bottom = img.data + (img.height - 1 - y) * img.row_pitch;
+
+        std::memcpy(row.data(), top, img.row_pitch);
+        std::memcpy(top, bottom, img.row_pitch);
+        std::memcpy(bottom, row.data(), img.row_pitch);
+      }
+    }
+
+    /**
+     * @brief Check if the compositor can copy frames into shared memory in a format the encoders take.
+     * @return `true` if screencopy can be used.
+     */
+    bool
+    probe_screencopy() {
+      // copy_with_damage was added in version 2
+      if (!interface[wl::interface_t::WLR_SCREENCOPY] || !interface[wl::interface_t::SHM] || interface.screencopy_version < 2) {
+        return false;
+      }
+
+      screencopy.version = interface.screencopy_version;
+      screencopy.listen(interface.screencopy_manager, output, false, nullptr);
+      while (screencopy.status == screencopy_t::WAITING) {
+        if (!display.dispatch(1000ms)) {
+          return false;
+        }
+      }
+
+      if (screencopy.status != screencopy_t::READY) {
+        return false;
+      }
+
+      // Frames are passed on as BGRA, like the ones read back from dmabufs
+      if (
+        (screencopy.format != WL_SHM_FORMAT_ARGB8888 && screencopy.format != WL_SHM_FORMAT_XRGB8888) ||
+        screencopy.width != (std::uint32_t) width || screencopy.height != (std::uint32_t) height ||
+        screencopy.stride < (std::uint32_t) width * 4) {
+        BOOST_LOG(info) << "Screencopy buffer format "sv << util::hex(screencopy.format).to_string_view() << " with size "sv
+                        << screencopy.width << 'x' << screencopy.height << " is not supported"sv;
+        return false;
+      }
+
+      return true;
+    }
+
     int
     init(platf::mem_type_e hwdevice_type, const std::string &display_name, const ::video::config_t &config) {
       if (wlr_t::init(hwdevice_type, display_name, config)) {
         return -1;
       }
 
+      use_screencopy = probe_screencopy();
+      if (use_screencopy) {
+        BOOST_LOG(info) << "Capturing damaged frames with wlr-screencopy"sv;
+        return 0;
+      }
+
+      if (!interface[wl::interface_t::WLR_EXPORT_DMABUF]) {
+        BOOST_LOG(error) << "Missing Wayland wire for wlr-export-dmabuf"sv;
+        return -1;
+      }
+
       egl_display = egl::make_display(display.get());
       if (!egl_display) {
         return -1;
@@ -244,22 +405,86 @@ namespace wl {
 
     std::shared_ptr<platf::img_t>
     alloc_img() override {
-      auto img = std::make_shared<img_t>();
+      if (use_screencopy) {
+        return alloc_shm_img();
+      }
+
+      auto row_pitch = 4 * width;
+
+      auto img = std::make_shared<img_t>((std::size_t) height * row_pitch);
       img->width = width;
       img->height = height;
       img->pixel_pitch = 4;
-      img->row_pitch = img->pixel_pitch * width;
-      img->data = new std::uint8_t[height * img->row_pitch];
+      img->row_pitch = row_pitch;
+
+      return img;
+    }
+
+    std::shared_ptr<platf::img_t>
+    alloc_shm_img() {
+      auto img = std::make_shared<shm_img_t>();
+      img->width = width;
+      img->height = height;
+      img->pixel_pitch = 4;
+      img->row_pitch = screencopy.stride;
+      img->size = (std::size_t) img->row_pitch * height;
+      img->display = display.shared();
+
+      int fd = memfd_create("sunshine-screencopy", MFD_CLOEXEC);
+      if (fd < 0) {
+        BOOST_LOG(error) << "Couldn't create shared memory for screencopy: "sv << strerror(errno);
+        return nullptr;
+      }
+      auto close_fd = util::fail_guard([fd]() {
+        close(fd);
+      });
+
+      if (ftruncate(fd, img->size)) {
+        BOOST_LOG(error) << "Couldn't size shared memory for screencopy: "sv << strerror(errno);
+        return nullptr;
+      }
+
+      auto data = mmap(nullptr, img->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED) {
+        BOOST_LOG(error) << "Couldn't map shared memory for screencopy: "sv << strerror(errno);
+        return nullptr;
+      }
+      img->data = (std::uint8_t *) data;
+
+      auto pool = wl_shm_create_pool(interface.shm, fd, img->size);
+      img->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, img->row_pitch, screencopy.format);
+      wl_shm_pool_destroy(pool);
 
       return img;
     }
 
     egl::display_t egl_display;
     egl::ctx_t ctx;
+
+    bool use_screencopy = false;
+
+    // The image the request in flight copies into, declared before the request so it outlives it
+    std::shared_ptr<platf::img_t> screencopy_img;
+    screencopy_t screencopy;
   };
 
   class wlr_vram_t: public wlr_t {
   public:
+    int
+    init(platf::mem_type_e hwdevice_type, const std::string &display_name, const ::video::config_t &config) {
+      if (wlr_t::init(hwdevice_type, display_name, config)) {
+        return -1;
+      }
+
+      // Only dmabufs can be imported by the encoders without a copy
+      if (!interface[wl::interface_t::WLR_EXPORT_DMABUF]) {
+        BOOST_LOG(error) << "Missing Wayland wire for wlr-export-dmabuf"sv;
+        return -1;
+      }
+
+      return 0;
+    }
+
     platf::capture_e
     capture(const push_captured_image_cb_t &push_captured_image_cb, const pull_free_image_cb_t &pull_free_image_cb, bool *cursor) override {
       auto next_frame = std::chrono::steady_clock::now();
@@ -325,6 +550,7 @@ namespace wl {
       img->sequence = sequence;
 
       img->sd = current_frame->sd;
+      img->frame_timestamp = dmabuf.ready_time;
 
       // Prevent dmabuf from closing the file descriptors.
       std::fill_n(current_frame->sd.fds, 4, -1);
@@ -420,8 +646,8 @@ namespace platf {
       return {};
     }
 
-    if (!interface[wl::interface_t::WLR_EXPORT_DMABUF]) {
-      BOOST_LOG(warning) << "Missing Wayland wire for wlr-export-dmabuf"sv;
+    if (!interface[wl::interface_t::WLR_EXPORT_DMABUF] && !interface[wl::interface_t::WLR_SCREENCOPY]) {
+      BOOST_LOG(warning) << "Missing Wayland wire for wlr-export-dmabuf and wlr-screencopy"sv;
       return {};
     }
 
@@ -20,10 +20,11 @@
 #include "src/config.h"
 #include "src/globals.h"
 #include "src/logging.h"
-#include "src/task_pool.h"
+#include "src/thread_pool.h"
 #include "src/video.h"
 
 #include "cuda.h"
+#include "cursor_blend.h"
 #include "graphics.h"
 #include "misc.h"
 #include "vaapi.h"
@@ -184,12 +185,16 @@ namespace platf {
         xcb_shm_seg_t shmseg,
         uint32_t offset));
 
-    _FN(shm_attach, xcb_void_cookie_t,
+    _FN(shm_attach_checked, xcb_void_cookie_t,
       (xcb_connection_t * c,
         xcb_shm_seg_t shmseg,
         uint32_t shmid,
         uint8_t read_only));
 
+    _FN(shm_detach, xcb_void_cookie_t,
+      (xcb_connection_t * c,
+        xcb_shm_seg_t shmseg));
+
     _FN(get_extension_data, xcb_query_extension_reply_t *,
       (xcb_connection_t * c, xcb_extension_t *ext));
 
@@ -199,6 +204,8 @@ namespace platf {
     _FN(connect, xcb_connection_t *, (const char *displayname, int *screenp));
     _FN(setup_roots_iterator, xcb_screen_iterator_t, (const xcb_setup_t *R));
     _FN(generate_id, std::uint32_t, (xcb_connection_t * c));
+    _FN(flush, int, (xcb_connection_t * c));
+    _FN(request_check, xcb_generic_error_t *, (xcb_connection_t * c, xcb_void_cookie_t cookie));
 
     int
     init_shm() {
@@ -218,7 +225,8 @@ namespace platf {
         { (dyn::apiproc *) &shm_id, "xcb_shm_id" },
         { (dyn::apiproc *) &shm_get_image_reply, "xcb_shm_get_image_reply" },
         { (dyn::apiproc *) &shm_get_image_unchecked, "xcb_shm_get_image_unchecked" },
-        { (dyn::apiproc *) &shm_attach, "xcb_shm_attach" },
+        { (dyn::apiproc *) &shm_attach_checked, "xcb_shm_attach_checked" },
+        { (dyn::apiproc *) &shm_detach, "xcb_shm_detach" },
       };
 
       if (dyn::load(handle, funcs)) {
@@ -251,6 +259,8 @@ namespace platf {
         { (dyn::apiproc *) &connect, "xcb_connect" },
         { (dyn::apiproc *) &setup_roots_iterator, "xcb_setup_roots_iterator" },
         { (dyn::apiproc *) &generate_id, "xcb_generate_id" },
+        { (dyn::apiproc *) &flush, "xcb_flush" },
+        { (dyn::apiproc *) &request_check, "xcb_request_check" },
       };
 
       if (dyn::load(handle, funcs)) {
@@ -269,7 +279,6 @@ namespace platf {
   void
   freeX(XFixesCursorImage *);
 
-  using xcb_connect_t = util::dyn_safe_ptr<xcb_connection_t, &xcb::disconnect>;
   using xcb_img_t = util::c_ptr<xcb_shm_get_image_reply_t>;
 
   using ximg_t = util::safe_ptr<XImage, freeImage>;
@@ -324,62 +333,49 @@ namespace platf {
     ximg_t img;
   };
 
+  /**
+   * @brief An image backed by its own SHM segment, so the X server writes captured frames directly into it.
+   */
   struct shm_img_t: public img_t {
     ~shm_img_t() override {
-      delete[] data;
+      if (xcb) {
+        // Requests are buffered, without a flush the server keeps the segment until the next capture request
+        xcb::shm_detach(xcb.get(), seg);
+        xcb::flush(xcb.get());
+      }
+
+      // Owned by shm_data
       data = nullptr;
     }
+
+    // The segment is registered with this connection, which must outlive it.
+    // Empty if the segment couldn't be created.
+    std::shared_ptr<xcb_connection_t> xcb;
+    std::uint32_t seg;
+
+    shm_id_t shm_id;
+    shm_data_t shm_data;
+
+    // Holds the frame instead of the segment if the image has none
+    ximg_t ximg;
   };
 
   static void
-  blend_cursor(Display *display, img_t &img, int offsetX, int offsetY) {
-    xcursor_t overlay { x11::fix::GetCursorImage(display) };
+  blend_cursor(Display *display, img_t &img, int offsetX, int offsetY, cursor::overlay_t &overlay) {
+    xcursor_t xcursor { x11::fix::GetCursorImage(display) };
 
-    if (!overlay) {
+    if (!xcursor) {
       BOOST_LOG(error) << "Couldn't get cursor from XFixesGetCursorImage"sv;
       return;
     }
 
-    overlay->x -= overlay->xhot;
-    overlay->y -= overlay->yhot;
-
-    overlay->x -= offsetX;
-    overlay->y -= offsetY;
-
-    overlay->x = std::max((short) 0, overlay->x);
-    overlay->y = std::max((short) 0, overlay->y);
-
-    auto pixels = (int *) img.data;
-
-    auto screen_height = img.height;
-    auto screen_width = img.width;
-
-    auto delta_height = std::min<uint16_t>(overlay->height, std::max(0, screen_height - overlay->y));
-    auto delta_width = std::min<uint16_t>(overlay->width, std::max(0, screen_width - overlay->x));
-    for (auto y = 0; y < delta_height; ++y) {
-      auto overlay_begin = &overlay->pixels[y * overlay->width];
-      auto overlay_end = &overlay->pixels[y * overlay->width + delta_width];
-
-      auto pixels_begin = &pixels[(y + overlay->y) * (img.row_pitch / img.pixel_pitch) + overlay->x];
-
-      std::for_each(overlay_begin, overlay_end, [&](long pixel) {
-        int *pixel_p = (int *) &pixel;
-
-        auto colors_in = (uint8_t *) pixels_begin;
-
-        auto alpha = (*(uint *) pixel_p) >> 24u;
-        if (alpha == 255) {
-          *pixels_begin = *pixel_p;
-        }
-        else {
-          auto colors_out = (uint8_t *) pixel_p;
-          colors_in[0] = colors_out[0] + (colors_in[0] * (255 - alpha) + 255 / 2) / 255;
-          colors_in[1] = colors_out[1] + (colors_in[1] * (255 - alpha) + 255 / 2) / 255;
-          colors_in[2] = colors_out[2] + (colors_in[2] * (255 - alpha) + 255 / 2) / 255;
-        }
-        ++pixels_begin;
-      });
+    // XFixes hands out the pixels as longs, so only convert them when the cursor image changed
+    if (overlay.stale(xcursor->cursor_serial)) {
+      std::vector<std::uint32_t> pixels(xcursor->pixels, xcursor->pixels + xcursor->width * xcursor->height);
+      overlay.update(xcursor->cursor_serial, pixels.data(), xcursor->width, xcursor->height, xcursor->width, xcursor->width, xcursor->height);
     }
+
+    overlay.blend(img, xcursor->x - xcursor->xhot - offsetX, xcursor->y - xcursor->yhot - offsetY);
   }
 
   struct x11_attr_t: public display_t {
@@ -391,6 +387,8 @@ namespace platf {
 
     mem_type_e mem_type;
 
+    cursor::overlay_t cursor_overlay;
+
     /**
      * Last X (NOT the streamed monitor!) size.
      * This way we can trigger reinitialization if the dimensions changed while streaming
@@ -549,7 +547,7 @@ namespace platf {
       img->img.reset(x_img);
 
       if (cursor) {
-        blend_cursor(xdisplay.get(), *img, offset_x, offset_y);
+        blend_cursor(xdisplay.get(), *img, offset_x, offset_y, cursor_overlay);
       }
 
       return capture_e::ok;
@@ -595,30 +593,32 @@ namespace platf {
 
   struct shm_attr_t: public x11_attr_t {
     x11::xdisplay_t shm_xdisplay;  // Prevent race condition with x11_attr_t::xdisplay
-    xcb_connect_t xcb;
+    std::shared_ptr<xcb_connection_t> xcb;
     xcb_screen_t *display;
-    std::uint32_t seg;
-
-    shm_id_t shm_id;
-
-    shm_data_t data;
 
+    // The refresh reposts itself, so its id is only touched on this strand
+    std::shared_ptr<thread_pool_util::Strand> refresh_strand;
     task_pool_util::TaskPool::task_id_t refresh_task_id;
 
     void
     delayed_refresh() {
       refresh();
 
-      refresh_task_id = task_pool.pushDelayed(&shm_attr_t::delayed_refresh, 2s, this).task_id;
+      refresh_task_id = refresh_strand->postDelayed(&shm_attr_t::delayed_refresh, 2s, this);
     }
 
     shm_attr_t(mem_type_e mem_type):
-        x11_attr_t(mem_type), shm_xdisplay { x11::OpenDisplay(nullptr) } {
-      refresh_task_id = task_pool.pushDelayed(&shm_attr_t::delayed_refresh, 2s, this).task_id;
+        x11_attr_t(mem_type), shm_xdisplay { x11::OpenDisplay(nullptr) }, refresh_strand { task_pool.strand() }, refresh_task_id {} {
+      refresh_strand->run_and_wait([this]() {
+        refresh_task_id = refresh_strand->postDelayed(&shm_attr_t::delayed_refresh, 2s, this);
+      });
     }
 
     ~shm_attr_t() override {
-      while (!task_pool.cancel(refresh_task_id));
+      // Once canceled on the strand, the refresh is neither running nor reposted
+      refresh_strand->run_and_wait([this]() {
+        refresh_strand->cancel(refresh_task_id);
+      });
     }
 
     capture_e
@@ -675,7 +675,19 @@ namespace platf {
         return capture_e::reinit;
       }
       else {
-        auto img_cookie = xcb::shm_get_image_unchecked(xcb.get(), display->root, offset_x, offset_y, width, height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP, seg, 0);
+        if (!pull_free_image_cb(img_out)) {
+          return platf::capture_e::interrupted;
+        }
+
+        // The X server writes the frame straight into the segment of the image the encoder will consume
+        auto img = (shm_img_t *) img_out.get();
+        if (!img->xcb) {
+          // Out of SHM segments. A reinit would allocate as many segments again, so fetch this image's frames through the
+          // X connection instead, the way the capture without SHM does.
+          return snapshot_without_segment(*img, cursor);
+        }
+
+        auto img_cookie = xcb::shm_get_image_unchecked(xcb.get(), display->root, offset_x, offset_y, width, height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP, img->seg, 0);
         auto frame_timestamp = std::chrono::steady_clock::now();
 
         xcb_img_t img_reply { xcb::shm_get_image_reply(xcb.get(), img_cookie, nullptr) };
@@ -684,21 +696,45 @@ namespace platf {
           return capture_e::reinit;
         }
 
-        if (!pull_free_image_cb(img_out)) {
-          return platf::capture_e::interrupted;
-        }
-
-        std::copy_n((std::uint8_t *) data.data, frame_size(), img_out->data);
         img_out->frame_timestamp = frame_timestamp;
 
         if (cursor) {
-          blend_cursor(shm_xdisplay.get(), *img_out, offset_x, offset_y);
+          blend_cursor(shm_xdisplay.get(), *img_out, offset_x, offset_y, cursor_overlay);
         }
 
         return capture_e::ok;
       }
     }
 
+    /**
+     * @brief Capture into an image that has no SHM segment with XGetImage.
+     * @param img The image to capture into.
+     * @param cursor Whether to blend the cursor into the frame.
+     * @return The status of the capture.
+     */
+    capture_e
+    snapshot_without_segment(shm_img_t &img, bool cursor) {
+      XImage *x_img { x11::GetImage(shm_xdisplay.get(), display->root, offset_x, offset_y, width, height, AllPlanes, ZPixmap) };
+      if (!x_img) {
+        BOOST_LOG(error) << "Could not get image"sv;
+        return capture_e::reinit;
+      }
+      img.frame_timestamp = std::chrono::steady_clock::now();
+
+      img.width = x_img->width;
+      img.height = x_img->height;
+      img.data = (uint8_t *) x_img->data;
+      img.row_pitch = x_img->bytes_per_line;
+      img.pixel_pitch = x_img->bits_per_pixel / 8;
+      img.ximg.reset(x_img);
+
+      if (cursor) {
+        blend_cursor(shm_xdisplay.get(), img, offset_x, offset_y, cursor_overlay);
+      }
+
+      return capture_e::ok;
+    }
+
     std::shared_ptr<img_t>
     alloc_img() override {
       auto img = std::make_shared<shm_img_t>();
@@ -706,11 +742,47 @@ namespace platf {
       img->height = height;
       img->pixel_pitch = 4;
       img->row_pitch = img->pixel_pitch * width;
-      img->data = new std::uint8_t[height * img->row_pitch];
+
+      // On failure the image is still handed to the pool, instead of the pool waiting for an image forever
+      attach_segment(*img);
 
       return img;
     }
 
+    /**
+     * @brief Create an SHM segment for an image and register it with the X server.
+     * @details Each pooled image gets its own segment, registered once for the image's lifetime.
+     * @param img The image to back by the segment.
+     * @return 0 on success, -1 if the segment couldn't be created or attached.
+     */
+    int
+    attach_segment(shm_img_t &img) {
+      img.shm_id.id = shmget(IPC_PRIVATE, frame_size(), IPC_CREAT | 0777);
+      if (img.shm_id.id == -1) {
+        BOOST_LOG(error) << "shmget failed"sv;
+        return -1;
+      }
+
+      img.shm_data.data = shmat(img.shm_id.id, nullptr, 0);
+      if ((uintptr_t) img.shm_data.data == -1) {
+        BOOST_LOG(error) << "shmat failed"sv;
+        return -1;
+      }
+
+      // The server may not be able to map the segment, e.g. when it runs on another host
+      img.seg = xcb::generate_id(xcb.get());
+      auto attach_error = xcb::request_check(xcb.get(), xcb::shm_attach_checked(xcb.get(), img.seg, img.shm_id.id, false));
+      if (attach_error) {
+        free(attach_error);
+        BOOST_LOG(error) << "xcb_shm_attach failed"sv;
+        return -1;
+      }
+      img.xcb = xcb;
+      img.data = (std::uint8_t *) img.shm_data.data;
+
+      return 0;
+    }
+
     int
     dummy_img(platf::img_t *img) override {
       return 0;
@@ -723,7 +795,7 @@ namespace platf {
       }
 
       shm_xdisplay.reset(x11::OpenDisplay(nullptr));
-      xcb.reset(xcb::connect(nullptr, nullptr));
+      xcb = std::shared_ptr<xcb_connection_t> { xcb::connect(nullptr, nullptr), xcb::disconnect };
       if (xcb::connection_has_error(xcb.get())) {
         return -1;
       }
@@ -736,20 +808,10 @@ namespace platf {
 
       auto iter = xcb::setup_roots_iterator(xcb::get_setup(xcb.get()));
       display = iter.data;
-      seg = xcb::generate_id(xcb.get());
-
-      shm_id.id = shmget(IPC_PRIVATE, frame_size(), IPC_CREAT | 0777);
-      if (shm_id.id == -1) {
-        BOOST_LOG(error) << "shmget failed"sv;
-        return -1;
-      }
-
-      xcb::shm_attach(xcb.get(), seg, shm_id.id, false);
-      data.data = shmat(shm_id.id, nullptr, 0);
-
-      if ((uintptr_t) data.data == -1) {
-        BOOST_LOG(error) << "shmat failed"sv;
 
+      // Make sure segments can be created at all, otherwise fall back to XGetImage
+      shm_img_t probe;
+      if (attach_segment(probe)) {
         return -1;
       }
 
@@ -906,7 +968,7 @@ namespace platf {
 
     void
     cursor_t::blend(img_t &img, int offsetX, int offsetY) {
-      blend_cursor((xdisplay_t::pointer) ctx.get(), img, offsetX, offsetY);
+      blend_cursor((xdisplay_t::pointer) ctx.get(), img, offsetX, offsetY, overlay);
     }
 
     xdisplay_t
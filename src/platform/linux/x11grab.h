@@ -7,6 +7,7 @@
 #include <optional>
 
 #include "src/platform/common.h"
+#include "src/platform/linux/cursor_blend.h"
 #include "src/utility.h"
 
 // X11 Display
@@ -44,6 +45,7 @@ namespace platf::x11 {
     blend(img_t &img, int offsetX, int offsetY);
 
     cursor_ctx_t ctx;
+    cursor::overlay_t overlay;
   };
 
   xdisplay_t
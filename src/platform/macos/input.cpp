@@ -299,7 +299,7 @@ const KeyCodeMap kKeyCodesMap[] = {
   }
 
   int
-  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue) {
+  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue, std::shared_ptr<thread_pool_util::Strand> strand) {
     BOOST_LOG(info) << "alloc_gamepad: Gamepad not yet implemented for MacOS."sv;
     return -1;
   }
@@ -473,10 +473,11 @@ const KeyCodeMap kKeyCodesMap[] = {
   /**
    * @brief Allocates a context to store per-client input data.
    * @param input The global input context.
+   * @param strand The strand the input of the client runs on.
    * @return A unique pointer to a per-client input data context.
    */
   std::unique_ptr<client_input_t>
-  allocate_client_input_context(input_t &input) {
+  allocate_client_input_context(input_t &input, std::shared_ptr<thread_pool_util::Strand> strand) {
     // Unused
     return nullptr;
   }
@@ -235,6 +235,23 @@ namespace platf {
     // Unimplemented
   }
 
+  std::vector<cpu_t>
+  cpu_topology() {
+    // macOS doesn't expose the cache topology, treat all CPUs as a single domain
+    std::vector<cpu_t> cpus;
+    for (int id = 0; id < (int) std::thread::hardware_concurrency(); ++id) {
+      cpus.emplace_back(cpu_t { id, 0, 0 });
+    }
+
+    return cpus;
+  }
+
+  bool
+  set_thread_affinity(const std::vector<int> &cpus) {
+    // macOS doesn't allow pinning threads to CPUs
+    return false;
+  }
+
   void
   streaming_will_start() {
     // Nothing to do
@@ -334,6 +351,17 @@ namespace platf {
     return false;
   }
 
+  bool
+  enable_socket_txtime(std::uintptr_t native_socket) {
+    // Not supported, the caller paces the traffic itself
+    return false;
+  }
+
+  bool
+  departure_time_enforced(const boost::asio::ip::address &address) {
+    return false;
+  }
+
   bool
   send(send_info_t &send_info) {
     auto sockfd = (int) send_info.native_socket;
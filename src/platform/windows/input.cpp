@@ -16,6 +16,7 @@
 #include "src/globals.h"
 #include "src/logging.h"
 #include "src/platform/common.h"
+#include "src/thread_pool.h"
 
 #ifdef __MINGW32__
 DECLARE_HANDLE(HSYNTHETICPOINTERDEVICE);
@@ -77,6 +78,8 @@ namespace platf {
 
     uint8_t client_relative_index;
 
+    // The strand of the client's input, the repeated reports run on it too
+    std::shared_ptr<thread_pool_util::Strand> strand;
     thread_pool_util::ThreadPool::task_id_t repeat_task {};
     std::chrono::steady_clock::time_point last_report_ts;
 
@@ -215,15 +218,17 @@ namespace platf {
      * @brief Attaches a new gamepad.
      * @param id The gamepad ID.
      * @param feedback_queue The queue for posting messages back to the client.
+     * @param strand The strand of the client's input.
      * @param gp_type The type of gamepad.
      * @return 0 on success.
      */
     int
-    alloc_gamepad_internal(const gamepad_id_t &id, feedback_queue_t &feedback_queue, VIGEM_TARGET_TYPE gp_type) {
+    alloc_gamepad_internal(const gamepad_id_t &id, feedback_queue_t &feedback_queue, std::shared_ptr<thread_pool_util::Strand> strand, VIGEM_TARGET_TYPE gp_type) {
       auto &gamepad = gamepads[id.globalIndex];
       assert(!gamepad.gp);
 
       gamepad.client_relative_index = id.clientRelativeIndex;
+      gamepad.strand = std::move(strand);
       gamepad.last_report_ts = std::chrono::steady_clock::now();
 
       // Establish a connect to the ViGEm driver if we don't have one yet
@@ -293,9 +298,10 @@ namespace platf {
       auto &gamepad = gamepads[nr];
 
       if (gamepad.repeat_task) {
-        task_pool.cancel(gamepad.repeat_task);
+        gamepad.strand->cancel(gamepad.repeat_task);
         gamepad.repeat_task = 0;
       }
+      gamepad.strand.reset();
 
       if (gamepad.gp && vigem_target_is_attached(gamepad.gp.get())) {
         auto status = vigem_target_remove(client.get(), gamepad.gp.get());
@@ -412,7 +418,7 @@ namespace platf {
       << "largeMotor: "sv << (int) largeMotor << std::endl
       << "smallMotor: "sv << (int) smallMotor;
 
-    task_pool.push(&vigem_t::rumble, (vigem_t *) userdata, target, largeMotor, smallMotor);
+    task_pool.post(&vigem_t::rumble, (vigem_t *) userdata, target, largeMotor, smallMotor);
   }
 
   void CALLBACK
@@ -429,8 +435,8 @@ namespace platf {
       << util::hex(led_color.Green).to_string_view() << ' '
       << util::hex(led_color.Blue).to_string_view() << std::endl;
 
-    task_pool.push(&vigem_t::rumble, (vigem_t *) userdata, target, largeMotor, smallMotor);
-    task_pool.push(&vigem_t::set_rgb_led, (vigem_t *) userdata, target, led_color.Red, led_color.Green, led_color.Blue);
+    task_pool.post(&vigem_t::rumble, (vigem_t *) userdata, target, largeMotor, smallMotor);
+    task_pool.post(&vigem_t::set_rgb_led, (vigem_t *) userdata, target, led_color.Red, led_color.Green, led_color.Blue);
   }
 
   struct input_raw_t {
@@ -670,16 +676,18 @@ namespace platf {
   }
 
   struct client_input_raw_t: public client_input_t {
-    client_input_raw_t(input_t &input) {
+    client_input_raw_t(input_t &input, std::shared_ptr<thread_pool_util::Strand> strand):
+        strand { std::move(strand) } {
       global = (input_raw_t *) input.get();
     }
 
+    // Destroyed on the strand, so no repeat is running
     ~client_input_raw_t() override {
       if (penRepeatTask) {
-        task_pool.cancel(penRepeatTask);
+        strand->cancel(penRepeatTask);
       }
       if (touchRepeatTask) {
-        task_pool.cancel(touchRepeatTask);
+        strand->cancel(touchRepeatTask);
       }
 
       if (pen) {
@@ -692,6 +700,9 @@ namespace platf {
 
     input_raw_t *global;
 
+    // The strand of the client's input, the repeats of pen and touch input run on it too
+    std::shared_ptr<thread_pool_util::Strand> strand;
+
     // Device state and handles for pen and touch input must be stored in the per-client
     // input context, because each connected client may be sending their own independent
     // pen/touch events. To maintain separation, we expose separate pen and touch devices
@@ -710,11 +721,12 @@ namespace platf {
   /**
    * @brief Allocates a context to store per-client input data.
    * @param input The global input context.
+   * @param strand The strand the input of the client runs on.
    * @return A unique pointer to a per-client input data context.
    */
   std::unique_ptr<client_input_t>
-  allocate_client_input_context(input_t &input) {
-    return std::make_unique<client_input_raw_t>(input);
+  allocate_client_input_context(input_t &input, std::shared_ptr<thread_pool_util::Strand> strand) {
+    return std::make_unique<client_input_raw_t>(input, std::move(strand));
   }
 
   /**
@@ -864,7 +876,7 @@ namespace platf {
       BOOST_LOG(warning) << "Failed to refresh virtual touch input: "sv << err;
     }
 
-    raw->touchRepeatTask = task_pool.pushDelayed(repeat_touch, ISPI_REPEAT_INTERVAL, raw).task_id;
+    raw->touchRepeatTask = raw->strand->postDelayed(repeat_touch, ISPI_REPEAT_INTERVAL, raw);
   }
 
   /**
@@ -878,7 +890,7 @@ namespace platf {
       BOOST_LOG(warning) << "Failed to refresh virtual pen input: "sv << err;
     }
 
-    raw->penRepeatTask = task_pool.pushDelayed(repeat_pen, ISPI_REPEAT_INTERVAL, raw).task_id;
+    raw->penRepeatTask = raw->strand->postDelayed(repeat_pen, ISPI_REPEAT_INTERVAL, raw);
   }
 
   /**
@@ -889,7 +901,7 @@ namespace platf {
   cancel_all_active_touches(client_input_raw_t *raw) {
     // Cancel touch repeat callbacks
     if (raw->touchRepeatTask) {
-      task_pool.cancel(raw->touchRepeatTask);
+      raw->strand->cancel(raw->touchRepeatTask);
       raw->touchRepeatTask = nullptr;
     }
 
@@ -953,7 +965,7 @@ namespace platf {
 
     // Cancel touch repeat callbacks
     if (raw->touchRepeatTask) {
-      task_pool.cancel(raw->touchRepeatTask);
+      raw->strand->cancel(raw->touchRepeatTask);
       raw->touchRepeatTask = nullptr;
     }
 
@@ -1043,7 +1055,7 @@ namespace platf {
 
     // If we still have an active touch, refresh the touch state periodically
     if (raw->activeTouchSlots > 1 || touchInfo.pointerInfo.pointerFlags != POINTER_FLAG_NONE) {
-      raw->touchRepeatTask = task_pool.pushDelayed(repeat_touch, ISPI_REPEAT_INTERVAL, raw).task_id;
+      raw->touchRepeatTask = raw->strand->postDelayed(repeat_touch, ISPI_REPEAT_INTERVAL, raw);
     }
   }
 
@@ -1084,7 +1096,7 @@ namespace platf {
 
     // Cancel pen repeat callbacks
     if (raw->penRepeatTask) {
-      task_pool.cancel(raw->penRepeatTask);
+      raw->strand->cancel(raw->penRepeatTask);
       raw->penRepeatTask = nullptr;
     }
 
@@ -1168,7 +1180,7 @@ namespace platf {
 
     // If we still have an active pen interaction, refresh the pen state periodically
     if (penInfo.pointerInfo.pointerFlags != POINTER_FLAG_NONE) {
-      raw->penRepeatTask = task_pool.pushDelayed(repeat_pen, ISPI_REPEAT_INTERVAL, raw).task_id;
+      raw->penRepeatTask = raw->strand->postDelayed(repeat_pen, ISPI_REPEAT_INTERVAL, raw);
     }
   }
 
@@ -1202,7 +1214,7 @@ namespace platf {
   }
 
   int
-  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue) {
+  alloc_gamepad(input_t &input, const gamepad_id_t &id, const gamepad_arrival_t &metadata, feedback_queue_t feedback_queue, std::shared_ptr<thread_pool_util::Strand> strand) {
     auto raw = (input_raw_t *) input.get();
 
     if (!raw->vigem) {
@@ -1260,7 +1272,7 @@ namespace platf {
       }
     }
 
-    return raw->vigem->alloc_gamepad_internal(id, feedback_queue, selectedGamepadType);
+    return raw->vigem->alloc_gamepad_internal(id, feedback_queue, std::move(strand), selectedGamepadType);
   }
 
   void
@@ -1447,7 +1459,7 @@ namespace platf {
 
     // Cancel any pending updates. We will requeue one here when we're finished.
     if (gamepad.repeat_task) {
-      task_pool.cancel(gamepad.repeat_task);
+      gamepad.strand->cancel(gamepad.repeat_task);
       gamepad.repeat_task = 0;
     }
 
@@ -1467,7 +1479,7 @@ namespace platf {
 
       // Repeat at least every 100ms to keep the 16-bit timestamp field from overflowing
       gamepad.last_report_ts = now;
-      gamepad.repeat_task = task_pool.pushDelayed(ds4_update_ts_and_send, 100ms, vigem, nr).task_id;
+      gamepad.repeat_task = gamepad.strand->postDelayed(ds4_update_ts_and_send, 100ms, vigem, nr);
     }
   }
 
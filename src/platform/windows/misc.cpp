@@ -1163,6 +1163,94 @@ namespace platf {
     }
   }
 
+  std::vector<cpu_t>
+  cpu_topology() {
+    // Threads can only be restricted to CPUs within a single processor group,
+    // so only the CPUs of the group the process runs in are of use
+    GROUP_AFFINITY process_group;
+    if (!GetThreadGroupAffinity(GetCurrentThread(), &process_group)) {
+      auto winerr = GetLastError();
+      BOOST_LOG(warning) << "Unable to get the thread's processor group: "sv << winerr;
+      return {};
+    }
+
+    DWORD size = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+    std::vector<std::uint8_t> buffer(size);
+    if (!GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) buffer.data(), &size)) {
+      auto winerr = GetLastError();
+      BOOST_LOG(warning) << "Unable to get the processor topology: "sv << winerr;
+      return {};
+    }
+
+    std::vector<cpu_t> cpus;
+    for (int id = 0; id < (int) sizeof(KAFFINITY) * 8; ++id) {
+      if (process_group.Mask & ((KAFFINITY) 1 << id)) {
+        cpus.emplace_back(cpu_t { id, 0, 0 });
+      }
+    }
+
+    auto for_each_cpu = [&](const GROUP_AFFINITY &affinity, auto &&f) {
+      if (affinity.Group != process_group.Group) {
+        return;
+      }
+
+      for (auto &cpu : cpus) {
+        if (affinity.Mask & ((KAFFINITY) 1 << cpu.id)) {
+          f(cpu);
+        }
+      }
+    };
+
+    // Name each domain after its position in the list, like Linux names its NUMA nodes
+    int l3_domain = 0;
+    for (DWORD offset = 0; offset < size;) {
+      auto info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) (buffer.data() + offset);
+      offset += info->Size;
+
+      if (info->Relationship == RelationNumaNode) {
+        for_each_cpu(info->NumaNode.GroupMask, [&](cpu_t &cpu) {
+          cpu.numa_node = (int) info->NumaNode.NodeNumber;
+        });
+      }
+      else if (info->Relationship == RelationCache && info->Cache.Level == 3) {
+        for_each_cpu(info->Cache.GroupMask, [&](cpu_t &cpu) {
+          cpu.l3_domain = l3_domain;
+        });
+        ++l3_domain;
+      }
+    }
+
+    return cpus;
+  }
+
+  bool
+  set_thread_affinity(const std::vector<int> &cpus) {
+    GROUP_AFFINITY affinity {};
+    if (!GetThreadGroupAffinity(GetCurrentThread(), &affinity)) {
+      return false;
+    }
+
+    affinity.Mask = 0;
+    for (auto cpu : cpus) {
+      if (cpu >= 0 && cpu < (int) sizeof(KAFFINITY) * 8) {
+        affinity.Mask |= (KAFFINITY) 1 << cpu;
+      }
+    }
+
+    if (!affinity.Mask) {
+      return false;
+    }
+
+    if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr)) {
+      auto winerr = GetLastError();
+      BOOST_LOG(warning) << "Unable to set the thread's CPU affinity: "sv << winerr;
+      return false;
+    }
+
+    return true;
+  }
+
   void
   streaming_will_start() {
     static std::once_flag load_wlanapi_once_flag;
@@ -1600,6 +1688,17 @@ namespace platf {
     return WSASendMsg((SOCKET) send_info.native_socket, &msg, 0, &bytes_sent, nullptr, nullptr) != SOCKET_ERROR;
   }
 
+  bool
+  enable_socket_txtime(std::uintptr_t native_socket) {
+    // Not supported, the caller paces the traffic itself
+    return false;
+  }
+
+  bool
+  departure_time_enforced(const boost::asio::ip::address &address) {
+    return false;
+  }
+
   bool
   send(send_info_t &send_info) {
     WSAMSG msg;
@@ -48,6 +48,7 @@ namespace proc {
   namespace pt = boost::property_tree;
 
   proc_t proc;
+  std::atomic<std::uint64_t> apps_generation;
 
 #ifdef _WIN32
   VDISPLAY::DRIVER_STATUS vDisplayDriverStatus = VDISPLAY::DRIVER_STATUS::UNKNOWN;
@@ -991,6 +992,7 @@ namespace proc {
 
     if (proc_opt) {
       proc = std::move(*proc_opt);
+      ++apps_generation;
     }
   }
 }  // namespace proc
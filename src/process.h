@@ -8,6 +8,8 @@
   #define __kernel_entry
 #endif
 
+#include <atomic>
+#include <cstdint>
 #include <optional>
 #include <unordered_map>
 
@@ -176,4 +178,9 @@ namespace proc {
   terminate_process_group(boost::process::v1::child &proc, boost::process::v1::group &group, std::chrono::seconds exit_timeout);
 
   extern proc_t proc;
+
+  /**
+   * @brief Incremented every time `refresh()` reloaded the apps, so others can tell their copies are stale.
+   */
+  extern std::atomic<std::uint64_t> apps_generation;
 }  // namespace proc
@@ -112,46 +112,373 @@
 
 #include "rswrapper.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+  #include <cpuid.h>
+  #include <immintrin.h>
+  #include <string.h>
+
+  #ifndef bit_GFNI
+    #define bit_GFNI (1 << 8)
+  #endif
+
+  // Parity rows encoded together, each keeps an accumulator in a register
+  #define GFNI_ROWS 4
+
+// GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1, the field nanors works in
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+
+// The multiplication by each constant as the 8x8 bit matrix GF2P8AFFINEQB takes,
+// where byte 7 - i of the matrix selects the input bits that are summed into output bit i
+static uint64_t gfni_matrices[256];
+
+static uint8_t
+gf_mul(uint8_t a, uint8_t b) {
+  if (!a || !b) {
+    return 0;
+  }
+
+  return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static void
+gfni_tables_init(void) {
+  static int initialized;
+  if (initialized) {
+    return;
+  }
+
+  int x = 1;
+  for (int i = 0; i < 255; i++) {
+    gf_exp[i] = gf_exp[i + 255] = (uint8_t) x;
+    gf_log[x] = (uint8_t) i;
+
+    x <<= 1;
+    if (x & 0x100) {
+      x ^= 0x11d;
+    }
+  }
+
+  for (int c = 0; c < 256; c++) {
+    uint64_t matrix = 0;
+    for (int bit = 0; bit < 8; bit++) {
+      uint8_t column = gf_mul((uint8_t) c, (uint8_t) (1 << bit));
+      for (int row = 0; row < 8; row++) {
+        if (column & (1 << row)) {
+          matrix |= (uint64_t) 1 << (8 * (7 - row) + bit);
+        }
+      }
+    }
+    gfni_matrices[c] = matrix;
+  }
+
+  initialized = 1;
+}
+
+// Inlined with a constant row count, so the accumulators of the rows stay in registers
+  #define GFNI_ENCODE_ROWS(kernel, rs, data, parity, first, bs) \
+    do {                                                        \
+      switch ((rs)->ps - (first)) {                             \
+        case 1:                                                 \
+          kernel(rs, data, parity, first, 1, bs);               \
+          break;                                                \
+        case 2:                                                 \
+          kernel(rs, data, parity, first, 2, bs);               \
+          break;                                                \
+        case 3:                                                 \
+          kernel(rs, data, parity, first, 3, bs);               \
+          break;                                                \
+        default:                                                \
+          kernel(rs, data, parity, first, GFNI_ROWS, bs);       \
+          break;                                                \
+      }                                                         \
+    } while (0)
+
+/**
+ * @brief Encode the bytes of the parity shards from `from` on without vector instructions.
+ */
+static void
+gfni_encode_tail(const reed_solomon *rs, uint8_t **data, uint8_t **parity, int from, int bs) {
+  for (int i = 0; i < rs->ps; i++) {
+    const uint8_t *coefs = &rs->p[i * rs->ds];
+    for (int off = from; off < bs; off++) {
+      uint8_t acc = 0;
+      for (int j = 0; j < rs->ds; j++) {
+        acc ^= gf_mul(coefs[j], data[j][off]);
+      }
+      parity[i][off] = acc;
+    }
+  }
+}
+
+  // Compile the GFNI kernel for AVX2
+  #if defined(__clang__)
+    #pragma clang attribute push(__attribute__((target("gfni,avx2"))), apply_to = function)
+  #else
+    #pragma GCC push_options
+    #pragma GCC target("gfni,avx2")
+  #endif
+static inline __attribute__((always_inline)) void
+gfni_encode_rows_avx2(const reed_solomon *rs, uint8_t **data, uint8_t **parity, int first, int rows, int bs) {
+  for (int off = 0; off < bs; off += 32) {
+    __m256i acc[GFNI_ROWS];
+    for (int r = 0; r < rows; r++) {
+      acc[r] = _mm256_setzero_si256();
+    }
+
+    for (int j = 0; j < rs->ds; j++) {
+      __m256i x = _mm256_loadu_si256((const __m256i *) &data[j][off]);
+      for (int r = 0; r < rows; r++) {
+        __m256i matrix = _mm256_set1_epi64x((long long) gfni_matrices[rs->p[(first + r) * rs->ds + j]]);
+        acc[r] = _mm256_xor_si256(acc[r], _mm256_gf2p8affine_epi64_epi8(x, matrix, 0));
+      }
+    }
+
+    for (int r = 0; r < rows; r++) {
+      _mm256_storeu_si256((__m256i *) &parity[first + r][off], acc[r]);
+    }
+  }
+}
+
+static int
+reed_solomon_encode_gfni_avx2(reed_solomon *rs, uint8_t **shards, int nr_shards, int bs) {
+  if (nr_shards < rs->ts) {
+    return -1;
+  }
+
+  uint8_t **data = shards;
+  uint8_t **parity = shards + rs->ds;
+  int aligned = bs & ~31;
+
+  for (int i = 0; i < rs->ps; i += GFNI_ROWS) {
+    GFNI_ENCODE_ROWS(gfni_encode_rows_avx2, rs, data, parity, i, aligned);
+  }
+
+  gfni_encode_tail(rs, data, parity, aligned, bs);
+  return 0;
+}
+  #if defined(__clang__)
+    #pragma clang attribute pop
+  #else
+    #pragma GCC pop_options
+  #endif
+
+  // Compile the GFNI kernel for AVX512BW
+  #if defined(__clang__)
+    #pragma clang attribute push(__attribute__((target("gfni,avx512f,avx512bw"))), apply_to = function)
+  #else
+    #pragma GCC push_options
+    #pragma GCC target("gfni,avx512f,avx512bw")
+  #endif
+static inline __attribute__((always_inline)) void
+gfni_encode_rows_avx512(const reed_solomon *rs, uint8_t **data, uint8_t **parity, int first, int rows, int bs) {
+  for (int off = 0; off < bs; off += 64) {
+    // The last bytes of a shard are loaded and stored with a mask instead of a scalar tail
+    __mmask64 mask = bs - off >= 64 ? ~(__mmask64) 0 : ((__mmask64) 1 << (bs - off)) - 1;
+
+    __m512i acc[GFNI_ROWS];
+    for (int r = 0; r < rows; r++) {
+      acc[r] = _mm512_setzero_si512();
+    }
+
+    for (int j = 0; j < rs->ds; j++) {
+      __m512i x = _mm512_maskz_loadu_epi8(mask, &data[j][off]);
+      for (int r = 0; r < rows; r++) {
+        __m512i matrix = _mm512_set1_epi64((long long) gfni_matrices[rs->p[(first + r) * rs->ds + j]]);
+        acc[r] = _mm512_xor_si512(acc[r], _mm512_gf2p8affine_epi64_epi8(x, matrix, 0));
+      }
+    }
+
+    for (int r = 0; r < rows; r++) {
+      _mm512_mask_storeu_epi8(&parity[first + r][off], mask, acc[r]);
+    }
+  }
+}
+
+static int
+reed_solomon_encode_gfni_avx512(reed_solomon *rs, uint8_t **shards, int nr_shards, int bs) {
+  if (nr_shards < rs->ts) {
+    return -1;
+  }
+
+  uint8_t **data = shards;
+  uint8_t **parity = shards + rs->ds;
+
+  for (int i = 0; i < rs->ps; i += GFNI_ROWS) {
+    GFNI_ENCODE_ROWS(gfni_encode_rows_avx512, rs, data, parity, i, bs);
+  }
+
+  return 0;
+}
+  #if defined(__clang__)
+    #pragma clang attribute pop
+  #else
+    #pragma GCC pop_options
+  #endif
+
+static int
+cpu_supports_gfni(void) {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return 0;
+  }
+
+  return (ecx & bit_GFNI) != 0;
+}
+
+/**
+ * @brief Check a GFNI kernel against the reference implementation.
+ * @details The kernels rely on the field and the layout of the parity matrix of nanors,
+ * so they are only used if they compute the same parity.
+ */
+static int
+gfni_matches_reference(reed_solomon_new_t new_fn, reed_solomon_release_t release_fn, reed_solomon_encode_t encode_fn) {
+  enum {
+    data_shards = 5,
+    parity_shards = 3,
+    total_shards = data_shards + parity_shards,
+    blocksize = 100,
+  };
+
+  uint8_t expected[total_shards][blocksize];
+  uint8_t actual[total_shards][blocksize];
+  uint8_t *expected_p[total_shards];
+  uint8_t *actual_p[total_shards];
+
+  for (int x = 0; x < total_shards; x++) {
+    for (int off = 0; off < blocksize; off++) {
+      expected[x][off] = actual[x][off] = (uint8_t) (x * 31 + off * 7 + 1);
+    }
+    expected_p[x] = expected[x];
+    actual_p[x] = actual[x];
+  }
+
+  reed_solomon_init_def();
+  reed_solomon *reference = reed_solomon_new_def(data_shards, parity_shards);
+  reed_solomon *rs = new_fn(data_shards, parity_shards);
+
+  int matches = reference && rs &&
+                reed_solomon_encode_def(reference, expected_p, total_shards, blocksize) == 0 &&
+                encode_fn(rs, actual_p, total_shards, blocksize) == 0 &&
+                !memcmp(expected, actual, sizeof(expected));
+
+  if (reference) {
+    reed_solomon_release_def(reference);
+  }
+  if (rs) {
+    release_fn(rs);
+  }
+
+  return matches;
+}
+
+static void
+reed_solomon_init_gfni_avx2(void) {
+  reed_solomon_init_avx2();
+  gfni_tables_init();
+}
+
+static void
+reed_solomon_init_gfni_avx512(void) {
+  reed_solomon_init_avx512();
+  gfni_tables_init();
+}
+
+static int
+supports_gfni_avx512(void) {
+  static int supported = -1;
+  if (supported < 0) {
+    supported = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && cpu_supports_gfni();
+    if (supported) {
+      reed_solomon_init_gfni_avx512();
+      supported = gfni_matches_reference(reed_solomon_new_avx512, reed_solomon_release_avx512, reed_solomon_encode_gfni_avx512);
+    }
+  }
+
+  return supported;
+}
+
+static int
+supports_gfni_avx2(void) {
+  static int supported = -1;
+  if (supported < 0) {
+    supported = __builtin_cpu_supports("avx2") && cpu_supports_gfni();
+    if (supported) {
+      reed_solomon_init_gfni_avx2();
+      supported = gfni_matches_reference(reed_solomon_new_avx2, reed_solomon_release_avx2, reed_solomon_encode_gfni_avx2);
+    }
+  }
+
+  return supported;
+}
+
+static int
+supports_avx512(void) {
+  return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+static int
+supports_avx2(void) {
+  return __builtin_cpu_supports("avx2");
+}
+
+static int
+supports_ssse3(void) {
+  return __builtin_cpu_supports("ssse3");
+}
+#endif
+
+static int
+supports_def(void) {
+  return 1;
+}
+
+// From the most to the least specialized
+static const reed_solomon_variant variants[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "gfni_avx512", supports_gfni_avx512, reed_solomon_init_gfni_avx512, reed_solomon_new_avx512, reed_solomon_release_avx512, reed_solomon_encode_gfni_avx512, reed_solomon_decode_avx512 },
+  { "gfni_avx2", supports_gfni_avx2, reed_solomon_init_gfni_avx2, reed_solomon_new_avx2, reed_solomon_release_avx2, reed_solomon_encode_gfni_avx2, reed_solomon_decode_avx2 },
+  { "avx512", supports_avx512, reed_solomon_init_avx512, reed_solomon_new_avx512, reed_solomon_release_avx512, reed_solomon_encode_avx512, reed_solomon_decode_avx512 },
+  { "avx2", supports_avx2, reed_solomon_init_avx2, reed_solomon_new_avx2, reed_solomon_release_avx2, reed_solomon_encode_avx2, reed_solomon_decode_avx2 },
+  { "ssse3", supports_ssse3, reed_solomon_init_ssse3, reed_solomon_new_ssse3, reed_solomon_release_ssse3, reed_solomon_encode_ssse3, reed_solomon_decode_ssse3 },
+#endif
+  { "default", supports_def, reed_solomon_init_def, reed_solomon_new_def, reed_solomon_release_def, reed_solomon_encode_def, reed_solomon_decode_def },
+};
+
 reed_solomon_new_t reed_solomon_new_fn;
 reed_solomon_release_t reed_solomon_release_fn;
 reed_solomon_encode_t reed_solomon_encode_fn;
 reed_solomon_decode_t reed_solomon_decode_fn;
 
+const reed_solomon_variant *
+reed_solomon_variants(int *count) {
+  *count = (int) (sizeof(variants) / sizeof(variants[0]));
+  return variants;
+}
+
+void
+reed_solomon_use(const reed_solomon_variant *variant) {
+  variant->init();
+
+  reed_solomon_new_fn = variant->new_fn;
+  reed_solomon_release_fn = variant->release_fn;
+  reed_solomon_encode_fn = variant->encode_fn;
+  reed_solomon_decode_fn = variant->decode_fn;
+}
+
 /**
  * @brief This initializes the RS function pointers to the best vectorized version available.
  * @details The streaming code will directly invoke these function pointers during encoding.
  */
 void
 reed_solomon_init(void) {
-#if defined(__x86_64__) || defined(__i386__)
-  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
-    reed_solomon_new_fn = reed_solomon_new_avx512;
-    reed_solomon_release_fn = reed_solomon_release_avx512;
-    reed_solomon_encode_fn = reed_solomon_encode_avx512;
-    reed_solomon_decode_fn = reed_solomon_decode_avx512;
-    reed_solomon_init_avx512();
-  }
-  else if (__builtin_cpu_supports("avx2")) {
-    reed_solomon_new_fn = reed_solomon_new_avx2;
-    reed_solomon_release_fn = reed_solomon_release_avx2;
-    reed_solomon_encode_fn = reed_solomon_encode_avx2;
-    reed_solomon_decode_fn = reed_solomon_decode_avx2;
-    reed_solomon_init_avx2();
-  }
-  else if (__builtin_cpu_supports("ssse3")) {
-    reed_solomon_new_fn = reed_solomon_new_ssse3;
-    reed_solomon_release_fn = reed_solomon_release_ssse3;
-    reed_solomon_encode_fn = reed_solomon_encode_ssse3;
-    reed_solomon_decode_fn = reed_solomon_decode_ssse3;
-    reed_solomon_init_ssse3();
-  }
-  else
-#endif
-  {
-    reed_solomon_new_fn = reed_solomon_new_def;
-    reed_solomon_release_fn = reed_solomon_release_def;
-    reed_solomon_encode_fn = reed_solomon_encode_def;
-    reed_solomon_decode_fn = reed_solomon_decode_def;
-    reed_solomon_init_def();
+  int count;
+  const reed_solomon_variant *all = reed_solomon_variants(&count);
+
+  for (int x = 0; x < count; x++) {
+    if (all[x].supported()) {
+      reed_solomon_use(&all[x]);
+      return;
+    }
   }
 }
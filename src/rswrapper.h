@@ -19,6 +19,19 @@ extern reed_solomon_release_t reed_solomon_release_fn;
 extern reed_solomon_encode_t reed_solomon_encode_fn;
 extern reed_solomon_decode_t reed_solomon_decode_fn;
 
+/**
+ * @brief An implementation of the RS functions for one instruction set.
+ */
+typedef struct {
+  const char *name;  ///< The name of the variant, as accepted by the `fec_kernel` option
+  int (*supported)(void);  ///< Whether the CPU can run the variant
+  void (*init)(void);  ///< Initialize the tables of the variant
+  reed_solomon_new_t new_fn;
+  reed_solomon_release_t release_fn;
+  reed_solomon_encode_t encode_fn;
+  reed_solomon_decode_t decode_fn;
+} reed_solomon_variant;
+
 #define reed_solomon_new reed_solomon_new_fn
 #define reed_solomon_release reed_solomon_release_fn
 #define reed_solomon_encode reed_solomon_encode_fn
@@ -30,3 +43,18 @@ extern reed_solomon_decode_t reed_solomon_decode_fn;
  */
 void
 reed_solomon_init(void);
+
+/**
+ * @brief Get the variants that were compiled in.
+ * @param count Set to the number of variants.
+ * @return The variants, from the most to the least specialized.
+ */
+const reed_solomon_variant *
+reed_solomon_variants(int *count);
+
+/**
+ * @brief Point the RS function pointers at a variant.
+ * @param variant The variant, which must be supported by the CPU.
+ */
+void
+reed_solomon_use(const reed_solomon_variant *variant);
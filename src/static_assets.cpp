@@ -0,0 +1,287 @@
+/**
+ * @file src/static_assets.cpp
+ * @brief Definitions for the in-memory Web UI asset table.
+ */
+// standard includes
+#include <algorithm>
+#include <cctype>
+#include <optional>
+
+// lib includes
+#include <zlib.h>
+
+// local includes
+#include "confighttp.h"
+#include "crypto.h"
+#include "file_handler.h"
+#include "logging.h"
+#include "static_assets.h"
+#include "utility.h"
+
+using namespace std::literals;
+
+namespace static_assets {
+  namespace fs = std::filesystem;
+
+  namespace {
+    /**
+     * @brief Remove leading and trailing whitespace.
+     */
+    std::string_view
+    trim(std::string_view value) {
+      while (!value.empty() && std::isspace((unsigned char) value.front())) {
+        value.remove_prefix(1);
+      }
+      while (!value.empty() && std::isspace((unsigned char) value.back())) {
+        value.remove_suffix(1);
+      }
+      return value;
+    }
+
+    bool
+    is_compressible(std::string_view content_type) {
+      return content_type.substr(0, 5) == "text/"sv ||
+             content_type == "application/javascript"sv ||
+             content_type == "application/json"sv ||
+             content_type == "image/svg+xml"sv ||
+             content_type == "image/x-icon"sv ||
+             content_type == "font/ttf"sv;
+    }
+
+    std::string
+    read_binary(const fs::path &path) {
+      std::error_code ec;
+      auto size = fs::file_size(path, ec);
+      if (ec) {
+        return {};
+      }
+
+      return file_handler::read_file_range(path.string().c_str(), 0, size);
+    }
+  }  // namespace
+
+  const std::string &
+  asset_t::body(encoding_e encoding) const {
+    switch (encoding) {
+      case encoding_e::gzip:
+        return gzip;
+      case encoding_e::brotli:
+        return brotli;
+      case encoding_e::identity:
+      default:
+        return identity;
+    }
+  }
+
+  std::string
+  asset_t::etag_for(encoding_e encoding) const {
+    // Each representation needs its own strong validator, the suffix goes inside the quotes
+    switch (encoding) {
+      case encoding_e::gzip:
+        return etag.substr(0, etag.size() - 1) + "-gzip\""s;
+      case encoding_e::brotli:
+        return etag.substr(0, etag.size() - 1) + "-br\""s;
+      case encoding_e::identity:
+      default:
+        return etag;
+    }
+  }
+
+  void
+  asset_table_t::load(const fs::path &web_dir) {
+    assets.clear();
+
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(web_dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+      if (!it->is_regular_file()) {
+        continue;
+      }
+
+      auto &path = it->path();
+      auto extension = path.extension().string();
+
+      // Precompressed variants are picked up together with the file they belong to
+      if (extension == ".br" || extension == ".gz" || extension.empty()) {
+        continue;
+      }
+
+      auto mime_type = mime_types.find(extension.substr(1));
+      if (mime_type == mime_types.end()) {
+        continue;
+      }
+
+      auto rel_path = fs::relative(path, web_dir).generic_string();
+
+      asset_t asset;
+      asset.content_type = mime_type->second;
+      asset.identity = read_binary(path);
+      asset.immutable = is_hashed_name(rel_path);
+
+      auto digest = crypto::hash(asset.identity);
+      asset.etag = "\""s + util::hex_vec(std::begin(digest), std::begin(digest) + 16) + "\""s;
+
+      auto shipped_br = fs::path { path }.concat(".br");
+      if (fs::exists(shipped_br)) {
+        asset.brotli = read_binary(shipped_br);
+      }
+
+      auto shipped_gz = fs::path { path }.concat(".gz");
+      if (fs::exists(shipped_gz)) {
+        asset.gzip = read_binary(shipped_gz);
+      }
+      else if (is_compressible(asset.content_type)) {
+        asset.gzip = gzip_compress(asset.identity);
+      }
+
+      // Not worth the Content-Encoding header
+      if (asset.gzip.size() >= asset.identity.size()) {
+        asset.gzip.clear();
+      }
+      if (asset.brotli.size() >= asset.identity.size()) {
+        asset.brotli.clear();
+      }
+
+      assets.emplace(std::move(rel_path), std::move(asset));
+    }
+
+    if (ec) {
+      BOOST_LOG(warning) << "Couldn't load web assets from "sv << web_dir << ": "sv << ec.message();
+    }
+
+    BOOST_LOG(debug) << "Loaded "sv << assets.size() << " web assets, "sv << memory_size() / 1024 << " KiB in memory"sv;
+  }
+
+  const asset_t *
+  asset_table_t::find(std::string_view path) const {
+    auto it = assets.find(std::string { path });
+    if (it == assets.end()) {
+      return nullptr;
+    }
+
+    return &it->second;
+  }
+
+  std::size_t
+  asset_table_t::memory_size() const {
+    std::size_t size = 0;
+    for (auto &[path, asset] : assets) {
+      size += asset.identity.size() + asset.gzip.size() + asset.brotli.size();
+    }
+
+    return size;
+  }
+
+  encoding_e
+  negotiate(const asset_t &asset, std::string_view accept_encoding) {
+    // An explicitly listed coding takes precedence over "*", regardless of their order
+    std::optional<bool> accepts_gzip;
+    std::optional<bool> accepts_brotli;
+    std::optional<bool> accepts_any;
+
+    while (!accept_encoding.empty()) {
+      auto end = accept_encoding.find(',');
+      auto token = accept_encoding.substr(0, end);
+      accept_encoding.remove_prefix(end == std::string_view::npos ? accept_encoding.size() : end + 1);
+
+      auto params = token.find(';');
+      auto coding = trim(token.substr(0, params));
+
+      // An explicit "q=0" means the coding is not acceptable
+      bool acceptable = true;
+      if (params != std::string_view::npos) {
+        auto q = trim(token.substr(params + 1));
+        if (q.substr(0, 2) == "q="sv) {
+          q.remove_prefix(2);
+          acceptable = q.find_first_not_of("0."sv) != std::string_view::npos;
+        }
+      }
+
+      if (coding == "gzip"sv) {
+        accepts_gzip = acceptable;
+      }
+      else if (coding == "br"sv) {
+        accepts_brotli = acceptable;
+      }
+      else if (coding == "*"sv) {
+        accepts_any = acceptable;
+      }
+    }
+
+    auto any = accepts_any.value_or(false);
+    if (accepts_brotli.value_or(any) && !asset.brotli.empty()) {
+      return encoding_e::brotli;
+    }
+    if (accepts_gzip.value_or(any) && !asset.gzip.empty()) {
+      return encoding_e::gzip;
+    }
+
+    return encoding_e::identity;
+  }
+
+  bool
+  etag_matches(std::string_view if_none_match, std::string_view etag) {
+    while (!if_none_match.empty()) {
+      auto end = if_none_match.find(',');
+      auto token = trim(if_none_match.substr(0, end));
+      if_none_match.remove_prefix(end == std::string_view::npos ? if_none_match.size() : end + 1);
+
+      // Weak comparison is what If-None-Match uses
+      if (token.substr(0, 2) == "W/"sv) {
+        token.remove_prefix(2);
+      }
+
+      if (token == "*"sv || token == etag) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool
+  is_hashed_name(std::string_view path) {
+    if (path.substr(0, 7) != "assets/"sv) {
+      return false;
+    }
+
+    auto name = path.substr(path.rfind('/') + 1);
+    auto stem = name.substr(0, name.find('.'));
+
+    // Vite appends "-<8 character base64url hash>" to the file name
+    constexpr std::size_t hash_length = 8;
+    if (stem.size() <= hash_length || stem[stem.size() - hash_length - 1] != '-') {
+      return false;
+    }
+
+    auto hash = stem.substr(stem.size() - hash_length);
+    return std::all_of(std::begin(hash), std::end(hash), [](char ch) {
+      return std::isalnum((unsigned char) ch) || ch == '_' || ch == '-';
+    });
+  }
+
+  std::string
+  gzip_compress(std::string_view data) {
+    z_stream stream {};
+
+    // 15 window bits + 16 selects the gzip wrapper instead of zlib
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return {};
+    }
+    auto fg = util::fail_guard([&stream]() {
+      deflateEnd(&stream);
+    });
+
+    std::string compressed(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = (Bytef *) data.data();
+    stream.avail_in = (uInt) data.size();
+    stream.next_out = (Bytef *) compressed.data();
+    stream.avail_out = (uInt) compressed.size();
+
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+      return {};
+    }
+
+    compressed.resize(stream.total_out);
+    return compressed;
+  }
+}  // namespace static_assets
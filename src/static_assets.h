@@ -0,0 +1,127 @@
+/**
+ * @file src/static_assets.h
+ * @brief Declarations for the in-memory Web UI asset table.
+ */
+#pragma once
+
+// standard includes
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief In-memory, precompressed copies of the static Web UI files.
+ */
+namespace static_assets {
+  /**
+   * @brief Content encodings an asset can be served with.
+   */
+  enum class encoding_e {
+    identity,  ///< Uncompressed
+    gzip,  ///< gzip, compressed at load time
+    brotli  ///< Brotli, only available when a precompressed `.br` file was shipped
+  };
+
+  /**
+   * @brief A single static file and its encoded variants.
+   */
+  struct asset_t {
+    std::string content_type;
+    std::string etag;  ///< Strong ETag of the uncompressed content, including the quotes
+    bool immutable;  ///< The file name contains a content hash, so it can be cached forever
+    std::string identity;
+    std::string gzip;  ///< Empty if compressing the asset doesn't save anything
+    std::string brotli;  ///< Empty if no precompressed variant was shipped
+
+    /**
+     * @brief Get the body for an encoding.
+     * @param encoding The encoding, as returned by `negotiate()`.
+     * @return The encoded content.
+     */
+    const std::string &
+    body(encoding_e encoding) const;
+
+    /**
+     * @brief Get the ETag of an encoded representation.
+     * @details Caches must not mix up representations, so the compressed ones get a suffix.
+     * @param encoding The encoding, as returned by `negotiate()`.
+     * @return The quoted ETag, e.g. `"1a2b3c4d-gzip"`.
+     */
+    std::string
+    etag_for(encoding_e encoding) const;
+  };
+
+  /**
+   * @brief Table of static assets, keyed by their path relative to the web directory.
+   */
+  class asset_table_t {
+  public:
+    /**
+     * @brief Load every servable file below a directory.
+     * @details Files with an unknown mime type are skipped. Text files are gzip-compressed once here.
+     * A `<file>.br` or `<file>.gz` next to a file is used as its precompressed variant.
+     * @param web_dir The directory to load.
+     */
+    void
+    load(const std::filesystem::path &web_dir);
+
+    /**
+     * @brief Find an asset.
+     * @param path The path relative to the web directory, e.g. `assets/index-1a2b3c4d.js`.
+     * @return The asset, or `nullptr` if it wasn't loaded.
+     */
+    const asset_t *
+    find(std::string_view path) const;
+
+    /**
+     * @brief Get the total size of all variants held in memory.
+     * @return The size in bytes.
+     */
+    std::size_t
+    memory_size() const;
+
+  private:
+    std::unordered_map<std::string, asset_t> assets;
+  };
+
+  /**
+   * @brief Pick the best encoding of an asset the client accepts.
+   * @param asset The asset to serve.
+   * @param accept_encoding The value of the `Accept-Encoding` request header.
+   * @return The encoding to serve.
+   * @examples
+   * auto encoding = negotiate(asset, "gzip, deflate, br");
+   * @examples_end
+   */
+  encoding_e
+  negotiate(const asset_t &asset, std::string_view accept_encoding);
+
+  /**
+   * @brief Check whether an `If-None-Match` header matches an ETag.
+   * @param if_none_match The value of the `If-None-Match` request header.
+   * @param etag The quoted ETag of the asset.
+   * @return `true` if the client's copy is current.
+   */
+  bool
+  etag_matches(std::string_view if_none_match, std::string_view etag);
+
+  /**
+   * @brief Check whether a file name carries a content hash, as emitted by Vite.
+   * @param path The path relative to the web directory.
+   * @return `true` for `assets/<name>-<hash>.<ext>`.
+   * @examples
+   * bool immutable = is_hashed_name("assets/index-BxYz12_a.js");
+   * @examples_end
+   */
+  bool
+  is_hashed_name(std::string_view path);
+
+  /**
+   * @brief Compress data with gzip.
+   * @param data The data to compress.
+   * @return The compressed data, or an empty string on failure.
+   */
+  std::string
+  gzip_compress(std::string_view data);
+}  // namespace static_assets
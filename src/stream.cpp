@@ -4,8 +4,10 @@
  */
 #include "process.h"
 
+#include <cstring>
 #include <future>
 #include <queue>
+#include <span>
 
 #include <fstream>
 #include <openssl/err.h>
@@ -19,12 +21,17 @@ extern "C" {
 // clang-format on
 }
 
+#include "arena.h"
 #include "config.h"
+#include "congestion_controller.h"
 #include "crypto.h"
 #include "display_device.h"
+#include "fec.h"
+#include "fec_controller.h"
 #include "globals.h"
 #include "input.h"
 #include "logging.h"
+#include "nal.h"
 #include "network.h"
 #include "stream.h"
 #include "sync.h"
@@ -368,7 +375,32 @@ namespace stream {
       safe::mail_raw_t::event_t<bool> idr_events;
       safe::mail_raw_t::event_t<std::pair<int64_t, int64_t>> invalidate_ref_frames_events;
 
+      // Raised with the time the client's video ping arrived, the encoder holds back frames until then
+      safe::mail_raw_t::event_t<std::chrono::steady_clock::time_point> start_events;
+      std::chrono::steady_clock::time_point start_time;
+      // Written by videoBroadcastThread, read by the control stream when the client asks for an IDR frame
+      std::atomic_bool first_frame_sent;
+
+      // Whether the qdisc towards the client enforces departure times, set once the client's address is known
+      std::atomic_bool kernel_pacing;
+
+      // Picks the FEC percentage of each frame from the loss the client reports
+      std::optional<fec::controller_t> fec;
+
+      // Picks the bitrate of the encoder from the congestion of the network path, if enabled
+      std::optional<congestion::controller_t> congestion;
+      safe::mail_raw_t::event_t<int> bitrate_events;
+
       std::unique_ptr<platf::deinit_t> qos;
+
+      // The buffers of the frame that is being sent, reset for each frame
+      arena::arena_t frame_arena;
+
+      // The largest frame is the burst a recovery from lost frames caused, compared to the average.
+      // Only written by videoBroadcastThread, which outlives the session's own threads, so join() reads them concurrently.
+      std::atomic<std::size_t> peak_frame_size;
+      std::atomic<std::uint64_t> frame_bytes;
+      std::atomic<std::uint64_t> frames;
     } video;
 
     struct {
@@ -613,181 +645,111 @@ namespace stream {
     }
   }
 
-  namespace fec {
-    using rs_t = util::safe_ptr<reed_solomon, [](reed_solomon *rs) { reed_solomon_release(rs); }>;
-
-    struct fec_t {
-      size_t data_shards;
-      size_t nr_shards;
-      size_t percentage;
-
-      size_t blocksize;
-      size_t prefixsize;
-      util::buffer_t<char> shards;
-      util::buffer_t<char> headers;
-      util::buffer_t<uint8_t *> shards_p;
-
-      std::vector<platf::buffer_descriptor_t> payload_buffers;
-
-      char *
-      data(size_t el) {
-        return (char *) shards_p[el];
-      }
-
-      char *
-      prefix(size_t el) {
-        return prefixsize ? &headers[el * prefixsize] : nullptr;
-      }
-
-      size_t
-      size() const {
-        return nr_shards;
-      }
-    };
-
-    static fec_t
-    encode(const std::string_view &payload, size_t blocksize, size_t fecpercentage, size_t minparityshards, size_t prefixsize) {
-      auto payload_size = payload.size();
-
-      auto pad = payload_size % blocksize != 0;
-
-      auto aligned_data_shards = payload_size / blocksize;
-      auto data_shards = aligned_data_shards + (pad ? 1 : 0);
-      auto parity_shards = (data_shards * fecpercentage + 99) / 100;
-
-      // increase the FEC percentage for this frame if the parity shard minimum is not met
-      if (parity_shards < minparityshards && fecpercentage != 0) {
-        parity_shards = minparityshards;
-        fecpercentage = (100 * parity_shards) / data_shards;
-
-        BOOST_LOG(verbose) << "Increasing FEC percentage to "sv << fecpercentage << " to meet parity shard minimum"sv << std::endl;
-      }
+  /**
+   * @brief Get the size of buffers combined by `concat_and_insert()`.
+   * @param insert_size The number of bytes to insert.
+   * @param slice_size The number of bytes between insertions.
+   * @param segments The data buffers.
+   * @return The size of the result.
+   */
+  std::size_t
+  concat_and_insert_size(uint64_t insert_size, uint64_t slice_size, std::span<const std::string_view> segments) {
+    std::size_t data_size = 0;
+    for (auto &segment : segments) {
+      data_size += segment.size();
+    }
 
-      auto nr_shards = data_shards + parity_shards;
+    auto pad = data_size % slice_size != 0;
+    auto elements = data_size / slice_size + (pad ? 1 : 0);
 
-      // If we need to store a zero-padded data shard, allocate that first to
-      // to keep the shards in order and reduce buffer fragmentation
-      auto parity_shard_offset = pad ? 1 : 0;
-      util::buffer_t<char> shards { (parity_shard_offset + parity_shards) * blocksize };
-      util::buffer_t<uint8_t *> shards_p { nr_shards };
-      std::vector<platf::buffer_descriptor_t> payload_buffers;
-      payload_buffers.reserve(2);
+    return elements * insert_size + data_size;
+  }
 
-      // Point into the payload buffer for all except the final padded data shard
-      auto next = std::begin(payload);
-      for (auto x = 0; x < aligned_data_shards; ++x) {
-        shards_p[x] = (uint8_t *) next;
-        next += blocksize;
-      }
-      payload_buffers.emplace_back(std::begin(payload), aligned_data_shards * blocksize);
+  /**
+   * @brief Fills part of the buffer combined by `concat_and_insert()`, so a large result can be filled piece by piece.
+   * @param insert_size The number of bytes to insert.
+   * @param slice_size The number of bytes between insertions.
+   * @param segments The data buffers, in order.
+   * @param result The buffer to fill, of `concat_and_insert_size()` bytes.
+   * @param begin The first byte of the result to fill, a multiple of `insert_size + slice_size`.
+   * @param end The byte after the last one to fill, a multiple of `insert_size + slice_size` or the size of the result.
+   */
+  void
+  concat_and_insert(uint64_t insert_size, uint64_t slice_size, std::span<const std::string_view> segments, std::span<uint8_t> result, std::size_t begin, std::size_t end) {
+    auto stride = insert_size + slice_size;
+
+    // Skip the data that went before the insertion at `begin`
+    auto segment = std::begin(segments);
+    std::size_t offset = begin / stride * slice_size;
+    while (segment != std::end(segments) && offset >= segment->size()) {
+      offset -= segment->size();
+      ++segment;
+    }
 
-      // If the last data shard needs to be zero-padded, we must use the shards buffer
-      if (pad) {
-        shards_p[aligned_data_shards] = (uint8_t *) &shards[0];
+    for (std::size_t x = begin / stride; x * stride < end; ++x) {
+      auto p = (char *) &result[x * stride];
+      std::memset(p, 0, insert_size);
+      p += insert_size;
 
-        // GCC doesn't figure out that std::copy_n() can be replaced with memcpy() here
-        // and ends up compiling a horribly slow element-by-element copy loop, so we
-        // help it by using memcpy()/memset() directly.
-        auto copy_len = std::min<size_t>(blocksize, std::end(payload) - next);
-        std::memcpy(shards_p[aligned_data_shards], next, copy_len);
-        if (copy_len < blocksize) {
-          // Zero any additional space after the end of the payload
-          std::memset(shards_p[aligned_data_shards] + copy_len, 0, blocksize - copy_len);
-        }
-      }
+      // For the last iteration, only copy to the end of the data
+      auto remaining = std::min<std::size_t>(slice_size, end - x * stride - insert_size);
 
-      // Add a payload buffer describing the shard buffer
-      payload_buffers.emplace_back(std::begin(shards), shards.size());
+      // A slice may span any number of buffers
+      while (remaining > 0) {
+        if (offset == segment->size()) {
+          ++segment;
+          offset = 0;
 
-      if (fecpercentage != 0) {
-        // Point into our allocated buffer for the parity shards
-        for (auto x = 0; x < parity_shards; ++x) {
-          shards_p[data_shards + x] = (uint8_t *) &shards[(parity_shard_offset + x) * blocksize];
+          continue;
         }
 
-        // packets = parity_shards + data_shards
-        rs_t rs { reed_solomon_new(data_shards, parity_shards) };
+        auto copy_len = std::min(remaining, segment->size() - offset);
+        std::copy_n(segment->data() + offset, copy_len, p);
 
-        reed_solomon_encode(rs.get(), shards_p.begin(), nr_shards, blocksize);
+        p += copy_len;
+        offset += copy_len;
+        remaining -= copy_len;
       }
-
-      return {
-        data_shards,
-        nr_shards,
-        fecpercentage,
-        blocksize,
-        prefixsize,
-        std::move(shards),
-        util::buffer_t<char> { nr_shards * prefixsize },
-        std::move(shards_p),
-        std::move(payload_buffers),
-      };
     }
-  }  // namespace fec
+  }
 
   /**
-   * @brief Combines two buffers and inserts new buffers at each slice boundary of the result.
+   * @brief Combines buffers into a buffer and inserts zeroed space at each slice boundary.
    * @param insert_size The number of bytes to insert.
    * @param slice_size The number of bytes between insertions.
-   * @param data1 The first data buffer.
-   * @param data2 The second data buffer.
+   * @param segments The data buffers, in order.
+   * @param result The buffer to fill, of `concat_and_insert_size()` bytes.
    */
-  std::vector<uint8_t>
-  concat_and_insert(uint64_t insert_size, uint64_t slice_size, const std::string_view &data1, const std::string_view &data2) {
-    auto data_size = data1.size() + data2.size();
-    auto pad = data_size % slice_size != 0;
-    auto elements = data_size / slice_size + (pad ? 1 : 0);
-
-    std::vector<uint8_t> result;
-    result.resize(elements * insert_size + data_size);
-
-    auto next = std::begin(data1);
-    auto end = std::end(data1);
-    for (auto x = 0; x < elements; ++x) {
-      void *p = &result[x * (insert_size + slice_size)];
-
-      // For the last iteration, only copy to the end of the data
-      if (x == elements - 1) {
-        slice_size = data_size - (x * slice_size);
-      }
-
-      // Test if this slice will extend into the next buffer
-      if (next + slice_size > end) {
-        // Copy the first portion from the first buffer
-        auto copy_len = end - next;
-        std::copy(next, end, (char *) p + insert_size);
+  void
+  concat_and_insert(uint64_t insert_size, uint64_t slice_size, std::span<const std::string_view> segments, std::span<uint8_t> result) {
+    concat_and_insert(insert_size, slice_size, segments, result, 0, result.size());
+  }
 
-        // Copy the remaining portion from the second buffer
-        next = std::begin(data2);
-        end = std::end(data2);
-        std::copy(next, next + (slice_size - copy_len), (char *) p + copy_len + insert_size);
-        next += slice_size - copy_len;
-      }
-      else {
-        std::copy(next, next + slice_size, (char *) p + insert_size);
-        next += slice_size;
-      }
-    }
+  /**
+   * @brief Combines buffers and inserts new buffers at each slice boundary of the result.
+   * @param insert_size The number of bytes to insert.
+   * @param slice_size The number of bytes between insertions.
+   * @param segments The data buffers, in order.
+   */
+  std::vector<uint8_t>
+  concat_and_insert(uint64_t insert_size, uint64_t slice_size, std::span<const std::string_view> segments) {
+    std::vector<uint8_t> result(concat_and_insert_size(insert_size, slice_size, segments));
+    concat_and_insert(insert_size, slice_size, segments, result);
 
     return result;
   }
 
+  /**
+   * @brief Combines two buffers and inserts new buffers at each slice boundary of the result.
+   * @param insert_size The number of bytes to insert.
+   * @param slice_size The number of bytes between insertions.
+   * @param data1 The first data buffer.
+   * @param data2 The second data buffer.
+   */
   std::vector<uint8_t>
-  replace(const std::string_view &original, const std::string_view &old, const std::string_view &_new) {
-    std::vector<uint8_t> replaced;
-    replaced.reserve(original.size() + _new.size() - old.size());
-
-    auto begin = std::begin(original);
-    auto end = std::end(original);
-    auto next = std::search(begin, end, std::begin(old), std::end(old));
-
-    std::copy(begin, next, std::back_inserter(replaced));
-    if (next != end) {
-      std::copy(std::begin(_new), std::end(_new), std::back_inserter(replaced));
-      std::copy(next + old.size(), end, std::back_inserter(replaced));
-    }
-
-    return replaced;
+  concat_and_insert(uint64_t insert_size, uint64_t slice_size, const std::string_view &data1, const std::string_view &data2) {
+    std::string_view segments[] { data1, data2 };
+    return concat_and_insert(insert_size, slice_size, segments);
   }
 
   /**
@@ -946,6 +908,11 @@ namespace stream {
 
       auto lastGoodFrame = stats[3];
 
+      session->video.fec->loss_stats(count, std::chrono::steady_clock::now());
+      if (session->video.congestion) {
+        session->video.congestion->loss_stats(count);
+      }
+
       BOOST_LOG(verbose)
         << "type [IDX_LOSS_STATS]"sv << std::endl
         << "---begin stats---" << std::endl
@@ -958,6 +925,14 @@ namespace stream {
     server->map(packetTypes[IDX_REQUEST_IDR_FRAME], [&](session_t *session, const std::string_view &payload) {
       BOOST_LOG(debug) << "type [IDX_REQUEST_IDR_FRAME]"sv;
 
+      // Clients also ask for an IDR frame when their decoder starts, which isn't caused by loss
+      if (session->video.first_frame_sent) {
+        session->video.fec->frames_lost(std::chrono::steady_clock::now());
+        if (session->video.congestion) {
+          session->video.congestion->frames_lost();
+        }
+      }
+
       session->video.idr_events->raise(true);
     });
 
@@ -971,6 +946,11 @@ namespace stream {
         << "firstFrame [" << firstFrame << ']' << std::endl
         << "lastFrame [" << lastFrame << ']';
 
+      session->video.fec->frames_lost(std::chrono::steady_clock::now());
+      if (session->video.congestion) {
+        session->video.congestion->frames_lost();
+      }
+
       session->video.invalidate_ref_frames_events->raise(std::make_pair(firstFrame, lastFrame));
     });
 
@@ -1185,6 +1165,15 @@ namespace stream {
 
               send_hdr_mode(session, std::move(hdr_info));
             }
+
+            auto &congestion = session->video.congestion;
+            if (congestion && session->control.peer) {
+              std::chrono::milliseconds rtt { session->control.peer->roundTripTime };
+              if (auto bitrate = congestion->update(rtt, now)) {
+                BOOST_LOG(info) << "Changing video bitrate to "sv << *bitrate << " Kbps"sv;
+                session->video.bitrate_events->raise(*bitrate);
+              }
+            }
           }
 
           ++pos;
@@ -1341,10 +1330,12 @@ namespace stream {
     platf::adjust_thread_priority(platf::thread_priority_e::high);
 
     logging::min_max_avg_periodic_logger<double> frame_processing_latency_logger(debug, "Frame processing latency", "ms");
+    logging::min_max_avg_periodic_logger<double> frame_size_logger(debug, "Encoded frame sizes", "kB");
 
     logging::time_delta_periodic_logger frame_send_batch_latency_logger(debug, "Network: each send_batch() latency");
     logging::time_delta_periodic_logger frame_fec_latency_logger(debug, "Network: each FEC block latency");
     logging::time_delta_periodic_logger frame_network_latency_logger(debug, "Network: frame's overall network latency");
+    logging::time_delta_periodic_logger encode_to_first_packet_latency_logger(debug, "Network: encode to first packet latency");
 
     crypto::aes_t iv(12);
 
@@ -1354,6 +1345,16 @@ namespace stream {
       return;
     }
 
+    // Hand each batch to the kernel with its departure time instead of sleeping until then.
+    // This only takes effect for sessions whose traffic leaves through an fq qdisc.
+    auto kernel_pacing = config::stream.kernel_pacing && platf::enable_socket_txtime(sock.native_handle());
+
+    fec::parity_pool_t parity_pool;
+    std::array<fec::parity_ready_t, fec::MAX_FEC_BLOCKS> parity_ready;
+
+    // The pieces a frame is put together from, reused from frame to frame
+    std::vector<std::string_view> payload_segments;
+
     auto ratecontrol_next_frame_start = std::chrono::steady_clock::now();
 
     while (auto packet = packets->pop()) {
@@ -1366,29 +1367,58 @@ namespace stream {
       auto session = (session_t *) packet->channel_data;
       auto lowseq = session->video.lowseq;
 
+      // Nothing of the previous frame of this session is in use anymore
+      auto &frame_arena = session->video.frame_arena;
+      auto frame_arena_capacity = frame_arena.capacity();
+      frame_arena.reset();
+      if (frame_arena.capacity() != frame_arena_capacity) {
+        BOOST_LOG(debug) << "Frame buffers grew to "sv << frame_arena.capacity() / 1024 << " KiB"sv;
+      }
+
+      if (!session->video.first_frame_sent.exchange(true)) {
+        auto now = std::chrono::steady_clock::now();
+        auto client_ready = session->video.start_events->view(0ms).value_or(now);
+        BOOST_LOG(info) << "Time to first frame: "sv
+                        << std::chrono::duration_cast<std::chrono::milliseconds>(now - session->video.start_time).count() << "ms since session start, "sv
+                        << std::chrono::duration_cast<std::chrono::milliseconds>(now - client_ready).count() << "ms since the client was ready"sv;
+      }
+
       std::string_view payload { (char *) packet->data(), packet->data_size() };
-      std::vector<uint8_t> payload_with_replacements;
 
-      // Apply replacements on the packet payload before performing any other operations.
-      // We need to know the final frame size to calculate the last packet size, and we
-      // must avoid matching replacements against the frame header or any other non-video
-      // part of the payload.
+      // The frame header goes in front, once the size of the frame is known
+      payload_segments.assign(1, std::string_view {});
+
+      // Parameter sets are replaced before performing any other operations. We need to know
+      // the final frame size to calculate the last packet size, and we must avoid matching
+      // replacements against the frame header or any other non-video part of the payload.
+      // Only the NAL units in front of the first slice are looked at, and the replacements
+      // are spliced in while the frame is copied into packets, instead of copying it first.
       if (packet->is_idr() && packet->replacements) {
-        for (auto &replacement : *packet->replacements) {
-          auto frame_old = replacement.old;
-          auto frame_new = replacement._new;
+        auto hevc = session->config.monitor.videoFormat == 1;
+        nal::splice_parameter_sets(payload, *packet->replacements, hevc, payload_segments);
+      }
+      else {
+        payload_segments.emplace_back(payload);
+      }
 
-          payload_with_replacements = replace(payload, frame_old, frame_new);
-          payload = { (char *) payload_with_replacements.data(), payload_with_replacements.size() };
-        }
+      std::size_t payload_size = 0;
+      for (auto &segment : payload_segments) {
+        payload_size += segment.size();
       }
 
+      if (payload_size > session->video.peak_frame_size.load(std::memory_order_relaxed)) {
+        session->video.peak_frame_size.store(payload_size, std::memory_order_relaxed);
+      }
+      session->video.frame_bytes.fetch_add(payload_size, std::memory_order_relaxed);
+      session->video.frames.fetch_add(1, std::memory_order_relaxed);
+      frame_size_logger.collect_and_log(payload_size / 1000.);
+
       video_short_frame_header_t frame_header = {};
       frame_header.headerType = 0x01;  // Short header type
       frame_header.frameType = packet->is_idr()                     ? 2 :
                                packet->after_ref_frame_invalidation ? 5 :
                                                                       1;
-      frame_header.lastPayloadLen = (payload.size() + sizeof(frame_header)) % (session->config.packetsize - sizeof(NV_VIDEO_PACKET));
+      frame_header.lastPayloadLen = (payload_size + sizeof(frame_header)) % (session->config.packetsize - sizeof(NV_VIDEO_PACKET));
       if (frame_header.lastPayloadLen == 0) {
         frame_header.lastPayloadLen = session->config.packetsize - sizeof(NV_VIDEO_PACKET);
       }
@@ -1407,18 +1437,27 @@ namespace stream {
         frame_header.frame_processing_latency = 0;
       }
 
-      auto fecPercentage = config::stream.fec_percentage;
+      auto previousFecPercentage = session->video.fec->current();
+      auto fecPercentage = session->video.fec->percentage(std::chrono::steady_clock::now());
+      auto minRequiredFecPackets = session->video.fec->min_parity_packets(session->config.minRequiredFecPackets);
+      if (fecPercentage != previousFecPercentage) {
+        BOOST_LOG(debug) << "FEC percentage changed from "sv << previousFecPercentage << " to "sv << fecPercentage;
+      }
 
-      // Insert space for packet headers
+      // Insert space for packet headers. The frame is copied into the packets of each FEC block
+      // right before the block is sent, so the first packets leave before the whole frame is copied.
       auto blocksize = session->config.packetsize + MAX_RTP_HEADER_SIZE;
       auto payload_blocksize = blocksize - sizeof(video_packet_raw_t);
-      auto payload_new = concat_and_insert(sizeof(video_packet_raw_t), payload_blocksize,
-        std::string_view { (char *) &frame_header, sizeof(frame_header) }, payload);
+      payload_segments.front() = std::string_view { (char *) &frame_header, sizeof(frame_header) };
+      auto payload_new = frame_arena.allocate<uint8_t>(concat_and_insert_size(sizeof(video_packet_raw_t), payload_blocksize, payload_segments));
 
       payload = std::string_view { (char *) payload_new.data(), payload_new.size() };
 
-      // There are 2 bits for FEC block count for a maximum of 4 FEC blocks
-      constexpr auto MAX_FEC_BLOCKS = 4;
+      // Below this many data shards per frame, handing the parity off to the pool costs more than it saves
+      constexpr auto PARITY_POOL_MIN_DATA_SHARDS = 64;
+
+      // With kernel pacing, video is paced to this multiple of the stream's bitrate
+      constexpr auto PACING_BITRATE_MULTIPLIER = 10;
 
       // The max number of data shards per block is found by solving this system of equations for D:
       // D = 255 - P
@@ -1435,16 +1474,13 @@ namespace stream {
 
       // If the number of FEC blocks needed exceeds the protocol limit, turn off FEC for this frame.
       // For normal FEC percentages, this should only happen for enormous frames (over 800 packets at 20%).
-      if (fec_blocks_needed > MAX_FEC_BLOCKS) {
+      if (fec_blocks_needed > fec::MAX_FEC_BLOCKS) {
         BOOST_LOG(warning) << "Skipping FEC for abnormally large encoded frame (needed "sv << fec_blocks_needed << " FEC blocks)"sv;
         fecPercentage = 0;
-        fec_blocks_needed = MAX_FEC_BLOCKS;
+        fec_blocks_needed = fec::MAX_FEC_BLOCKS;
       }
 
-      std::array<std::string_view, MAX_FEC_BLOCKS> fec_blocks;
-      decltype(fec_blocks)::iterator
-        fec_blocks_begin = std::begin(fec_blocks),
-        fec_blocks_end = std::begin(fec_blocks) + fec_blocks_needed;
+      std::array<std::string_view, fec::MAX_FEC_BLOCKS> fec_blocks;
 
       BOOST_LOG(verbose) << "Generating "sv << fec_blocks_needed << " FEC blocks"sv;
 
@@ -1471,8 +1507,21 @@ namespace stream {
       }
 
       try {
-        // Use around 80% of 1Gbps          1Gbps            percent    ms     packet      byte
-        size_t ratecontrol_packets_in_1ms = std::giga::num * 80 / 100 / 1000 / blocksize / 8;
+        auto paced_by_kernel = kernel_pacing && session->video.kernel_pacing;
+
+        // Use around 80% of the link rate (Mbps to bytes per ms)
+        std::uint64_t ratecontrol_bytes_in_1ms = (std::uint64_t) config::stream.pacing_link_rate * std::mega::num * 80 / 100 / 1000 / 8;
+
+        // The kernel paces precisely enough to follow the stream's own rate. An IDR frame is roughly
+        // ten times the size of an average frame, so ten times the bitrate lets it drain within a frame
+        // interval, while average frames still leave within a tenth of it.
+        if (paced_by_kernel && session->config.monitor.bitrate > 0) {
+          // Kbps to bytes per ms
+          auto stream_bytes_in_1ms = (std::uint64_t) session->config.monitor.bitrate * PACING_BITRATE_MULTIPLIER / 8;
+          ratecontrol_bytes_in_1ms = std::min(ratecontrol_bytes_in_1ms, stream_bytes_in_1ms);
+        }
+
+        size_t ratecontrol_packets_in_1ms = std::max<std::uint64_t>(1, ratecontrol_bytes_in_1ms / blocksize);
 
         // Send less than 64K in a single batch.
         // On Windows, batches above 64K seem to bypass SO_SNDBUF regardless of its size,
@@ -1490,38 +1539,34 @@ namespace stream {
         size_t ratecontrol_frame_packets_sent = 0;
         size_t ratecontrol_group_packets_sent = 0;
 
-        auto blockIndex = 0;
-        std::for_each(fec_blocks_begin, fec_blocks_end, [&](std::string_view &current_payload) {
-          auto packets = (current_payload.size() + (blocksize - 1)) / blocksize;
+        auto peer_address = session->video.peer.address();
+        auto prefixsize = session->video.cipher ? sizeof(video_packet_enc_prefix_t) : 0;
 
-          for (int x = 0; x < packets; ++x) {
-            auto *inspect = (video_packet_raw_t *) &current_payload[x * blocksize];
+        // set FEC info now that we know for sure what our percentage will be for this frame
+        auto set_shard_header = [&](fec::fec_t &shards, int blockIndex, int blockLowseq, size_t x) {
+          auto *inspect = (video_packet_raw_t *) shards.data(x);
 
-            inspect->packet.frameIndex = packet->frame_index();
-            inspect->packet.streamPacketIndex = ((uint32_t) lowseq + x) << 8;
+          // RTP video timestamps use a 90 KHz clock
+          auto now = boost::posix_time::microsec_clock::universal_time();
+          auto timestamp = (now - timebase).total_microseconds() / (1000 / 90);
 
-            // Match multiFecFlags with Moonlight
-            inspect->packet.multiFecFlags = 0x10;
-            inspect->packet.multiFecBlocks = (blockIndex << 4) | ((fec_blocks_needed - 1) << 6);
+          inspect->packet.fecInfo =
+            (x << 12 |
+              shards.data_shards << 22 |
+              shards.percentage << 4);
 
-            inspect->packet.flags = FLAG_CONTAINS_PIC_DATA;
-            if (x == 0) {
-              inspect->packet.flags |= FLAG_SOF;
-            }
-            if (x == packets - 1) {
-              inspect->packet.flags |= FLAG_EOF;
-            }
-          }
+          inspect->rtp.header = 0x80 | FLAG_EXTENSION;
+          inspect->rtp.sequenceNumber = util::endian::big<uint16_t>(blockLowseq + x);
+          inspect->rtp.timestamp = util::endian::big<uint32_t>(timestamp);
 
-          frame_fec_latency_logger.first_point_now();
-          // If video encryption is enabled, we allocate space for the encryption header before each shard
-          auto shards = fec::encode(current_payload, blocksize, fecPercentage, session->config.minRequiredFecPackets,
-            session->video.cipher ? sizeof(video_packet_enc_prefix_t) : 0);
-          frame_fec_latency_logger.second_point_now_and_log();
+          inspect->packet.multiFecBlocks = (blockIndex << 4) | ((fec_blocks_needed - 1) << 6);
+          inspect->packet.frameIndex = packet->frame_index();
+        };
 
-          auto peer_address = session->video.peer.address();
+        // Encrypt and send the shards in [begin, end)
+        auto send_shards = [&](fec::fec_t &shards, size_t begin, size_t end) {
           auto batch_info = platf::batched_send_info_t {
-            shards.headers.begin(),
+            shards.headers.data(),
             shards.prefixsize,
             shards.payload_buffers,
             shards.blocksize,
@@ -1533,28 +1578,10 @@ namespace stream {
             session->localAddress,
           };
 
-          size_t next_shard_to_send = 0;
-
-          // set FEC info now that we know for sure what our percentage will be for this frame
-          for (auto x = 0; x < shards.size(); ++x) {
-            auto *inspect = (video_packet_raw_t *) shards.data(x);
-
-            // RTP video timestamps use a 90 KHz clock
-            auto now = boost::posix_time::microsec_clock::universal_time();
-            auto timestamp = (now - timebase).total_microseconds() / (1000 / 90);
-
-            inspect->packet.fecInfo =
-              (x << 12 |
-                shards.data_shards << 22 |
-                shards.percentage << 4);
-
-            inspect->rtp.header = 0x80 | FLAG_EXTENSION;
-            inspect->rtp.sequenceNumber = util::endian::big<uint16_t>(lowseq + x);
-            inspect->rtp.timestamp = util::endian::big<uint32_t>(timestamp);
-
-            inspect->packet.multiFecBlocks = (blockIndex << 4) | ((fec_blocks_needed - 1) << 6);
-            inspect->packet.frameIndex = packet->frame_index();
+          size_t next_shard_to_send = begin;
+          int batches = 0;
 
+          for (auto x = begin; x < end; ++x) {
             // Encrypt this shard if video encryption is enabled
             if (session->video.cipher) {
               // We use the deterministic IV construction algorithm specified in NIST SP 800-38D
@@ -1569,21 +1596,27 @@ namespace stream {
               iv[11] = 'V';  // Video stream
               session->video.gcm_iv_counter++;
 
-              // Encrypt the target buffer in place
+              // Data shards are encrypted into a separate buffer, parity shards in place
               auto *prefix = (video_packet_enc_prefix_t *) shards.prefix(x);
               prefix->frameNumber = packet->frame_index();
               std::copy(std::begin(iv), std::end(iv), prefix->iv);
-              session->video.cipher->encrypt(std::string_view { (char *) inspect, (size_t) blocksize },
-                prefix->tag, (uint8_t *) inspect, &iv);
+              session->video.cipher->encrypt(std::string_view { shards.data(x), (size_t) blocksize },
+                prefix->tag, (uint8_t *) shards.payload(x), &iv);
             }
 
             if (x - next_shard_to_send + 1 >= send_batch_size ||
-                x + 1 == shards.size()) {
+                x + 1 == end) {
+              if (paced_by_kernel) {
+                // The kernel holds each batch until it's due, so every batch gets its exact departure time
+                batch_info.departure_time = ratecontrol_frame_start +
+                                            std::chrono::duration_cast<std::chrono::nanoseconds>(1ms) *
+                                              ratecontrol_frame_packets_sent / ratecontrol_packets_in_1ms;
+              }
               // Do pacing within the frame.
               // Also trigger pacing before the first send_batch() of the frame
               // to account for the last send_batch() of the previous frame.
-              if (ratecontrol_group_packets_sent >= ratecontrol_packets_in_1ms ||
-                  ratecontrol_frame_packets_sent == 0) {
+              else if (ratecontrol_group_packets_sent >= ratecontrol_packets_in_1ms ||
+                       ratecontrol_frame_packets_sent == 0) {
                 auto due = ratecontrol_frame_start +
                            std::chrono::duration_cast<std::chrono::nanoseconds>(1ms) *
                              ratecontrol_frame_packets_sent / ratecontrol_packets_in_1ms;
@@ -1600,6 +1633,7 @@ namespace stream {
               batch_info.block_offset = next_shard_to_send;
               batch_info.block_count = current_batch_size;
 
+              ++batches;
               frame_send_batch_latency_logger.first_point_now();
               // Use a batched send if it's supported on this platform
               if (!platf::send_batch(batch_info)) {
@@ -1609,7 +1643,7 @@ namespace stream {
                   auto send_info = platf::send_info_t {
                     shards.prefix(next_shard_to_send + y),
                     shards.prefixsize,
-                    shards.data(next_shard_to_send + y),
+                    shards.payload(next_shard_to_send + y),
                     shards.blocksize,
                     (uintptr_t) sock.native_handle(),
                     peer_address,
@@ -1622,12 +1656,104 @@ namespace stream {
               }
               frame_send_batch_latency_logger.second_point_now_and_log();
 
+              if (ratecontrol_frame_packets_sent == 0 && packet->encoded_timestamp) {
+                encode_to_first_packet_latency_logger.first_point(*packet->encoded_timestamp);
+                encode_to_first_packet_latency_logger.second_point_now_and_log();
+              }
+
               ratecontrol_group_packets_sent += current_batch_size;
               ratecontrol_frame_packets_sent += current_batch_size;
               next_shard_to_send = x + 1;
             }
           }
 
+          if (session->video.congestion) {
+            session->video.congestion->sent(end - begin, batches, batch_info.short_batches);
+          }
+        };
+
+        // Every block is packetized before the first one is sent. For large frames, the parity of all blocks
+        // is then computed on the parity pool while the data shards are sent, block after block.
+        auto offload_parity = fecPercentage != 0 && payload.size() / blocksize >= PARITY_POOL_MIN_DATA_SHARDS;
+
+        std::array<std::optional<fec::fec_t>, fec::MAX_FEC_BLOCKS> blocks;
+        std::array<int, fec::MAX_FEC_BLOCKS> blocks_lowseq;
+
+        // The parity pool must be done with the blocks before they are freed
+        auto wait_for_parity = util::fail_guard([&]() {
+          for (auto &ready : parity_ready) {
+            ready.wait();
+          }
+        });
+
+        auto prepare_block = [&](int blockIndex) {
+          auto &current_payload = fec_blocks[blockIndex];
+          auto packets = (current_payload.size() + (blocksize - 1)) / blocksize;
+
+          auto block_begin = (std::size_t) (current_payload.data() - payload.data());
+          concat_and_insert(sizeof(video_packet_raw_t), payload_blocksize, payload_segments, payload_new, block_begin, block_begin + current_payload.size());
+
+          for (int x = 0; x < packets; ++x) {
+            auto *inspect = (video_packet_raw_t *) &current_payload[x * blocksize];
+
+            inspect->packet.frameIndex = packet->frame_index();
+            inspect->packet.streamPacketIndex = ((uint32_t) lowseq + x) << 8;
+
+            // Match multiFecFlags with Moonlight
+            inspect->packet.multiFecFlags = 0x10;
+            inspect->packet.multiFecBlocks = (blockIndex << 4) | ((fec_blocks_needed - 1) << 6);
+
+            inspect->packet.flags = FLAG_CONTAINS_PIC_DATA;
+            if (x == 0) {
+              inspect->packet.flags |= FLAG_SOF;
+            }
+            if (x == packets - 1) {
+              inspect->packet.flags |= FLAG_EOF;
+            }
+          }
+
+          // If video encryption is enabled, we allocate space for the encryption header before each shard
+          auto &shards = blocks[blockIndex].emplace(fec::prepare(current_payload, blocksize, fecPercentage, minRequiredFecPackets, prefixsize, frame_arena));
+
+          // The parity shards get their own headers after they are computed. The parity bytes covering
+          // these header fields are overwritten, so filling them in first doesn't change the parity on the wire.
+          for (auto x = 0; x < shards.data_shards; ++x) {
+            set_shard_header(shards, blockIndex, lowseq, x);
+          }
+
+          if (offload_parity) {
+            parity_pool.submit(shards, parity_ready[blockIndex]);
+          }
+
+          blocks_lowseq[blockIndex] = lowseq;
+          lowseq += shards.size();
+        };
+
+        for (int blockIndex = 0; blockIndex < fec_blocks_needed; ++blockIndex) {
+          prepare_block(blockIndex);
+        }
+
+        for (int blockIndex = 0; blockIndex < fec_blocks_needed; ++blockIndex) {
+          auto &shards = *blocks[blockIndex];
+
+          send_shards(shards, 0, shards.data_shards);
+
+          if (offload_parity) {
+            parity_ready[blockIndex].wait();
+          }
+          else {
+            shards.encode_parity();
+          }
+
+          frame_fec_latency_logger.first_point(shards.parity_start);
+          frame_fec_latency_logger.second_point_and_log(shards.parity_end);
+
+          for (auto x = shards.data_shards; x < shards.size(); ++x) {
+            set_shard_header(shards, blockIndex, blocks_lowseq[blockIndex], x);
+          }
+
+          send_shards(shards, shards.data_shards, shards.size());
+
           // remember this in case the next frame comes immediately
           ratecontrol_next_frame_start = ratecontrol_frame_start +
                                          std::chrono::duration_cast<std::chrono::nanoseconds>(1ms) *
@@ -1642,9 +1768,8 @@ namespace stream {
             BOOST_LOG(verbose) << "Frame ["sv << packet->frame_index() << "] :: send ["sv << shards.size() << "] shards..."sv << std::endl;
           }
 
-          ++blockIndex;
-          lowseq += shards.size();
-        });
+          session->video.fec->sent(shards.size());
+        }
 
         session->video.lowseq = lowseq;
       }
@@ -1887,9 +2012,15 @@ namespace stream {
     while (current_time - start_time < config::stream.ping_timeout) {
       auto delta_time = current_time - start_time;
 
-      auto msg_opt = messages->pop(config::stream.ping_timeout - delta_time);
+      // Wake up periodically, the session may be stopped before the client ever pings us
+      auto msg_opt = messages->pop(std::min<std::chrono::steady_clock::duration>(config::stream.ping_timeout - delta_time, 100ms));
       if (!msg_opt) {
-        break;
+        if (!messages->running() || session->shutdown_event->peek()) {
+          return -1;
+        }
+
+        current_time = std::chrono::steady_clock::now();
+        continue;
       }
 
       TUPLE_2D_REF(recv_peer, msg, *msg_opt);
@@ -1925,15 +2056,35 @@ namespace stream {
     while_starting_do_nothing(session->state);
 
     auto ref = broadcast.ref();
-    auto error = recv_ping(session, ref, socket_e::video, session->video.ping_payload, session->video.peer, config::stream.ping_timeout);
-    if (error < 0) {
-      return;
-    }
 
-    // Enable local prioritization and QoS tagging on video traffic if requested by the client
-    auto address = session->video.peer.address();
-    session->video.qos = platf::enable_socket_qos(ref->video_sock.native_handle(), address,
-      session->video.peer.port(), platf::qos_data_type_e::video, session->config.videoQosType != 0);
+    // Wait for the client's ping on a separate thread, so display capture and the encoder are
+    // brought up while the client is still finishing the RTSP handshake. The encoder holds back
+    // frames until the ping arrives, since only then do we know where to send them.
+    std::thread ping_thread { [session, ref]() {
+      auto error = recv_ping(session, ref, socket_e::video, session->video.ping_payload, session->video.peer, config::stream.ping_timeout);
+      if (error < 0) {
+        session::stop(*session);
+        return;
+      }
+
+      // Enable local prioritization and QoS tagging on video traffic if requested by the client
+      auto address = session->video.peer.address();
+      session->video.qos = platf::enable_socket_qos(ref->video_sock.native_handle(), address,
+        session->video.peer.port(), platf::qos_data_type_e::video, session->config.videoQosType != 0);
+
+      if (config::stream.kernel_pacing) {
+        session->video.kernel_pacing = platf::departure_time_enforced(address);
+        if (session->video.kernel_pacing) {
+          BOOST_LOG(info) << "Video packets are paced by the kernel"sv;
+        }
+      }
+
+      session->video.start_events->raise(std::chrono::steady_clock::now());
+    } };
+    auto ping_fg = util::fail_guard([&]() {
+      session::stop(*session);
+      ping_thread.join();
+    });
 
     BOOST_LOG(debug) << "Start capturing Video"sv;
     video::capture(session->mail, session->config.monitor, session);
@@ -1985,6 +2136,11 @@ namespace stream {
       return session.device_uuid == uuid;
     }
 
+    int
+    fec_percentage(const session_t &session) {
+      return session.video.fec->current();
+    }
+
     bool
     update_device_info(session_t& session, const std::string& name, const crypto::PERM& newPerm) {
       session.permission = newPerm;
@@ -2060,7 +2216,7 @@ namespace stream {
         logging::log_flush();
         lifetime::debug_trap();
       };
-      auto force_kill = task_pool.pushDelayed(task, 10s).task_id;
+      auto force_kill = task_pool.postDelayed(task, 10s);
       auto fg = util::fail_guard([&force_kill]() {
         // Cancel the kill task if we manage to return from this function
         task_pool.cancel(force_kill);
@@ -2068,6 +2224,15 @@ namespace stream {
 
       BOOST_LOG(debug) << "Waiting for video to end..."sv;
       session.videoThread.join();
+
+      auto frames = session.video.frames.load(std::memory_order_relaxed);
+      if (frames) {
+        auto peak_frame_size = session.video.peak_frame_size.load(std::memory_order_relaxed);
+        auto average_frame_size = (double) session.video.frame_bytes.load(std::memory_order_relaxed) / frames;
+        BOOST_LOG(info) << "Largest video frame: "sv << peak_frame_size / 1000 << " kB, "sv
+                        << stat_trackers::one_digit_after_decimal() % (peak_frame_size / average_frame_size) << " times the average"sv;
+      }
+
       BOOST_LOG(debug) << "Waiting for audio to end..."sv;
       session.audioThread.join();
       BOOST_LOG(debug) << "Waiting for control to end..."sv;
@@ -2119,6 +2284,7 @@ namespace stream {
       session.audio.peer.port(0);
 
       session.pingTimeout = std::chrono::steady_clock::now() + config::stream.ping_timeout;
+      session.video.start_time = std::chrono::steady_clock::now();
 
       session.audioThread = std::thread { audioThread, &session };
       session.videoThread = std::thread { videoThread, &session };
@@ -2157,7 +2323,27 @@ namespace stream {
 
       session->video.idr_events = mail->event<bool>(mail::idr);
       session->video.invalidate_ref_frames_events = mail->event<std::pair<int64_t, int64_t>>(mail::invalidate_ref_frames);
+      session->video.start_events = mail->event<std::chrono::steady_clock::time_point>(mail::video_start);
+      session->video.first_frame_sent = false;
+      session->video.kernel_pacing = false;
       session->video.lowseq = 0;
+      session->video.peak_frame_size = 0;
+      session->video.frame_bytes = 0;
+      session->video.frames = 0;
+      if (config::stream.adaptive_fec) {
+        // The configured percentage is always within the bounds, so it is never clamped when the session starts
+        session->video.fec.emplace(
+          config::stream.fec_percentage,
+          std::min(config::stream.fec_percentage_min, config::stream.fec_percentage),
+          std::max(config::stream.fec_percentage_max, config::stream.fec_percentage));
+      }
+      else {
+        session->video.fec.emplace(config::stream.fec_percentage, config::stream.fec_percentage, config::stream.fec_percentage);
+      }
+      session->video.bitrate_events = mail->event<int>(mail::bitrate);
+      if (config::stream.adaptive_bitrate && config.monitor.bitrate > 0) {
+        session->video.congestion.emplace(config.monitor.bitrate, config.monitor.bitrate * config::stream.adaptive_bitrate_min / 100, std::chrono::steady_clock::now());
+      }
       session->video.ping_payload = launch_session.av_ping_payload;
       if (config.encryptionFlagsEnabled & SS_ENC_VIDEO) {
         BOOST_LOG(info) << "Video encryption enabled"sv;
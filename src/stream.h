@@ -47,6 +47,13 @@ namespace stream {
     uuid(const session_t& session);
     bool
     uuid_match(const session_t& session, const std::string& uuid);
+    /**
+     * @brief Get the FEC percentage currently used for the session's video stream.
+     * @param session The session.
+     * @return The FEC percentage.
+     */
+    int
+    fec_percentage(const session_t &session);
     bool
     update_device_info(session_t& session, const std::string& name, const crypto::PERM& newPerm);
     int
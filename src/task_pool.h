@@ -5,11 +5,16 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <optional>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -18,34 +23,155 @@
 #include "utility.h"
 namespace task_pool_util {
 
-  class _ImplBase {
+  /**
+   * @brief A move-only callable without a result.
+   * @details Callables of up to `inline_size` bytes, like a lambda capturing a few pointers or the
+   * shared state of a `std::packaged_task`, are stored inline instead of on the heap.
+   */
+  class task_t {
   public:
-    // _unique_base_type _this_ptr;
+    static constexpr std::size_t inline_size = 6 * sizeof(void *);
 
-    inline virtual ~_ImplBase() = default;
+    task_t() = default;
 
-    virtual void
-    run() = 0;
-  };
+    template <class Function, std::enable_if_t<!std::is_same_v<std::decay_t<Function>, task_t> && std::is_invocable_v<std::decay_t<Function> &>, int> = 0>
+    task_t(Function &&f) {
+      using F = std::decay_t<Function>;
 
-  template <class Function>
-  class _Impl: public _ImplBase {
-    Function _func;
+      if constexpr (fits_inline<F>) {
+        new (&_storage) F(std::forward<Function>(f));
+      }
+      else {
+        *reinterpret_cast<F **>(&_storage) = new F(std::forward<Function>(f));
+      }
 
-  public:
-    _Impl(Function &&f):
-        _func(std::forward<Function>(f)) {}
+      _ops = &ops_for<F>;
+    }
+
+    task_t(task_t &&other) noexcept:
+        _ops { other._ops } {
+      if (_ops) {
+        _ops->move(&other._storage, &_storage);
+        other._ops = nullptr;
+      }
+    }
+
+    task_t &
+    operator=(task_t &&other) noexcept {
+      if (this != &other) {
+        reset();
+
+        _ops = other._ops;
+        if (_ops) {
+          _ops->move(&other._storage, &_storage);
+          other._ops = nullptr;
+        }
+      }
+
+      return *this;
+    }
+
+    ~task_t() {
+      reset();
+    }
 
     void
-    run() override {
-      _func();
+    run() {
+      _ops->run(&_storage);
+    }
+
+    explicit operator bool() const {
+      return _ops != nullptr;
     }
+
+  private:
+    struct ops_t {
+      void (*run)(void *storage);
+      // Move constructs the callable at `to` and destroys it at `from`
+      void (*move)(void *from, void *to);
+      void (*destroy)(void *storage);
+    };
+
+    template <class F>
+    static constexpr bool fits_inline = sizeof(F) <= inline_size && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>;
+
+    template <class F>
+    static constexpr ops_t
+    make_ops() {
+      if constexpr (fits_inline<F>) {
+        return {
+          [](void *storage) {
+            (*std::launder(reinterpret_cast<F *>(storage)))();
+          },
+          [](void *from, void *to) {
+            auto f = std::launder(reinterpret_cast<F *>(from));
+            new (to) F(std::move(*f));
+            f->~F();
+          },
+          [](void *storage) {
+            std::launder(reinterpret_cast<F *>(storage))->~F();
+          },
+        };
+      }
+      else {
+        return {
+          [](void *storage) {
+            (**reinterpret_cast<F **>(storage))();
+          },
+          [](void *from, void *to) {
+            *reinterpret_cast<F **>(to) = *reinterpret_cast<F **>(from);
+          },
+          [](void *storage) {
+            delete *reinterpret_cast<F **>(storage);
+          },
+        };
+      }
+    }
+
+    template <class F>
+    static constexpr ops_t ops_for = make_ops<F>();
+
+    void
+    reset() {
+      if (_ops) {
+        _ops->destroy(&_storage);
+        _ops = nullptr;
+      }
+    }
+
+    alignas(std::max_align_t) unsigned char _storage[inline_size];
+    const ops_t *_ops = nullptr;
+  };
+
+  /**
+   * @brief Something that runs tasks in an order of its own, like a strand of a thread pool.
+   */
+  class executor_t {
+  public:
+    virtual ~executor_t() = default;
+
+    /**
+     * @brief Queue a task, it may run on another thread.
+     */
+    virtual void
+    execute(task_t &&task) = 0;
   };
 
+  /**
+   * @brief Never defined, task ids only point to it to keep them distinct from other pointers.
+   */
+  class _TaskHandle;
+
   class TaskPool {
   public:
-    typedef std::unique_ptr<_ImplBase> __task;
-    typedef _ImplBase *task_id_t;
+    typedef task_t __task;
+
+    /**
+     * @brief An opaque handle to a delayed task, which is never dereferenced.
+     * @details It stays invalid after the task ran or was canceled, even if its slot is reused,
+     * and is never equal to `nullptr` or `(task_id_t) 0x01`.
+     */
+    typedef _TaskHandle *task_id_t;
 
     typedef std::chrono::steady_clock::time_point __time_point;
 
@@ -60,19 +186,55 @@ namespace task_pool_util {
     };
 
   protected:
+    /**
+     * @brief A delayed task in the timer heap.
+     */
+    struct _timer_t {
+      __time_point time;
+      std::uint32_t slot;
+    };
+
+    /**
+     * @brief Where a delayed task lives while it's in the timer heap.
+     */
+    struct _slot_t {
+      __task task;
+      std::uintptr_t generation = 0;
+      std::size_t heap_index = 0;
+
+      // Runs the task once it's due, the pool runs it if this is empty
+      std::shared_ptr<executor_t> executor;
+    };
+
+    // The heap index of a due task that waits in the queue of its executor
+    static constexpr std::size_t _handed_over = SIZE_MAX;
+
+    // The low bits of a task id are the slot, the high bits its generation
+    static constexpr int _slot_bits = 20;
+    static constexpr std::uintptr_t _slot_mask = (std::uintptr_t { 1 } << _slot_bits) - 1;
+
     std::deque<__task> _tasks;
-    std::vector<std::pair<__time_point, __task>> _timer_tasks;
+
+    // A binary min-heap on the time of the delayed tasks, each slot knows its position in the heap
+    std::vector<_timer_t> _timer_heap;
+    std::vector<_slot_t> _timer_slots;
+    std::vector<std::uint32_t> _free_slots;
     std::mutex _task_mutex;
 
   public:
     TaskPool() = default;
     TaskPool(TaskPool &&other) noexcept:
-        _tasks { std::move(other._tasks) }, _timer_tasks { std::move(other._timer_tasks) } {}
+        _tasks(std::move(other._tasks)),
+        _timer_heap(std::move(other._timer_heap)),
+        _timer_slots(std::move(other._timer_slots)),
+        _free_slots(std::move(other._free_slots)) {}
 
     TaskPool &
     operator=(TaskPool &&other) noexcept {
       std::swap(_tasks, other._tasks);
-      std::swap(_timer_tasks, other._timer_tasks);
+      std::swap(_timer_heap, other._timer_heap);
+      std::swap(_timer_slots, other._timer_slots);
+      std::swap(_free_slots, other._free_slots);
 
       return *this;
     }
@@ -85,32 +247,57 @@ namespace task_pool_util {
       using __return = std::invoke_result_t<Function, Args &&...>;
       using task_t = std::packaged_task<__return()>;
 
-      auto bind = [task = std::forward<Function>(newTask), tuple_args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
-        return std::apply(task, std::move(tuple_args));
-      };
-
-      task_t task(std::move(bind));
+      task_t task(bind(std::forward<Function>(newTask), std::forward<Args>(args)...));
 
       auto future = task.get_future();
 
       std::lock_guard<std::mutex> lg(_task_mutex);
-      _tasks.emplace_back(toRunnable(std::move(task)));
+      _tasks.emplace_back(std::move(task));
 
       return future;
     }
 
+    /**
+     * @brief Queue a task whose result nobody waits for.
+     * @details Unlike `push()`, no future is allocated and small tasks aren't allocated at all.
+     */
+    template <class Function, class... Args>
     void
+    post(Function &&newTask, Args &&...args) {
+      static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
+
+      __task task { bind(std::forward<Function>(newTask), std::forward<Args>(args)...) };
+
+      std::lock_guard<std::mutex> lg(_task_mutex);
+      _tasks.emplace_back(std::move(task));
+    }
+
+    void
+    post(__task &&task) {
+      std::lock_guard<std::mutex> lg(_task_mutex);
+      _tasks.emplace_back(std::move(task));
+    }
+
+    /**
+     * @return An id to potentially delay or cancel the task.
+     */
+    task_id_t
     pushDelayed(std::pair<__time_point, __task> &&task) {
       std::lock_guard lg(_task_mutex);
 
-      auto it = _timer_tasks.cbegin();
-      for (; it < _timer_tasks.cend(); ++it) {
-        if (std::get<0>(*it) < task.first) {
-          break;
-        }
-      }
+      return schedule(task.first, std::move(task.second), nullptr);
+    }
 
-      _timer_tasks.emplace(it, task.first, std::move(task.second));
+    /**
+     * @brief Delay a task that runs on `executor` instead of the pool.
+     * @details The task can still be canceled while it waits in the queue of the executor.
+     * @return An id to potentially delay or cancel the task.
+     */
+    task_id_t
+    pushDelayed(std::pair<__time_point, __task> &&task, std::shared_ptr<executor_t> executor) {
+      std::lock_guard lg(_task_mutex);
+
+      return schedule(task.first, std::move(task.second), std::move(executor));
     }
 
     /**
@@ -124,28 +311,25 @@ namespace task_pool_util {
       using __return = std::invoke_result_t<Function, Args &&...>;
       using task_t = std::packaged_task<__return()>;
 
-      __time_point time_point;
-      if constexpr (std::is_floating_point_v<X>) {
-        time_point = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
-      }
-      else {
-        time_point = std::chrono::steady_clock::now() + duration;
-      }
-
-      auto bind = [task = std::forward<Function>(newTask), tuple_args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
-        return std::apply(task, std::move(tuple_args));
-      };
-
-      task_t task(std::move(bind));
+      task_t task(bind(std::forward<Function>(newTask), std::forward<Args>(args)...));
 
       auto future = task.get_future();
-      auto runnable = toRunnable(std::move(task));
+      auto task_id = pushDelayed(std::pair { time_point_after(duration), __task { std::move(task) } });
 
-      task_id_t task_id = &*runnable;
+      return timer_task_t<__return> { task_id, future };
+    }
 
-      pushDelayed(std::pair { time_point, std::move(runnable) });
+    /**
+     * @brief Delay a task whose result nobody waits for.
+     * @details Unlike `pushDelayed()`, no future is allocated and small tasks aren't allocated at all.
+     * @return An id to potentially delay or cancel the task.
+     */
+    template <class Function, class X, class Y, class... Args>
+    task_id_t
+    postDelayed(Function &&newTask, std::chrono::duration<X, Y> duration, Args &&...args) {
+      static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
 
-      return timer_task_t<__return> { task_id, future };
+      return pushDelayed(std::pair { time_point_after(duration), __task { bind(std::forward<Function>(newTask), std::forward<Args>(args)...) } });
     }
 
     /**
@@ -157,62 +341,41 @@ namespace task_pool_util {
     delay(task_id_t task_id, std::chrono::duration<X, Y> duration) {
       std::lock_guard<std::mutex> lg(_task_mutex);
 
-      auto it = _timer_tasks.begin();
-      for (; it < _timer_tasks.cend(); ++it) {
-        const __task &task = std::get<1>(*it);
-
-        if (&*task == task_id) {
-          std::get<0>(*it) = std::chrono::steady_clock::now() + duration;
-
-          break;
-        }
-      }
-
-      if (it == _timer_tasks.cend()) {
+      auto slot = find(task_id);
+      if (!slot || slot->heap_index == _handed_over) {
         return;
       }
 
-      // smaller time goes to the back
-      auto prev = it - 1;
-      while (it > _timer_tasks.cbegin()) {
-        if (std::get<0>(*it) > std::get<0>(*prev)) {
-          std::swap(*it, *prev);
-        }
+      auto index = slot->heap_index;
+      _timer_heap[index].time = time_point_after(duration);
 
-        --prev;
-        --it;
-      }
+      sift_up(index);
+      sift_down(slot->heap_index);
     }
 
     bool
     cancel(task_id_t task_id) {
-      std::lock_guard lg(_task_mutex);
-
-      auto it = _timer_tasks.begin();
-      for (; it < _timer_tasks.cend(); ++it) {
-        const __task &task = std::get<1>(*it);
-
-        if (&*task == task_id) {
-          _timer_tasks.erase(it);
-
-          return true;
-        }
-      }
-
-      return false;
+      // The task is destroyed without holding the lock, its destructor may push tasks of its own
+      return pop(task_id).has_value();
     }
 
     std::optional<std::pair<__time_point, __task>>
     pop(task_id_t task_id) {
-      std::lock_guard lg(_task_mutex);
+      std::shared_ptr<executor_t> executor;
 
-      auto pos = std::find_if(std::begin(_timer_tasks), std::end(_timer_tasks), [&task_id](const auto &t) { return t.second.get() == task_id; });
+      std::lock_guard lg(_task_mutex);
 
-      if (pos == std::end(_timer_tasks)) {
+      auto slot = find(task_id);
+      if (!slot) {
         return std::nullopt;
       }
 
-      return std::move(*pos);
+      executor = std::move(slot->executor);
+      if (slot->heap_index == _handed_over) {
+        return std::pair { std::chrono::steady_clock::now(), release(task_id) };
+      }
+
+      return take(slot->heap_index);
     }
 
     std::optional<__task>
@@ -225,10 +388,24 @@ namespace task_pool_util {
         return task;
       }
 
-      if (!_timer_tasks.empty() && std::get<0>(_timer_tasks.back()) <= std::chrono::steady_clock::now()) {
-        __task task = std::move(std::get<1>(_timer_tasks.back()));
-        _timer_tasks.pop_back();
-        return task;
+      if (!_timer_heap.empty() && _timer_heap.front().time <= std::chrono::steady_clock::now()) {
+        auto &slot = _timer_slots[_timer_heap.front().slot];
+        if (!slot.executor) {
+          return std::move(take(0).second);
+        }
+
+        // The task stays in its slot until the executor gets to it, so it can still be canceled
+        auto task_id = id_of(_timer_heap.front().slot);
+        unlink(0);
+        slot.heap_index = _handed_over;
+
+        return __task { [this, executor = slot.executor, task_id]() {
+          executor->execute([this, task_id]() {
+            if (auto task = claim(task_id)) {
+              task->run();
+            }
+          });
+        } };
       }
 
       return std::nullopt;
@@ -238,25 +415,205 @@ namespace task_pool_util {
     ready() {
       std::lock_guard<std::mutex> lg(_task_mutex);
 
-      return !_tasks.empty() || (!_timer_tasks.empty() && std::get<0>(_timer_tasks.back()) <= std::chrono::steady_clock::now());
+      return !_tasks.empty() || (!_timer_heap.empty() && _timer_heap.front().time <= std::chrono::steady_clock::now());
     }
 
     std::optional<__time_point>
     next() {
       std::lock_guard<std::mutex> lg(_task_mutex);
 
-      if (_timer_tasks.empty()) {
+      if (_timer_heap.empty()) {
         return std::nullopt;
       }
 
-      return std::get<0>(_timer_tasks.back());
+      return _timer_heap.front().time;
     }
 
-  private:
-    template <class Function>
-    std::unique_ptr<_ImplBase>
-    toRunnable(Function &&f) {
-      return std::make_unique<_Impl<Function>>(std::forward<Function &&>(f));
+    /**
+     * @brief Bind the arguments to a function, they are moved into it when it runs.
+     */
+    template <class Function, class... Args>
+    static auto
+    bind(Function &&newTask, Args &&...args) {
+      return [task = std::forward<Function>(newTask), tuple_args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        return std::apply(task, std::move(tuple_args));
+      };
+    }
+
+  protected:
+    template <class X, class Y>
+    static __time_point
+    time_point_after(std::chrono::duration<X, Y> duration) {
+      if constexpr (std::is_floating_point_v<X>) {
+        return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+      }
+      else {
+        return std::chrono::steady_clock::now() + duration;
+      }
+    }
+
+    /**
+     * @brief Add a task to the timer heap, the caller must hold `_task_mutex`.
+     */
+    task_id_t
+    schedule(__time_point time, __task &&task, std::shared_ptr<executor_t> executor) {
+      std::uint32_t index;
+      if (_free_slots.empty()) {
+        index = (std::uint32_t) _timer_slots.size();
+        _timer_slots.emplace_back();
+      }
+      else {
+        index = _free_slots.back();
+        _free_slots.pop_back();
+      }
+
+      auto &slot = _timer_slots[index];
+      slot.task = std::move(task);
+      slot.executor = std::move(executor);
+
+      // Generation 0 is skipped when it wraps around, so no id is ever 0 or 1
+      slot.generation = (slot.generation + 1) & (~std::uintptr_t { 0 } >> _slot_bits);
+      if (!slot.generation) {
+        slot.generation = 1;
+      }
+
+      _timer_heap.emplace_back(_timer_t { time, index });
+      slot.heap_index = _timer_heap.size() - 1;
+      sift_up(slot.heap_index);
+
+      return id_of(index);
+    }
+
+    task_id_t
+    id_of(std::uint32_t index) const {
+      return reinterpret_cast<task_id_t>(_timer_slots[index].generation << _slot_bits | index);
+    }
+
+    /**
+     * @brief Take a due task out of its slot once its executor gets to it.
+     * @return The task, unless it was canceled in the meantime.
+     */
+    std::optional<__task>
+    claim(task_id_t task_id) {
+      std::shared_ptr<executor_t> executor;
+
+      std::lock_guard lg(_task_mutex);
+
+      auto slot = find(task_id);
+      if (!slot || slot->heap_index != _handed_over) {
+        return std::nullopt;
+      }
+
+      executor = std::move(slot->executor);
+      return release(task_id);
+    }
+
+    /**
+     * @brief Find the slot of a task that hasn't run yet, the caller must hold `_task_mutex`.
+     */
+    _slot_t *
+    find(task_id_t task_id) {
+      auto id = reinterpret_cast<std::uintptr_t>(task_id);
+      auto index = id & _slot_mask;
+
+      if (index >= _timer_slots.size()) {
+        return nullptr;
+      }
+
+      auto &slot = _timer_slots[index];
+      if (!slot.task || slot.generation != id >> _slot_bits) {
+        return nullptr;
+      }
+
+      return &slot;
+    }
+
+    /**
+     * @brief Remove a task from the timer heap and free its slot, the caller must hold `_task_mutex`.
+     */
+    std::pair<__time_point, __task>
+    take(std::size_t heap_index) {
+      auto timer = unlink(heap_index);
+
+      _free_slots.emplace_back(timer.slot);
+      return { timer.time, std::move(_timer_slots[timer.slot].task) };
+    }
+
+    /**
+     * @brief Free the slot of a task that was handed over to its executor, the caller must hold `_task_mutex`.
+     */
+    __task
+    release(task_id_t task_id) {
+      auto index = (std::uint32_t) (reinterpret_cast<std::uintptr_t>(task_id) & _slot_mask);
+
+      _free_slots.emplace_back(index);
+      return std::move(_timer_slots[index].task);
+    }
+
+    /**
+     * @brief Remove a task from the timer heap, but keep its slot, the caller must hold `_task_mutex`.
+     */
+    _timer_t
+    unlink(std::size_t heap_index) {
+      auto timer = _timer_heap[heap_index];
+
+      auto last = _timer_heap.back();
+      _timer_heap.pop_back();
+      if (heap_index < _timer_heap.size()) {
+        place(heap_index, last);
+        sift_up(heap_index);
+        sift_down(_timer_slots[last.slot].heap_index);
+      }
+
+      return timer;
+    }
+
+    void
+    place(std::size_t heap_index, const _timer_t &timer) {
+      _timer_heap[heap_index] = timer;
+      _timer_slots[timer.slot].heap_index = heap_index;
+    }
+
+    void
+    sift_up(std::size_t heap_index) {
+      auto timer = _timer_heap[heap_index];
+
+      while (heap_index > 0) {
+        auto parent = (heap_index - 1) / 2;
+        if (!(timer.time < _timer_heap[parent].time)) {
+          break;
+        }
+
+        place(heap_index, _timer_heap[parent]);
+        heap_index = parent;
+      }
+
+      place(heap_index, timer);
+    }
+
+    void
+    sift_down(std::size_t heap_index) {
+      auto timer = _timer_heap[heap_index];
+
+      while (true) {
+        auto child = heap_index * 2 + 1;
+        if (child >= _timer_heap.size()) {
+          break;
+        }
+
+        if (child + 1 < _timer_heap.size() && _timer_heap[child + 1].time < _timer_heap[child].time) {
+          ++child;
+        }
+
+        if (!(_timer_heap[child].time < timer.time)) {
+          break;
+        }
+
+        place(heap_index, _timer_heap[child]);
+        heap_index = child;
+      }
+
+      place(heap_index, timer);
     }
   };
 }  // namespace task_pool_util
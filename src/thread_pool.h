@@ -5,9 +5,132 @@
 #pragma once
 
 #include "task_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <thread>
 
 namespace thread_pool_util {
+  class ThreadPool;
+
+  /**
+   * @brief Runs the tasks posted to it one after the other, in order, on the threads of a pool.
+   * @details Tasks of different strands run in parallel. A task running on a strand that
+   * posts to the pool, posts to its strand instead, delayed tasks included.
+   */
+  class Strand: public task_pool_util::executor_t, public std::enable_shared_from_this<Strand> {
+  public:
+    typedef task_pool_util::task_t __task;
+    typedef task_pool_util::TaskPool::task_id_t task_id_t;
+    typedef std::chrono::steady_clock::time_point __time_point;
+
+    struct stats_t {
+      std::size_t queued;  ///< Tasks waiting to run right now
+      std::size_t max_queued;  ///< The most tasks that waited at once
+      std::uint64_t tasks;  ///< Tasks that ran
+      std::chrono::nanoseconds total_wait;  ///< Time the tasks spent in the queue
+      std::chrono::nanoseconds max_wait;
+      std::chrono::nanoseconds total_run;  ///< Time the tasks took to run
+      std::chrono::nanoseconds max_run;
+    };
+
+    /**
+     * @brief The number of tasks a thread of the pool runs before it gives other strands a turn.
+     */
+    static constexpr int batch_size = 16;
+
+    explicit Strand(ThreadPool &pool):
+        _pool { pool } {}
+
+    template <class Function, class... Args>
+    void
+    post(Function &&newTask, Args &&...args) {
+      static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
+
+      execute(__task { task_pool_util::TaskPool::bind(std::forward<Function>(newTask), std::forward<Args>(args)...) });
+    }
+
+    void
+    execute(__task &&task) override;
+
+    /**
+     * @brief Delay a task that runs on this strand, no matter which thread posts it.
+     * @details A task that cancels or reposts it from this strand never runs at the same time as it.
+     * @return An id to cancel the task with.
+     */
+    template <class Function, class X, class Y, class... Args>
+    task_id_t
+    postDelayed(Function &&newTask, std::chrono::duration<X, Y> duration, Args &&...args);
+
+    /**
+     * @brief Cancel a delayed task of this strand.
+     * @return `true` if the task hadn't started running yet.
+     */
+    bool
+    cancel(task_id_t task_id);
+
+    /**
+     * @brief Run a task on this strand and wait until it ran.
+     * @details Called from this strand, the task runs right away instead of waiting for itself.
+     */
+    template <class Function>
+    void
+    run_and_wait(Function &&task) {
+      if (_current == this) {
+        task();
+
+        return;
+      }
+
+      std::promise<void> done;
+      post([&]() {
+        task();
+        done.set_value();
+      });
+
+      done.get_future().wait();
+    }
+
+    stats_t
+    stats() {
+      std::lock_guard lg(_lock);
+
+      auto stats = _stats;
+      stats.queued = _queue.size();
+
+      return stats;
+    }
+
+    ThreadPool &
+    pool() const {
+      return _pool;
+    }
+
+    /**
+     * @return The strand whose task runs on this thread, if any.
+     */
+    static Strand *
+    current() {
+      return _current;
+    }
+
+  private:
+    void
+    run();
+
+    ThreadPool &_pool;
+
+    std::mutex _lock;
+    std::deque<std::pair<__time_point, __task>> _queue;
+
+    // True while a thread of the pool runs the queue, or is about to
+    bool _running = false;
+
+    stats_t _stats {};
+
+    static inline thread_local Strand *_current = nullptr;
+  };
+
   /**
    * Allow threads to execute unhindered while keeping full control over the threads.
    */
@@ -16,12 +139,14 @@ namespace thread_pool_util {
     typedef TaskPool::__task __task;
 
   private:
+    friend class Strand;
+
     std::vector<std::thread> _thread;
 
     std::condition_variable _cv;
     std::mutex _lock;
 
-    bool _continue;
+    std::atomic<bool> _continue;
 
   public:
     ThreadPool():
@@ -44,29 +169,88 @@ namespace thread_pool_util {
     template <class Function, class... Args>
     auto
     push(Function &&newTask, Args &&...args) {
-      std::lock_guard lg(_lock);
-      auto future = TaskPool::push(std::forward<Function>(newTask), std::forward<Args>(args)...);
+      static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
+
+      using __return = std::invoke_result_t<Function, Args &&...>;
+      using task_t = std::packaged_task<__return()>;
+
+      task_t task(bind(std::forward<Function>(newTask), std::forward<Args>(args)...));
+
+      auto future = task.get_future();
+      dispatch(__task { std::move(task) });
 
-      _cv.notify_one();
       return future;
     }
 
+    template <class Function, class... Args>
     void
+    post(Function &&newTask, Args &&...args) {
+      static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
+
+      dispatch(__task { bind(std::forward<Function>(newTask), std::forward<Args>(args)...) });
+    }
+
+    task_id_t
     pushDelayed(std::pair<__time_point, __task> &&task) {
       std::lock_guard lg(_lock);
 
-      TaskPool::pushDelayed(std::move(task));
+      task_id_t task_id;
+      if (auto strand = current_strand()) {
+        task_id = TaskPool::pushDelayed(std::move(task), strand->shared_from_this());
+      }
+      else {
+        task_id = TaskPool::pushDelayed(std::move(task));
+      }
+
+      // Update all timers for wait_until
+      _cv.notify_all();
+      return task_id;
+    }
+
+    /**
+     * @brief Delay a task that runs on `strand` instead of the pool.
+     */
+    task_id_t
+    pushDelayed(std::pair<__time_point, __task> &&task, std::shared_ptr<Strand> strand) {
+      std::lock_guard lg(_lock);
+
+      auto task_id = TaskPool::pushDelayed(std::move(task), std::move(strand));
+
+      // Update all timers for wait_until
+      _cv.notify_all();
+      return task_id;
     }
 
     template <class Function, class X, class Y, class... Args>
     auto
     pushDelayed(Function &&newTask, std::chrono::duration<X, Y> duration, Args &&...args) {
-      std::lock_guard lg(_lock);
-      auto future = TaskPool::pushDelayed(std::forward<Function>(newTask), duration, std::forward<Args>(args)...);
+      static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
 
-      // Update all timers for wait_until
-      _cv.notify_all();
-      return future;
+      using __return = std::invoke_result_t<Function, Args &&...>;
+      using task_t = std::packaged_task<__return()>;
+
+      task_t task(bind(std::forward<Function>(newTask), std::forward<Args>(args)...));
+
+      auto future = task.get_future();
+      auto task_id = pushDelayed(std::pair { time_point_after(duration), __task { std::move(task) } });
+
+      return timer_task_t<__return> { task_id, future };
+    }
+
+    template <class Function, class X, class Y, class... Args>
+    task_id_t
+    postDelayed(Function &&newTask, std::chrono::duration<X, Y> duration, Args &&...args) {
+      static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
+
+      return pushDelayed(std::pair { time_point_after(duration), __task { bind(std::forward<Function>(newTask), std::forward<Args>(args)...) } });
+    }
+
+    /**
+     * @brief Create a strand whose tasks run in order on the threads of this pool.
+     */
+    std::shared_ptr<Strand>
+    strand() {
+      return std::make_shared<Strand>(*this);
     }
 
     void
@@ -95,12 +279,48 @@ namespace thread_pool_util {
       }
     }
 
+  private:
+    /**
+     * @return The strand of this pool whose task runs on this thread, if any.
+     */
+    Strand *
+    current_strand() {
+      auto strand = Strand::current();
+
+      return strand && &strand->pool() == this ? strand : nullptr;
+    }
+
+    /**
+     * @brief Queue a task on the strand that runs on this thread, or on the pool otherwise.
+     */
+    void
+    dispatch(__task &&task) {
+      if (auto strand = current_strand()) {
+        strand->execute(std::move(task));
+
+        return;
+      }
+
+      enqueue(std::move(task));
+    }
+
+    /**
+     * @brief Queue a task on the pool itself.
+     */
+    void
+    enqueue(__task &&task) {
+      std::lock_guard lg(_lock);
+      TaskPool::post(std::move(task));
+
+      _cv.notify_one();
+    }
+
   public:
     void
     _main() {
       while (_continue) {
         if (auto task = this->pop()) {
-          (*task)->run();
+          task->run();
         }
         else {
           std::unique_lock uniq_lock(_lock);
@@ -124,8 +344,85 @@ namespace thread_pool_util {
 
       // Execute remaining tasks
       while (auto task = this->pop()) {
-        (*task)->run();
+        task->run();
       }
     }
   };
+
+  inline void
+  Strand::execute(__task &&task) {
+    {
+      std::lock_guard lg(_lock);
+
+      _queue.emplace_back(std::chrono::steady_clock::now(), std::move(task));
+      _stats.max_queued = std::max(_stats.max_queued, _queue.size());
+
+      if (std::exchange(_running, true)) {
+        return;
+      }
+    }
+
+    _pool.enqueue([strand = shared_from_this()]() {
+      strand->run();
+    });
+  }
+
+  template <class Function, class X, class Y, class... Args>
+  Strand::task_id_t
+  Strand::postDelayed(Function &&newTask, std::chrono::duration<X, Y> duration, Args &&...args) {
+    static_assert(std::is_invocable_v<Function, Args &&...>, "arguments don't match the function");
+
+    return _pool.pushDelayed(
+      std::pair { ThreadPool::time_point_after(duration), __task { task_pool_util::TaskPool::bind(std::forward<Function>(newTask), std::forward<Args>(args)...) } },
+      shared_from_this());
+  }
+
+  inline bool
+  Strand::cancel(task_id_t task_id) {
+    return _pool.cancel(task_id);
+  }
+
+  inline void
+  Strand::run() {
+    auto previous = std::exchange(_current, this);
+    auto restore = util::fail_guard([previous]() {
+      _current = previous;
+    });
+
+    std::unique_lock ul(_lock);
+    for (int x = 0; x < batch_size && !_queue.empty(); ++x) {
+      auto [queued_at, task] = std::move(_queue.front());
+      _queue.pop_front();
+      ul.unlock();
+
+      auto start = std::chrono::steady_clock::now();
+      task.run();
+      auto end = std::chrono::steady_clock::now();
+
+      // The task is destroyed without holding the lock, its destructor may post tasks of its own
+      task = __task {};
+
+      ul.lock();
+      auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(start - queued_at);
+      auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+
+      ++_stats.tasks;
+      _stats.total_wait += wait;
+      _stats.max_wait = std::max(_stats.max_wait, wait);
+      _stats.total_run += duration;
+      _stats.max_run = std::max(_stats.max_run, duration);
+    }
+
+    if (_queue.empty()) {
+      _running = false;
+
+      return;
+    }
+
+    // Let the tasks of other strands run before the rest of this one
+    ul.unlock();
+    _pool.enqueue([strand = shared_from_this()]() {
+      strand->run();
+    });
+  }
 }  // namespace thread_pool_util
@@ -360,6 +360,89 @@ namespace safe {
     std::vector<T> _queue;
   };
 
+  /**
+   * @brief A lock-free, bounded stash of objects that are expensive to create, for reuse.
+   * @details Any thread may put objects back and take them out. The stash never allocates,
+   * objects that don't fit are left to the caller to destroy.
+   */
+  template <class T, std::size_t N = 16>
+  class recycler_t {
+  public:
+    recycler_t() = default;
+
+    recycler_t(const recycler_t &) = delete;
+    recycler_t &
+    operator=(const recycler_t &) = delete;
+
+    ~recycler_t() {
+      for (auto &slot : _slots) {
+        delete slot.exchange(nullptr);
+      }
+    }
+
+    /**
+     * @brief Take an object out of the stash.
+     * @return An object that was put back, or `nullptr` if the stash is empty.
+     */
+    T *
+    take() {
+      for (auto &slot : _slots) {
+        if (!slot.load(std::memory_order_relaxed)) {
+          continue;
+        }
+
+        if (auto object = slot.exchange(nullptr, std::memory_order_acquire)) {
+          _hits.fetch_add(1, std::memory_order_relaxed);
+
+          return object;
+        }
+      }
+
+      _misses.fetch_add(1, std::memory_order_relaxed);
+
+      return nullptr;
+    }
+
+    /**
+     * @brief Put an object back into the stash.
+     * @param object The object, owned by the stash if it fits.
+     * @return `true` if the object was stashed, `false` if the stash is full.
+     */
+    bool
+    put(T *object) {
+      for (auto &slot : _slots) {
+        T *empty = nullptr;
+        if (slot.compare_exchange_strong(empty, object, std::memory_order_release, std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    /**
+     * @brief Get the number of times `take()` returned a stashed object.
+     */
+    std::uint64_t
+    hits() const {
+      return _hits.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the number of times `take()` found the stash empty.
+     */
+    std::uint64_t
+    misses() const {
+      return _misses.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::array<std::atomic<T *>, N> _slots {};
+
+    std::atomic<std::uint64_t> _hits {};
+    std::atomic<std::uint64_t> _misses {};
+  };
+
   template <class T>
   class shared_t {
   public:
@@ -20,6 +20,8 @@ extern "C" {
 #include "cbs.h"
 #include "config.h"
 #include "display_device.h"
+#include "encode_scheduler.h"
+#include "frame_deadline.h"
 #include "globals.h"
 #include "input.h"
 #include "logging.h"
@@ -52,6 +54,11 @@ namespace video {
     av_buffer_unref(&ref);
   }
 
+  void
+  free_packet(AVPacket *packet) {
+    av_packet_free(&packet);
+  }
+
   namespace nv {
 
     enum class profile_h264_e : int {
@@ -305,6 +312,8 @@ namespace video {
       replacements = std::move(other.replacements);
       sps = std::move(other.sps);
       vps = std::move(other.vps);
+      received = std::move(other.received);
+      packet_pool = std::move(other.packet_pool);
 
       inject = other.inject;
 
@@ -341,6 +350,47 @@ namespace video {
       request_idr_frame();
     }
 
+    bool
+    set_bitrate(int bitrate_kbps) override {
+      // These FFmpeg wrappers compare the rate control fields against their last values
+      // before each frame and reconfigure the encoder in place, the others only read them once
+      static const std::array<std::string_view, 7> live_reconfig_codecs {
+        "libx264"sv,
+        "h264_nvenc"sv,
+        "hevc_nvenc"sv,
+        "av1_nvenc"sv,
+        "h264_qsv"sv,
+        "hevc_qsv"sv,
+        "av1_qsv"sv,
+      };
+
+      auto ctx = avcodec_ctx.get();
+      if (!ctx || !ctx->codec || !ctx->rc_max_rate ||
+          std::find(std::begin(live_reconfig_codecs), std::end(live_reconfig_codecs), ctx->codec->name) == std::end(live_reconfig_codecs)) {
+        return false;
+      }
+
+      std::int64_t bitrate = (std::int64_t) bitrate_kbps * 1000;
+
+      // Keep the rate control mode and the buffer length in frames we opened the encoder with
+      auto cbr_with_vbr = ctx->bit_rate != ctx->rc_max_rate;
+      if (ctx->rc_buffer_size) {
+        ctx->rc_buffer_size = (int) (ctx->rc_buffer_size * bitrate / ctx->rc_max_rate);
+      }
+      if (ctx->rc_min_rate) {
+        ctx->rc_min_rate = bitrate;
+      }
+      ctx->rc_max_rate = bitrate;
+      ctx->bit_rate = cbr_with_vbr ? bitrate - 1 : bitrate;
+
+      return true;
+    }
+
+    packet_pool_stats_t
+    packet_pool_stats() const override {
+      return { packet_pool->hits(), packet_pool->misses() };
+    }
+
     avcodec_ctx_t avcodec_ctx;
     std::unique_ptr<platf::avcodec_encode_device_t> device;
 
@@ -351,6 +401,10 @@ namespace video {
 
     // inject sps/vps data into idr pictures
     int inject;
+
+    // The encoder returns each packet here first, so only packets that hold a frame come from the pool
+    avcodec_packet_t received { av_packet_alloc() };
+    std::shared_ptr<packet_raw_avcodec::pool_t> packet_pool = std::make_shared<packet_raw_avcodec::pool_t>();
   };
 
   class nvenc_encode_session_t: public encode_session_t {
@@ -384,15 +438,29 @@ namespace video {
       }
     }
 
+    bool
+    set_bitrate(int bitrate_kbps) override {
+      if (!device || !device->nvenc) return false;
+
+      return device->nvenc->set_bitrate(bitrate_kbps);
+    }
+
     nvenc::nvenc_encoded_frame
-    encode_frame(uint64_t frame_index) {
+    encode_frame(uint64_t frame_index, std::vector<uint8_t> &&buffer) {
       if (!device || !device->nvenc) return {};
 
-      auto result = device->nvenc->encode_frame(frame_index, force_idr);
+      auto result = device->nvenc->encode_frame(frame_index, force_idr, std::move(buffer));
       force_idr = false;
       return result;
     }
 
+    packet_pool_stats_t
+    packet_pool_stats() const override {
+      return { packet_pool->hits(), packet_pool->misses() };
+    }
+
+    std::shared_ptr<packet_raw_generic::pool_t> packet_pool = std::make_shared<packet_raw_generic::pool_t>();
+
   private:
     std::unique_ptr<platf::nvenc_encode_device_t> device;
     bool force_idr = false;
@@ -1206,10 +1274,15 @@ namespace video {
     // Capture takes place on this thread
     platf::adjust_thread_priority(platf::thread_priority_e::critical);
 
+    std::uint64_t capture_nr = 0;
     while (capture_ctx_queue->running()) {
       bool artificial_reinit = false;
 
       auto push_captured_image_callback = [&](std::shared_ptr<platf::img_t> &&img, bool frame_captured) -> bool {
+        if (frame_captured) {
+          img->capture_nr = ++capture_nr;
+        }
+
         KITTY_WHILE_LOOP(auto capture_ctx = std::begin(capture_ctxs), capture_ctx != std::end(capture_ctxs), {
           if (!capture_ctx->images->running()) {
             capture_ctx = capture_ctxs.erase(capture_ctx);
@@ -1322,6 +1395,52 @@ namespace video {
     }
   }
 
+  packet_ptr_t<packet_raw_avcodec>
+  packet_raw_avcodec::make(const std::shared_ptr<pool_t> &pool) {
+    auto packet = pool->take();
+    if (!packet) {
+      packet = new packet_raw_avcodec;
+    }
+
+    packet->pool = pool;
+    return packet_ptr_t<packet_raw_avcodec> { packet };
+  }
+
+  void
+  packet_raw_avcodec::recycle() {
+    av_packet_unref(av_packet);
+    reset();
+
+    // The last packet of a finished session takes its pool down with it
+    auto pool = std::move(this->pool);
+    if (!pool || !pool->put(this)) {
+      delete this;
+    }
+  }
+
+  packet_ptr_t<packet_raw_generic>
+  packet_raw_generic::make(const std::shared_ptr<pool_t> &pool) {
+    auto packet = pool->take();
+    if (!packet) {
+      packet = new packet_raw_generic;
+    }
+
+    packet->pool = pool;
+    return packet_ptr_t<packet_raw_generic> { packet };
+  }
+
+  void
+  packet_raw_generic::recycle() {
+    frame_data.clear();
+    reset();
+
+    // The last packet of a finished session takes its pool down with it
+    auto pool = std::move(this->pool);
+    if (!pool || !pool->put(this)) {
+      delete this;
+    }
+  }
+
   int
   encode_avcodec(int64_t frame_nr, avcodec_encode_session_t &session, safe::mail_raw_t::queue_t<packet_t> &packets, void *channel_data, std::optional<std::chrono::steady_clock::time_point> frame_timestamp) {
     auto &frame = session.device->frame;
@@ -1342,10 +1461,7 @@ namespace video {
     }
 
     while (ret >= 0) {
-      auto packet = std::make_unique<packet_raw_avcodec>();
-      auto av_packet = packet.get()->av_packet;
-
-      ret = avcodec_receive_packet(ctx.get(), av_packet);
+      ret = avcodec_receive_packet(ctx.get(), session.received.get());
       if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
         return 0;
       }
@@ -1353,6 +1469,11 @@ namespace video {
         return ret;
       }
 
+      // Only take a packet from the pool once there is something to put in it
+      auto packet = packet_raw_avcodec::make(session.packet_pool);
+      auto av_packet = packet->av_packet;
+      av_packet_move_ref(av_packet, session.received.get());
+
       if (av_packet->flags & AV_PKT_FLAG_KEY) {
         BOOST_LOG(debug) << "Frame "sv << frame_nr << ": IDR Keyframe (AV_FRAME_FLAG_KEY)"sv;
       }
@@ -1391,6 +1512,7 @@ namespace video {
 
       packet->replacements = &session.replacements;
       packet->channel_data = channel_data;
+      packet->encoded_timestamp = std::chrono::steady_clock::now();
       packets->raise(std::move(packet));
     }
 
@@ -1399,7 +1521,10 @@ namespace video {
 
   int
   encode_nvenc(int64_t frame_nr, nvenc_encode_session_t &session, safe::mail_raw_t::queue_t<packet_t> &packets, void *channel_data, std::optional<std::chrono::steady_clock::time_point> frame_timestamp) {
-    auto encoded_frame = session.encode_frame(frame_nr);
+    // The frame is copied into the buffer of a recycled packet
+    auto packet = packet_raw_generic::make(session.packet_pool);
+
+    auto encoded_frame = session.encode_frame(frame_nr, std::move(packet->frame_data));
     if (encoded_frame.data.empty()) {
       BOOST_LOG(error) << "NvENC returned empty packet";
       return -1;
@@ -1409,10 +1534,13 @@ namespace video {
       BOOST_LOG(error) << "NvENC frame index mismatch " << frame_nr << " " << encoded_frame.frame_index;
     }
 
-    auto packet = std::make_unique<packet_raw_generic>(std::move(encoded_frame.data), encoded_frame.frame_index, encoded_frame.idr);
+    packet->frame_data = std::move(encoded_frame.data);
+    packet->index = encoded_frame.frame_index;
+    packet->idr = encoded_frame.idr;
     packet->channel_data = channel_data;
     packet->after_ref_frame_invalidation = encoded_frame.after_ref_frame_invalidation;
     packet->frame_timestamp = frame_timestamp;
+    packet->encoded_timestamp = std::chrono::steady_clock::now();
     packets->raise(std::move(packet));
 
     return 0;
@@ -1462,6 +1590,11 @@ namespace video {
       return nullptr;
     }
 
+    // FFmpeg can't start a wave of intra refresh on demand, only native NVENC repairs lost frames with one
+    if (config::video.recovery_mode == "intra_refresh"sv) {
+      BOOST_LOG(info) << video_format.name << ": intra refresh isn't supported, recovering from lost frames with IDR frames"sv;
+    }
+
     auto colorspace = encode_device->colorspace;
     auto sw_fmt = (colorspace.bit_depth == 8 && config.chromaSamplingType == 0)  ? platform_formats->avcodec_pix_fmt_8bit :
                   (colorspace.bit_depth == 8 && config.chromaSamplingType == 1)  ? platform_formats->avcodec_pix_fmt_yuv444_8bit :
@@ -1603,7 +1736,12 @@ namespace video {
         // Clients will request for the fewest slices per frame to get the
         // most efficient encode, but we may want to provide more slices than
         // requested to ensure we have enough parallelism for good performance.
-        ctx->slices = std::max(config.slicesPerFrame, config::video.min_threads);
+        // Slices beyond this session's share of the CPUs can't be encoded in parallel though.
+        auto min_threads = config::video.min_threads;
+        if (auto budget = scheduler::thread_budget()) {
+          min_threads = std::min(min_threads, budget);
+        }
+        ctx->slices = std::max(config.slicesPerFrame, min_threads);
       }
 
       if (encoder.flags & SINGLE_SLICE_ONLY) {
@@ -1679,6 +1817,13 @@ namespace video {
         }
       }
 
+      // x265 sizes its thread pool for the whole host, unless told otherwise
+      if (auto budget = scheduler::thread_budget(); !hardware && budget && video_format.name == "libx265"sv) {
+        auto params = av_dict_get(options, "x265-params", nullptr, 0);
+        auto pools = (params ? params->value + ":"s : ""s) + "pools="s + std::to_string(budget);
+        av_dict_set(&options, "x265-params", pools.c_str(), 0);
+      }
+
       // Allow the encoding device a final opportunity to set/unset or override any options
       encode_device->init_codec_options(ctx.get(), &options);
 
@@ -1810,12 +1955,18 @@ namespace video {
     int &frame_nr,  // Store progress of the frame number
     safe::mail_t mail,
     img_event_t images,
-    config_t config,
+    config_t &config,
     std::shared_ptr<platf::display_t> disp,
     std::unique_ptr<platf::encode_device_t> encode_device,
     safe::signal_t &reinit_event,
     const encoder_t &encoder,
-    void *channel_data) {
+    void *channel_data,
+    scheduler::slot_t *slot) {
+    // The encoder's threads inherit the CPUs of this thread
+    if (slot) {
+      slot->apply();
+    }
+
     auto session = make_encode_session(disp.get(), encoder, config, disp->width, disp->height, std::move(encode_device));
     if (!session) {
       return;
@@ -1825,10 +1976,33 @@ namespace video {
     auto minimum_frame_time = std::chrono::milliseconds(1000 / std::min(config.framerate, (config::video.min_fps_factor * 10)));
     BOOST_LOG(debug) << "Minimum frame time set to "sv << minimum_frame_time.count() << "ms, based on min fps factor of "sv << config::video.min_fps_factor << "."sv;
 
+    // A frame has to be encoded before the next one is captured
+    auto frame_interval = std::chrono::nanoseconds { 1s } / config.framerate;
+
     auto shutdown_event = mail->event<bool>(mail::shutdown);
     auto packets = mail::man->queue<packet_t>(mail::video_packets);
     auto idr_events = mail->event<bool>(mail::idr);
     auto invalidate_ref_frames_events = mail->event<std::pair<int64_t, int64_t>>(mail::invalidate_ref_frames);
+    auto bitrate_events = mail->event<int>(mail::bitrate);
+
+    // Encoders that can't change their bitrate in place are only recreated for changes of at least this percentage
+    constexpr int MIN_REINIT_BITRATE_CHANGE = 20;
+
+    deadline::policy_t frame_deadline { frame_interval };
+    auto last_deadline_report = std::chrono::steady_clock::now();
+    auto report_deadlines = [&]() {
+      auto &stats = frame_deadline.stats();
+      if (stats.on_time || stats.late || stats.skipped) {
+        BOOST_LOG(debug) << "Captures encoded on time: "sv << stats.on_time << ", late: "sv << stats.late << ", skipped: "sv << stats.skipped;
+      }
+
+      auto packet_stats = session->packet_pool_stats();
+      BOOST_LOG(debug) << "Encoded packets reused: "sv << packet_stats.hits << ", allocated: "sv << packet_stats.misses;
+
+      frame_deadline.reset_stats();
+      last_deadline_report = std::chrono::steady_clock::now();
+    };
+    auto report_deadlines_guard = util::fail_guard(report_deadlines);
 
     {
       // Load a dummy image into the AVFrame to ensure we have something to encode
@@ -1841,6 +2015,16 @@ namespace video {
       }
     }
 
+    // Display capture and the encoder are ready, but the client may still be finishing the RTSP
+    // handshake. Hold back encoding until it's ready to receive video, the image event keeps only
+    // the newest capture in the meantime.
+    auto video_start_event = mail->event<std::chrono::steady_clock::time_point>(mail::video_start);
+    while (!video_start_event->view(100ms)) {
+      if (shutdown_event->peek() || !images->running() || reinit_event.peek()) {
+        return;
+      }
+    }
+
     while (true) {
       // Break out of the encoding loop if any of the following are true:
       // a) The stream is ending
@@ -1866,16 +2050,48 @@ namespace video {
         idr_events->pop();
       }
 
+      if (slot && slot->moved()) {
+        BOOST_LOG(info) << "Recreating the encoder to move it to its new share of the CPUs"sv;
+        return;
+      }
+
+      if (bitrate_events->peek()) {
+        auto bitrate = *bitrate_events->pop();
+        if (session->set_bitrate(bitrate)) {
+          BOOST_LOG(debug) << "Encoder bitrate changed to "sv << bitrate << " Kbps"sv;
+          config.bitrate = bitrate;
+        }
+        else if (std::abs(bitrate - config.bitrate) * 100 >= config.bitrate * MIN_REINIT_BITRATE_CHANGE) {
+          BOOST_LOG(info) << "Recreating the encoder for a bitrate of "sv << bitrate << " Kbps"sv;
+          config.bitrate = bitrate;
+          return;
+        }
+      }
+
       if (requested_idr_frame) {
         session->request_idr_frame();
       }
 
       std::optional<std::chrono::steady_clock::time_point> frame_timestamp;
+      std::chrono::steady_clock::time_point encode_start;
+      std::uint64_t capture_nr = 0;
 
-      // Encode at a minimum FPS to avoid image quality issues with static content
+      // Encode at a minimum FPS to avoid image quality issues with static content.
+      // The image event only holds the newest capture, older ones went back to the capture pool.
       if (!requested_idr_frame || images->peek()) {
         if (auto img = images->pop(minimum_frame_time)) {
+          encode_start = std::chrono::steady_clock::now();
+
+          // Don't spend an encode on a capture that will be late anyway if the next one is due
+          if (frame_deadline.admit(img->frame_timestamp, encode_start) == deadline::decision_e::wait_for_newer) {
+            if (auto newer = images->pop(frame_deadline.grace())) {
+              img = std::move(newer);
+              encode_start = std::chrono::steady_clock::now();
+            }
+          }
+
           frame_timestamp = img->frame_timestamp;
+          capture_nr = img->capture_nr;
           if (session->convert(*img)) {
             BOOST_LOG(error) << "Could not convert image"sv;
             return;
@@ -1891,6 +2107,20 @@ namespace video {
         return;
       }
 
+      // Repeated frames aren't converted, only account for new captures
+      if (capture_nr) {
+        auto now = std::chrono::steady_clock::now();
+
+        frame_deadline.encoded(capture_nr, frame_timestamp, encode_start, now);
+        if (now - last_deadline_report >= 10s) {
+          report_deadlines();
+        }
+
+        if (slot) {
+          slot->frame_encoded(now - encode_start, frame_interval);
+        }
+      }
+
       session->request_normal_frame();
     }
   }
@@ -2234,6 +2464,12 @@ namespace video {
     // Encoding takes place on this thread
     platf::adjust_thread_priority(platf::thread_priority_e::high);
 
+    // Software encoders share the host's CPUs with the other software encoded sessions
+    std::shared_ptr<scheduler::slot_t> slot;
+    if (ref->encoder_p == &software) {
+      slot = scheduler::instance().join();
+    }
+
     while (!shutdown_event->peek() && images->running()) {
       // Wait for the main capture event when the display is being reinitialized
       if (ref->reinit_event.peek()) {
@@ -2279,7 +2515,7 @@ namespace video {
         config, display,
         std::move(encode_device),
         ref->reinit_event, *ref->encoder_p,
-        channel_data);
+        channel_data, slot.get());
     }
   }
 
@@ -2295,6 +2531,15 @@ namespace video {
       capture_async(std::move(mail), config, channel_data);
     }
     else {
+      // Synchronous encoders are shared with other sessions, so they can't be brought up ahead of time
+      auto shutdown_event = mail->event<bool>(mail::shutdown);
+      auto video_start_event = mail->event<std::chrono::steady_clock::time_point>(mail::video_start);
+      while (!video_start_event->view(100ms)) {
+        if (shutdown_event->peek()) {
+          return;
+        }
+      }
+
       safe::signal_t join_event;
       auto ref = capture_thread_sync.ref();
       ref->encode_session_ctx_queue.raise(sync_session_ctx_t {
@@ -53,10 +53,13 @@ namespace video {
   free_frame(AVFrame *frame);
   void
   free_buffer(AVBufferRef *ref);
+  void
+  free_packet(AVPacket *packet);
 
   using avcodec_ctx_t = util::safe_ptr<AVCodecContext, free_ctx>;
   using avcodec_frame_t = util::safe_ptr<AVFrame, free_frame>;
   using avcodec_buffer_t = util::safe_ptr<AVBufferRef, free_buffer>;
+  using avcodec_packet_t = util::safe_ptr<AVPacket, free_packet>;
   using sws_t = util::safe_ptr<SwsContext, sws_freeContext>;
   using img_event_t = std::shared_ptr<safe::event_t<std::shared_ptr<platf::img_t>>>;
 
@@ -199,6 +202,14 @@ namespace video {
     uint32_t flags;
   };
 
+  /**
+   * @brief How often encoded packets were reused instead of allocated.
+   */
+  struct packet_pool_stats_t {
+    std::uint64_t hits;
+    std::uint64_t misses;
+  };
+
   struct encode_session_t {
     virtual ~encode_session_t() = default;
 
@@ -213,6 +224,22 @@ namespace video {
 
     virtual void
     invalidate_ref_frames(int64_t first_frame, int64_t last_frame) = 0;
+
+    /**
+     * @brief Change the bitrate of the running encoder.
+     * @param bitrate_kbps The new bitrate in Kbps.
+     * @return `true` if the following frames are encoded at the new bitrate,
+     *         `false` if the encoder has to be recreated for it.
+     */
+    virtual bool
+    set_bitrate(int bitrate_kbps) = 0;
+
+    /**
+     * @brief Get how often the packets of this session were reused instead of allocated.
+     * @return The hits and misses since the session was created.
+     */
+    virtual packet_pool_stats_t
+    packet_pool_stats() const = 0;
   };
 
   // encoders
@@ -260,13 +287,50 @@ namespace video {
           old { std::move(old) }, _new { std::move(_new) } {}
     };
 
+    /**
+     * @brief Release the packet once the broadcast side is done with it.
+     * @details `packet_t` calls this instead of deleting the packet, so packets can be reused.
+     */
+    virtual void
+    recycle() {
+      delete this;
+    }
+
     std::vector<replace_t> *replacements = nullptr;
     void *channel_data = nullptr;
     bool after_ref_frame_invalidation = false;
     std::optional<std::chrono::steady_clock::time_point> frame_timestamp;
+
+    // When the encoder handed the packet over, for the latency until its first packet is sent
+    std::optional<std::chrono::steady_clock::time_point> encoded_timestamp;
+
+  protected:
+    /**
+     * @brief Clear what was set for the last frame, before the packet is reused.
+     */
+    void
+    reset() {
+      replacements = nullptr;
+      channel_data = nullptr;
+      after_ref_frame_invalidation = false;
+      frame_timestamp.reset();
+      encoded_timestamp.reset();
+    }
   };
 
+  struct packet_deleter_t {
+    void
+    operator()(packet_raw_t *packet) const {
+      packet->recycle();
+    }
+  };
+
+  template <class T>
+  using packet_ptr_t = std::unique_ptr<T, packet_deleter_t>;
+
   struct packet_raw_avcodec: packet_raw_t {
+    using pool_t = safe::recycler_t<packet_raw_avcodec>;
+
     packet_raw_avcodec() {
       av_packet = av_packet_alloc();
     }
@@ -275,6 +339,17 @@ namespace video {
       av_packet_free(&this->av_packet);
     }
 
+    /**
+     * @brief Get an empty packet, reusing a recycled one and its `AVPacket` if there is one.
+     * @param pool The pool of the encode session, kept alive until the packet is recycled into it.
+     * @return The packet.
+     */
+    static packet_ptr_t<packet_raw_avcodec>
+    make(const std::shared_ptr<pool_t> &pool);
+
+    void
+    recycle() override;
+
     bool
     is_idr() override {
       return av_packet->flags & AV_PKT_FLAG_KEY;
@@ -296,13 +371,31 @@ namespace video {
     }
 
     AVPacket *av_packet;
+
+    // Packets can outlive their session in the queue of the broadcast thread
+    std::shared_ptr<pool_t> pool;
   };
 
   struct packet_raw_generic: packet_raw_t {
+    using pool_t = safe::recycler_t<packet_raw_generic>;
+
+    packet_raw_generic() = default;
+
     packet_raw_generic(std::vector<uint8_t> &&frame_data, int64_t frame_index, bool idr):
         frame_data { std::move(frame_data) }, index { frame_index }, idr { idr } {
     }
 
+    /**
+     * @brief Get an empty packet, reusing a recycled one and the capacity of its data if there is one.
+     * @param pool The pool of the encode session, kept alive until the packet is recycled into it.
+     * @return The packet.
+     */
+    static packet_ptr_t<packet_raw_generic>
+    make(const std::shared_ptr<pool_t> &pool);
+
+    void
+    recycle() override;
+
     bool
     is_idr() override {
       return idr;
@@ -324,11 +417,14 @@ namespace video {
     }
 
     std::vector<uint8_t> frame_data;
-    int64_t index;
-    bool idr;
+    int64_t index = 0;
+    bool idr = false;
+
+    // Packets can outlive their session in the queue of the broadcast thread
+    std::shared_ptr<pool_t> pool;
   };
 
-  using packet_t = std::unique_ptr<packet_raw_t>;
+  using packet_t = packet_ptr_t<packet_raw_t>;
 
   struct hdr_info_raw_t {
     explicit hdr_info_raw_t(bool enabled):
@@ -0,0 +1,86 @@
+/**
+ * @file src/xml_writer.cpp
+ * @brief Definitions for writing XML responses without building a property tree.
+ */
+// local includes
+#include "xml_writer.h"
+
+using namespace std::literals;
+
+namespace xml {
+  void
+  escape(std::string &out, std::string_view text) {
+    // Text of only spaces gets its first space encoded, so it survives being parsed again
+    if (!text.empty() && text.find_first_not_of(' ') == std::string_view::npos) {
+      out += "&#32;"sv;
+      out.append(text.size() - 1, ' ');
+
+      return;
+    }
+
+    for (auto ch : text) {
+      switch (ch) {
+        case '<':
+          out += "&lt;"sv;
+          break;
+        case '>':
+          out += "&gt;"sv;
+          break;
+        case '&':
+          out += "&amp;"sv;
+          break;
+        case '"':
+          out += "&quot;"sv;
+          break;
+        case '\'':
+          out += "&apos;"sv;
+          break;
+        default:
+          out += ch;
+      }
+    }
+  }
+
+  void
+  begin_document(std::string &out, int status_code) {
+    out += R"(<?xml version="1.0" encoding="utf-8"?>)"sv;
+    out += "\n<root status_code=\""sv;
+    out += std::to_string(status_code);
+    out += "\">"sv;
+  }
+
+  void
+  end_document(std::string &out) {
+    close(out, "root"sv);
+  }
+
+  void
+  open(std::string &out, std::string_view name) {
+    out += '<';
+    out += name;
+    out += '>';
+  }
+
+  void
+  close(std::string &out, std::string_view name) {
+    out += "</"sv;
+    out += name;
+    out += '>';
+  }
+
+  void
+  element(std::string &out, std::string_view name, std::string_view value) {
+    // An element without a value is written as an empty-element tag
+    if (value.empty()) {
+      out += '<';
+      out += name;
+      out += "/>"sv;
+
+      return;
+    }
+
+    open(out, name);
+    escape(out, value);
+    close(out, name);
+  }
+}  // namespace xml
@@ -0,0 +1,87 @@
+/**
+ * @file src/xml_writer.h
+ * @brief Declarations for writing XML responses without building a property tree.
+ */
+#pragma once
+
+// standard includes
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Appends XML to a string, formatted the way `boost::property_tree::write_xml()` formats it.
+ * @details Moonlight parses the GameStream responses leniently, but matching the output of
+ * `write_xml()` byte for byte keeps responses written with either one interchangeable.
+ */
+namespace xml {
+  /**
+   * @brief Append text, escaping the characters that are special in XML.
+   * @param out The document to append to.
+   * @param text The text to escape.
+   */
+  void
+  escape(std::string &out, std::string_view text);
+
+  /**
+   * @brief Append the XML declaration and the opening tag of the root element.
+   * @param out The document to append to.
+   * @param status_code The value of the `status_code` attribute of the root element.
+   */
+  void
+  begin_document(std::string &out, int status_code);
+
+  /**
+   * @brief Append the closing tag of the root element.
+   * @param out The document to append to.
+   */
+  void
+  end_document(std::string &out);
+
+  /**
+   * @brief Append the opening tag of an element that contains other elements.
+   * @param out The document to append to.
+   * @param name The name of the element.
+   */
+  void
+  open(std::string &out, std::string_view name);
+
+  /**
+   * @brief Append the closing tag of an element that contains other elements.
+   * @param out The document to append to.
+   * @param name The name of the element.
+   */
+  void
+  close(std::string &out, std::string_view name);
+
+  /**
+   * @brief Append an element with a text value.
+   * @param out The document to append to.
+   * @param name The name of the element.
+   * @param value The value, it's escaped.
+   * @examples
+   * std::string out;
+   * xml::element(out, "hostname", "Sunshine");  // <hostname>Sunshine</hostname>
+   * @examples_end
+   */
+  void
+  element(std::string &out, std::string_view name, std::string_view value);
+
+  /**
+   * @brief Append an element with a numeric or boolean value.
+   */
+  template <class T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+  void
+  element(std::string &out, std::string_view name, T value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      element(out, name, std::string_view { value ? "true" : "false" });
+    }
+    else {
+      char buffer[24];
+      auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+
+      element(out, name, std::string_view { buffer, (std::size_t) (result.ptr - buffer) });
+    }
+  }
+}  // namespace xml
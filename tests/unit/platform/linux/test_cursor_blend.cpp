@@ -0,0 +1,100 @@
+/**
+ * @file tests/unit/platform/linux/test_cursor_blend.cpp
+ * @brief Test src/platform/linux/cursor_blend.*.
+ */
+#ifdef __linux__
+  #include <src/platform/linux/cursor_blend.h>
+
+  #include "../../../tests_common.h"
+
+namespace {
+  std::uint32_t
+  bgra(std::uint8_t b, std::uint8_t g, std::uint8_t r, std::uint8_t a) {
+    return b | (g << 8) | (r << 16) | ((std::uint32_t) a << 24);
+  }
+
+  struct test_img_t: public platf::img_t {
+    test_img_t(int width, int height, std::uint32_t fill) {
+      pixels.resize(width * height, fill);
+      this->data = (std::uint8_t *) pixels.data();
+      this->width = width;
+      this->height = height;
+      this->pixel_pitch = 4;
+      this->row_pitch = width * 4;
+    }
+
+    ~test_img_t() override {
+      data = nullptr;
+    }
+
+    std::vector<std::uint32_t> pixels;
+  };
+}  // namespace
+
+TEST(CursorBlendTest, SimdMatchesScalar) {
+  // An odd length exercises the scalar tail of the SIMD paths
+  constexpr int count = 67;
+
+  std::vector<std::uint32_t> src(count), dst(count);
+  std::uint32_t seed = 1;
+  for (int x = 0; x < count; ++x) {
+    seed = seed * 1103515245 + 12345;
+    std::uint8_t alpha = (seed >> 24) & 0xFF;
+
+    // Premultiplied colors never exceed alpha
+    src[x] = (x % 9 == 0) ? 0 : bgra(alpha / 2, alpha / 3, alpha, alpha);
+    dst[x] = seed ^ (seed << 7);
+  }
+  src[1] = bgra(10, 20, 30, 255);
+
+  auto expected = dst;
+  platf::cursor::blend_row_scalar(expected.data(), src.data(), count);
+  platf::cursor::blend_row(dst.data(), src.data(), count);
+
+  ASSERT_EQ(dst, expected);
+  ASSERT_EQ(dst[1], src[1]);
+}
+
+TEST(CursorBlendTest, HalfTransparent) {
+  std::uint32_t dst = bgra(200, 100, 0, 255);
+  std::uint32_t src = bgra(64, 0, 128, 128);
+
+  platf::cursor::blend_row_scalar(&dst, &src, 1);
+
+  // 64 + 200 * 127 / 255, 0 + 100 * 127 / 255, 128 + 0
+  ASSERT_EQ(dst, bgra(164, 50, 128, 255));
+}
+
+TEST(CursorBlendTest, OverlayClipsAndCrops) {
+  // A 4x4 cursor with a single opaque pixel at (2, 1)
+  std::vector<std::uint32_t> cursor(16, 0);
+  cursor[1 * 4 + 2] = bgra(1, 2, 3, 255);
+
+  platf::cursor::overlay_t overlay;
+  ASSERT_TRUE(overlay.stale(1));
+  overlay.update(1, cursor.data(), 4, 4, 4, 4, 4);
+  ASSERT_FALSE(overlay.stale(1));
+
+  test_img_t img { 8, 8, bgra(9, 9, 9, 255) };
+  overlay.blend(img, -2, 6);
+  ASSERT_EQ(img.pixels[7 * 8 + 0], bgra(1, 2, 3, 255));
+  ASSERT_EQ(std::count(std::begin(img.pixels), std::end(img.pixels), bgra(9, 9, 9, 255)), 63);
+
+  // Entirely off screen
+  test_img_t untouched { 8, 8, 0 };
+  overlay.blend(untouched, -3, 0);
+  overlay.blend(untouched, 7, 7);
+  ASSERT_EQ(std::count(std::begin(untouched.pixels), std::end(untouched.pixels), 0), 64);
+}
+
+TEST(CursorBlendTest, OverlayScales) {
+  std::vector<std::uint32_t> cursor(4, bgra(255, 255, 255, 255));
+
+  platf::cursor::overlay_t overlay;
+  overlay.update(1, cursor.data(), 2, 2, 2, 4, 4);
+
+  test_img_t img { 4, 4, 0 };
+  overlay.blend(img, 0, 0);
+  ASSERT_EQ(std::count(std::begin(img.pixels), std::end(img.pixels), bgra(255, 255, 255, 255)), 16);
+}
+#endif
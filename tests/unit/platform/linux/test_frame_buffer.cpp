@@ -0,0 +1,211 @@
+/**
+ * @file tests/unit/platform/linux/test_frame_buffer.cpp
+ * @brief Test src/platform/linux/frame_buffer.*.
+ */
+#ifdef __linux__
+  #include <src/platform/linux/frame_buffer.h>
+
+  #include "../../../tests_common.h"
+
+  #include <chrono>
+  #include <cstring>
+  #include <memory>
+
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+
+using namespace std::literals;
+
+namespace {
+  constexpr int width = 3840;
+  constexpr int height = 2160;
+
+  /**
+   * @brief Count the data TLB misses of the calling thread, if the kernel lets us.
+   */
+  class tlb_misses_t {
+  public:
+    tlb_misses_t() {
+      perf_event_attr attr {};
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.size = sizeof(attr);
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~tlb_misses_t() {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+
+    void
+    start() {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+
+    /**
+     * @return The misses since `start()`, or -1 if they can't be counted.
+     */
+    long long
+    stop() {
+      long long count = -1;
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+          count = -1;
+        }
+      }
+
+      return count;
+    }
+
+  private:
+    int fd;
+  };
+
+  /**
+   * @brief Convert a BGRA frame to the luma plane of NV12, the way a software encoder's input is prepared.
+   */
+  void
+  convert_luma(const std::uint8_t *bgra, std::uint8_t *luma) {
+    // Column by column, like a vertical filter pass, so each row lands on another page
+    for (int x = 0; x < width; x += 16) {
+      for (int y = 0; y < height; ++y) {
+        auto src = bgra + ((std::size_t) y * width + x) * 4;
+        auto dst = luma + (std::size_t) y * width + x;
+
+        for (int i = 0; i < 16; ++i) {
+          auto b = src[i * 4], g = src[i * 4 + 1], r = src[i * 4 + 2];
+          dst[i] = (std::uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Fill a BGRA frame with a gradient, so every pixel converts to another luma value than its neighbours.
+   */
+  void
+  fill_gradient(std::uint8_t *bgra) {
+    for (std::size_t x = 0; x < (std::size_t) width * height * 4; ++x) {
+      bgra[x] = (std::uint8_t) (x * 7 + x / (width * 4));
+    }
+  }
+
+  /**
+   * @return The duration of a conversion, averaged over a few frames.
+   */
+  std::chrono::nanoseconds
+  time_conversion(const std::uint8_t *bgra, std::uint8_t *luma) {
+    constexpr int frames = 10;
+
+    // Fault in the pages first
+    convert_luma(bgra, luma);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int x = 0; x < frames; ++x) {
+      convert_luma(bgra, luma);
+    }
+
+    return (std::chrono::steady_clock::now() - start) / frames;
+  }
+}  // namespace
+
+TEST(FrameBufferTest, AlignsBuffers) {
+  auto before = platf::frame_buffer::stats();
+
+  {
+    platf::frame_buffer::buffer_t small { 1000 };
+    platf::frame_buffer::buffer_t frame { (std::size_t) width * height * 4 };
+
+    ASSERT_EQ(small.backing(), platf::frame_buffer::backing_e::heap);
+    ASSERT_EQ((std::uintptr_t) small.data() % platf::frame_buffer::alignment, 0);
+
+    ASSERT_NE(frame.backing(), platf::frame_buffer::backing_e::heap);
+    ASSERT_EQ((std::uintptr_t) frame.data() % platf::frame_buffer::huge_page_size, 0);
+    ASSERT_EQ(frame.size(), (std::size_t) width * height * 4);
+
+    // Every byte is writable
+    std::memset(frame.data(), 0xFF, frame.size());
+
+    auto stats = platf::frame_buffer::stats();
+    ASSERT_EQ(stats.buffers, before.buffers + 2);
+    ASSERT_GE(stats.bytes, before.bytes + frame.size() + small.size());
+    ASSERT_GE(stats.transparent_huge_page_bytes + stats.pinned_bytes, frame.size());
+
+    // Moving hands over the memory
+    auto moved = std::move(frame);
+    ASSERT_EQ(frame.data(), nullptr);
+    ASSERT_EQ(platf::frame_buffer::stats().buffers, before.buffers + 2);
+  }
+
+  auto after = platf::frame_buffer::stats();
+  ASSERT_EQ(after.buffers, before.buffers);
+  ASSERT_EQ(after.bytes, before.bytes);
+}
+
+TEST(FrameBufferTest, ConvertsLikeHeapMemory) {
+  auto expected_bgra = std::make_unique<std::uint8_t[]>((std::size_t) width * height * 4);
+  auto expected_luma = std::make_unique<std::uint8_t[]>((std::size_t) width * height);
+  fill_gradient(expected_bgra.get());
+  convert_luma(expected_bgra.get(), expected_luma.get());
+
+  platf::frame_buffer::buffer_t bgra { (std::size_t) width * height * 4 };
+  platf::frame_buffer::buffer_t luma { (std::size_t) width * height };
+  fill_gradient(bgra.data());
+  convert_luma(bgra.data(), luma.data());
+
+  ASSERT_EQ(std::memcmp(expected_luma.get(), luma.data(), luma.size()), 0);
+}
+
+/**
+ * @brief Compare converting a 4K frame in memory from `new[]` with converting it in frame buffers.
+ * @details Reports the data TLB misses too, where `perf_event_open()` is permitted.
+ * Run with `--gtest_also_run_disabled_tests`.
+ */
+TEST(FrameBufferTest, DISABLED_ConversionBenchmark) {
+  auto heap_bgra = std::make_unique<std::uint8_t[]>((std::size_t) width * height * 4);
+  auto heap_luma = std::make_unique<std::uint8_t[]>((std::size_t) width * height);
+  platf::frame_buffer::buffer_t bgra { (std::size_t) width * height * 4 };
+  platf::frame_buffer::buffer_t luma { (std::size_t) width * height };
+  ASSERT_NE(bgra.backing(), platf::frame_buffer::backing_e::heap);
+
+  fill_gradient(heap_bgra.get());
+  fill_gradient(bgra.data());
+
+  tlb_misses_t tlb_misses;
+
+  tlb_misses.start();
+  auto heap = time_conversion(heap_bgra.get(), heap_luma.get());
+  auto heap_misses = tlb_misses.stop();
+
+  tlb_misses.start();
+  auto frame_buffer = time_conversion(bgra.data(), luma.data());
+  auto frame_buffer_misses = tlb_misses.stop();
+
+  ASSERT_EQ(std::memcmp(heap_luma.get(), luma.data(), luma.size()), 0);
+  ASSERT_GT(heap.count(), 0);
+  ASSERT_GT(frame_buffer.count(), 0);
+
+  auto us = [](auto duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  };
+
+  std::cout << "BGRA to luma per 4K frame: "
+            << us(heap) << "us in new[], " << us(frame_buffer) << "us in frame buffers" << std::endl;
+  if (heap_misses >= 0 && frame_buffer_misses >= 0) {
+    std::cout << "dTLB misses over the frames: "
+              << heap_misses << " in new[], " << frame_buffer_misses << " in frame buffers" << std::endl;
+  }
+}
+#endif
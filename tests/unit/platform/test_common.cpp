@@ -5,6 +5,7 @@
 #include <src/platform/common.h>
 
 #include <boost/asio/ip/host_name.hpp>
+#include <boost/asio/ip/udp.hpp>
 
 #include "../../tests_common.h"
 
@@ -54,3 +55,69 @@ TEST(HostnameTests, TestAsioEquality) {
   // These should be equivalent on all platforms for ASCII hostnames
   ASSERT_EQ(platf::get_host_name(), boost::asio::ip::host_name());
 }
+
+TEST(SendBatchTests, DepartureTimeSpacesBatches) {
+  using namespace std::literals;
+  using boost::asio::ip::udp;
+
+  boost::asio::io_context io_context;
+  udp::socket sender { io_context, udp::endpoint { boost::asio::ip::address_v4::loopback(), 0 } };
+  udp::socket receiver { io_context, udp::endpoint { boost::asio::ip::address_v4::loopback(), 0 } };
+
+  if (!platf::enable_socket_txtime(sender.native_handle())) {
+    GTEST_SKIP() << "Departure times aren't supported on this platform";
+  }
+
+  constexpr auto packet_size = 64;
+  constexpr auto packet_count = 4;
+  constexpr auto spacing = 10ms;
+
+  std::vector<char> payload(packet_size * packet_count, 'x');
+  std::vector<platf::buffer_descriptor_t> payload_buffers;
+  payload_buffers.emplace_back(payload.data(), payload.size());
+
+  auto target_address = receiver.local_endpoint().address();
+  auto source_address = sender.local_endpoint().address();
+
+  auto start = std::chrono::steady_clock::now() + spacing;
+  for (int x = 0; x < packet_count; ++x) {
+    auto batch_info = platf::batched_send_info_t {
+      nullptr,
+      0,
+      payload_buffers,
+      packet_size,
+      (size_t) x,
+      1,
+      (uintptr_t) sender.native_handle(),
+      target_address,
+      receiver.local_endpoint().port(),
+      source_address,
+    };
+    batch_info.departure_time = start + spacing * x;
+
+    ASSERT_TRUE(platf::send_batch(batch_info));
+  }
+
+  std::vector<std::chrono::steady_clock::time_point> arrivals;
+  auto deadline = std::chrono::steady_clock::now() + 1s;
+  while (arrivals.size() < packet_count && std::chrono::steady_clock::now() < deadline) {
+    if (!receiver.available()) {
+      std::this_thread::sleep_for(100us);
+      continue;
+    }
+
+    char buffer[packet_size];
+    ASSERT_EQ(receiver.receive(boost::asio::buffer(buffer)), packet_size);
+    arrivals.emplace_back(std::chrono::steady_clock::now());
+  }
+  ASSERT_EQ(arrivals.size(), packet_count);
+
+  // Only the fq qdisc enforces departure times, loopback has no qdisc by default
+  if (arrivals.back() - arrivals.front() < spacing * (packet_count - 1) / 2) {
+    GTEST_SKIP() << "The loopback qdisc doesn't enforce departure times, attach fq to lo to verify the spacing";
+  }
+
+  for (int x = 1; x < packet_count; ++x) {
+    ASSERT_GE(arrivals[x] - arrivals[0], spacing * x - 1ms);
+  }
+}
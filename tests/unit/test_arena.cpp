@@ -0,0 +1,204 @@
+/**
+ * @file tests/unit/test_arena.cpp
+ * @brief Test src/arena.*.
+ */
+#include <src/arena.h>
+#include <src/fec.h>
+
+#include "../tests_common.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+  // Counts the heap allocations of the thread that sets it, whoever makes them
+  thread_local bool count_allocations = false;
+  thread_local std::size_t allocations = 0;
+
+  void *
+  counted_allocate(std::size_t size, std::size_t alignment) {
+    if (count_allocations) {
+      ++allocations;
+    }
+
+    size = std::max<std::size_t>(size, 1);
+#ifdef _WIN32
+    auto data = alignment ? _aligned_malloc(size, alignment) : std::malloc(size);
+#else
+    // aligned_alloc() wants a multiple of the alignment
+    auto data = alignment ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : std::malloc(size);
+#endif
+    if (!data) {
+      throw std::bad_alloc {};
+    }
+
+    return data;
+  }
+
+  void
+  counted_free(void *data, bool aligned) {
+#ifdef _WIN32
+    if (aligned) {
+      _aligned_free(data);
+      return;
+    }
+#endif
+    std::free(data);
+  }
+}  // namespace
+
+void *
+operator new(std::size_t size) {
+  return counted_allocate(size, 0);
+}
+
+void *
+operator new[](std::size_t size) {
+  return counted_allocate(size, 0);
+}
+
+void *
+operator new(std::size_t size, std::align_val_t alignment) {
+  return counted_allocate(size, (std::size_t) alignment);
+}
+
+void *
+operator new[](std::size_t size, std::align_val_t alignment) {
+  return counted_allocate(size, (std::size_t) alignment);
+}
+
+void
+operator delete(void *data) noexcept {
+  counted_free(data, false);
+}
+
+void
+operator delete[](void *data) noexcept {
+  counted_free(data, false);
+}
+
+void
+operator delete(void *data, std::size_t) noexcept {
+  counted_free(data, false);
+}
+
+void
+operator delete[](void *data, std::size_t) noexcept {
+  counted_free(data, false);
+}
+
+void
+operator delete(void *data, std::align_val_t) noexcept {
+  counted_free(data, true);
+}
+
+void
+operator delete[](void *data, std::align_val_t) noexcept {
+  counted_free(data, true);
+}
+
+void
+operator delete(void *data, std::size_t, std::align_val_t) noexcept {
+  counted_free(data, true);
+}
+
+void
+operator delete[](void *data, std::size_t, std::align_val_t) noexcept {
+  counted_free(data, true);
+}
+
+TEST(ArenaTest, AllocatesAlignedBuffers) {
+  arena::arena_t arena { 1024 };
+
+  auto a = arena.allocate<char>(3);
+  auto b = arena.allocate<std::uint64_t>(4);
+
+  ASSERT_EQ(a.size(), 3);
+  ASSERT_EQ(b.size(), 4);
+  ASSERT_EQ((std::uintptr_t) a.data() % arena::arena_t::alignment, 0);
+  ASSERT_EQ((std::uintptr_t) b.data() % arena::arena_t::alignment, 0);
+  ASSERT_GE((char *) b.data(), a.data() + a.size());
+
+  ASSERT_TRUE(arena.allocate<char>(0).empty());
+  ASSERT_EQ(arena.heap_allocations(), 1);
+}
+
+TEST(ArenaTest, GrowsToTheHighWaterMark) {
+  arena::arena_t arena { 256 };
+
+  // Overflowing the block is fine until the next reset
+  auto a = arena.allocate<char>(200);
+  auto b = arena.allocate<char>(1000);
+  std::memset(a.data(), 'a', a.size());
+  std::memset(b.data(), 'b', b.size());
+  ASSERT_EQ(arena.heap_allocations(), 2);
+  ASSERT_EQ(arena.capacity(), 256);
+
+  arena.reset();
+  ASSERT_GE(arena.capacity(), arena.high_water());
+  ASSERT_EQ(arena.heap_allocations(), 3);
+
+  // The same cycle fits the block now
+  arena.allocate<char>(200);
+  arena.allocate<char>(1000);
+  arena.reset();
+  ASSERT_EQ(arena.heap_allocations(), 3);
+}
+
+TEST(ArenaTest, OverflowGrowsGeometrically) {
+  arena::arena_t arena { 64 };
+
+  // Every allocation overflows, only the blocks themselves should go to the heap
+  count_allocations = true;
+  allocations = 0;
+  for (int x = 0; x < 1000; ++x) {
+    arena.allocate<char>(128);
+  }
+  count_allocations = false;
+
+  ASSERT_EQ(arena.heap_allocations(), 1001);
+  ASSERT_LT(allocations, 1000 + 20);
+}
+
+TEST(ArenaTest, FramesDontAllocateOnceWarm) {
+  constexpr std::size_t blocksize = 1408;
+  constexpr std::size_t prefixsize = 32;
+
+  std::string idr_frame(blocksize * 200, 'i');
+  std::string frame(blocksize * 20, 'p');
+
+  reed_solomon_init();
+
+  arena::arena_t arena;
+  stream::fec::parity_pool_t pool { 1 };
+  stream::fec::parity_ready_t parity_ready;
+
+  auto send_frame = [&](const std::string &payload) {
+    arena.reset();
+
+    auto copy = arena.allocate<char>(payload.size());
+    std::memcpy(copy.data(), payload.data(), payload.size());
+
+    auto shards = stream::fec::prepare({ copy.data(), copy.size() }, blocksize, 20, 2, prefixsize, arena);
+    pool.submit(shards, parity_ready);
+    parity_ready.wait();
+
+    return shards.data_shards == payload.size() / blocksize && std::memcmp(shards.data(0), payload.data(), blocksize) == 0;
+  };
+
+  // An IDR frame at the start of the stream sizes the arena
+  ASSERT_TRUE(send_frame(idr_frame));
+  ASSERT_TRUE(send_frame(frame));
+
+  auto frames_sent = 0;
+  count_allocations = true;
+  allocations = 0;
+  for (int x = 0; x < 100; ++x) {
+    frames_sent += send_frame(x % 30 ? frame : idr_frame);
+  }
+  count_allocations = false;
+
+  ASSERT_EQ(frames_sent, 100);
+  ASSERT_EQ(allocations, 0);
+}
@@ -0,0 +1,215 @@
+/**
+ * @file tests/unit/test_congestion_controller.cpp
+ * @brief Test src/congestion_controller.*.
+ */
+#include <src/congestion_controller.h>
+
+#include "../tests_common.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+  using clock = stream::congestion::controller_t::clock;
+
+  /**
+   * @brief A step of a bandwidth trace: the bottleneck's capacity from a point in time on.
+   */
+  struct capacity_step_t {
+    std::chrono::seconds from;
+    int kbps;
+  };
+
+  struct sim_result_t {
+    int changes = 0;
+    int last_bitrate = 0;
+    int min_bitrate = 0;
+    int max_bitrate = 0;
+    double mean_bitrate = 0;
+    std::size_t lost_packets = 0;
+    std::size_t sent_packets = 0;
+  };
+
+  /**
+   * @brief Stream 60 FPS video through a bottleneck that follows a bandwidth trace.
+   * @details The bottleneck's buffer holds 100ms worth of its capacity, so a bitrate above
+   * the capacity first builds a queue that shows in the round trip time, then loses packets.
+   * Mirrors what the client and the control stream do: loss is reported every 50ms,
+   * and the controller is updated every 150ms with the current round trip time.
+   */
+  sim_result_t
+  simulate(stream::congestion::controller_t &controller, const std::vector<capacity_step_t> &trace, std::chrono::seconds duration) {
+    constexpr auto frame_time = 1000000us / 60;
+    constexpr int packet_bits = 1400 * 8;
+    constexpr auto base_rtt = 20ms;
+
+    sim_result_t result;
+    result.last_bitrate = result.min_bitrate = result.max_bitrate = controller.current();
+
+    auto start = clock::now();
+    auto next_report = start + 50ms;
+    auto next_update = start + 150ms;
+    int lost_since_report = 0;
+
+    // Bits queued at the bottleneck
+    double queue = 0;
+    auto bitrate = controller.current();
+    int frames = 0;
+
+    for (auto now = start; now < start + duration; now += frame_time) {
+      auto capacity = trace.front().kbps;
+      for (auto &step : trace) {
+        if (now - start >= step.from) {
+          capacity = step.kbps;
+        }
+      }
+
+      // kbps are bits per millisecond
+      auto buffer = capacity * 100.0;
+      queue = std::max(0.0, queue - capacity * (frame_time.count() / 1000.0));
+
+      auto packets = std::max(1, (int) (bitrate * 1000 / 60 / packet_bits));
+      for (int x = 0; x < packets; ++x) {
+        if (queue + packet_bits > buffer) {
+          ++lost_since_report;
+          ++result.lost_packets;
+        }
+        else {
+          queue += packet_bits;
+        }
+      }
+      controller.sent(packets, 1, 0);
+      result.sent_packets += packets;
+
+      if (now >= next_report) {
+        controller.loss_stats(lost_since_report);
+        lost_since_report = 0;
+        next_report += 50ms;
+      }
+
+      if (now >= next_update) {
+        auto rtt = base_rtt + std::chrono::milliseconds { (int) (queue / capacity) };
+        if (auto new_bitrate = controller.update(rtt, now)) {
+          bitrate = *new_bitrate;
+          ++result.changes;
+        }
+        next_update += 150ms;
+      }
+
+      result.last_bitrate = bitrate;
+      result.min_bitrate = std::min(result.min_bitrate, bitrate);
+      result.max_bitrate = std::max(result.max_bitrate, bitrate);
+      result.mean_bitrate += bitrate;
+      ++frames;
+    }
+    result.mean_bitrate /= frames;
+
+    return result;
+  }
+}  // namespace
+
+TEST(CongestionControllerTest, StableLinkKeepsMaximum) {
+  stream::congestion::controller_t controller { 20000, 5000, clock::now() };
+
+  auto result = simulate(controller, { { 0s, 50000 } }, 30s);
+
+  ASSERT_EQ(result.changes, 0);
+  ASSERT_EQ(result.last_bitrate, 20000);
+  ASSERT_EQ(result.lost_packets, 0);
+}
+
+TEST(CongestionControllerTest, CapacityDropConvergesBelowCapacity) {
+  stream::congestion::controller_t controller { 20000, 2000, clock::now() };
+
+  auto result = simulate(controller, { { 0s, 50000 }, { 5s, 8000 } }, 40s);
+
+  ASSERT_LE(result.last_bitrate, 8000);
+  ASSERT_GE(result.last_bitrate, 4000);
+  ASSERT_GE(result.min_bitrate, 2000);
+
+  // Only the first seconds after the drop should lose packets
+  ASSERT_LT((double) result.lost_packets / result.sent_packets, 0.05);
+}
+
+TEST(CongestionControllerTest, RecoversWhenCapacityReturns) {
+  stream::congestion::controller_t controller { 20000, 2000, clock::now() };
+
+  auto result = simulate(controller, { { 0s, 50000 }, { 5s, 8000 }, { 20s, 50000 } }, 80s);
+
+  ASSERT_LT(result.min_bitrate, 8000);
+  ASSERT_EQ(result.last_bitrate, 20000);
+}
+
+TEST(CongestionControllerTest, ConstrainedLinkDoesNotFlap) {
+  stream::congestion::controller_t controller { 20000, 2000, clock::now() };
+
+  auto result = simulate(controller, { { 0s, 12000 } }, 60s);
+
+  // Probing near the capacity is fine, reconfiguring the encoder every other second isn't
+  ASSERT_LT(result.changes, 20);
+  ASSERT_LE(result.mean_bitrate, 12000);
+  ASSERT_GE(result.mean_bitrate, 9000);
+  ASSERT_LT((double) result.lost_packets / result.sent_packets, 0.02);
+}
+
+TEST(CongestionControllerTest, BoundsAreRespected) {
+  auto now = clock::now();
+  stream::congestion::controller_t controller { 10000, 4000, now };
+
+  for (int x = 1; x <= 20; ++x) {
+    controller.sent(100, 1, 0);
+    controller.loss_stats(50);
+    controller.frames_lost();
+    auto bitrate = controller.update(20ms, now + x * 1s);
+    if (bitrate) {
+      ASSERT_GE(*bitrate, 4000);
+    }
+  }
+  ASSERT_EQ(controller.current(), 4000);
+
+  // Nothing is reported while clean at the maximum
+  stream::congestion::controller_t clean { 10000, 4000, now };
+  ASSERT_FALSE(clean.update(20ms, now + 1s));
+  ASSERT_EQ(clean.current(), 10000);
+}
+
+TEST(CongestionControllerTest, RepeatedFrameLossAndQueueingDelayLowerBitrate) {
+  auto now = clock::now();
+
+  // A single lost frame on an otherwise clean path is not congestion
+  stream::congestion::controller_t single { 10000, 1000, now };
+  single.sent(1000, 10, 0);
+  single.frames_lost();
+  ASSERT_FALSE(single.update(20ms, now + 1s));
+  ASSERT_EQ(single.current(), 10000);
+
+  stream::congestion::controller_t repeated { 10000, 1000, now };
+  repeated.sent(1000, 10, 0);
+  for (int x = 0; x < 3; ++x) {
+    repeated.frames_lost();
+  }
+  ASSERT_TRUE(repeated.update(20ms, now + 1s));
+  ASSERT_LT(repeated.current(), 10000);
+
+  stream::congestion::controller_t delayed { 10000, 1000, now };
+  ASSERT_FALSE(delayed.update(20ms, now + 1s));
+  ASSERT_TRUE(delayed.update(100ms, now + 2s));
+  ASSERT_LT(delayed.current(), 10000);
+}
+
+TEST(CongestionControllerTest, ShortSendBatchesLowerBitrate) {
+  auto now = clock::now();
+
+  // Another session's burst holds up a few batches of this one
+  stream::congestion::controller_t burst { 10000, 1000, now };
+  burst.sent(1000, 100, 5);
+  ASSERT_FALSE(burst.update(20ms, now + 1s));
+  ASSERT_EQ(burst.current(), 10000);
+
+  stream::congestion::controller_t blocked { 10000, 1000, now };
+  blocked.sent(1000, 100, 40);
+  ASSERT_TRUE(blocked.update(20ms, now + 1s));
+  ASSERT_LT(blocked.current(), 10000);
+}
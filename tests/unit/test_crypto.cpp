@@ -0,0 +1,176 @@
+/**
+ * @file tests/unit/test_crypto.cpp
+ * @brief Test src/crypto.*
+ */
+#include <src/crypto.h>
+
+#include "../tests_common.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace {
+  const crypto::aes_t key { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+
+  /**
+   * @brief Encrypt with a freshly created and keyed context, the way a packet would be encrypted without context reuse.
+   */
+  int
+  encrypt_cbc_reinit(const std::string_view &plaintext, std::uint8_t *cipher, crypto::aes_t &iv) {
+    crypto::cipher_ctx_t ctx { EVP_CIPHER_CTX_new() };
+    if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_128_cbc(), nullptr, key.data(), iv.data()) != 1) {
+      return -1;
+    }
+
+    int update_outlen, final_outlen;
+    if (EVP_EncryptUpdate(ctx.get(), cipher, &update_outlen, (const std::uint8_t *) plaintext.data(), plaintext.size()) != 1) {
+      return -1;
+    }
+    if (EVP_EncryptFinal_ex(ctx.get(), cipher + update_outlen, &final_outlen) != 1) {
+      return -1;
+    }
+
+    return update_outlen + final_outlen;
+  }
+
+  /**
+   * @brief The CBC encryption as it was before the key schedule was expanded when the session starts.
+   * @details The context is created and keyed by the first packet, later packets only change the IV.
+   */
+  struct baseline_cbc_t {
+    crypto::cipher_ctx_t ctx;
+
+    int
+    encrypt(const std::string_view &plaintext, std::uint8_t *cipher, crypto::aes_t &iv) {
+      if (!ctx) {
+        ctx.reset(EVP_CIPHER_CTX_new());
+        if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_128_cbc(), nullptr, key.data(), iv.data()) != 1) {
+          return -1;
+        }
+      }
+
+      if (EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr, nullptr, iv.data()) != 1) {
+        return -1;
+      }
+
+      int update_outlen, final_outlen;
+      if (EVP_EncryptUpdate(ctx.get(), cipher, &update_outlen, (const std::uint8_t *) plaintext.data(), plaintext.size()) != 1) {
+        return -1;
+      }
+      if (EVP_EncryptFinal_ex(ctx.get(), cipher + update_outlen, &final_outlen) != 1) {
+        return -1;
+      }
+
+      return update_outlen + final_outlen;
+    }
+  };
+
+  void
+  set_audio_iv(crypto::aes_t &iv, std::uint32_t seq) {
+    *(std::uint32_t *) iv.data() = seq;
+  }
+}  // namespace
+
+TEST(CryptoCipherTest, CbcMatchesFreshContext) {
+  crypto::cipher::cbc_t cbc { key, true };
+  crypto::aes_t iv(16);
+
+  std::string plaintext(1400, '\0');
+  for (std::size_t x = 0; x < plaintext.size(); ++x) {
+    plaintext[x] = (char) x;
+  }
+
+  std::vector<std::uint8_t> expected(crypto::cipher::round_to_pkcs7_padded(plaintext.size() + 1));
+  std::vector<std::uint8_t> actual(expected.size());
+
+  for (std::uint32_t seq = 0; seq < 8; ++seq) {
+    set_audio_iv(iv, seq);
+
+    auto size = seq * 150 + 1;
+    auto view = std::string_view { plaintext }.substr(0, size);
+
+    auto expected_size = encrypt_cbc_reinit(view, expected.data(), iv);
+    auto actual_size = cbc.encrypt(view, actual.data(), &iv);
+
+    ASSERT_EQ(expected_size, crypto::cipher::round_to_pkcs7_padded(size + 1));
+    ASSERT_EQ(actual_size, expected_size);
+    ASSERT_TRUE(std::equal(std::begin(expected), std::begin(expected) + expected_size, std::begin(actual)));
+  }
+}
+
+TEST(CryptoCipherTest, GcmRoundTripWithChangingIvSize) {
+  crypto::cipher::gcm_t gcm { key, false };
+
+  const std::string plaintext = "control message";
+  std::vector<std::uint8_t> tagged_cipher(crypto::cipher::round_to_pkcs7_padded(plaintext.size()) + crypto::cipher::tag_size);
+  std::vector<std::uint8_t> decrypted;
+
+  // Control stream V2 uses 12 byte IVs, the legacy protocol 16 byte IVs
+  for (auto iv_size : { 12, 16, 12 }) {
+    crypto::aes_t iv(iv_size);
+    iv[0] = (std::uint8_t) iv_size;
+
+    auto bytes = gcm.encrypt(plaintext, tagged_cipher.data(), &iv);
+    ASSERT_EQ(bytes, plaintext.size());
+
+    std::string_view view { (char *) tagged_cipher.data(), bytes + crypto::cipher::tag_size };
+    ASSERT_EQ(gcm.decrypt(view, decrypted, &iv), 0);
+    ASSERT_EQ(std::string(std::begin(decrypted), std::end(decrypted)), plaintext);
+
+    // A different IV must not authenticate
+    iv[1] = 1;
+    ASSERT_NE(gcm.decrypt(view, decrypted, &iv), 0);
+  }
+}
+
+/**
+ * @brief Compare per-packet CBC encryption with the implementation before key schedules were expanded up front.
+ * @details Both reuse one context for every packet, so the steady state is expected to be on par.
+ * The difference is where the key schedule is expanded, on the first packet or when the session starts.
+ * Run with `--gtest_also_run_disabled_tests`.
+ */
+TEST(CryptoCipherTest, DISABLED_CbcBaselineBenchmark) {
+  constexpr int packets = 20000;
+
+  // Typical Opus frame size for high quality stereo audio
+  std::string plaintext(400, 'a');
+  std::vector<std::uint8_t> expected(crypto::cipher::round_to_pkcs7_padded(plaintext.size() + 1));
+  std::vector<std::uint8_t> actual(expected.size());
+  crypto::aes_t iv(16);
+
+  auto start = std::chrono::steady_clock::now();
+  baseline_cbc_t baseline;
+  set_audio_iv(iv, 0);
+  ASSERT_GT(baseline.encrypt(plaintext, expected.data(), iv), 0);
+  auto baseline_first = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  crypto::cipher::cbc_t cbc { key, true };
+  ASSERT_GT(cbc.encrypt(plaintext, actual.data(), &iv), 0);
+  auto reused_first = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int x = 1; x < packets; ++x) {
+    set_audio_iv(iv, x);
+    ASSERT_GT(baseline.encrypt(plaintext, expected.data(), iv), 0);
+  }
+  auto baseline_steady = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int x = 1; x < packets; ++x) {
+    set_audio_iv(iv, x);
+    ASSERT_GT(cbc.encrypt(plaintext, actual.data(), &iv), 0);
+  }
+  auto reused_steady = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(expected, actual);
+
+  auto ns = [](auto duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  };
+
+  std::cout << "CBC session start and first packet: "
+            << ns(baseline_first) << "ns baseline, " << ns(reused_first) << "ns now" << std::endl
+            << "CBC encrypt per packet: "
+            << ns(baseline_steady) / (packets - 1) << "ns baseline, " << ns(reused_steady) / (packets - 1) << "ns now" << std::endl;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file tests/unit/test_encode_scheduler.cpp
+ * @brief Test src/encode_scheduler.*.
+ */
+#include <src/encode_scheduler.h>
+
+#include "../tests_common.h"
+
+#include <set>
+
+namespace {
+  /**
+   * @brief Make the topology of a host with NUMA nodes of several L3 domains of the same size.
+   */
+  std::vector<platf::cpu_t>
+  make_topology(int numa_nodes, int domains_per_node, int cpus_per_domain) {
+    std::vector<platf::cpu_t> cpus;
+
+    int id = 0;
+    for (int node = 0; node < numa_nodes; ++node) {
+      for (int domain = 0; domain < domains_per_node; ++domain) {
+        for (int x = 0; x < cpus_per_domain; ++x) {
+          cpus.emplace_back(platf::cpu_t { id++, node, node * domains_per_node + domain });
+        }
+      }
+    }
+
+    return cpus;
+  }
+
+  std::set<int>
+  domains_of(const std::vector<int> &cpu_ids, int cpus_per_domain) {
+    std::set<int> domains;
+    for (auto id : cpu_ids) {
+      domains.emplace(id / cpus_per_domain);
+    }
+
+    return domains;
+  }
+}  // namespace
+
+TEST(EncodeSchedulerTest, PartitionsUseWholeDomains) {
+  auto partitions = video::scheduler::partition(make_topology(2, 2, 8), 2);
+
+  ASSERT_EQ(partitions.size(), 2);
+  for (auto &cpu_ids : partitions) {
+    ASSERT_EQ(cpu_ids.size(), 16);
+    ASSERT_EQ(domains_of(cpu_ids, 8).size(), 2);
+
+    // Both domains are on the same NUMA node
+    ASSERT_EQ(domains_of(cpu_ids, 16).size(), 1);
+  }
+
+  // Domains that can't be shared out evenly are still kept whole
+  partitions = video::scheduler::partition(make_topology(1, 3, 4), 2);
+  ASSERT_EQ(partitions[0].size() + partitions[1].size(), 12);
+  ASSERT_EQ(std::min(partitions[0].size(), partitions[1].size()), 4);
+}
+
+TEST(EncodeSchedulerTest, PartitionsSplitDomainsWhenNeeded) {
+  auto partitions = video::scheduler::partition(make_topology(2, 1, 8), 4);
+
+  ASSERT_EQ(partitions.size(), 4);
+
+  std::set<int> used;
+  for (auto &cpu_ids : partitions) {
+    ASSERT_EQ(cpu_ids.size(), 4);
+    ASSERT_EQ(domains_of(cpu_ids, 8).size(), 1);
+    used.insert(std::begin(cpu_ids), std::end(cpu_ids));
+  }
+  ASSERT_EQ(used.size(), 16);
+
+  // More sessions than CPUs still gives everyone a CPU
+  partitions = video::scheduler::partition(make_topology(1, 1, 2), 3);
+  for (auto &cpu_ids : partitions) {
+    ASSERT_EQ(cpu_ids.size(), 1);
+  }
+}
+
+TEST(EncodeSchedulerTest, UnknownTopologyLeavesThreadsAlone) {
+  auto partitions = video::scheduler::partition({}, 2);
+
+  ASSERT_EQ(partitions.size(), 2);
+  ASSERT_TRUE(partitions[0].empty());
+  ASSERT_EQ(video::scheduler::thread_budget(), 0);
+}
+
+TEST(EncodeSchedulerTest, RebalancesWhenSessionsJoinAndLeave) {
+  video::scheduler::scheduler_t scheduler { make_topology(1, 2, 4) };
+
+  auto first = scheduler.join();
+  ASSERT_EQ(first->cpus().size(), 8);
+  ASSERT_TRUE(first->moved());
+
+  {
+    auto second = scheduler.join();
+    ASSERT_EQ(first->cpus().size(), 4);
+    ASSERT_EQ(second->cpus().size(), 4);
+    ASSERT_NE(first->cpus(), second->cpus());
+  }
+
+  ASSERT_EQ(first->cpus().size(), 8);
+}
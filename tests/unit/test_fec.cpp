@@ -0,0 +1,191 @@
+/**
+ * @file tests/unit/test_fec.cpp
+ * @brief Test src/fec.*.
+ */
+#include <src/fec.h>
+
+#include "../tests_common.h"
+
+#include <array>
+#include <random>
+
+using namespace std::literals;
+
+namespace {
+  constexpr size_t blocksize = 1400;
+  constexpr size_t fec_percentage = 20;
+
+  /**
+   * @brief Make a frame of random bytes that fills all FEC blocks, like a 4K IDR frame does.
+   */
+  std::string
+  make_frame() {
+    // The most data shards per block at this FEC percentage, see videoBroadcastThread()
+    constexpr size_t data_shards = (255 * 100) / (100 + fec_percentage);
+
+    std::string frame(data_shards * blocksize * stream::fec::MAX_FEC_BLOCKS, '\0');
+
+    std::mt19937 rng { 1234 };
+    for (auto &c : frame) {
+      c = (char) rng();
+    }
+
+    return frame;
+  }
+
+  std::vector<stream::fec::fec_t>
+  prepare_blocks(const std::string &frame, arena::arena_t &arena) {
+    std::vector<stream::fec::fec_t> blocks;
+
+    auto block_size = frame.size() / stream::fec::MAX_FEC_BLOCKS;
+    for (int x = 0; x < stream::fec::MAX_FEC_BLOCKS; ++x) {
+      blocks.emplace_back(stream::fec::prepare(std::string_view { frame }.substr(x * block_size, block_size), blocksize, fec_percentage, 2, 0, arena));
+    }
+
+    return blocks;
+  }
+
+  void
+  encode_pooled(stream::fec::parity_pool_t &pool, std::vector<stream::fec::fec_t> &blocks) {
+    std::array<stream::fec::parity_ready_t, stream::fec::MAX_FEC_BLOCKS> parity_ready;
+    for (std::size_t x = 0; x < blocks.size(); ++x) {
+      pool.submit(blocks[x], parity_ready[x]);
+    }
+
+    for (auto &ready : parity_ready) {
+      ready.wait();
+    }
+  }
+}  // namespace
+
+class FecTest: public ::testing::Test {
+protected:
+  void
+  SetUp() override {
+    reed_solomon_init();
+  }
+};
+
+TEST_F(FecTest, PoolMatchesInlineParity) {
+  auto frame = make_frame();
+
+  arena::arena_t inline_arena;
+  auto inline_blocks = prepare_blocks(frame, inline_arena);
+  for (auto &block : inline_blocks) {
+    block.encode_parity();
+  }
+
+  stream::fec::parity_pool_t pool { stream::fec::MAX_FEC_BLOCKS };
+  arena::arena_t pooled_arena;
+  auto pooled_blocks = prepare_blocks(frame, pooled_arena);
+  encode_pooled(pool, pooled_blocks);
+
+  for (int x = 0; x < stream::fec::MAX_FEC_BLOCKS; ++x) {
+    auto &expected = inline_blocks[x];
+    auto &actual = pooled_blocks[x];
+
+    ASSERT_EQ(expected.size(), actual.size());
+    ASSERT_GT(actual.size(), actual.data_shards);
+    for (auto y = actual.data_shards; y < actual.size(); ++y) {
+      ASSERT_EQ(std::memcmp(expected.data(y), actual.data(y), blocksize), 0);
+    }
+  }
+}
+
+TEST_F(FecTest, SharesRsHandlesPerShape) {
+  auto rs = stream::fec::rs_for_shape(40, 8);
+  ASSERT_NE(rs, nullptr);
+  ASSERT_EQ(stream::fec::rs_for_shape(40, 8), rs);
+  ASSERT_NE(stream::fec::rs_for_shape(40, 9), rs);
+
+  // A shared handle computes the same parity as a fresh one
+  auto frame = make_frame();
+  arena::arena_t arena;
+  auto block = stream::fec::prepare(std::string_view { frame }.substr(0, 40 * blocksize), blocksize, fec_percentage, 2, 0, arena);
+  ASSERT_EQ(block.size(), 48);
+  block.encode_parity();
+
+  std::vector<uint8_t> parity(8 * blocksize);
+  std::vector<uint8_t *> shards_p { block.shards_p.begin(), block.shards_p.end() };
+  for (auto x = 0; x < 8; ++x) {
+    shards_p[40 + x] = &parity[x * blocksize];
+  }
+  stream::fec::rs_t fresh { reed_solomon_new(40, 8) };
+  reed_solomon_encode(fresh.get(), shards_p.data(), 48, blocksize);
+
+  for (auto x = 0; x < 8; ++x) {
+    ASSERT_EQ(std::memcmp(block.data(40 + x), &parity[x * blocksize], blocksize), 0);
+  }
+}
+
+/**
+ * @brief Compare the parity of a frame computed on the broadcast thread with the parity pool.
+ * @details Run with `--gtest_also_run_disabled_tests`.
+ */
+TEST_F(FecTest, DISABLED_ParallelParityBenchmark) {
+  constexpr int frames = 20;
+
+  auto frame = make_frame();
+  stream::fec::parity_pool_t pool;
+  arena::arena_t arena;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int x = 0; x < frames; ++x) {
+    arena.reset();
+    auto blocks = prepare_blocks(frame, arena);
+    for (auto &block : blocks) {
+      block.encode_parity();
+    }
+  }
+  auto serial = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int x = 0; x < frames; ++x) {
+    arena.reset();
+    auto blocks = prepare_blocks(frame, arena);
+    encode_pooled(pool, blocks);
+  }
+  auto parallel = std::chrono::steady_clock::now() - start;
+
+  auto per_frame = [](auto duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / frames;
+  };
+
+  std::cout << "FEC parity per " << frame.size() / 1024 << " KiB frame: "
+            << per_frame(serial) << "us on the broadcast thread, "
+            << per_frame(parallel) << "us on " << stream::fec::parity_pool_t::default_threads() << " pool threads" << std::endl;
+}
+
+TEST_F(FecTest, InitUsesNamedKernel) {
+  auto &variant = stream::fec::init("default"sv);
+  ASSERT_STREQ(variant.name, "default");
+  ASSERT_EQ(reed_solomon_encode, variant.encode_fn);
+
+  // Unknown kernels fall back to the fastest supported one
+  auto &fastest = stream::fec::init("unknown"sv);
+  ASSERT_TRUE(fastest.supported());
+  ASSERT_EQ(reed_solomon_encode, fastest.encode_fn);
+}
+
+/**
+ * @brief Print the throughput of every supported parity kernel.
+ * @details Run with `--gtest_also_run_disabled_tests`.
+ */
+TEST_F(FecTest, DISABLED_KernelBenchmark) {
+  int count;
+  auto variants = reed_solomon_variants(&count);
+
+  for (auto x = 0; x < count; ++x) {
+    if (!variants[x].supported()) {
+      continue;
+    }
+
+    for (auto &shape : stream::fec::benchmark_shapes()) {
+      auto rate = stream::fec::benchmark(variants[x], shape, 20ms);
+      ASSERT_GT(rate, 0);
+
+      std::cout << variants[x].name << ": " << shape.data_shards << " + " << shape.parity_shards
+                << " shards of " << shape.blocksize << " bytes: " << rate << " GB/s" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,174 @@
+/**
+ * @file tests/unit/test_fec_controller.cpp
+ * @brief Test src/fec_controller.*.
+ */
+#include <src/fec_controller.h>
+
+#include "../tests_common.h"
+
+#include <cmath>
+#include <random>
+
+using namespace std::literals;
+
+namespace {
+  using clock = stream::fec::controller_t::clock;
+
+  /**
+   * @brief Gilbert-Elliott packet loss: a good and a bad state, each with its own loss probability.
+   */
+  struct loss_trace_t {
+    double good_loss;
+    double bad_loss;
+    double good_to_bad;
+    double bad_to_good;
+
+    std::mt19937 rng { 1234 };
+    bool bad = false;
+
+    double
+    uniform() {
+      // std::uniform_real_distribution isn't reproducible across standard libraries
+      return rng() / 4294967296.0;
+    }
+
+    bool
+    lost() {
+      bad = bad ? uniform() >= bad_to_good : uniform() < good_to_bad;
+      return uniform() < (bad ? bad_loss : good_loss);
+    }
+  };
+
+  struct sim_result_t {
+    int unrecoverable_frames = 0;
+    std::size_t data_packets = 0;
+    std::size_t parity_packets = 0;
+    int min_level = 1000;
+    int max_level = 0;
+    int last_level = 0;
+
+    double
+    overhead() const {
+      return (double) parity_packets / data_packets;
+    }
+  };
+
+  /**
+   * @brief Stream 60 FPS video with 40 data packets per frame, about 25 Mbps through a loss trace.
+   * @details Mirrors what the client does: loss is reported every 50ms,
+   * and frames with more lost packets than parity packets are invalidated.
+   */
+  sim_result_t
+  simulate(stream::fec::controller_t &controller, loss_trace_t trace, std::chrono::seconds duration) {
+    constexpr int data_shards = 40;
+    constexpr auto frame_time = 1000000us / 60;
+
+    sim_result_t result;
+
+    auto start = clock::now();
+    auto next_report = start + 50ms;
+    int lost_since_report = 0;
+
+    for (auto now = start; now < start + duration; now += frame_time) {
+      auto level = controller.percentage(now);
+      result.min_level = std::min(result.min_level, level);
+      result.max_level = std::max(result.max_level, level);
+      result.last_level = level;
+
+      // Same rounding as fec::encode()
+      auto parity_shards = std::max((data_shards * level + 99) / 100, controller.min_parity_packets(0));
+
+      int lost = 0;
+      for (int x = 0; x < data_shards + parity_shards; ++x) {
+        lost += trace.lost();
+      }
+
+      controller.sent(data_shards + parity_shards);
+      result.data_packets += data_shards;
+      result.parity_packets += parity_shards;
+      lost_since_report += lost;
+
+      if (lost > parity_shards) {
+        ++result.unrecoverable_frames;
+        controller.frames_lost(now);
+      }
+
+      if (now >= next_report) {
+        controller.loss_stats(lost_since_report, now);
+        lost_since_report = 0;
+        next_report += 50ms;
+      }
+    }
+
+    return result;
+  }
+}  // namespace
+
+TEST(FecControllerTest, CleanLinkFallsToMinimum) {
+  stream::fec::controller_t controller { 20, 5, 50 };
+
+  auto result = simulate(controller, { 0.0, 0.0, 0.0, 1.0 }, 30s);
+
+  ASSERT_EQ(result.unrecoverable_frames, 0);
+  ASSERT_EQ(result.last_level, 5);
+  ASSERT_EQ(result.max_level, 20);
+  ASSERT_LT(result.overhead(), 0.2);
+}
+
+TEST(FecControllerTest, RandomLossRaisesLevel) {
+  stream::fec::controller_t controller { 20, 5, 50 };
+
+  auto result = simulate(controller, { 0.03, 0.03, 0.0, 1.0 }, 30s);
+
+  ASSERT_GT(result.last_level, 5);
+  ASSERT_LE(result.max_level, 50);
+  ASSERT_GE(result.min_level, 5);
+}
+
+TEST(FecControllerTest, BurstyLossBeatsFixedLevel) {
+  // Mostly clean Wi-Fi with short bursts of heavy loss
+  loss_trace_t wifi { 0.002, 0.6, 0.001, 0.2 };
+
+  stream::fec::controller_t fixed { 20, 20, 20 };
+  auto fixed_result = simulate(fixed, wifi, 60s);
+
+  stream::fec::controller_t adaptive { 20, 5, 50 };
+  auto adaptive_result = simulate(adaptive, wifi, 60s);
+
+  ASSERT_EQ(fixed_result.min_level, 20);
+  ASSERT_EQ(fixed_result.max_level, 20);
+  ASSERT_LT(adaptive_result.unrecoverable_frames, fixed_result.unrecoverable_frames);
+  ASSERT_LE(adaptive_result.max_level, 50);
+}
+
+TEST(FecControllerTest, FramesLostRaisesLevelAndParity) {
+  stream::fec::controller_t controller { 10, 5, 50 };
+  auto now = clock::now();
+
+  ASSERT_EQ(controller.min_parity_packets(2), 2);
+
+  controller.frames_lost(now);
+  ASSERT_EQ(controller.min_parity_packets(2), 3);
+  ASSERT_EQ(controller.percentage(now), 15);
+  ASSERT_EQ(controller.current(), 15);
+
+  // The level that failed isn't used again while the link was only briefly clean
+  ASSERT_EQ(controller.percentage(now + stream::fec::controller_t::hold_time + 1s), 15);
+  ASSERT_EQ(controller.min_parity_packets(2), 3);
+
+  // Both are given up after a longer clean period
+  ASSERT_LT(controller.percentage(now + stream::fec::controller_t::parity_step_down_interval), 15);
+  ASSERT_EQ(controller.min_parity_packets(2), 2);
+}
+
+TEST(FecControllerTest, FixedLevelIgnoresLoss) {
+  stream::fec::controller_t controller { 20, 20, 20 };
+  auto now = clock::now();
+
+  controller.sent(100);
+  controller.loss_stats(50, now);
+  controller.frames_lost(now);
+
+  ASSERT_EQ(controller.percentage(now + 1h), 20);
+  ASSERT_EQ(controller.min_parity_packets(1), 1);
+}
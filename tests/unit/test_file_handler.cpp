@@ -88,3 +88,29 @@ TEST(FileHandlerTests, ReadMissingFileTest) {
   // read missing file
   EXPECT_EQ(file_handler::read_file("non-existing-file.txt"), "");
 }
+
+struct FileHandlerReadRangeTest: testing::TestWithParam<std::tuple<std::uintmax_t, std::size_t, std::string>> {};
+
+TEST_P(FileHandlerReadRangeTest, Run) {
+  auto [offset, max_size, expected] = GetParam();
+  constexpr auto fileName = "read_file_range_test.txt";
+  ASSERT_EQ(file_handler::write_file(fileName, "0123456789"), 0);
+  EXPECT_EQ(file_handler::read_file_range(fileName, offset, max_size), expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  FileHandlerTests,
+  FileHandlerReadRangeTest,
+  testing::Values(
+    std::make_tuple(0, 100, "0123456789"),  // whole file
+    std::make_tuple(0, 4, "0123"),  // head
+    std::make_tuple(6, 100, "6789"),  // tail
+    std::make_tuple(3, 2, "34"),  // middle
+    std::make_tuple(10, 100, ""),  // at the end
+    std::make_tuple(20, 100, ""),  // past the end
+    std::make_tuple(0, 0, "")  // empty range
+    ));
+
+TEST(FileHandlerTests, ReadRangeMissingFileTest) {
+  EXPECT_EQ(file_handler::read_file_range("non-existing-file.txt", 0, 100), "");
+}
@@ -0,0 +1,61 @@
+/**
+ * @file tests/unit/test_frame_deadline.cpp
+ * @brief Test src/frame_deadline.*.
+ */
+#include <src/frame_deadline.h>
+
+#include "../tests_common.h"
+
+using namespace std::literals;
+using video::deadline::decision_e;
+
+namespace {
+  using clock = video::deadline::clock;
+
+  constexpr auto frame_interval = std::chrono::nanoseconds { 1s } / 60;
+}  // namespace
+
+TEST(FrameDeadlineTest, FreshCapturesAreEncoded) {
+  video::deadline::policy_t policy { frame_interval };
+
+  auto now = clock::now();
+  ASSERT_EQ(policy.admit(now - 1ms, now), decision_e::encode);
+  ASSERT_EQ(policy.admit(std::nullopt, now), decision_e::encode);
+}
+
+TEST(FrameDeadlineTest, StaleCaptureWaitsForTheNextOne) {
+  video::deadline::policy_t policy { frame_interval };
+
+  // The encoder needs 12ms per frame
+  auto now = clock::now();
+  policy.encoded(1, now, now, now + 12ms);
+
+  // A capture taken 15ms ago can't be done before the next one is due in about 2ms
+  ASSERT_EQ(policy.admit(now - 15ms, now), decision_e::wait_for_newer);
+
+  // The next capture is too far off to wait for
+  ASSERT_EQ(policy.admit(now - 5ms, now), decision_e::encode);
+
+  // Static content, there won't be a next capture
+  ASSERT_EQ(policy.admit(now - 100ms, now), decision_e::encode);
+}
+
+TEST(FrameDeadlineTest, CountsOnTimeLateAndSkippedCaptures) {
+  video::deadline::policy_t policy { frame_interval };
+
+  auto now = clock::now();
+  policy.encoded(1, now, now, now + 5ms);
+  policy.encoded(2, now, now + 5ms, now + 20ms);
+  policy.encoded(5, now, now + 20ms, now + 25ms);
+
+  auto &stats = policy.stats();
+  ASSERT_EQ(stats.on_time, 1);
+  ASSERT_EQ(stats.late, 2);
+  ASSERT_EQ(stats.skipped, 2);
+
+  // A restarted capture thread numbers its captures from the start
+  policy.reset_stats();
+  policy.encoded(1, std::nullopt, now, now + 5ms);
+  ASSERT_EQ(policy.stats().skipped, 0);
+  ASSERT_EQ(policy.stats().on_time, 0);
+}
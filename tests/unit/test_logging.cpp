@@ -7,7 +7,12 @@
 #include "../tests_common.h"
 #include "../tests_log_checker.h"
 
+#include <atomic>
+#include <mutex>
 #include <random>
+#include <thread>
+
+using namespace std::literals;
 
 namespace {
   std::array log_levels = {
@@ -42,3 +47,85 @@ TEST_P(LogLevelsTest, PutMessage) {
 
   ASSERT_TRUE(log_checker::line_contains(log_file, test_message));
 }
+
+struct ParseLogLevelTest: testing::TestWithParam<std::tuple<std::string, int>> {};
+
+TEST_P(ParseLogLevelTest, Run) {
+  auto [line, expected] = GetParam();
+  EXPECT_EQ(logging::parse_log_level(line), expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  Logging,
+  ParseLogLevelTest,
+  testing::Values(
+    std::make_tuple("[2024-01-01 12:00:00.000]: Verbose: message", 0),
+    std::make_tuple("[2024-01-01 12:00:00.000]: Debug: message", 1),
+    std::make_tuple("[2024-01-01 12:00:00.000]: Info: message", 2),
+    std::make_tuple("[2024-01-01 12:00:00.000]: Warning: message", 3),
+    std::make_tuple("[2024-01-01 12:00:00.000]: Error: message", 4),
+    std::make_tuple("[2024-01-01 12:00:00.000]: Fatal: message", 5),
+    std::make_tuple("continuation of a multi-line record", -1),
+    std::make_tuple("[2024-01-01 12:00:00.000]: Unknown: message", -1),
+    std::make_tuple("", -1)));
+
+TEST(LoggingTest, FilterLogLevel) {
+  const std::string log =
+    "tail of a cut record\n"
+    "[2024-01-01 12:00:00.000]: Debug: dropped\n"
+    "dropped continuation\n"
+    "[2024-01-01 12:00:00.000]: Warning: kept\n"
+    "kept continuation\n"
+    "[2024-01-01 12:00:00.000]: Info: dropped\n"
+    "[2024-01-01 12:00:00.000]: Error: kept\n";
+
+  EXPECT_EQ(logging::filter_log_level(log, 3),
+    "tail of a cut record\n"
+    "[2024-01-01 12:00:00.000]: Warning: kept\n"
+    "kept continuation\n"
+    "[2024-01-01 12:00:00.000]: Error: kept\n");
+  EXPECT_EQ(logging::filter_log_level(log, 0), log);
+}
+
+TEST(LoggingTest, LogListener) {
+  std::mutex lines_mutex;
+  std::vector<std::string> lines;
+  auto listener = logging::add_log_listener([&](int log_level, const std::string &line) {
+    std::lock_guard lg { lines_mutex };
+    if (log_level == 3) {
+      lines.emplace_back(line);
+    }
+  });
+
+  BOOST_LOG(warning) << "listened message";
+  logging::log_flush();
+  {
+    std::lock_guard lg { lines_mutex };
+    ASSERT_EQ(lines.size(), 1);
+    EXPECT_EQ(logging::parse_log_level(lines.front()), 3);
+    EXPECT_EQ(log_checker::remove_timestamp_prefix(lines.front()), "Warning: listened message");
+  }
+
+  listener.reset();
+  BOOST_LOG(warning) << "unheard message";
+  logging::log_flush();
+  std::lock_guard lg { lines_mutex };
+  EXPECT_EQ(lines.size(), 1);
+}
+
+TEST(LoggingTest, SlowLogListenerDoesntHoldUpLogging) {
+  std::atomic_int heard = 0;
+  auto listener = logging::add_log_listener([&heard](int log_level, const std::string &line) {
+    std::this_thread::sleep_for(100ms);
+    ++heard;
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  for (int x = 0; x < 5; ++x) {
+    BOOST_LOG(warning) << "slowly listened message";
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 100ms);
+
+  logging::log_flush();
+  EXPECT_EQ(heard, 5);
+}
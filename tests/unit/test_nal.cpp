@@ -0,0 +1,102 @@
+/**
+ * @file tests/unit/test_nal.cpp
+ * @brief Test src/nal.*.
+ */
+#include <src/nal.h>
+
+#include "../tests_common.h"
+
+using namespace std::literals;
+
+namespace {
+  struct replacement_t {
+    std::string_view old;
+    std::string_view _new;
+  };
+
+  std::string
+  join(const std::vector<std::string_view> &segments) {
+    std::string data;
+    for (auto &segment : segments) {
+      data += segment;
+    }
+
+    return data;
+  }
+
+  const std::uint8_t *
+  find(std::string_view data, std::size_t from = 0) {
+    auto begin = (const std::uint8_t *) data.data();
+    return nal::find_start_code(begin + from, begin + data.size());
+  }
+}  // namespace
+
+TEST(NalTest, FindsStartCodes) {
+  auto data = "\x00\x00\x00\x01\x67\x01\x00\x01\x00\x00\x01\x68"sv;
+  auto begin = (const std::uint8_t *) data.data();
+
+  ASSERT_EQ(find(data), begin + 1);
+  ASSERT_EQ(find(data, 4), begin + 8);
+  ASSERT_EQ(find(data, 9), begin + data.size());
+
+  // Too short to hold a start code
+  auto short_data = "\x00\x01"sv;
+  ASSERT_EQ(find(short_data), (const std::uint8_t *) short_data.data() + short_data.size());
+}
+
+TEST(NalTest, ChecksSliceTypes) {
+  // H.264 IDR slice and SPS
+  ASSERT_TRUE(nal::is_vcl(0x65, false));
+  ASSERT_FALSE(nal::is_vcl(0x67, false));
+
+  // HEVC IDR_W_RADL slice and VPS
+  ASSERT_TRUE(nal::is_vcl(0x26, true));
+  ASSERT_FALSE(nal::is_vcl(0x40, true));
+}
+
+TEST(NalTest, SplicesParameterSetsInFrontOfTheSlices) {
+  auto sps = "\x00\x00\x00\x01\x67\x42\x00\x1f"sv;
+  auto pps = "\x00\x00\x01\x68\xce\x3c\x80"sv;
+  auto slice = "\x00\x00\x01\x65\x88\x84\x00\x00\x00\x01\x67\x42\x00\x1f"sv;
+  auto access_unit = std::string { sps } + std::string { pps } + std::string { slice };
+
+  replacement_t replacements[] {
+    { "\x00\x00\x00\x01\x67\x42\x00\x1f"sv, "\x00\x00\x00\x01\x67\x64\x00\x1f\x01"sv },
+  };
+
+  std::vector<std::string_view> segments;
+  ASSERT_EQ(nal::splice_parameter_sets(access_unit, replacements, false, segments), 1);
+
+  // The copy of the SPS behind the first slice is left alone
+  auto expected = std::string { replacements[0]._new } + std::string { pps } + std::string { slice };
+  ASSERT_EQ(join(segments), expected);
+
+  // The slices are not copied
+  ASSERT_EQ(segments.back().data(), access_unit.data() + sps.size());
+}
+
+TEST(NalTest, MatchesWithEitherStartCode) {
+  auto access_unit = "\x00\x00\x00\x01\x40\x01\x0c\x00\x00\x00\x01\x42\x01\x01\x00\x00\x01\x26\x01\xaf"sv;
+
+  replacement_t replacements[] {
+    { "\x00\x00\x01\x40\x01\x0c"sv, "\x00\x00\x01\x40\x01\x0d"sv },
+    { "\x00\x00\x00\x01\x42\x01\x01"sv, "\x00\x00\x00\x01\x42\x01\x02"sv },
+  };
+
+  std::vector<std::string_view> segments;
+  ASSERT_EQ(nal::splice_parameter_sets(access_unit, replacements, true, segments), 2);
+  ASSERT_EQ(join(segments), "\x00\x00\x00\x01\x40\x01\x0d\x00\x00\x00\x01\x42\x01\x02\x00\x00\x01\x26\x01\xaf"sv);
+}
+
+TEST(NalTest, LeavesFramesWithoutParameterSetsAlone) {
+  auto access_unit = "\x00\x00\x00\x01\x65\x88\x84"sv;
+
+  replacement_t replacements[] {
+    { "\x00\x00\x00\x01\x67\x42"sv, "\x00\x00\x00\x01\x67\x64"sv },
+  };
+
+  std::vector<std::string_view> segments;
+  ASSERT_EQ(nal::splice_parameter_sets(access_unit, replacements, false, segments), 0);
+  ASSERT_EQ(segments.size(), 1);
+  ASSERT_EQ(segments.front(), access_unit);
+}
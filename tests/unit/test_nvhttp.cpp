@@ -0,0 +1,323 @@
+/**
+ * @file tests/unit/test_nvhttp.cpp
+ * @brief Test src/nvhttp.*.
+ */
+#include <src/config.h>
+#include <src/httpcommon.h>
+#include <src/network.h>
+#include <src/nvhttp.h>
+#include <src/video.h>
+
+#include "../tests_common.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <openssl/ssl.h>
+
+#include <sstream>
+
+using namespace std::literals;
+namespace pt = boost::property_tree;
+
+namespace {
+  struct connection_t {};
+
+  using ssl_ctx_t = util::safe_ptr<SSL_CTX, SSL_CTX_free>;
+  using ssl_t = util::safe_ptr<SSL, SSL_free>;
+  using ssl_session_t = util::safe_ptr<SSL_SESSION, SSL_SESSION_free>;
+
+  /**
+   * @brief Create an SSL context with a certificate and key, like the HTTPS server and Moonlight have.
+   */
+  ssl_ctx_t
+  make_ctx(const SSL_METHOD *method, const crypto::creds_t &creds) {
+    ssl_ctx_t ctx { SSL_CTX_new(method) };
+
+    auto x509 = crypto::x509(creds.x509);
+    auto pkey = crypto::pkey(creds.pkey);
+    SSL_CTX_use_certificate(ctx.get(), x509.get());
+    SSL_CTX_use_PrivateKey(ctx.get(), pkey.get());
+
+    return ctx;
+  }
+
+  /**
+   * @brief Run a handshake between a client and the server over a pair of in-memory BIOs.
+   * @param session The session to resume, or `nullptr` for a full handshake.
+   * @param server_out The server side of the connection.
+   * @return The client's session after the handshake, including the tickets the server sent.
+   */
+  ssl_session_t
+  handshake(SSL_CTX *server_ctx, SSL_CTX *client_ctx, SSL_SESSION *session, ssl_t &server_out) {
+    ssl_t server { SSL_new(server_ctx) };
+    ssl_t client { SSL_new(client_ctx) };
+
+    BIO *server_bio, *client_bio;
+    BIO_new_bio_pair(&server_bio, 0, &client_bio, 0);
+    SSL_set_bio(server.get(), server_bio, server_bio);
+    SSL_set_bio(client.get(), client_bio, client_bio);
+
+    SSL_set_accept_state(server.get());
+    SSL_set_connect_state(client.get());
+    if (session) {
+      SSL_set_session(client.get(), session);
+    }
+
+    bool server_done = false;
+    bool client_done = false;
+    for (int x = 0; x < 16 && !(server_done && client_done); ++x) {
+      client_done = client_done || SSL_do_handshake(client.get()) == 1;
+      server_done = server_done || SSL_do_handshake(server.get()) == 1;
+    }
+    EXPECT_TRUE(server_done && client_done);
+
+    // With TLS 1.3, session tickets arrive after the handshake
+    char byte;
+    SSL_read(client.get(), &byte, 1);
+
+    // A session of a connection that isn't shut down cleanly can't be resumed
+    SSL_shutdown(client.get());
+    SSL_shutdown(server.get());
+
+    server_out = std::move(server);
+    return ssl_session_t { SSL_get1_session(client.get()) };
+  }
+
+  /**
+   * @brief Build a serverinfo response with a property tree, the way nvhttp did before the responses were cached.
+   * @param client The fields of the client.
+   * @param codec_mode_flags The codec support expected from the current codec modes.
+   */
+  std::string
+  serverinfo_ptree(const nvhttp::serverinfo_client_t &client, std::uint32_t codec_mode_flags) {
+    pt::ptree tree;
+
+    tree.put("root.<xmlattr>.status_code", 200);
+    tree.put("root.hostname", config::nvhttp.sunshine_name);
+    tree.put("root.appversion", nvhttp::VERSION);
+    tree.put("root.GfeVersion", nvhttp::GFE_VERSION);
+    tree.put("root.uniqueid", http::unique_id);
+    tree.put("root.HttpsPort", net::map_port(nvhttp::PORT_HTTPS));
+    tree.put("root.ExternalPort", net::map_port(nvhttp::PORT_HTTP));
+    tree.put("root.MaxLumaPixelsHEVC", video::active_hevc_mode > 1 ? "1869449984" : "0");
+    tree.put("root.mac", client.mac);
+
+    if (client.server_commands) {
+      for (const auto &cmd : config::sunshine.server_cmds) {
+        pt::ptree cmd_node;
+        cmd_node.put_value(cmd.cmd_name);
+        tree.get_child("root").push_back(std::make_pair("ServerCommand", cmd_node));
+      }
+    }
+
+    tree.put("root.Permission", std::to_string(client.permission));
+
+    if (client.virtual_display_driver_ready) {
+      tree.put("root.VirtualDisplayCapable", true);
+      tree.put("root.VirtualDisplayDriverReady", *client.virtual_display_driver_ready);
+    }
+
+    tree.put("root.LocalIP", client.local_ip);
+    tree.put("root.ServerCodecModeSupport", codec_mode_flags);
+    tree.put("root.PairStatus", client.pair_status);
+    tree.put("root.currentgame", client.current_game);
+    tree.put("root.state", client.current_game > 0 ? "SUNSHINE_SERVER_BUSY" : "SUNSHINE_SERVER_FREE");
+
+    std::ostringstream data;
+    pt::write_xml(data, tree);
+
+    return data.str();
+  }
+
+  /**
+   * @brief A request over HTTP, from a client that isn't paired.
+   */
+  nvhttp::serverinfo_client_t
+  unpaired_client() {
+    nvhttp::serverinfo_client_t client;
+    client.mac = "00:00:00:00:00:00";
+    client.local_ip = "192.168.1.2";
+
+    return client;
+  }
+
+  /**
+   * @brief A request over HTTPS, from a paired client with every permission while an app is running.
+   */
+  nvhttp::serverinfo_client_t
+  paired_client() {
+    nvhttp::serverinfo_client_t client;
+    client.mac = "01:23:45:67:89:AB";
+    client.server_commands = true;
+    client.permission = 0x04000000;
+    client.virtual_display_driver_ready = false;
+    client.local_ip = "127.0.0.1";
+    client.pair_status = 1;
+    client.current_game = 2;
+
+    return client;
+  }
+
+  template <class F>
+  double
+  requests_per_second(F &&f, std::chrono::milliseconds duration) {
+    auto start = std::chrono::steady_clock::now();
+    auto end = start;
+
+    std::size_t requests = 0;
+    std::size_t bytes = 0;
+    do {
+      for (int x = 0; x < 100; ++x) {
+        bytes += f().size();
+      }
+      requests += 100;
+
+      end = std::chrono::steady_clock::now();
+    } while (end - start < duration);
+
+    EXPECT_GT(bytes, 0);
+    return requests / std::chrono::duration<double>(end - start).count();
+  }
+}  // namespace
+
+/**
+ * @brief Restores what the cached serverinfo parts are rendered from after each test.
+ */
+class ServerinfoTest: public ::testing::Test {
+protected:
+  void
+  SetUp() override {
+    sunshine_name = config::nvhttp.sunshine_name;
+    server_cmds = config::sunshine.server_cmds;
+    hevc_mode = video::active_hevc_mode;
+    av1_mode = video::active_av1_mode;
+    yuv444 = video::last_encoder_probe_supported_yuv444_for_codec;
+
+    config::nvhttp.sunshine_name = "Sunshine & <Friends>";
+    config::sunshine.server_cmds.clear();
+    config::sunshine.server_cmds.emplace_back("Sleep"s, "systemctl suspend"s, false);
+    config::sunshine.server_cmds.emplace_back("Restart"s, "reboot"s, true);
+    video::active_hevc_mode = 1;
+    video::active_av1_mode = 1;
+    video::last_encoder_probe_supported_yuv444_for_codec = { false, false, false };
+  }
+
+  void
+  TearDown() override {
+    config::nvhttp.sunshine_name = sunshine_name;
+    config::sunshine.server_cmds = server_cmds;
+    video::active_hevc_mode = hevc_mode;
+    video::active_av1_mode = av1_mode;
+    video::last_encoder_probe_supported_yuv444_for_codec = yuv444;
+  }
+
+private:
+  std::string sunshine_name;
+  std::vector<config::server_cmd_t> server_cmds;
+  int hevc_mode;
+  int av1_mode;
+  std::array<bool, 3> yuv444;
+};
+
+TEST(NvhttpTest, ConnectionTableFindsOpenConnections) {
+  nvhttp::connection_table_t<connection_t> table;
+
+  boost::asio::ip::tcp::endpoint first { boost::asio::ip::make_address("192.168.1.2"), 50000 };
+  boost::asio::ip::tcp::endpoint second { boost::asio::ip::make_address("192.168.1.2"), 50001 };
+
+  auto first_connection = std::make_shared<connection_t>();
+  auto second_connection = std::make_shared<connection_t>();
+  table.add(first, first_connection);
+  table.add(second, second_connection);
+
+  ASSERT_EQ(table.find(first), first_connection);
+  ASSERT_EQ(table.find(second), second_connection);
+  ASSERT_EQ(table.find({ boost::asio::ip::make_address("192.168.1.3"), 50000 }), nullptr);
+
+  // A closed connection isn't found anymore, and dropped when the next connection is added
+  first_connection.reset();
+  ASSERT_EQ(table.find(first), nullptr);
+
+  auto third_connection = std::make_shared<connection_t>();
+  table.add({ boost::asio::ip::make_address("192.168.1.3"), 50000 }, third_connection);
+  ASSERT_EQ(table.size(), 2);
+
+  // A new connection from the endpoint of an old one replaces it
+  auto reused_connection = std::make_shared<connection_t>();
+  table.add(second, reused_connection);
+  ASSERT_EQ(table.find(second), reused_connection);
+}
+
+TEST(NvhttpTest, ResumedSessionKeepsClientCertificate) {
+  auto server_creds = crypto::gen_creds("Sunshine Gamestream Host"sv, 2048);
+  auto client_creds = crypto::gen_creds("NVIDIA GameStream Client"sv, 2048);
+
+  auto server_ctx = make_ctx(TLS_server_method(), server_creds);
+  SSL_CTX_set_verify(server_ctx.get(), SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, [](int, X509_STORE_CTX *) {
+    // Self-signed client certificates are verified against the paired clients after the handshake
+    return 1;
+  });
+  nvhttp::enable_session_resumption(server_ctx.get());
+
+  auto client_ctx = make_ctx(TLS_client_method(), client_creds);
+  SSL_CTX_set_session_cache_mode(client_ctx.get(), SSL_SESS_CACHE_CLIENT);
+
+  ssl_t server;
+  auto session = handshake(server_ctx.get(), client_ctx.get(), nullptr, server);
+  ASSERT_TRUE(session);
+  ASSERT_FALSE(SSL_session_reused(server.get()));
+
+  handshake(server_ctx.get(), client_ctx.get(), session.get(), server);
+  ASSERT_TRUE(SSL_session_reused(server.get()));
+
+  // The certificate of a resumed session is verified again, so it must still be there
+  crypto::x509_t peer {
+#if OPENSSL_VERSION_MAJOR >= 3
+    SSL_get1_peer_certificate(server.get())
+#else
+    SSL_get_peer_certificate(server.get())
+#endif
+  };
+  ASSERT_TRUE(peer);
+  ASSERT_EQ(crypto::pem(peer), client_creds.x509);
+}
+
+TEST_F(ServerinfoTest, MatchesPropertyTree) {
+  for (auto &client : { unpaired_client(), paired_client() }) {
+    auto expected = serverinfo_ptree(client, SCM_H264);
+
+    // The first response may render the cached parts, the second one is built from the cache
+    ASSERT_EQ(nvhttp::serverinfo_response(client), expected);
+    ASSERT_EQ(nvhttp::serverinfo_response(client), expected);
+  }
+}
+
+TEST_F(ServerinfoTest, RendersAgainWhenTheHostChanges) {
+  auto client = paired_client();
+  ASSERT_EQ(nvhttp::serverinfo_response(client), serverinfo_ptree(client, SCM_H264));
+
+  config::nvhttp.sunshine_name = "Renamed";
+  ASSERT_EQ(nvhttp::serverinfo_response(client), serverinfo_ptree(client, SCM_H264));
+
+  // An encoder probe found more codecs
+  video::active_hevc_mode = 3;
+  video::active_av1_mode = 2;
+  video::last_encoder_probe_supported_yuv444_for_codec = { true, true, false };
+
+  auto codec_mode_flags = SCM_H264 | SCM_H264_HIGH8_444 | SCM_HEVC | SCM_HEVC_REXT8_444 | SCM_HEVC_MAIN10 | SCM_HEVC_REXT10_444 | SCM_AV1_MAIN8;
+  ASSERT_EQ(nvhttp::serverinfo_response(client), serverinfo_ptree(client, codec_mode_flags));
+}
+
+/**
+ * @brief Compare serverinfo responses built from a property tree with the ones nvhttp builds from its cache.
+ * @details Run with `--gtest_also_run_disabled_tests`.
+ */
+TEST_F(ServerinfoTest, DISABLED_ServerinfoBenchmark) {
+  auto client = paired_client();
+
+  auto before = requests_per_second([&]() { return serverinfo_ptree(client, SCM_H264); }, 50ms);
+  auto after = requests_per_second([&]() { return nvhttp::serverinfo_response(client); }, 50ms);
+
+  std::cout << "serverinfo: "sv << (int) before << " requests/s with a property tree, "sv
+            << (int) after << " requests/s from the cache"sv << std::endl;
+}
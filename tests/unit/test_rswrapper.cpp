@@ -8,6 +8,9 @@ extern "C" {
 
 #include "../tests_common.h"
 
+#include <algorithm>
+#include <vector>
+
 TEST(ReedSolomonWrapperTests, InitTest) {
   reed_solomon_init();
 
@@ -34,3 +37,53 @@ TEST(ReedSolomonWrapperTests, EncodeTest) {
 
   reed_solomon_release(rs);
 }
+
+TEST(ReedSolomonWrapperTests, VariantsMatchDefaultTest) {
+  int count;
+  auto variants = reed_solomon_variants(&count);
+  ASSERT_GT(count, 0);
+
+  // The last variant is the default one, which is always supported
+  auto &reference = variants[count - 1];
+  ASSERT_STREQ(reference.name, "default");
+  ASSERT_TRUE(reference.supported());
+
+  // Not a multiple of any vector size
+  constexpr int data_shards = 17;
+  constexpr int parity_shards = 5;
+  constexpr int total_shards = data_shards + parity_shards;
+  constexpr int blocksize = 1001;
+
+  std::vector<uint8_t> expected(total_shards * blocksize);
+  for (size_t x = 0; x < expected.size(); ++x) {
+    expected[x] = (uint8_t) (x * 131 + 7);
+  }
+  auto actual = expected;
+
+  std::vector<uint8_t *> expected_p(total_shards);
+  std::vector<uint8_t *> actual_p(total_shards);
+  for (int x = 0; x < total_shards; ++x) {
+    expected_p[x] = &expected[x * blocksize];
+    actual_p[x] = &actual[x * blocksize];
+  }
+
+  reed_solomon_use(&reference);
+  auto rs = reed_solomon_new(data_shards, parity_shards);
+  ASSERT_EQ(reed_solomon_encode(rs, expected_p.data(), total_shards, blocksize), 0);
+  reed_solomon_release(rs);
+
+  for (int x = 0; x < count; ++x) {
+    if (!variants[x].supported()) {
+      continue;
+    }
+
+    std::fill(std::begin(actual) + data_shards * blocksize, std::end(actual), 0);
+
+    reed_solomon_use(&variants[x]);
+    rs = reed_solomon_new(data_shards, parity_shards);
+    ASSERT_EQ(reed_solomon_encode(rs, actual_p.data(), total_shards, blocksize), 0);
+    reed_solomon_release(rs);
+
+    ASSERT_EQ(expected, actual) << variants[x].name;
+  }
+}
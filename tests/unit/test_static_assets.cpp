@@ -0,0 +1,119 @@
+/**
+ * @file tests/unit/test_static_assets.cpp
+ * @brief Test src/static_assets.*.
+ */
+#include <src/file_handler.h>
+#include <src/static_assets.h>
+
+#include "../tests_common.h"
+
+struct StaticAssetsHashedNameTest: testing::TestWithParam<std::tuple<std::string, bool>> {};
+
+TEST_P(StaticAssetsHashedNameTest, Run) {
+  auto [path, expected] = GetParam();
+  EXPECT_EQ(static_assets::is_hashed_name(path), expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  StaticAssetsTests,
+  StaticAssetsHashedNameTest,
+  testing::Values(
+    std::make_tuple("assets/index-BxYz12_a.js", true),
+    std::make_tuple("assets/fa-solid-900-3UVT1fzd.woff2", true),
+    std::make_tuple("assets/index.js", false),
+    std::make_tuple("assets/index-abc.js", false),
+    std::make_tuple("assets/index-BxYz12!a.js", false),
+    std::make_tuple("index-BxYz12_a.js", false),  // not emitted by Vite
+    std::make_tuple("index.html", false)));
+
+struct StaticAssetsNegotiateTest: testing::TestWithParam<std::tuple<std::string, bool, static_assets::encoding_e>> {};
+
+TEST_P(StaticAssetsNegotiateTest, Run) {
+  auto [accept_encoding, has_brotli, expected] = GetParam();
+
+  static_assets::asset_t asset {};
+  asset.identity = "identity";
+  asset.gzip = "gzip";
+  if (has_brotli) {
+    asset.brotli = "br";
+  }
+
+  EXPECT_EQ(static_assets::negotiate(asset, accept_encoding), expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  StaticAssetsTests,
+  StaticAssetsNegotiateTest,
+  testing::Values(
+    std::make_tuple("", true, static_assets::encoding_e::identity),
+    std::make_tuple("gzip, deflate, br", true, static_assets::encoding_e::brotli),
+    std::make_tuple("gzip, deflate, br", false, static_assets::encoding_e::gzip),
+    std::make_tuple("gzip;q=1.0, br;q=0", true, static_assets::encoding_e::gzip),
+    std::make_tuple("gzip;q=0", false, static_assets::encoding_e::identity),
+    std::make_tuple("*", false, static_assets::encoding_e::gzip),
+    std::make_tuple("br;q=0, *", true, static_assets::encoding_e::gzip),
+    std::make_tuple("*, br;q=0", true, static_assets::encoding_e::gzip),
+    std::make_tuple("gzip, *;q=0", true, static_assets::encoding_e::gzip),
+    std::make_tuple("deflate", true, static_assets::encoding_e::identity)));
+
+TEST(StaticAssetsTests, EtagMatches) {
+  EXPECT_TRUE(static_assets::etag_matches("\"abc\"", "\"abc\""));
+  EXPECT_TRUE(static_assets::etag_matches("\"xyz\", W/\"abc\"", "\"abc\""));
+  EXPECT_TRUE(static_assets::etag_matches("*", "\"abc\""));
+  EXPECT_FALSE(static_assets::etag_matches("\"xyz\"", "\"abc\""));
+  EXPECT_FALSE(static_assets::etag_matches("", "\"abc\""));
+}
+
+TEST(StaticAssetsTests, EtagPerEncoding) {
+  static_assets::asset_t asset {};
+  asset.etag = "\"abc\"";
+
+  EXPECT_EQ(asset.etag_for(static_assets::encoding_e::identity), "\"abc\"");
+  EXPECT_EQ(asset.etag_for(static_assets::encoding_e::gzip), "\"abc-gzip\"");
+  EXPECT_EQ(asset.etag_for(static_assets::encoding_e::brotli), "\"abc-br\"");
+  EXPECT_FALSE(static_assets::etag_matches(asset.etag_for(static_assets::encoding_e::gzip), asset.etag));
+}
+
+TEST(StaticAssetsTests, GzipCompress) {
+  std::string data(4096, 'a');
+  auto compressed = static_assets::gzip_compress(data);
+
+  ASSERT_GT(compressed.size(), 2);
+  EXPECT_LT(compressed.size(), data.size());
+  // gzip magic number
+  EXPECT_EQ((std::uint8_t) compressed[0], 0x1f);
+  EXPECT_EQ((std::uint8_t) compressed[1], 0x8b);
+}
+
+TEST(StaticAssetsTests, LoadTable) {
+  const auto web_dir = std::filesystem::path { "static_assets_test" };
+  std::filesystem::create_directories(web_dir / "assets");
+  std::string script(4096, ';');
+  ASSERT_EQ(file_handler::write_file((web_dir / "index.html").string().c_str(), "<html></html>"), 0);
+  ASSERT_EQ(file_handler::write_file((web_dir / "assets/index-BxYz12_a.js").string().c_str(), script), 0);
+  ASSERT_EQ(file_handler::write_file((web_dir / "assets/index-BxYz12_a.js.br").string().c_str(), "br"), 0);
+  ASSERT_EQ(file_handler::write_file((web_dir / "unknown.type").string().c_str(), "skipped"), 0);
+
+  static_assets::asset_table_t table;
+  table.load(web_dir);
+
+  auto page = table.find("index.html");
+  ASSERT_NE(page, nullptr);
+  EXPECT_EQ(page->content_type, "text/html");
+  EXPECT_EQ(page->identity, "<html></html>");
+  EXPECT_FALSE(page->immutable);
+  EXPECT_EQ(page->etag.front(), '"');
+  EXPECT_EQ(page->etag.back(), '"');
+
+  auto asset = table.find("assets/index-BxYz12_a.js");
+  ASSERT_NE(asset, nullptr);
+  EXPECT_TRUE(asset->immutable);
+  EXPECT_EQ(asset->identity, script);
+  EXPECT_FALSE(asset->gzip.empty());
+  EXPECT_EQ(asset->brotli, "br");
+
+  EXPECT_EQ(table.find("assets/index-BxYz12_a.js.br"), nullptr);
+  EXPECT_EQ(table.find("unknown.type"), nullptr);
+
+  std::filesystem::remove_all(web_dir);
+}
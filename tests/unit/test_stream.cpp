@@ -5,12 +5,19 @@
 
 #include <cstdint>
 #include <functional>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace stream {
   std::vector<uint8_t>
   concat_and_insert(uint64_t insert_size, uint64_t slice_size, const std::string_view &data1, const std::string_view &data2);
+
+  std::vector<uint8_t>
+  concat_and_insert(uint64_t insert_size, uint64_t slice_size, std::span<const std::string_view> segments);
+
+  void
+  concat_and_insert(uint64_t insert_size, uint64_t slice_size, std::span<const std::string_view> segments, std::span<uint8_t> result, std::size_t begin, std::size_t end);
 }
 
 #include "../tests_common.h"
@@ -38,3 +45,22 @@ TEST(ConcatAndInsertTests, ConcatSmallStrideTest) {
   auto expected = std::vector<uint8_t> { 0, 'a', 0, 'b', 0, 'c', 0, 'd', 0, 'e' };
   ASSERT_EQ(res, expected);
 }
+
+TEST(ConcatAndInsertTests, ConcatSegmentsTest) {
+  std::string_view segments[] { "ab", "", "c", "defgh" };
+  auto res = stream::concat_and_insert(1, 3, segments);
+  auto expected = std::vector<uint8_t> { 0, 'a', 'b', 'c', 0, 'd', 'e', 'f', 0, 'g', 'h' };
+  ASSERT_EQ(res, expected);
+}
+
+TEST(ConcatAndInsertTests, ConcatInPiecesTest) {
+  std::string_view segments[] { "ab", "", "c", "defgh" };
+  auto expected = stream::concat_and_insert(1, 3, segments);
+
+  // The middle piece starts within the last segment
+  std::vector<uint8_t> res(expected.size(), 0xFF);
+  stream::concat_and_insert(1, 3, segments, res, 4, 8);
+  stream::concat_and_insert(1, 3, segments, res, 0, 4);
+  stream::concat_and_insert(1, 3, segments, res, 8, res.size());
+  ASSERT_EQ(res, expected);
+}
@@ -0,0 +1,92 @@
+/**
+ * @file tests/unit/test_task_pool.cpp
+ * @brief Test src/task_pool.h.
+ */
+#include <src/task_pool.h>
+
+#include "../tests_common.h"
+
+#include <array>
+#include <memory>
+#include <thread>
+
+using namespace std::literals;
+using task_pool_util::TaskPool;
+
+namespace {
+  /**
+   * @brief Run the tasks that are due, in the order the pool hands them out.
+   */
+  void
+  run_ready(TaskPool &pool) {
+    while (auto task = pool.pop()) {
+      task->run();
+    }
+  }
+}  // namespace
+
+TEST(TaskPoolTest, DelayedTasksRunInTimeOrder) {
+  TaskPool pool;
+  std::vector<int> order;
+
+  pool.postDelayed([&]() { order.emplace_back(3); }, 3ms);
+  pool.postDelayed([&]() { order.emplace_back(1); }, 1ms);
+  pool.postDelayed([&]() { order.emplace_back(2); }, 2ms);
+  pool.post([&]() { order.emplace_back(0); });
+
+  ASSERT_TRUE(pool.next());
+  std::this_thread::sleep_until(*pool.next() + 2ms);
+
+  run_ready(pool);
+  ASSERT_EQ(order, (std::vector<int> { 0, 1, 2, 3 }));
+  ASSERT_FALSE(pool.next());
+}
+
+TEST(TaskPoolTest, CancelAndDelayUseStableIds) {
+  TaskPool pool;
+  std::vector<int> order;
+
+  auto first = pool.postDelayed([&]() { order.emplace_back(1); }, 0ms);
+  auto second = pool.postDelayed([&]() { order.emplace_back(2); }, 0ms);
+  auto third = pool.postDelayed([&]() { order.emplace_back(3); }, 0ms);
+
+  // Ids must not collide with the sentinels callers keep in them
+  for (auto id : { first, second, third }) {
+    ASSERT_NE(id, nullptr);
+    ASSERT_NE(id, (TaskPool::task_id_t) 0x01);
+  }
+
+  ASSERT_TRUE(pool.cancel(second));
+  ASSERT_FALSE(pool.cancel(second));
+
+  pool.delay(first, 1h);
+  run_ready(pool);
+  ASSERT_EQ(order, (std::vector<int> { 3 }));
+
+  // The slot of a task that ran is reused, but its old id stays invalid
+  auto fourth = pool.postDelayed([&]() { order.emplace_back(4); }, 1h);
+  ASSERT_NE(fourth, third);
+  ASSERT_FALSE(pool.cancel(third));
+
+  ASSERT_TRUE(pool.cancel(first));
+  ASSERT_TRUE(pool.cancel(fourth));
+  ASSERT_FALSE(pool.next());
+}
+
+TEST(TaskPoolTest, FuturesAndLargeTasksStillWork) {
+  TaskPool pool;
+
+  auto future = pool.push([](int x) { return x * 2; }, 21);
+  auto timer = pool.pushDelayed([]() { return "done"s; }, 0ms);
+
+  // Too large to be stored inline
+  std::array<int, 64> values {};
+  values.back() = 7;
+  auto result = std::make_shared<int>();
+  pool.post([values, result]() { *result = values.back(); });
+
+  run_ready(pool);
+  ASSERT_EQ(future.get(), 42);
+  ASSERT_EQ(timer.future.get(), "done"s);
+  ASSERT_EQ(*result, 7);
+}
@@ -0,0 +1,147 @@
+/**
+ * @file tests/unit/test_thread_pool.cpp
+ * @brief Test src/thread_pool.h.
+ */
+#include <src/thread_pool.h>
+
+#include "../tests_common.h"
+
+#include <atomic>
+#include <future>
+
+using namespace std::literals;
+using thread_pool_util::Strand;
+using thread_pool_util::ThreadPool;
+
+TEST(ThreadPoolTest, StrandRunsTasksInOrder) {
+  ThreadPool pool { 4 };
+  auto strand = pool.strand();
+
+  std::vector<int> order;
+  std::atomic_int running = 0;
+  std::atomic_bool overlapped = false;
+
+  for (int x = 0; x < 1000; ++x) {
+    strand->post([&, x]() {
+      overlapped = overlapped || running++;
+      order.emplace_back(x);
+      --running;
+    });
+  }
+
+  std::promise<void> done;
+  strand->post([&]() { done.set_value(); });
+  ASSERT_EQ(done.get_future().wait_for(10s), std::future_status::ready);
+
+  ASSERT_FALSE(overlapped);
+  ASSERT_EQ(order.size(), 1000);
+  ASSERT_TRUE(std::is_sorted(std::begin(order), std::end(order)));
+
+  // The last task may still be running
+  auto stats = strand->stats();
+  ASSERT_GE(stats.tasks, 1000);
+  ASSERT_EQ(stats.queued, 0);
+  ASSERT_GE(stats.max_queued, 1);
+}
+
+TEST(ThreadPoolTest, StrandsRunInParallel) {
+  ThreadPool pool { 2 };
+  auto first = pool.strand();
+  auto second = pool.strand();
+
+  // The task of the first strand only finishes once the second strand ran its task
+  std::promise<void> second_ran;
+  std::promise<bool> first_done;
+
+  first->post([&]() {
+    first_done.set_value(second_ran.get_future().wait_for(10s) == std::future_status::ready);
+  });
+  second->post([&]() { second_ran.set_value(); });
+
+  ASSERT_TRUE(first_done.get_future().get());
+}
+
+TEST(ThreadPoolTest, TasksPostedFromStrandStayOnIt) {
+  ThreadPool pool { 4 };
+  auto strand = pool.strand();
+
+  std::promise<Strand *> ran_on;
+  std::atomic_bool canceled_ran = false;
+
+  strand->post([&]() {
+    pool.post([&]() {
+      pool.postDelayed([&]() {
+        ran_on.set_value(Strand::current());
+      },
+        1ms);
+    });
+
+    // Due while this task still runs, so it waits in the queue of the strand
+    auto task_id = pool.postDelayed([&]() { canceled_ran = true; }, 0ms);
+    std::this_thread::sleep_for(50ms);
+
+    ASSERT_TRUE(pool.cancel(task_id));
+  });
+
+  ASSERT_EQ(ran_on.get_future().get(), strand.get());
+
+  pool.push([]() {}).wait();
+  ASSERT_FALSE(canceled_ran);
+  ASSERT_EQ(Strand::current(), nullptr);
+}
+
+TEST(ThreadPoolTest, StrandCancelsItsRepeatFromAnotherThread) {
+  ThreadPool pool { 4 };
+
+  for (int x = 0; x < 100; ++x) {
+    auto strand = pool.strand();
+
+    // Only touched on the strand, like the id of a key repeat
+    Strand::task_id_t repeat_id {};
+    std::atomic_int repeats = 0;
+    std::atomic_bool canceled = false;
+    std::atomic_bool ran_after_cancel = false;
+
+    std::function<void()> repeat = [&]() {
+      ran_after_cancel = ran_after_cancel || canceled;
+      ++repeats;
+
+      repeat_id = strand->postDelayed(repeat, 0ms);
+    };
+    strand->post([&]() {
+      repeat_id = strand->postDelayed(repeat, 0ms);
+    });
+
+    while (repeats < 3) {
+      std::this_thread::yield();
+    }
+
+    // Canceled from this thread while the strand keeps reposting on the threads of the pool
+    strand->run_and_wait([&]() {
+      ASSERT_TRUE(strand->cancel(repeat_id));
+      canceled = true;
+    });
+
+    std::this_thread::sleep_for(1ms);
+    ASSERT_FALSE(ran_after_cancel);
+  }
+}
+
+TEST(ThreadPoolTest, StrandRunsAndWaitsOnItself) {
+  ThreadPool pool { 2 };
+  auto strand = pool.strand();
+
+  std::promise<bool> ran_inline;
+  strand->post([&]() {
+    bool ran = false;
+    strand->run_and_wait([&]() {
+      ran = true;
+    });
+
+    ran_inline.set_value(ran);
+  });
+
+  auto future = ran_inline.get_future();
+  ASSERT_EQ(future.wait_for(10s), std::future_status::ready);
+  ASSERT_TRUE(future.get());
+}
@@ -0,0 +1,72 @@
+/**
+ * @file tests/unit/test_thread_safe.cpp
+ * @brief Test src/thread_safe.*.
+ */
+#include <src/thread_safe.h>
+
+#include "../tests_common.h"
+
+#include <set>
+#include <thread>
+
+TEST(RecyclerTest, ReusesObjects) {
+  safe::recycler_t<int, 2> recycler;
+
+  ASSERT_EQ(recycler.take(), nullptr);
+  ASSERT_EQ(recycler.misses(), 1);
+
+  auto a = new int { 1 };
+  auto b = new int { 2 };
+  auto c = new int { 3 };
+  ASSERT_TRUE(recycler.put(a));
+  ASSERT_TRUE(recycler.put(b));
+
+  // A full stash leaves the object to the caller
+  ASSERT_FALSE(recycler.put(c));
+  delete c;
+
+  std::set<int *> taken { recycler.take(), recycler.take() };
+  ASSERT_EQ(taken, (std::set<int *> { a, b }));
+  ASSERT_EQ(recycler.hits(), 2);
+
+  // The stash deletes what's left in it
+  ASSERT_TRUE(recycler.put(a));
+  delete b;
+}
+
+TEST(RecyclerTest, HandsEachObjectToOneThread) {
+  constexpr int threads = 4;
+  constexpr int rounds = 20000;
+
+  safe::recycler_t<std::atomic<int>, 4> recycler;
+  std::atomic<int> owners_seen_twice { 0 };
+
+  std::vector<std::thread> workers;
+  for (int x = 0; x < threads; ++x) {
+    workers.emplace_back([&]() {
+      for (int y = 0; y < rounds; ++y) {
+        auto object = recycler.take();
+        if (!object) {
+          object = new std::atomic<int> { 0 };
+        }
+
+        // Nobody else may hold the object meanwhile
+        if (object->fetch_add(1) != 0) {
+          ++owners_seen_twice;
+        }
+        object->fetch_sub(1);
+
+        if (!recycler.put(object)) {
+          delete object;
+        }
+      }
+    });
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  ASSERT_EQ(owners_seen_twice, 0);
+  ASSERT_EQ(recycler.hits() + recycler.misses(), threads * rounds);
+}
@@ -46,3 +46,38 @@ INSTANTIATE_TEST_SUITE_P(
 TEST_P(EncoderTest, ValidateEncoder) {
   // todo:: test something besides fixture setup
 }
+
+TEST(PacketTest, RecyclesPackets) {
+  auto pool = std::make_shared<video::packet_raw_generic::pool_t>();
+
+  auto packet = video::packet_raw_generic::make(pool);
+  packet->frame_data.assign(1024, 0xAB);
+  packet->channel_data = &packet;
+
+  auto raw = packet.get();
+  ASSERT_EQ(pool->misses(), 1);
+
+  // Releasing the packet hands it back, with the capacity of its data
+  video::packet_t released { std::move(packet) };
+  released.reset();
+
+  auto reused = video::packet_raw_generic::make(pool);
+  ASSERT_EQ(reused.get(), raw);
+  ASSERT_TRUE(reused->frame_data.empty());
+  ASSERT_GE(reused->frame_data.capacity(), 1024);
+  ASSERT_EQ(reused->channel_data, nullptr);
+  ASSERT_EQ(pool->hits(), 1);
+}
+
+TEST(PacketTest, PacketsKeepTheirPoolAlive) {
+  auto pool = std::make_shared<video::packet_raw_generic::pool_t>();
+  std::weak_ptr<video::packet_raw_generic::pool_t> weak_pool = pool;
+
+  // The session ends while its last packet is still queued
+  video::packet_t packet { video::packet_raw_generic::make(pool) };
+  pool.reset();
+  ASSERT_FALSE(weak_pool.expired());
+
+  packet.reset();
+  ASSERT_TRUE(weak_pool.expired());
+}
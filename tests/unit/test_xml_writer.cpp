@@ -0,0 +1,55 @@
+/**
+ * @file tests/unit/test_xml_writer.cpp
+ * @brief Test src/xml_writer.*.
+ */
+#include <src/xml_writer.h>
+
+#include "../tests_common.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include <sstream>
+
+using namespace std::literals;
+namespace pt = boost::property_tree;
+
+namespace {
+  std::string
+  write_ptree(const pt::ptree &tree) {
+    std::ostringstream data;
+    pt::write_xml(data, tree);
+
+    return data.str();
+  }
+}  // namespace
+
+TEST(XmlWriterTest, MatchesPropertyTree) {
+  pt::ptree tree;
+  tree.put("root.<xmlattr>.status_code", 200);
+  tree.put("root.text", "Tom & Jerry's <\"show\">");
+  tree.put("root.spaces", "   ");
+  tree.put("root.empty", "");
+  tree.put("root.number", -42);
+  tree.put("root.flag", true);
+
+  pt::ptree app;
+  app.put("AppTitle", "Desktop");
+  app.put("ID", 1);
+  tree.get_child("root").push_back({ "App", app });
+
+  std::string data;
+  xml::begin_document(data, 200);
+  xml::element(data, "text"sv, "Tom & Jerry's <\"show\">"sv);
+  xml::element(data, "spaces"sv, "   "sv);
+  xml::element(data, "empty"sv, ""sv);
+  xml::element(data, "number"sv, -42);
+  xml::element(data, "flag"sv, true);
+  xml::open(data, "App"sv);
+  xml::element(data, "AppTitle"sv, "Desktop"sv);
+  xml::element(data, "ID"sv, 1);
+  xml::close(data, "App"sv);
+  xml::end_document(data);
+
+  ASSERT_EQ(data, write_ptree(tree));
+}